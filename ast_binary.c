@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "parser.h"
+#include "flat_ast.h"
+#include "ast_binary.h"
+
+static uint64_t align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+//=============================================================================
+// WRITER
+//=============================================================================
+
+// Deduplicating string pool backed by an open-addressing table of offsets.
+// An entry is its 32-bit length, the bytes, and a NUL; offsets point at the
+// bytes.
+typedef struct {
+    char* data;
+    size_t len, cap;
+    uint32_t* slots;
+    size_t slot_count, used;
+} string_pool;
+
+static uint32_t fnv1a(const char* s, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+static uint32_t pool_length(const char* data, uint32_t off) {
+    uint32_t length;
+    memcpy(&length, data + off - sizeof(length), sizeof(length));
+    return length;
+}
+
+static void pool_rehash(string_pool* pool, size_t slot_count) {
+    uint32_t* slots = (uint32_t*)safe_malloc(sizeof(uint32_t) * slot_count);
+    for (size_t i = 0; i < slot_count; i++) slots[i] = AST_BINARY_NONE;
+    for (size_t i = 0; i < pool->slot_count; i++) {
+        uint32_t off = pool->slots[i];
+        if (off == AST_BINARY_NONE) continue;
+        size_t j = fnv1a(pool->data + off, pool_length(pool->data, off)) & (slot_count - 1);
+        while (slots[j] != AST_BINARY_NONE) j = (j + 1) & (slot_count - 1);
+        slots[j] = off;
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_count = slot_count;
+}
+
+static uint32_t pool_intern(string_pool* pool, const char* s, size_t length) {
+    if ((pool->used + 1) * 2 > pool->slot_count) {
+        pool_rehash(pool, pool->slot_count ? pool->slot_count * 2 : 256);
+    }
+    size_t j = fnv1a(s, length) & (pool->slot_count - 1);
+    while (pool->slots[j] != AST_BINARY_NONE) {
+        uint32_t off = pool->slots[j];
+        if (pool_length(pool->data, off) == length && memcmp(pool->data + off, s, length) == 0) return off;
+        j = (j + 1) & (pool->slot_count - 1);
+    }
+    size_t n = sizeof(uint32_t) + length + 1;
+    if (pool->len + n > pool->cap) {
+        size_t cap = pool->cap ? pool->cap : 1024;
+        while (cap < pool->len + n) cap *= 2;
+        char* data = realloc(pool->data, cap);
+        if (!data) exception("realloc failed");
+        pool->data = data;
+        pool->cap = cap;
+    }
+    if (pool->len + n >= AST_BINARY_NONE) exception("AST string pool exceeds 32-bit offsets");
+    uint32_t prefix = (uint32_t)length;
+    memcpy(pool->data + pool->len, &prefix, sizeof(prefix));
+    uint32_t off = (uint32_t)(pool->len + sizeof(prefix));
+    memcpy(pool->data + off, s, length);
+    pool->data[off + length] = '\0';
+    pool->len += n;
+    pool->slots[j] = off;
+    pool->used++;
+    return off;
+}
+
+static int write_padding(FILE* out, uint64_t from, uint64_t to) {
+    static const char zeros[8] = {0};
+    return to > from && fwrite(zeros, 1, to - from, out) != to - from ? -1 : 0;
+}
+
+int ast_binary_write(FILE* out, ast_t* ast, const char* (*tag_name)(tag_t)) {
+    flat_ast_t* fa = flat_ast_from_ast(ast);
+    string_pool pool = {0};
+
+    // Tag table: one entry per distinct tag, in order of first use.
+    ast_binary_tag_t* tags = NULL;
+    uint32_t tag_count = 0, tag_cap = 0;
+    ast_binary_node_t* nodes = (ast_binary_node_t*)safe_malloc(sizeof(ast_binary_node_t) * (fa->count ? fa->count : 1));
+
+    // Tag values are small enum constants; map them to table slots directly.
+    uint32_t* tag_slot = NULL;
+    size_t tag_slot_count = 0;
+
+    for (flat_index_t i = 0; i < fa->count; i++) {
+        tag_t tag = fa->tag[i];
+        uint32_t t = 0;
+        int dense = tag < 65536;
+        if (dense && (size_t)tag >= tag_slot_count) {
+            size_t n = tag_slot_count ? tag_slot_count : 64;
+            while (n <= (size_t)tag) n *= 2;
+            tag_slot = realloc(tag_slot, sizeof(uint32_t) * n);
+            if (!tag_slot) exception("realloc failed");
+            for (size_t k = tag_slot_count; k < n; k++) tag_slot[k] = AST_BINARY_NONE;
+            tag_slot_count = n;
+        }
+        if (dense && tag_slot[tag] != AST_BINARY_NONE) {
+            t = tag_slot[tag];
+        } else {
+            while (t < tag_count && tags[t].tag != (int32_t)tag) t++;
+        }
+        if (t == tag_count) {
+            if (tag_count == tag_cap) {
+                tag_cap = tag_cap ? tag_cap * 2 : 32;
+                tags = realloc(tags, sizeof(ast_binary_tag_t) * tag_cap);
+                if (!tags) exception("realloc failed");
+            }
+            const char* name = tag_name ? tag_name(tag) : NULL;
+            tags[t].tag = (int32_t)tag;
+            tags[t].name = name ? pool_intern(&pool, name, strlen(name)) : AST_BINARY_NONE;
+            tag_count++;
+        }
+        if (dense) tag_slot[tag] = t;
+
+        ast_binary_node_t* n = &nodes[i];
+        n->tag = t;
+        flat_index_t child = fa->first_child[i];
+        n->child = child == FLAT_AST_NIL ? AST_BINARY_NIL : child == FLAT_AST_NONE ? 0 : child - i;
+        n->next = fa->next_sibling[i] == FLAT_AST_NONE ? 0 : fa->next_sibling[i] - i;
+        const char* name = flat_ast_name(fa, i);
+        n->name = name ? pool_intern(&pool, name, flat_ast_name_length(fa, i)) : AST_BINARY_NONE;
+        n->line = fa->span[i].line;
+        n->col = fa->span[i].col;
+    }
+
+    ast_binary_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = AST_BINARY_MAGIC;
+    header.version = AST_BINARY_VERSION;
+    header.node_count = fa->count;
+    header.tag_count = tag_count;
+    header.root = fa->count ? fa->root : AST_BINARY_NONE;
+    header.tags_offset = align8(sizeof(header));
+    header.nodes_offset = align8(header.tags_offset + sizeof(ast_binary_tag_t) * (uint64_t)tag_count);
+    header.strings_offset = align8(header.nodes_offset + sizeof(ast_binary_node_t) * (uint64_t)fa->count);
+    header.strings_size = pool.len;
+
+    int rc = 0;
+    if (fwrite(&header, sizeof(header), 1, out) != 1) rc = -1;
+    if (rc == 0) rc = write_padding(out, sizeof(header), header.tags_offset);
+    if (rc == 0 && tag_count && fwrite(tags, sizeof(ast_binary_tag_t), tag_count, out) != tag_count) rc = -1;
+    if (rc == 0) rc = write_padding(out, header.tags_offset + sizeof(ast_binary_tag_t) * (uint64_t)tag_count, header.nodes_offset);
+    if (rc == 0 && fa->count && fwrite(nodes, sizeof(ast_binary_node_t), fa->count, out) != fa->count) rc = -1;
+    if (rc == 0) rc = write_padding(out, header.nodes_offset + sizeof(ast_binary_node_t) * (uint64_t)fa->count, header.strings_offset);
+    if (rc == 0 && pool.len && fwrite(pool.data, 1, pool.len, out) != pool.len) rc = -1;
+
+    free(nodes);
+    free(tag_slot);
+    free(tags);
+    free(pool.data);
+    free(pool.slots);
+    free_flat_ast(fa);
+    return rc;
+}
+
+//=============================================================================
+// READER
+//=============================================================================
+
+static int link_ok(uint32_t d, uint32_t i, uint32_t count, int allow_nil) {
+    if (d == 0) return 1;
+    if (allow_nil && d == AST_BINARY_NIL) return 1;
+    return d < count - i;
+}
+
+// Whether the section [offset, offset + length) lies within `size` bytes,
+// computed without overflow.
+static int section_ok(uint64_t offset, uint64_t length, uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+// Whether `name` is AST_BINARY_NONE or the offset of a complete pool entry.
+static int name_ok(const char* strings, uint64_t size, uint32_t name) {
+    if (name == AST_BINARY_NONE) return 1;
+    if (name < sizeof(uint32_t) || name > size) return 0;
+    uint32_t length = pool_length(strings, name);
+    return length < size - name && strings[name + length] == '\0';
+}
+
+// Marks the target of the link `d` from node `i`. A node reached twice would
+// be shared, and freed twice, once the image is rebuilt as a tree.
+static int claim_link(uint8_t* linked, uint32_t d, uint32_t i) {
+    if (d == 0 || d == AST_BINARY_NIL) return 1;
+    if (linked[i + d]) return 0;
+    linked[i + d] = 1;
+    return 1;
+}
+
+int ast_image_open(ast_image_t* img, const void* data, size_t size) {
+    const uint8_t* base = (const uint8_t*)data;
+    memset(img, 0, sizeof(*img));
+    if (size < sizeof(ast_binary_header_t) || ((uintptr_t)base & 7) != 0) return -1;
+
+    const ast_binary_header_t* h = (const ast_binary_header_t*)base;
+    if (h->magic != AST_BINARY_MAGIC || h->version != AST_BINARY_VERSION) return -1;
+    if ((h->tags_offset | h->nodes_offset | h->strings_offset) & 7) return -1;
+    // Counts are 32-bit, so the section lengths cannot overflow; the offsets
+    // and strings_size are only trusted after the subtractions below.
+    uint64_t tags_size = sizeof(ast_binary_tag_t) * (uint64_t)h->tag_count;
+    uint64_t nodes_size = sizeof(ast_binary_node_t) * (uint64_t)h->node_count;
+    if (h->tags_offset < sizeof(*h) || !section_ok(h->tags_offset, tags_size, h->nodes_offset)) return -1;
+    if (!section_ok(h->nodes_offset, nodes_size, h->strings_offset)) return -1;
+    if (!section_ok(h->strings_offset, h->strings_size, size)) return -1;
+    if (h->node_count == 0 ? h->root != AST_BINARY_NONE : h->root >= h->node_count) return -1;
+
+    const ast_binary_tag_t* tags = (const ast_binary_tag_t*)(base + h->tags_offset);
+    const ast_binary_node_t* nodes = (const ast_binary_node_t*)(base + h->nodes_offset);
+    const char* strings = (const char*)(base + h->strings_offset);
+    if (h->strings_size > 0 && strings[h->strings_size - 1] != '\0') return -1;
+
+    // Every index must stay inside its section so accessors need no checks.
+    for (uint32_t t = 0; t < h->tag_count; t++) {
+        if (!name_ok(strings, h->strings_size, tags[t].name)) return -1;
+    }
+    // Links only point forward, so they cannot form cycles; they must also
+    // form a tree: every node but the root is the target of exactly one.
+    uint8_t* linked = (uint8_t*)calloc(h->node_count ? h->node_count : 1, 1);
+    if (!linked) exception("calloc failed");
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < h->node_count; i++) {
+        const ast_binary_node_t* n = &nodes[i];
+        ok = n->tag < h->tag_count &&
+             link_ok(n->child, i, h->node_count, 1) && link_ok(n->next, i, h->node_count, 0) &&
+             claim_link(linked, n->child, i) && claim_link(linked, n->next, i) &&
+             name_ok(strings, h->strings_size, n->name);
+    }
+    for (uint32_t i = 0; ok && i < h->node_count; i++) {
+        ok = linked[i] == (i != h->root);
+    }
+    free(linked);
+    if (!ok) return -1;
+
+    img->header = h;
+    img->tags = tags;
+    img->nodes = nodes;
+    img->strings = strings;
+    return 0;
+}
+
+int ast_image_map(ast_image_t* img, const char* path) {
+    memset(img, 0, sizeof(*img));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return -1;
+    if (ast_image_open(img, mapping, (size_t)st.st_size) != 0) {
+        munmap(mapping, (size_t)st.st_size);
+        return -1;
+    }
+    img->mapping = mapping;
+    img->mapping_size = (size_t)st.st_size;
+    return 0;
+}
+
+void ast_image_close(ast_image_t* img) {
+    if (img->mapping) munmap(img->mapping, img->mapping_size);
+    memset(img, 0, sizeof(*img));
+}
+
+ast_t* ast_image_to_ast(const ast_image_t* img) {
+    uint32_t count = img->header->node_count;
+    if (count == 0) return NULL;
+    ast_t** nodes = (ast_t**)safe_malloc(sizeof(ast_t*) * count);
+    for (uint32_t i = 0; i < count; i++) {
+        ast_t* node = new_ast();
+        node->typ = ast_image_tag(img, i);
+        node->line = img->nodes[i].line;
+        node->col = img->nodes[i].col;
+        const char* name = ast_image_name(img, i);
+        node->sym = name ? sym_lookup_n(name, ast_image_name_length(img, i)) : NULL;
+        nodes[i] = node;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const ast_binary_node_t* n = &img->nodes[i];
+        if (n->child == AST_BINARY_NIL) {
+            nodes[i]->child = ensure_ast_nil_initialized();
+        } else if (n->child != 0) {
+            nodes[i]->child = nodes[i + n->child];
+        }
+        if (n->next != 0) nodes[i]->next = nodes[i + n->next];
+    }
+    ast_t* root = nodes[img->header->root];
+    free(nodes);
+    return root;
+}
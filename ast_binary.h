@@ -0,0 +1,119 @@
+#ifndef AST_BINARY_H
+#define AST_BINARY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+
+//=============================================================================
+// Binary AST images
+//=============================================================================
+//
+// A versioned on-disk form of an ast_t tree that can be used in place from an
+// mmap'd file. Layout (native byte order, every section 8-byte aligned):
+//
+//   header | tag table | node records | string pool
+//
+// Nodes are stored in pre-order. A node's child and next links are stored as
+// forward distances from the node itself (0 means "none"), so images are
+// position independent. Symbol names and tag names live once each in the
+// string pool, each preceded by its 32-bit length and followed by a NUL;
+// names may contain NULs of their own.
+
+#define AST_BINARY_MAGIC   0x54534143u  // "CAST"
+#define AST_BINARY_VERSION 2
+
+// Marks a missing node/name index.
+#define AST_BINARY_NONE ((uint32_t)0xFFFFFFFFu)
+// child value of a node whose child is the ast_nil sentinel.
+#define AST_BINARY_NIL  ((uint32_t)0xFFFFFFFFu)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t tag_count;
+    uint32_t root;            // first top-level node, AST_BINARY_NONE if empty
+    uint32_t reserved;
+    uint64_t tags_offset;
+    uint64_t nodes_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+} ast_binary_header_t;
+
+typedef struct {
+    int32_t tag;              // tag_t value when the image was written
+    uint32_t name;            // string pool offset, AST_BINARY_NONE if unnamed
+} ast_binary_tag_t;
+
+typedef struct {
+    uint32_t tag;             // index into the tag table
+    uint32_t child;           // distance to first child, 0 or AST_BINARY_NIL
+    uint32_t next;            // distance to next sibling, 0 if last
+    uint32_t name;            // string pool offset of the bytes, AST_BINARY_NONE if no symbol
+    int32_t line;
+    int32_t col;
+} ast_binary_node_t;
+
+// Writes `ast` (and its siblings) as an image. `tag_name` may be NULL; when
+// given, the tag table records each tag's name for tools built against a
+// different tag numbering. Returns 0 on success, -1 on I/O error.
+int ast_binary_write(FILE* out, ast_t* ast, const char* (*tag_name)(tag_t));
+
+// A read-only view over an image. All pointers alias the underlying bytes.
+typedef struct {
+    const ast_binary_header_t* header;
+    const ast_binary_tag_t* tags;
+    const ast_binary_node_t* nodes;
+    const char* strings;
+    void* mapping;            // non-NULL when created by ast_image_map
+    size_t mapping_size;
+} ast_image_t;
+
+// Validates `size` bytes at `data` and sets up `img` over them (no copy).
+// Returns 0 on success, -1 if the bytes are not a well-formed image.
+int ast_image_open(ast_image_t* img, const void* data, size_t size);
+// Maps the file at `path` read-only and opens it. Returns 0 on success.
+int ast_image_map(ast_image_t* img, const char* path);
+void ast_image_close(ast_image_t* img);
+
+static inline uint32_t ast_image_root(const ast_image_t* img) {
+    return img->header->root;
+}
+
+static inline uint32_t ast_image_child(const ast_image_t* img, uint32_t i) {
+    uint32_t d = img->nodes[i].child;
+    return (d == 0 || d == AST_BINARY_NIL) ? AST_BINARY_NONE : i + d;
+}
+
+static inline uint32_t ast_image_next(const ast_image_t* img, uint32_t i) {
+    uint32_t d = img->nodes[i].next;
+    return d == 0 ? AST_BINARY_NONE : i + d;
+}
+
+static inline tag_t ast_image_tag(const ast_image_t* img, uint32_t i) {
+    return (tag_t)img->tags[img->nodes[i].tag].tag;
+}
+
+static inline const char* ast_image_tag_name(const ast_image_t* img, uint32_t i) {
+    uint32_t name = img->tags[img->nodes[i].tag].name;
+    return name == AST_BINARY_NONE ? NULL : img->strings + name;
+}
+
+static inline const char* ast_image_name(const ast_image_t* img, uint32_t i) {
+    uint32_t name = img->nodes[i].name;
+    return name == AST_BINARY_NONE ? NULL : img->strings + name;
+}
+
+static inline size_t ast_image_name_length(const ast_image_t* img, uint32_t i) {
+    uint32_t name = img->nodes[i].name, length;
+    if (name == AST_BINARY_NONE) return 0;
+    memcpy(&length, img->strings + name - sizeof(length), sizeof(length));
+    return length;
+}
+
+// Rebuilds the top-level sibling list as ast_t nodes owned by the caller.
+ast_t* ast_image_to_ast(const ast_image_t* img);
+
+#endif // AST_BINARY_H
@@ -42,6 +42,14 @@ typedef struct {
     combinator_t* p;
 } optional_args;
 
+typedef struct {
+    combinator_t* p;
+} commit_args;
+
+typedef struct {
+    combinator_t* p;
+} skip_args;
+
 typedef struct {
     combinator_t* open;
     combinator_t* close;
@@ -86,4 +94,35 @@ typedef struct {
     combinator_t** parser_ptr;
 } lazy_args;
 
+// --- Sharing Helpers (parser.c) ---
+
+// intern_combinator() for constructors that fill in a caller-supplied node.
+combinator_t* intern_in_place(combinator_t* ret);
+// Records that a combinator not built through intern_combinator() holds an
+// edge to `child`.
+void combinator_adopt(combinator_t* child);
+// Recounts the edges by which an in-place node's children loop back to it.
+// Called once the node's children are adopted.
+void combinator_note_cycles(combinator_t* comb);
+
+// --- Event Journal Helpers (parser.c) ---
+// All of these do nothing unless the input has an event sink.
+
+// Like save_input_state() for the state a loop takes before each iteration:
+// it replaces the previous iteration's mark, so events of iterations that
+// can no longer be backtracked over reach the sink while the loop runs.
+void save_iteration_state(input_t* in, InputState* state);
+// Journals ENTER/LEAVE of a tagged node spanning `start` to the current
+// position.
+void events_enter(input_t* in, tag_t tag);
+void events_leave(input_t* in, tag_t tag, int start);
+// Journal position, and dropping everything journaled since it.
+size_t events_mark(input_t* in);
+void events_discard(input_t* in, size_t mark);
+// Wraps the events journaled since `mark` in a node built after the fact
+// (an infix or postfix operator around its left operand).
+void events_wrap(input_t* in, size_t mark, tag_t tag, int start);
+// A commit() point succeeded: nothing journaled so far can be rolled back.
+void events_commit(input_t* in);
+
 #endif // COMBINATOR_INTERNALS_H
@@ -4,15 +4,6 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
-// Initialize ast_nil if not already initialized
-static ast_t* ensure_ast_nil_initialized() {
-    if (ast_nil == NULL) {
-        ast_nil = new_ast();
-        ast_nil->typ = 0;
-    }
-    return ast_nil;
-}
-
 // --- Static Function Forward Declarations ---
 static ParseResult expect_fn(input_t * in, void * args, char* parser_name);
 static ParseResult seq_fn(input_t * in, void * args, char* parser_name);
@@ -32,15 +23,31 @@ static ParseResult map_fn(input_t * in, void * args, char* parser_name);
 static ParseResult errmap_fn(input_t * in, void * args, char* parser_name);
 static ParseResult many_fn(input_t * in, void * args, char* parser_name);
 static ParseResult optional_fn(input_t * in, void * args, char* parser_name);
+static ParseResult commit_fn(input_t * in, void * args, char* parser_name);
+static ParseResult skip_fn(input_t * in, void * args, char* parser_name);
+static ParseResult skip_many_fn(input_t * in, void * args, char* parser_name);
 
 // --- _fn Implementations ---
 
+// A committed failure goes straight to the caller instead of being treated
+// as "this alternative did not match".
+static bool is_committed(ParseResult res) {
+    return !res.is_success && res.value.error != NULL && res.value.error->committed;
+}
+
+// Recognize-only mode: a sub-result that is not ast_nil came from a custom
+// parser that builds regardless, and is dropped straight away.
+static ast_t* drop_ast(ast_t* ast) {
+    free_ast(ast);
+    return ensure_ast_nil_initialized();
+}
+
 static ParseResult optional_fn(input_t * in, void * args, char* parser_name) {
     optional_args* oargs = (optional_args*)args;
     InputState state;
     save_input_state(in, &state);
     ParseResult res = parse(in, oargs->p);
-    if (res.is_success) {
+    if (res.is_success || is_committed(res)) {
         return res;
     }
     // If it fails, we restore the input and return success with a nil AST.
@@ -49,6 +56,45 @@ static ParseResult optional_fn(input_t * in, void * args, char* parser_name) {
     return make_success(ensure_ast_nil_initialized());
 }
 
+static ParseResult commit_fn(input_t * in, void * args, char* parser_name) {
+    // The cut itself is applied by the enclosing seq/gseq.
+    return parse(in, ((commit_args*)args)->p);
+}
+
+static ParseResult skip_fn(input_t * in, void * args, char* parser_name) {
+    bool recognize_only = in->recognize_only;
+    in->recognize_only = true;
+    ParseResult res = parse(in, ((skip_args*)args)->p);
+    in->recognize_only = recognize_only;
+    if (res.is_success) res.value.ast = drop_ast(res.value.ast);
+    return res;
+}
+
+static ParseResult skip_many_fn(input_t * in, void * args, char* parser_name) {
+    combinator_t* p = ((skip_args*)args)->p;
+    bool recognize_only = in->recognize_only;
+    in->recognize_only = true;
+    while (1) {
+        InputState state;
+        save_iteration_state(in, &state);
+        ParseResult res = parse(in, p);
+        if (is_committed(res)) {
+            in->recognize_only = recognize_only;
+            return res;
+        }
+        if (!res.is_success) {
+            restore_input_state(in, &state);
+            free_error(res.value.error);
+            break;
+        }
+        drop_ast(res.value.ast);
+        // A match that consumed nothing would repeat forever
+        if (in->start == state.start) break;
+    }
+    in->recognize_only = recognize_only;
+    return make_success(ast_nil);
+}
+
 static ParseResult pnot_fn(input_t * in, void * args, char* parser_name) {
     not_args* nargs = (not_args*)args;
     InputState state; save_input_state(in, &state);
@@ -56,7 +102,7 @@ static ParseResult pnot_fn(input_t * in, void * args, char* parser_name) {
     restore_input_state(in, &state);
     if (res.is_success) {
         free_ast(res.value.ast);
-        return make_failure_v2(in, parser_name, strdup("not combinator failed."), NULL);
+        return make_failure_literal(in, parser_name, "not combinator failed.");
     }
     // The error from the inner parse is consumed and we return success.
     free_error(res.value.error);
@@ -75,6 +121,7 @@ static ParseResult expect_fn(input_t * in, void * args, char* parser_name) {
     expect_args * eargs = (expect_args *) args;
     ParseResult res = parse(in, eargs->comb);
     if (res.is_success) return res;
+    if (in->recognize_only) return wrap_failure(in, NULL, parser_name, res);
 
     char* final_message;
     if (res.value.error && res.value.error->unexpected) {
@@ -118,31 +165,47 @@ static ParseResult sep_by_fn(input_t * in, void * args, char* parser_name) {
     ast_t* tail = NULL;
 
     ParseResult res = parse(in, sargs->p);
+    if (is_committed(res)) return res;
     if (!res.is_success) {
         free_error(res.value.error);
         return make_success(ast_nil);
     }
-    head = tail = res.value.ast;
+    if (in->recognize_only) drop_ast(res.value.ast);
+    else head = tail = res.value.ast;
 
     while (1) {
-        InputState state; save_input_state(in, &state);
+        InputState state; save_iteration_state(in, &state);
         ParseResult sep_res = parse(in, sargs->sep);
+        if (is_committed(sep_res)) {
+            free_ast(head);
+            return sep_res;
+        }
         if (!sep_res.is_success) {
+            free_error(sep_res.value.error);
             restore_input_state(in, &state);
             break;
         }
         free_ast(sep_res.value.ast);
 
         ParseResult p_res = parse(in, sargs->p);
+        if (is_committed(p_res)) {
+            free_ast(head);
+            return p_res;
+        }
         if (!p_res.is_success) {
+            free_error(p_res.value.error);
             restore_input_state(in, &state);
             break;
         }
+        if (in->recognize_only) {
+            drop_ast(p_res.value.ast);
+            continue;
+        }
         tail->next = p_res.value.ast;
         tail = tail->next;
     }
 
-    return make_success(head);
+    return make_success(head ? head : ast_nil);
 }
 
 static ParseResult sep_end_by_fn(input_t * in, void * args, char* parser_name) {
@@ -151,26 +214,42 @@ static ParseResult sep_end_by_fn(input_t * in, void * args, char* parser_name) {
     ast_t* tail = NULL;
 
     ParseResult res = parse(in, sargs->p);
+    if (is_committed(res)) return res;
     if (!res.is_success) {
         free_error(res.value.error);
         return make_success(ast_nil);
     }
-    head = tail = res.value.ast;
+    if (in->recognize_only) drop_ast(res.value.ast);
+    else head = tail = res.value.ast;
 
     while (1) {
-        InputState state; save_input_state(in, &state);
+        InputState state; save_iteration_state(in, &state);
         ParseResult sep_res = parse(in, sargs->sep);
+        if (is_committed(sep_res)) {
+            free_ast(head);
+            return sep_res;
+        }
         if (!sep_res.is_success) {
+            free_error(sep_res.value.error);
             restore_input_state(in, &state);
             break;
         }
         free_ast(sep_res.value.ast);
 
         ParseResult p_res = parse(in, sargs->p);
+        if (is_committed(p_res)) {
+            free_ast(head);
+            return p_res;
+        }
         if (!p_res.is_success) {
+            free_error(p_res.value.error);
             restore_input_state(in, &state);
             break;
         }
+        if (in->recognize_only) {
+            drop_ast(p_res.value.ast);
+            continue;
+        }
         tail->next = p_res.value.ast;
         tail = tail->next;
     }
@@ -178,13 +257,18 @@ static ParseResult sep_end_by_fn(input_t * in, void * args, char* parser_name) {
     // Try to parse a final separator
     InputState final_sep_state; save_input_state(in, &final_sep_state);
     ParseResult final_sep_res = parse(in, sargs->sep);
+    if (is_committed(final_sep_res)) {
+        free_ast(head);
+        return final_sep_res;
+    }
     if (!final_sep_res.is_success) {
+        free_error(final_sep_res.value.error);
         restore_input_state(in, &final_sep_state);
     } else {
         free_ast(final_sep_res.value.ast);
     }
 
-    return make_success(head);
+    return make_success(head ? head : ast_nil);
 }
 
 static ParseResult chainl1_fn(input_t * in, void * args, char* parser_name) {
@@ -197,9 +281,14 @@ static ParseResult chainl1_fn(input_t * in, void * args, char* parser_name) {
     ast_t* left = res.value.ast;
 
     while (1) {
-        InputState state; save_input_state(in, &state);
+        InputState state; save_iteration_state(in, &state);
         ParseResult op_res = parse(in, cargs->op);
+        if (is_committed(op_res)) {
+            free_ast(left);
+            return op_res;
+        }
         if (!op_res.is_success) {
+            free_error(op_res.value.error);
             restore_input_state(in, &state);
             break;
         }
@@ -211,10 +300,12 @@ static ParseResult chainl1_fn(input_t * in, void * args, char* parser_name) {
             restore_input_state(in, &state);
             free_ast(left);
             // The op succeeded, so there is no error to free in op_res
-            return wrap_failure(in, strdup("Expected operand after operator in chainl1"), parser_name, right_res);
+            char* message = in->recognize_only ? NULL : strdup("Expected operand after operator in chainl1");
+            return wrap_failure(in, message, parser_name, right_res);
         }
         ast_t* right = right_res.value.ast;
-        left = ast2(op_tag, left, right);
+        if (in->recognize_only) drop_ast(right);
+        else left = ast2(op_tag, left, right);
     }
 
     return make_success(left);
@@ -222,6 +313,7 @@ static ParseResult chainl1_fn(input_t * in, void * args, char* parser_name) {
 
 static ParseResult succeed_fn(input_t * in, void * args, char* parser_name) {
     succeed_args* sargs = (succeed_args*)args;
+    if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
     return make_success(copy_ast(sargs->ast));
 }
 
@@ -231,7 +323,9 @@ static ParseResult errmap_fn(input_t * in, void * args, char* parser_name) {
     if (res.is_success) {
         return res;
     }
+    bool committed = res.value.error->committed;
     res.value.error = eargs->func(res.value.error);
+    if (res.value.error != NULL) res.value.error->committed = committed;
     return res;
 }
 
@@ -241,14 +335,20 @@ static ParseResult many_fn(input_t * in, void * args, char* parser_name) {
     ast_t* tail = NULL;
     while (1) {
         InputState state;
-        save_input_state(in, &state);
+        save_iteration_state(in, &state);
         ParseResult res = parse(in, p);
+        if (is_committed(res)) {
+            free_ast(head);
+            return res;
+        }
         if (!res.is_success) {
             restore_input_state(in, &state);
             free_error(res.value.error);
             break;
         }
-        if (head == NULL) {
+        if (in->recognize_only) {
+            drop_ast(res.value.ast);
+        } else if (head == NULL) {
             head = tail = res.value.ast;
         } else {
             tail->next = res.value.ast;
@@ -264,6 +364,7 @@ static ParseResult map_fn(input_t * in, void * args, char* parser_name) {
     if (!res.is_success) {
         return res;
     }
+    if (in->recognize_only) return make_success(drop_ast(res.value.ast));
     ast_t* new_ast = margs->func(res.value.ast);
     return make_success(new_ast);
 }
@@ -272,17 +373,35 @@ static ParseResult gseq_fn(input_t * in, void * args, char* parser_name) {
     seq_args * sa = (seq_args *) args;
     seq_list * seq = sa->list;
     ast_t * head = NULL, * tail = NULL;
+    bool committed = false;
+    InputState entry;
+    if (in->events != NULL) {
+        save_input_state(in, &entry);
+        events_enter(in, sa->typ);
+    }
     while (seq != NULL) {
         ParseResult res = parse(in, seq->comb);
-        if (!res.is_success) return res;
-        if (res.value.ast != ast_nil) {
+        if (!res.is_success) {
+            if (committed) res.value.error->committed = true;
+            if (in->events != NULL) events_discard(in, entry.mark);
+            return res;
+        }
+        if (seq->comb->type == COMB_COMMIT) {
+            committed = true;
+            events_commit(in);
+        }
+        if (in->recognize_only) {
+            drop_ast(res.value.ast);
+        } else if (res.value.ast != ast_nil) {
             if (head == NULL) head = tail = res.value.ast;
-            else { tail->next = res.value.ast; while(tail->next) tail = tail->next; }
+            else tail->next = res.value.ast;
+            while (tail->next) tail = tail->next;
         }
         seq = seq->next;
     }
+    if (in->events != NULL) events_leave(in, sa->typ, entry.start);
     ast_t* result_child = head ? head : ast_nil;
-    if (sa->typ == 0) {
+    if (sa->typ == 0 || in->recognize_only) {
         return make_success(result_child);
     } else {
         return make_success(ast1(sa->typ, result_child));
@@ -294,23 +413,34 @@ static ParseResult seq_fn(input_t * in, void * args, char* parser_name) {
     seq_args * sa = (seq_args *) args;
     seq_list * seq = sa->list;
     ast_t * head = NULL, * tail = NULL;
+    bool committed = false;
+    events_enter(in, sa->typ);
     while (seq != NULL) {
         ParseResult res = parse(in, seq->comb);
         if (!res.is_success) {
             restore_input_state(in, &state);
+            if (committed) res.value.error->committed = true;
             if (res.value.error->message == NULL) {
                 return wrap_failure_with_ast(in, "Failed to parse sequence.", res, head);
             }
             return wrap_failure_with_ast(in, res.value.error->message, res, head);
         }
-        if (res.value.ast != ast_nil) {
+        if (seq->comb->type == COMB_COMMIT) {
+            committed = true;
+            events_commit(in);
+        }
+        if (in->recognize_only) {
+            drop_ast(res.value.ast);
+        } else if (res.value.ast != ast_nil) {
             if (head == NULL) head = tail = res.value.ast;
-            else { tail->next = res.value.ast; while(tail->next) tail = tail->next; }
+            else tail->next = res.value.ast;
+            while (tail->next) tail = tail->next;
         }
         seq = seq->next;
     }
+    events_leave(in, sa->typ, state.start);
     ast_t* result_child = head ? head : ast_nil;
-    if (sa->typ == 0) {
+    if (sa->typ == 0 || in->recognize_only) {
         return make_success(result_child);
     } else {
         return make_success(ast1(sa->typ, result_child));
@@ -327,13 +457,24 @@ static ParseResult multi_fn(input_t * in, void * args, char* parser_name) {
             __func__, __FILE__, __LINE__);
         abort();
     }
+    // A tagged choice opens its node before knowing which alternative
+    // matches; the entry state keeps that event retractable.
+    InputState entry;
+    bool tagged_events = in->events != NULL && sa->typ != 0;
+    if (tagged_events) {
+        save_input_state(in, &entry);
+        events_enter(in, sa->typ);
+    }
     ParseResult res;
     // Initialize res with the failure of the first alternative, in case all fail.
     res = parse(in, seq->comb);
     if (res.is_success) {
-        if (sa->typ != 0) res.value.ast = ast1(sa->typ, res.value.ast);
+        if (tagged_events) events_leave(in, sa->typ, entry.start);
+        if (in->recognize_only) res.value.ast = drop_ast(res.value.ast);
+        else if (sa->typ != 0) res.value.ast = ast1(sa->typ, res.value.ast);
         return res;
     }
+    if (res.value.error->committed) return res;
 
     // Backtrack and try the rest
     InputState state;
@@ -345,10 +486,14 @@ static ParseResult multi_fn(input_t * in, void * args, char* parser_name) {
         seq = seq->next;
         res = parse(in, seq->comb);
         if (res.is_success) {
-            if (sa->typ != 0) res.value.ast = ast1(sa->typ, res.value.ast);
+            if (tagged_events) events_leave(in, sa->typ, entry.start);
+            if (in->recognize_only) res.value.ast = drop_ast(res.value.ast);
+            else if (sa->typ != 0) res.value.ast = ast1(sa->typ, res.value.ast);
             return res;
         }
+        if (res.value.error->committed) return res;
     }
+    if (tagged_events) events_discard(in, entry.mark);
     // Return the failure from the last alternative
     return res;
 }
@@ -356,7 +501,12 @@ static ParseResult multi_fn(input_t * in, void * args, char* parser_name) {
 static ParseResult flatMap_fn(input_t * in, void * args, char* parser_name) {
     flatMap_args * fm_args = (flatMap_args *)args;
     InputState state; save_input_state(in, &state);
+    // The continuation is chosen from the AST, so build it even when only
+    // recognizing.
+    bool recognize_only = in->recognize_only;
+    in->recognize_only = false;
     ParseResult res = parse(in, fm_args->parser);
+    in->recognize_only = recognize_only;
     if (!res.is_success) return res;
     combinator_t * next_parser = fm_args->func(res.value.ast);
     /* HARDENED: A flatMap function must not return a NULL parser. */
@@ -408,8 +558,8 @@ combinator_t * expect(combinator_t * c, char * msg) {
     expect_args * args = (expect_args*)safe_malloc(sizeof(expect_args));
     args->msg = msg; args->comb = c;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "expect %s", c->name ? c->name : "unnamed_parser");
-    comb->type = COMB_EXPECT; comb->fn = expect_fn; comb->args = (void *) args; return comb;
+    comb->type = COMB_EXPECT; comb->fn = expect_fn; comb->args = (void *) args;
+    return intern_combinator(comb);
 }
 
 combinator_t * seq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
@@ -420,36 +570,16 @@ combinator_t * seq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     seq_list* head = (seq_list*)safe_malloc(sizeof(seq_list));
     head->comb = c1;
     seq_list* current = head;
-    int count = 1;
-    size_t total_name_len = strlen("sequence of ") + (c1->name ? strlen(c1->name) : 0);
 
     combinator_t* c;
     while ((c = va_arg(ap, combinator_t*)) != NULL) {
         current->next = (seq_list*)safe_malloc(sizeof(seq_list));
         current = current->next;
         current->comb = c;
-        count++;
-        total_name_len += (c->name ? strlen(c->name) : 0) + 2; // for ", "
     }
     current->next = NULL;
     va_end(ap);
 
-    // Allocate and generate the name
-    char* name_buffer = (char*)safe_malloc(total_name_len + 1);
-    char* p = name_buffer;
-    p += sprintf(p, "sequence of ");
-    current = head;
-    for (int i = 0; i < count; i++) {
-        if (current->comb->name) {
-            p += sprintf(p, "%s", current->comb->name);
-        }
-        if (i < count - 1) {
-            p += sprintf(p, ", ");
-        }
-        current = current->next;
-    }
-    ret->name = name_buffer;
-
     // Set up the combinator
     seq_args* args = (seq_args*)safe_malloc(sizeof(seq_args));
     args->typ = typ;
@@ -457,7 +587,7 @@ combinator_t * seq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     ret->type = COMB_SEQ;
     ret->args = (void*)args;
     ret->fn = seq_fn;
-    return ret;
+    return intern_in_place(ret);
 }
 
 combinator_t * multi(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
@@ -468,36 +598,16 @@ combinator_t * multi(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     seq_list* head = (seq_list*)safe_malloc(sizeof(seq_list));
     head->comb = c1;
     seq_list* current = head;
-    int count = 1;
-    size_t total_name_len = strlen("any of ") + (c1->name ? strlen(c1->name) : 0);
 
     combinator_t* c;
     while ((c = va_arg(ap, combinator_t*)) != NULL) {
         current->next = (seq_list*)safe_malloc(sizeof(seq_list));
         current = current->next;
         current->comb = c;
-        count++;
-        total_name_len += (c->name ? strlen(c->name) : 0) + 2; // for ", "
     }
     current->next = NULL;
     va_end(ap);
 
-    // Allocate and generate the name
-    char* name_buffer = (char*)safe_malloc(total_name_len + 1);
-    char* p = name_buffer;
-    p += sprintf(p, "any of ");
-    current = head;
-    for (int i = 0; i < count; i++) {
-        if (current->comb->name) {
-            p += sprintf(p, "%s", current->comb->name);
-        }
-        if (i < count - 1) {
-            p += sprintf(p, ", ");
-        }
-        current = current->next;
-    }
-    ret->name = name_buffer;
-
     // Set up the combinator
     seq_args* args = (seq_args*)safe_malloc(sizeof(seq_args));
     args->typ = typ;
@@ -505,47 +615,47 @@ combinator_t * multi(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     ret->type = COMB_MULTI;
     ret->args = (void*)args;
     ret->fn = multi_fn;
-    return ret;
+    return intern_in_place(ret);
 }
 
 combinator_t * flatMap(combinator_t * p, flatMap_func func) {
     flatMap_args * args = (flatMap_args*)safe_malloc(sizeof(flatMap_args));
     args->parser = p; args->func = func;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "flatMap over %s", p->name ? p->name : "unnamed_parser");
-    comb->type = COMB_FLATMAP; comb->fn = flatMap_fn; comb->args = args; return comb;
+    comb->type = COMB_FLATMAP; comb->fn = flatMap_fn; comb->args = args;
+    return intern_combinator(comb);
 }
 
 combinator_t * left(combinator_t* p1, combinator_t* p2) {
     pair_args* args = (pair_args*)safe_malloc(sizeof(pair_args));
     args->p1 = p1; args->p2 = p2;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "left of %s and %s", p1->name ? p1->name : "unnamed_parser", p2->name ? p2->name : "unnamed_parser");
-    comb->type = COMB_LEFT; comb->fn = left_fn; comb->args = (void *) args; return comb;
+    comb->type = COMB_LEFT; comb->fn = left_fn; comb->args = (void *) args;
+    return intern_combinator(comb);
 }
 
 combinator_t * right(combinator_t* p1, combinator_t* p2) {
     pair_args* args = (pair_args*)safe_malloc(sizeof(pair_args));
     args->p1 = p1; args->p2 = p2;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "right of %s and %s", p1->name ? p1->name : "unnamed_parser", p2->name ? p2->name : "unnamed_parser");
-    comb->type = COMB_RIGHT; comb->fn = right_fn; comb->args = (void *) args; return comb;
+    comb->type = COMB_RIGHT; comb->fn = right_fn; comb->args = (void *) args;
+    return intern_combinator(comb);
 }
 
 combinator_t * pnot(combinator_t* p) {
     not_args* args = (not_args*)safe_malloc(sizeof(not_args));
     args->p = p;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "not %s", p->name ? p->name : "unnamed_parser");
-    comb->type = COMB_NOT; comb->fn = pnot_fn; comb->args = (void *) args; return comb;
+    comb->type = COMB_NOT; comb->fn = pnot_fn; comb->args = (void *) args;
+    return intern_combinator(comb);
 }
 
 combinator_t * peek(combinator_t* p) {
     peek_args* args = (peek_args*)safe_malloc(sizeof(peek_args));
     args->p = p;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "peek %s", p->name ? p->name : "unnamed_parser");
-    comb->type = COMB_PEEK; comb->fn = peek_fn; comb->args = (void *) args; return comb;
+    comb->type = COMB_PEEK; comb->fn = peek_fn; comb->args = (void *) args;
+    return intern_combinator(comb);
 }
 
 combinator_t * gseq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
@@ -556,36 +666,16 @@ combinator_t * gseq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     seq_list* head = (seq_list*)safe_malloc(sizeof(seq_list));
     head->comb = c1;
     seq_list* current = head;
-    int count = 1;
-    size_t total_name_len = strlen("gseq of ") + (c1->name ? strlen(c1->name) : 0);
 
     combinator_t* c;
     while ((c = va_arg(ap, combinator_t*)) != NULL) {
         current->next = (seq_list*)safe_malloc(sizeof(seq_list));
         current = current->next;
         current->comb = c;
-        count++;
-        total_name_len += (c->name ? strlen(c->name) : 0) + 2; // for ", "
     }
     current->next = NULL;
     va_end(ap);
 
-    // Allocate and generate the name
-    char* name_buffer = (char*)safe_malloc(total_name_len + 1);
-    char* p = name_buffer;
-    p += sprintf(p, "gseq of ");
-    current = head;
-    for (int i = 0; i < count; i++) {
-        if (current->comb->name) {
-            p += sprintf(p, "%s", current->comb->name);
-        }
-        if (i < count - 1) {
-            p += sprintf(p, ", ");
-        }
-        current = current->next;
-    }
-    ret->name = name_buffer;
-
     // Set up the combinator
     seq_args* args = (seq_args*)safe_malloc(sizeof(seq_args));
     args->typ = typ;
@@ -593,7 +683,7 @@ combinator_t * gseq(combinator_t * ret, tag_t typ, combinator_t * c1, ...) {
     ret->type = COMB_GSEQ;
     ret->args = (void*)args;
     ret->fn = gseq_fn;
-    return ret;
+    return intern_in_place(ret);
 }
 
 combinator_t * between(combinator_t* open, combinator_t* close, combinator_t* p) {
@@ -602,11 +692,10 @@ combinator_t * between(combinator_t* open, combinator_t* close, combinator_t* p)
     args->close = close;
     args->p = p;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "between %s and %s", open->name ? open->name : "unnamed_parser", close->name ? close->name : "unnamed_parser");
     comb->type = COMB_BETWEEN;
     comb->fn = between_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * errmap(combinator_t* p, err_map_func func) {
@@ -614,11 +703,10 @@ combinator_t * errmap(combinator_t* p, err_map_func func) {
     args->parser = p;
     args->func = func;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "errmap over %s", p->name ? p->name : "unnamed_parser");
     comb->type = COMB_ERRMAP;
     comb->fn = errmap_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * map(combinator_t* p, map_func func) {
@@ -626,11 +714,10 @@ combinator_t * map(combinator_t* p, map_func func) {
     args->parser = p;
     args->func = func;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "map over %s", p->name ? p->name : "unnamed_parser");
     comb->type = COMB_MAP;
     comb->fn = map_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * sep_by(combinator_t* p, combinator_t* sep) {
@@ -638,11 +725,10 @@ combinator_t * sep_by(combinator_t* p, combinator_t* sep) {
     args->p = p;
     args->sep = sep;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "%s separated by %s", p->name ? p->name : "unnamed_parser", sep->name ? sep->name : "unnamed_parser");
     comb->type = COMB_SEP_BY;
     comb->fn = sep_by_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * sep_end_by(combinator_t* p, combinator_t* sep) {
@@ -650,11 +736,10 @@ combinator_t * sep_end_by(combinator_t* p, combinator_t* sep) {
     args->p = p;
     args->sep = sep;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "%s separated and ended by %s", p->name ? p->name : "unnamed_parser", sep->name ? sep->name : "unnamed_parser");
     comb->type = COMB_SEP_END_BY;
     comb->fn = sep_end_by_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * chainl1(combinator_t* p, combinator_t* op) {
@@ -662,11 +747,10 @@ combinator_t * chainl1(combinator_t* p, combinator_t* op) {
     args->p = p;
     args->op = op;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "chainl1 of %s with %s", p->name ? p->name : "unnamed_parser", op->name ? op->name : "unnamed_parser");
     comb->type = COMB_CHAINL1;
     comb->fn = chainl1_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * succeed(ast_t* ast) {
@@ -679,22 +763,50 @@ combinator_t * succeed(ast_t* ast) {
     return comb;
 }
 
+combinator_t * commit(combinator_t* p) {
+    commit_args* args = (commit_args*)safe_malloc(sizeof(commit_args));
+    args->p = p;
+    combinator_t * comb = new_combinator();
+    comb->type = COMB_COMMIT;
+    comb->fn = commit_fn;
+    comb->args = (void *) args;
+    return intern_combinator(comb);
+}
+
+combinator_t * skip(combinator_t* p) {
+    skip_args* args = (skip_args*)safe_malloc(sizeof(skip_args));
+    args->p = p;
+    combinator_t * comb = new_combinator();
+    comb->type = COMB_SKIP;
+    comb->fn = skip_fn;
+    comb->args = (void *) args;
+    return intern_combinator(comb);
+}
+
+combinator_t * skip_many(combinator_t* p) {
+    skip_args* args = (skip_args*)safe_malloc(sizeof(skip_args));
+    args->p = p;
+    combinator_t * comb = new_combinator();
+    comb->type = COMB_SKIP_MANY;
+    comb->fn = skip_many_fn;
+    comb->args = (void *) args;
+    return intern_combinator(comb);
+}
+
 combinator_t * many(combinator_t* p) {
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "many %s", p->name ? p->name : "unnamed_parser");
     comb->type = COMB_MANY;
     comb->fn = many_fn;
     comb->args = (void *) p;
-    return comb;
+    return intern_combinator(comb);
 }
 
 combinator_t * optional(combinator_t* p) {
     optional_args* args = (optional_args*)safe_malloc(sizeof(optional_args));
     args->p = p;
     combinator_t * comb = new_combinator();
-    asprintf(&comb->name, "optional %s", p->name ? p->name : "unnamed_parser");
     comb->type = COMB_OPTIONAL;
     comb->fn = optional_fn;
     comb->args = (void *) args;
-    return comb;
+    return intern_combinator(comb);
 }
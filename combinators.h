@@ -13,6 +13,10 @@ combinator_t * optional(combinator_t* p);
 combinator_t * sep_by(combinator_t* p, combinator_t* sep);
 combinator_t * seq(combinator_t * ret, tag_t typ, combinator_t * c1, ...);
 combinator_t * multi(combinator_t * ret, tag_t typ, combinator_t * c1, ...);
+// Parses p, then the parser func builds from its AST, which is freed again
+// afterwards. Building and freeing it updates the grammar's shared state, so
+// parses that can reach a flatMap must not run concurrently with each other
+// or with grammar construction, even on separate inputs.
 combinator_t * flatMap(combinator_t * p, flatMap_func func);
 combinator_t * left(combinator_t* p1, combinator_t* p2);
 combinator_t * right(combinator_t* p1, combinator_t* p2);
@@ -25,5 +29,17 @@ combinator_t * chainl1(combinator_t* p, combinator_t* op);
 combinator_t * succeed(ast_t* ast);
 combinator_t * map(combinator_t* p, map_func func);
 combinator_t * errmap(combinator_t* p, err_map_func func);
+// Parses like p. Once it has succeeded inside a seq or gseq, a later failure
+// of that sequence is committed: enclosing multi, optional, many, sep_by,
+// sep_end_by and chainl1 return it instead of backtracking to other
+// alternatives. The commit must be a direct element of the seq or gseq; one
+// wrapped in another combinator (map, optional, token, ...) parses like p
+// and commits nothing.
+combinator_t * commit(combinator_t* p);
+// Parse p (once, or as many times as it matches) in recognize-only mode and
+// succeed with ast_nil, so discarded input such as whitespace and comments
+// never builds an AST.
+combinator_t * skip(combinator_t* p);
+combinator_t * skip_many(combinator_t* p);
 
 #endif // COMBINATORS_H
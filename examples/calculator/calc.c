@@ -2,9 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include "parser.h"
 #include "combinators.h"
 #include "calculator_logic.h"
+#include "calc_cache.h"
 
 // --- Forward declarations for local functions ---
 static void print_error_with_partial_ast(ParseError* error);
@@ -55,10 +57,185 @@ void count_nodes_visitor(ast_t* node, void* context) {
     (*counter)++;
 }
 
+// --- Batch Mode ---
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Evaluates one expression per line of `file` with a single grammar and
+// prints one result (or error) line per expression. Blank lines are
+// skipped. With a cache, repeated lines are not parsed again. Returns the
+// number of expressions that failed.
+static unsigned long run_batch(FILE* file, combinator_t* expr_parser, calc_cache_t* cache, FILE* summary) {
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    // Every line's AST is released at once by resetting the arena.
+    ast_arena_t* arena = new_ast_arena();
+    ast_arena_t* previous = ast_arena_use(arena);
+    input_t* in = new_input();
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t n;
+    unsigned long line_no = 0, count = 0, failed = 0;
+    uint64_t bytes = 0;
+    uint64_t start = now_ns();
+
+    while ((n = getline(&line, &line_cap, file)) != -1) {
+        line_no++;
+        bytes += (uint64_t)n;
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        ssize_t first = 0;
+        while (first < n && isspace((unsigned char)line[first])) first++;
+        if (first == n) continue;
+        count++;
+
+        long value;
+        const char* error;
+        if (cache != NULL) {
+            calc_cache_entry_t* entry = calc_cache_acquire(cache, line, (size_t)n, &error);
+            if (entry != NULL) {
+                if (calc_run(entry->program, NULL, &value, &error)) {
+                    printf("%ld\n", value);
+                } else {
+                    printf("error: line %lu: %s\n", line_no, error);
+                    failed++;
+                }
+                calc_cache_release(cache, entry);
+                ast_arena_reset(arena);
+                continue;
+            }
+            // Not cached: parse it below for the full error report.
+        }
+
+        init_input_buffer(in, line, (int)n);
+        ParseResult result = parse(in, expr_parser);
+        if (!result.is_success) {
+            printf("error: line %lu, col %d: %s\n", line_no, result.value.error->col, result.value.error->message);
+            free_error(result.value.error);
+            failed++;
+        } else if (in->start < in->length) {
+            printf("error: line %lu, col %d: Trailing characters\n", line_no, in->start + 1);
+            failed++;
+        } else if (!eval_checked(result.value.ast, &value, &error)) {
+            printf("error: line %lu: %s\n", line_no, error);
+            failed++;
+        } else {
+            printf("%ld\n", value);
+        }
+        ast_arena_reset(arena);
+    }
+    fflush(stdout);
+
+    double seconds = (now_ns() - start) / 1e9;
+    if (seconds <= 0) seconds = 1e-9;
+    fprintf(summary, "Evaluated %lu expressions (%lu failed) in %.3f s: %.0f expr/s, %.2f MB/s\n",
+            count, failed, seconds, count / seconds, bytes / seconds / 1e6);
+    if (cache != NULL) calc_cache_print_stats(cache, summary);
+
+    free(line);
+    free(in);
+    ast_arena_use(previous);
+    free_ast_arena(arena);
+    return failed;
+}
+
+typedef struct {
+    const char** names;
+    size_t count;
+} variable_list;
+
+static void collect_variable(ast_t* node, void* context) {
+    variable_list* vars = (variable_list*)context;
+    if (node->typ != CALC_T_VAR) return;
+    for (size_t i = 0; i < vars->count; i++) {
+        if (strcmp(vars->names[i], node->sym->name) == 0) return;
+    }
+    vars->names = realloc(vars->names, sizeof(char*) * (vars->count + 1));
+    if (!vars->names) exception("realloc failed");
+    vars->names[vars->count++] = node->sym->name;
+}
+
+// Evaluates `ast` over `rows` rows of generated values for its variables:
+// per row by walking the tree, per row through the bytecode, and a block
+// of rows at a time. Reports the rate of each.
+static int run_benchmark(ast_t* ast, long rows) {
+    variable_list vars = { NULL, 0 };
+    parser_walk_ast(ast, collect_variable, &vars);
+    const char* error;
+    calc_program_t* prog = calc_compile(ast, vars.names, vars.count, &error);
+    if (prog == NULL) {
+        fprintf(stderr, "Error: %s\n", error);
+        free(vars.names);
+        return 1;
+    }
+
+    int64_t** columns = (int64_t**)safe_malloc(sizeof(int64_t*) * (vars.count + 1));
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t c = 0; c < vars.count; c++) {
+        columns[c] = (int64_t*)safe_malloc(sizeof(int64_t) * rows);
+        for (long r = 0; r < rows; r++) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            columns[c][r] = (int64_t)(seed % 2001) - 1000;
+        }
+    }
+    int64_t* row = (int64_t*)safe_malloc(sizeof(int64_t) * (vars.count + 1));
+    int64_t* out = (int64_t*)safe_malloc(sizeof(int64_t) * rows);
+    calc_bindings_t bindings = { vars.names, row, vars.count };
+
+    long value = 0;
+    int64_t sums[3] = {0, 0, 0};
+    size_t failures[3] = {0, 0, 0};
+    uint64_t ns[3];
+    uint64_t start = now_ns();
+    for (long r = 0; r < rows; r++) {
+        for (size_t c = 0; c < vars.count; c++) row[c] = columns[c][r];
+        if (eval_bound(ast, &bindings, &value, &error)) sums[0] += value; else failures[0]++;
+    }
+    ns[0] = now_ns() - start;
+    start = now_ns();
+    for (long r = 0; r < rows; r++) {
+        for (size_t c = 0; c < vars.count; c++) row[c] = columns[c][r];
+        if (calc_run(prog, row, &value, &error)) sums[1] += value; else failures[1]++;
+    }
+    ns[1] = now_ns() - start;
+    start = now_ns();
+    failures[2] = calc_run_columns(prog, (const int64_t* const*)columns, (size_t)rows, out, NULL);
+    ns[2] = now_ns() - start;
+    for (long r = 0; r < rows; r++) sums[2] += out[r];
+
+    int rc = 0;
+    if (sums[0] != sums[1] || sums[0] != sums[2] || failures[0] != failures[1] || failures[0] != failures[2]) {
+        fprintf(stderr, "Error: evaluators disagree\n");
+        rc = 1;
+    } else {
+        static const char* labels[] = { "Tree walk (eval per row)", "Bytecode (per row)", "Bytecode (column blocks)" };
+        printf("%ld rows, %zu variables, %zu failing rows\n", rows, vars.count, failures[0]);
+        for (int k = 0; k < 3; k++) {
+            double seconds = ns[k] > 0 ? ns[k] / 1e9 : 1e-9;
+            printf("%-26s %8.1f ns/row %10.2f Mrows/s\n", labels[k], (double)ns[k] / rows, rows / seconds / 1e6);
+        }
+    }
+
+    for (size_t c = 0; c < vars.count; c++) free(columns[c]);
+    free(columns);
+    free(row);
+    free(out);
+    free(vars.names);
+    calc_free_program(prog);
+    return rc;
+}
+
 // --- Main ---
 int main(int argc, char *argv[]) {
     bool print_ast = false;
     bool count_nodes = false;
+    bool batch = false;
+    long cache_capacity = 0;
+    bool print_bytecode = false;
+    long bench_rows = 0;
     char *expr_str = NULL;
 
     for (int i = 1; i < argc; i++) {
@@ -66,19 +243,50 @@ int main(int argc, char *argv[]) {
             print_ast = true;
         } else if (strcmp(argv[i], "--count-nodes") == 0) {
             count_nodes = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_capacity = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--print-bytecode") == 0) {
+            print_bytecode = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_rows = strtol(argv[++i], NULL, 10);
         } else {
             expr_str = argv[i];
         }
     }
 
-    if (expr_str == NULL) {
-        fprintf(stderr, "Usage: %s [--print-ast] [--count-nodes] \"<expression>\"\n", argv[0]);
+    if (expr_str == NULL && !batch) {
+        fprintf(stderr, "Usage: %s [--print-ast] [--print-bytecode] [--count-nodes] [--bench ROWS] \"<expression>\"\n", argv[0]);
+        fprintf(stderr, "       %s --batch [--cache N] [<file>|-]   (one expression per line, stdin by default)\n", argv[0]);
         return 1;
     }
 
     combinator_t *expr_parser = new_combinator();
     init_calculator_parser(&expr_parser);
 
+    if (batch) {
+        FILE* file = stdin;
+        if (expr_str != NULL && strcmp(expr_str, "-") != 0) {
+            file = fopen(expr_str, "r");
+            if (file == NULL) {
+                perror(expr_str);
+                free_combinator(expr_parser);
+                return 1;
+            }
+        }
+        ast_nil = new_ast();
+        ast_nil->typ = CALC_T_NONE;
+        calc_cache_t cache;
+        bool cached = cache_capacity > 0 && calc_cache_init(&cache, expr_parser, NULL, 0, (size_t)cache_capacity, false) == 0;
+        unsigned long failed = run_batch(file, expr_parser, cached ? &cache : NULL, stderr);
+        if (cached) calc_cache_destroy(&cache);
+        if (file != stdin) fclose(file);
+        free_combinator(expr_parser);
+        free(ast_nil);
+        return failed == 0 ? 0 : 1;
+    }
+
     // Parsing
     input_t *in = new_input();
     in->buffer = expr_str;
@@ -102,6 +310,29 @@ int main(int argc, char *argv[]) {
             parser_walk_ast(result.value.ast, count_nodes_visitor, &node_count);
             printf("AST contains %d nodes.\n", node_count);
         }
+        if (print_bytecode) {
+            const char* error;
+            // Variables are bound to columns in order of first use.
+            variable_list vars = { NULL, 0 };
+            parser_walk_ast(result.value.ast, collect_variable, &vars);
+            calc_program_t* prog = calc_compile(result.value.ast, vars.names, vars.count, &error);
+            free(vars.names);
+            if (prog != NULL) {
+                calc_print_program(prog, stdout);
+                fflush(stdout);
+                calc_free_program(prog);
+            } else {
+                printf("Not compiled: %s\n", error);
+            }
+        }
+        if (bench_rows > 0) {
+            int rc = run_benchmark(result.value.ast, bench_rows);
+            free_ast(result.value.ast);
+            free_combinator(expr_parser);
+            free(in);
+            free(ast_nil);
+            return rc;
+        }
         long final_result = eval(result.value.ast);
         printf("%ld\n", final_result);
         free_ast(result.value.ast);
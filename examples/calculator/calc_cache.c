@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "calc_cache.h"
+
+static void cache_lock(calc_cache_t* cache) {
+    if (cache->thread_safe) pthread_mutex_lock(&cache->lock);
+}
+
+static void cache_unlock(calc_cache_t* cache) {
+    if (cache->thread_safe) pthread_mutex_unlock(&cache->lock);
+}
+
+int calc_cache_init(calc_cache_t* cache, combinator_t* parser, const char* const* columns, size_t column_count,
+                    size_t capacity, bool thread_safe) {
+    memset(cache, 0, sizeof(*cache));
+    if (capacity == 0) return -1;
+    cache->parser = parser;
+    cache->columns = columns;
+    cache->column_count = column_count;
+    cache->capacity = capacity;
+    // Load factor of at most one half
+    cache->bucket_count = 16;
+    while (cache->bucket_count < capacity * 2) cache->bucket_count *= 2;
+    cache->buckets = (calc_cache_entry_t**)calloc(cache->bucket_count, sizeof(calc_cache_entry_t*));
+    if (!cache->buckets) exception("calloc failed");
+    cache->thread_safe = thread_safe;
+    if (thread_safe && pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache->buckets);
+        cache->buckets = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void free_entry(calc_cache_entry_t* entry) {
+    calc_free_program((calc_program_t*)entry->program);
+    free(entry->text);
+    free(entry);
+}
+
+void calc_cache_destroy(calc_cache_t* cache) {
+    calc_cache_entry_t* entry = cache->lru_head;
+    while (entry != NULL) {
+        calc_cache_entry_t* next = entry->lru_next;
+        free_entry(entry);
+        entry = next;
+    }
+    free(cache->buckets);
+    if (cache->thread_safe) pthread_mutex_destroy(&cache->lock);
+    memset(cache, 0, sizeof(*cache));
+}
+
+uint64_t calc_cache_key(const char* text, size_t length) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static calc_cache_entry_t** bucket_for(calc_cache_t* cache, uint64_t hash) {
+    return &cache->buckets[hash & (cache->bucket_count - 1)];
+}
+
+static calc_cache_entry_t* find_entry(calc_cache_t* cache, uint64_t hash, const char* text, size_t length) {
+    for (calc_cache_entry_t* e = *bucket_for(cache, hash); e != NULL; e = e->bucket_next) {
+        if (e->hash == hash && e->length == length && memcmp(e->text, text, length) == 0) return e;
+    }
+    return NULL;
+}
+
+static void lru_unlink(calc_cache_t* cache, calc_cache_entry_t* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next; else cache->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev; else cache->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(calc_cache_t* cache, calc_cache_entry_t* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry; else cache->lru_tail = entry;
+    cache->lru_head = entry;
+}
+
+// Drops the cache's reference; the entry goes once no caller holds it.
+static void evict(calc_cache_t* cache, calc_cache_entry_t* entry) {
+    calc_cache_entry_t** slot = bucket_for(cache, entry->hash);
+    while (*slot != entry) slot = &(*slot)->bucket_next;
+    *slot = entry->bucket_next;
+    lru_unlink(cache, entry);
+    cache->count--;
+    cache->evictions++;
+    if (--entry->refs == 0) free_entry(entry);
+}
+
+// Parses and compiles without touching the cache.
+static calc_program_t* compile_text(calc_cache_t* cache, const char* text, size_t length, const char** error) {
+    input_t in;
+    memset(&in, 0, sizeof(in));
+    init_input_buffer(&in, (char*)text, (int)length);
+    ParseResult res = parse(&in, cache->parser);
+    if (!res.is_success) {
+        free_error(res.value.error);
+        *error = "Syntax error";
+        return NULL;
+    }
+    calc_program_t* prog = NULL;
+    if (in.start < in.length) {
+        *error = "Trailing characters";
+    } else {
+        prog = calc_compile(res.value.ast, cache->columns, cache->column_count, error);
+    }
+    free_ast(res.value.ast);
+    return prog;
+}
+
+calc_cache_entry_t* calc_cache_acquire(calc_cache_t* cache, const char* text, size_t length, const char** error) {
+    uint64_t hash = calc_cache_key(text, length);
+    cache_lock(cache);
+    calc_cache_entry_t* entry = find_entry(cache, hash, text, length);
+    if (entry != NULL) {
+        cache->hits++;
+        entry->refs++;
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        cache_unlock(cache);
+        if (error) *error = NULL;
+        return entry;
+    }
+    cache->misses++;
+    cache_unlock(cache);
+
+    const char* err = NULL;
+    calc_program_t* prog = compile_text(cache, text, length, &err);
+    if (error) *error = err;
+    if (prog == NULL) return NULL;
+
+    cache_lock(cache);
+    // Another thread may have compiled the same text meanwhile.
+    entry = find_entry(cache, hash, text, length);
+    if (entry != NULL) {
+        entry->refs++;
+        cache_unlock(cache);
+        calc_free_program(prog);
+        return entry;
+    }
+    entry = (calc_cache_entry_t*)safe_malloc(sizeof(calc_cache_entry_t));
+    entry->program = prog;
+    entry->hash = hash;
+    entry->length = length;
+    entry->text = (char*)safe_malloc(length + 1);
+    memcpy(entry->text, text, length);
+    entry->text[length] = '\0';
+    entry->refs = 2;
+    calc_cache_entry_t** bucket = bucket_for(cache, hash);
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+    while (cache->count > cache->capacity) evict(cache, cache->lru_tail);
+    cache_unlock(cache);
+    return entry;
+}
+
+void calc_cache_release(calc_cache_t* cache, calc_cache_entry_t* entry) {
+    if (entry == NULL) return;
+    cache_lock(cache);
+    bool last = --entry->refs == 0;
+    cache_unlock(cache);
+    if (last) free_entry(entry);
+}
+
+double calc_cache_hit_rate(const calc_cache_t* cache) {
+    calc_cache_t* c = (calc_cache_t*)cache;
+    cache_lock(c);
+    uint64_t lookups = c->hits + c->misses;
+    double rate = lookups ? (double)c->hits / lookups : 0.0;
+    cache_unlock(c);
+    return rate;
+}
+
+void calc_cache_print_stats(const calc_cache_t* cache, FILE* out) {
+    calc_cache_t* c = (calc_cache_t*)cache;
+    cache_lock(c);
+    uint64_t hits = c->hits, misses = c->misses, evictions = c->evictions;
+    size_t count = c->count;
+    cache_unlock(c);
+    fprintf(out, "Cache hits: %llu\n", (unsigned long long)hits);
+    fprintf(out, "Cache misses: %llu\n", (unsigned long long)misses);
+    fprintf(out, "Cache evictions: %llu\n", (unsigned long long)evictions);
+    fprintf(out, "Cache entries: %zu\n", count);
+    fprintf(out, "Hit rate: %.1f%%\n", hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
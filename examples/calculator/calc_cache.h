@@ -0,0 +1,65 @@
+#ifndef CALC_CACHE_H
+#define CALC_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "parser.h"
+#include "calculator_logic.h"
+
+// In-memory cache of compiled expressions, keyed by the expression text.
+// Lookups compare a 64-bit hash and the length before the bytes. At most
+// `capacity` entries are kept; the least recently used one is evicted to
+// make room. Programs are shared and must not be modified.
+typedef struct calc_cache_entry {
+    const calc_program_t* program;
+    // Managed by the cache
+    uint64_t hash;
+    size_t length;
+    char* text;
+    unsigned refs;            // the cache's own reference plus acquired ones
+    struct calc_cache_entry* bucket_next;
+    struct calc_cache_entry* lru_prev;    // towards most recently used
+    struct calc_cache_entry* lru_next;
+} calc_cache_entry_t;
+
+typedef struct {
+    combinator_t* parser;     // borrowed
+    const char* const* columns;           // borrowed; variables to bind
+    size_t column_count;
+    size_t capacity;
+    size_t count;
+    calc_cache_entry_t** buckets;
+    size_t bucket_count;      // power of two
+    calc_cache_entry_t* lru_head;         // most recently used
+    calc_cache_entry_t* lru_tail;
+    bool thread_safe;
+    pthread_mutex_t lock;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} calc_cache_t;
+
+// Expressions are parsed with `parser` and compiled against `columns` (see
+// calc_compile). With `thread_safe`, any number of threads may acquire and
+// release entries concurrently; misses are parsed outside the lock.
+// Returns 0 on success.
+int calc_cache_init(calc_cache_t* cache, combinator_t* parser, const char* const* columns, size_t column_count,
+                    size_t capacity, bool thread_safe);
+// All acquired entries must have been released.
+void calc_cache_destroy(calc_cache_t* cache);
+
+uint64_t calc_cache_key(const char* text, size_t length);
+
+// Returns the entry for text[0, length), parsing and compiling it on a
+// miss, or NULL with a static message in *error (if given) if it does not
+// parse or compile; failures are not cached. The entry stays valid, even
+// if evicted, until it is passed to calc_cache_release().
+calc_cache_entry_t* calc_cache_acquire(calc_cache_t* cache, const char* text, size_t length, const char** error);
+void calc_cache_release(calc_cache_t* cache, calc_cache_entry_t* entry);
+
+// Share of lookups served from the cache, 0 before the first lookup.
+double calc_cache_hit_rate(const calc_cache_t* cache);
+void calc_cache_print_stats(const calc_cache_t* cache, FILE* out);
+
+#endif // CALC_CACHE_H
@@ -2,7 +2,9 @@
 #include "parser.h"
 #include "combinators.h"
 #include "calculator_logic.h"
+#include "calc_cache.h"
 #include <stdio.h>
+#include <pthread.h>
 
 void test_calc_valid_expression(void) {
     combinator_t* p = new_combinator();
@@ -43,8 +45,250 @@ void test_calc_invalid_expression(void) {
     free(input);
 }
 
+void test_calc_eval_checked(void) {
+    combinator_t* p = new_combinator();
+    init_calculator_parser(&p);
+    const char* texts[] = { "7 - 2 * 3", "1 / (2 - 2)", "99999999999999999999 + 1" };
+    const char* errors[] = { NULL, "Division by zero", "Integer literal out of range" };
+
+    input_t* input = new_input();
+    for (int i = 0; i < 3; i++) {
+        init_input_buffer(input, (char*)texts[i], (int)strlen(texts[i]));
+        ParseResult res = parse(input, p);
+        TEST_ASSERT(res.is_success);
+        long value = 0;
+        const char* error = "unset";
+        bool ok = eval_checked(res.value.ast, &value, &error);
+        TEST_CHECK(ok == (errors[i] == NULL));
+        if (errors[i] == NULL) {
+            TEST_CHECK(error == NULL && value == 1);
+        } else {
+            TEST_CHECK(error != NULL && strcmp(error, errors[i]) == 0);
+        }
+        free_ast(res.value.ast);
+    }
+    free_combinator(p);
+    free(input);
+}
+
+void test_calc_bytecode(void) {
+    combinator_t* p = new_combinator();
+    init_calculator_parser(&p);
+    const char* texts[] = {
+        "1 + 2 * (3 - 4) / -5", "-(-9223372036854775807 - 1) / -1", "7 / (3 - 3)", "(1 / 0) * 2 + 3",
+        "-9223372036854775807 * 2",
+    };
+    input_t* input = new_input();
+    for (int i = 0; i < 5; i++) {
+        TEST_CASE(texts[i]);
+        init_input_buffer(input, (char*)texts[i], (int)strlen(texts[i]));
+        ParseResult res = parse(input, p);
+        TEST_ASSERT(res.is_success);
+
+        long expected = 0, actual = 0;
+        const char* expected_error = NULL;
+        const char* error = NULL;
+        bool ok = eval_checked(res.value.ast, &expected, &expected_error);
+        calc_program_t* prog = calc_compile(res.value.ast, NULL, 0, &error);
+        TEST_ASSERT(prog != NULL && error == NULL);
+        // Run repeatedly: the program is not modified by running it.
+        for (int round = 0; round < 3; round++) {
+            TEST_CHECK(calc_run(prog, NULL, &actual, &error) == ok);
+            if (ok) {
+                TEST_CHECK(actual == expected);
+                TEST_MSG("expected %ld, got %ld", expected, actual);
+            } else {
+                TEST_CHECK(error != NULL && strcmp(error, expected_error) == 0);
+            }
+        }
+        if (ok) {
+            // Folded down to a single constant
+            TEST_CHECK(prog->count == 0 && prog->const_count == 1);
+        } else {
+            TEST_CHECK(prog->count >= 1 && prog->code[0].op == CALC_OP_DIV);
+        }
+        calc_free_program(prog);
+        free_ast(res.value.ast);
+    }
+
+    const char* error = NULL;
+    const char* bad = "99999999999999999999 * 0";
+    init_input_buffer(input, (char*)bad, (int)strlen(bad));
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(calc_compile(res.value.ast, NULL, 0, &error) == NULL);
+    TEST_CHECK(error != NULL && strcmp(error, "Integer literal out of range") == 0);
+    free_ast(res.value.ast);
+
+    free_combinator(p);
+    free(input);
+}
+
+void test_calc_columns(void) {
+    combinator_t* p = new_combinator();
+    init_calculator_parser(&p);
+    const char* text = "a * b - 3 / (b - 2) + -a * (4 / 2)";
+    input_t* input = new_input();
+    init_input_buffer(input, (char*)text, (int)strlen(text));
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+
+    // Odd row count to cover a partial last block
+    enum { ROWS = 1001 };
+    static int64_t a[ROWS], b[ROWS], out[ROWS];
+    static uint8_t valid[ROWS];
+    for (int i = 0; i < ROWS; i++) {
+        a[i] = i % 3 == 0 ? INT64_MIN + i : i * 7919 - 4000000;
+        b[i] = i % 5 - 1;         // 2 every fifth row
+    }
+    const char* names[] = { "a", "b" };
+    const int64_t* columns[] = { a, b };
+    const char* error = NULL;
+    calc_program_t* prog = calc_compile(res.value.ast, names, 2, &error);
+    TEST_ASSERT(prog != NULL);
+    TEST_CHECK(prog->column_count == 2);
+
+    size_t failed = calc_run_columns(prog, columns, ROWS, out, valid);
+    size_t expected_failed = 0;
+    for (int i = 0; i < ROWS; i++) {
+        int64_t row[] = { a[i], b[i] };
+        calc_bindings_t vars = { names, row, 2 };
+        long expected = 0, scalar = 0;
+        bool ok = eval_bound(res.value.ast, &vars, &expected, &error);
+        TEST_CHECK(calc_run(prog, row, &scalar, &error) == ok);
+        TEST_CHECK(valid[i] == ok);
+        if (ok) {
+            TEST_CHECK(out[i] == expected && scalar == expected);
+            TEST_MSG("row %d: expected %ld, block %lld, scalar %ld", i, expected, (long long)out[i], scalar);
+        } else {
+            TEST_CHECK(out[i] == 0 && strcmp(error, "Division by zero") == 0);
+            expected_failed++;
+        }
+    }
+    TEST_CHECK(failed == expected_failed && failed == ROWS / 5);
+
+    // Variables need bindings
+    long value;
+    TEST_CHECK(!eval_checked(res.value.ast, &value, &error));
+    TEST_CHECK(strcmp(error, "Unbound variable") == 0);
+    TEST_CHECK(calc_compile(res.value.ast, names, 1, &error) == NULL);
+    TEST_CHECK(strcmp(error, "Unbound variable") == 0);
+
+    calc_free_program(prog);
+    free_ast(res.value.ast);
+    free_combinator(p);
+    free(input);
+}
+
+static long cached_value(calc_cache_t* cache, const char* text) {
+    long value = 0;
+    const char* error = NULL;
+    calc_cache_entry_t* entry = calc_cache_acquire(cache, text, strlen(text), &error);
+    if (entry == NULL) return -1;
+    calc_run(entry->program, NULL, &value, &error);
+    calc_cache_release(cache, entry);
+    return value;
+}
+
+void test_calc_cache(void) {
+    combinator_t* p = new_combinator();
+    init_calculator_parser(&p);
+    calc_cache_t cache;
+    TEST_ASSERT(calc_cache_init(&cache, p, NULL, 0, 2, false) == 0);
+
+    TEST_CHECK(cached_value(&cache, "1 + 2") == 3);
+    TEST_CHECK(cached_value(&cache, "2 * 3") == 6);
+    TEST_CHECK(cached_value(&cache, "1 + 2") == 3);
+    TEST_CHECK(cache.hits == 1 && cache.misses == 2);
+    // "2 * 3" is the least recently used entry now
+    TEST_CHECK(cached_value(&cache, "7 - 1") == 6);
+    TEST_CHECK(cache.evictions == 1 && cache.count == 2);
+    TEST_CHECK(cached_value(&cache, "1 + 2") == 3);
+    TEST_CHECK(cache.hits == 2);
+    TEST_CHECK(cached_value(&cache, "2 * 3") == 6);
+    TEST_CHECK(cache.misses == 4);
+
+    // Same length and different bytes are different keys
+    TEST_CHECK(cached_value(&cache, "2 + 1") == 3);
+    TEST_CHECK(cache.misses == 5);
+
+    // Failures are reported and not cached
+    const char* error = NULL;
+    TEST_CHECK(calc_cache_acquire(&cache, "1 +", 3, &error) == NULL);
+    TEST_CHECK(error != NULL && strcmp(error, "Syntax error") == 0);
+    TEST_CHECK(calc_cache_acquire(&cache, "x * 2", 5, &error) == NULL);
+    TEST_CHECK(error != NULL && strcmp(error, "Unbound variable") == 0);
+    TEST_CHECK(cache.count == 2);
+
+    // An acquired entry outlives its eviction
+    calc_cache_entry_t* held = calc_cache_acquire(&cache, "10 / 2", 6, &error);
+    TEST_ASSERT(held != NULL);
+    TEST_CHECK(cached_value(&cache, "3 * 3") == 9);
+    TEST_CHECK(cached_value(&cache, "4 * 4") == 16);
+    long value = 0;
+    TEST_CHECK(calc_run(held->program, NULL, &value, &error) && value == 5);
+    calc_cache_release(&cache, held);
+    TEST_CHECK(calc_cache_hit_rate(&cache) > 0.0);
+
+    calc_cache_destroy(&cache);
+    free_combinator(p);
+}
+
+typedef struct {
+    calc_cache_t* cache;
+    int seed;
+    int errors;
+} cache_worker;
+
+static void* cache_worker_run(void* arg) {
+    cache_worker* w = (cache_worker*)arg;
+    char text[32];
+    for (int i = 0; i < 2000; i++) {
+        int k = (i * 7 + w->seed) % 50;
+        snprintf(text, sizeof(text), "%d * 3 + 1", k);
+        if (cached_value(w->cache, text) != k * 3 + 1) w->errors++;
+    }
+    return NULL;
+}
+
+void test_calc_cache_threads(void) {
+    combinator_t* p = new_combinator();
+    init_calculator_parser(&p);
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = CALC_T_NONE;
+    }
+    calc_cache_t cache;
+    // Smaller than the working set, so entries are evicted while in use
+    TEST_ASSERT(calc_cache_init(&cache, p, NULL, 0, 16, true) == 0);
+
+    enum { THREADS = 4 };
+    pthread_t threads[THREADS];
+    cache_worker workers[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        workers[t].cache = &cache;
+        workers[t].seed = t * 13;
+        workers[t].errors = 0;
+        TEST_ASSERT(pthread_create(&threads[t], NULL, cache_worker_run, &workers[t]) == 0);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        TEST_CHECK(workers[t].errors == 0);
+    }
+    TEST_CHECK(cache.hits + cache.misses == THREADS * 2000);
+    TEST_CHECK(cache.count <= 16);
+
+    calc_cache_destroy(&cache);
+    free_combinator(p);
+}
+
 TEST_LIST = {
     { "test_calc_valid_expression", test_calc_valid_expression },
     { "test_calc_invalid_expression", test_calc_invalid_expression },
+    { "test_calc_eval_checked", test_calc_eval_checked },
+    { "test_calc_bytecode", test_calc_bytecode },
+    { "test_calc_columns", test_calc_columns },
+    { "test_calc_cache", test_calc_cache },
+    { "test_calc_cache_threads", test_calc_cache_threads },
     { NULL, NULL }
 };
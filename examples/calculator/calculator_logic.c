@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "parser.h"
 #include "combinators.h"
 #include "calculator_logic.h"
@@ -12,36 +15,408 @@ static bool is_whitespace_char(char c) {
 }
 
 static combinator_t* token(combinator_t* p) {
-    combinator_t* ws = many(satisfy(is_whitespace_char, CALC_T_NONE));
-    return right(ws, left(p, many(satisfy(is_whitespace_char, CALC_T_NONE))));
+    combinator_t* ws = skip_while(is_whitespace_char);
+    return right(ws, left(p, ws));
 }
 
 // --- Evaluation ---
+// Arithmetic shared by the tree walk, constant folding and the bytecode
+// interpreter. Wraps on overflow instead of leaving it undefined.
+static const char* apply_op(tag_t op, int64_t a, int64_t b, int64_t* out) {
+    switch (op) {
+        case CALC_T_ADD: *out = (int64_t)((uint64_t)a + (uint64_t)b); return NULL;
+        case CALC_T_SUB: *out = (int64_t)((uint64_t)a - (uint64_t)b); return NULL;
+        case CALC_T_MUL: *out = (int64_t)((uint64_t)a * (uint64_t)b); return NULL;
+        case CALC_T_DIV:
+            if (b == 0) return "Division by zero";
+            if (a == INT64_MIN && b == -1) return "Integer overflow";
+            *out = a / b;
+            return NULL;
+        case CALC_T_NEG: *out = (int64_t)(0 - (uint64_t)a); return NULL;
+        default: return "Unknown AST node type";
+    }
+}
+
+// Returns NULL, or what makes the expression impossible to evaluate.
+static const char* eval_into(ast_t* ast, const calc_bindings_t* vars, int64_t* out) {
+    int64_t a, b = 0;
+    const char* err;
+    switch (ast->typ) {
+        case CALC_T_INT:
+            // Decoded once by the integer scanner
+            if (!ast_int_value(ast, out)) return "Integer literal out of range";
+            return NULL;
+        case CALC_T_VAR:
+            for (size_t i = 0; vars != NULL && i < vars->count; i++) {
+                if (strcmp(vars->names[i], ast->sym->name) == 0) {
+                    *out = vars->values[i];
+                    return NULL;
+                }
+            }
+            return "Unbound variable";
+        case CALC_T_ADD:
+        case CALC_T_SUB:
+        case CALC_T_MUL:
+        case CALC_T_DIV:
+            if ((err = eval_into(ast->child->next, vars, &b)) != NULL) return err;
+            // fall through
+        case CALC_T_NEG:
+            if ((err = eval_into(ast->child, vars, &a)) != NULL) return err;
+            return apply_op(ast->typ, a, b, out);
+        default:
+            return "Unknown AST node type";
+    }
+}
+
+bool eval_bound(ast_t* ast, const calc_bindings_t* vars, long* result, const char** error) {
+    int64_t value = 0;
+    const char* err = ast ? eval_into(ast, vars, &value) : "NULL AST node";
+    if (error) *error = err;
+    *result = (long)value;
+    return err == NULL;
+}
+
+bool eval_checked(ast_t* ast, long* result, const char** error) {
+    return eval_bound(ast, NULL, result, error);
+}
+
 /* HARDENED: Abort on division by zero. */
+/* HARDENED: Abort on integer literals that do not fit 64 bits. */
 /* HARDENED: Abort on unknown AST node type. */
+/* HARDENED: Abort on variables, which eval() has no values for. */
 long eval(ast_t *ast) {
-    if (!ast) {
-        fprintf(stderr, "FATAL: trying to evaluate a NULL AST node in %s at %s:%d\n", __func__, __FILE__, __LINE__);
+    long result;
+    const char* error;
+    if (!eval_checked(ast, &result, &error)) {
+        fprintf(stderr, "FATAL: %s in %s at %s:%d\n", error, __func__, __FILE__, __LINE__);
         abort();
     }
+    return result;
+}
+
+// --- Bytecode ---
+// Operands name columns (CALC_COLUMN_BIT) and temporaries (CALC_TEMP_BIT)
+// by their own numbering while compiling, because the number of constants,
+// which come first in the register file, is only known at the end.
+#define CALC_TEMP_BIT 0x8000u
+#define CALC_COLUMN_BIT 0x4000u
+#define CALC_MAX_SLOTS 0x3FFFu
+
+typedef struct {
+    bool is_const;
+    int64_t value;            // is_const
+    uint16_t slot;            // otherwise: the column or temporary holding it
+} calc_operand;
+
+typedef struct {
+    calc_program_t* prog;
+    const char* const* columns;
+    size_t column_count;
+    uint32_t code_cap;
+    uint32_t const_cap;
+    uint16_t temps;           // temporaries needed so far
+    const char* error;
+} calc_compiler;
+
+static uint16_t add_const(calc_compiler* c, int64_t value) {
+    calc_program_t* prog = c->prog;
+    for (uint16_t i = 0; i < prog->const_count; i++) {
+        if (prog->consts[i] == value) return i;
+    }
+    if (prog->const_count == CALC_MAX_SLOTS) {
+        c->error = "Expression too complex";
+        return 0;
+    }
+    if (prog->const_count == c->const_cap) {
+        c->const_cap = c->const_cap ? c->const_cap * 2 : 8;
+        prog->consts = realloc(prog->consts, sizeof(int64_t) * c->const_cap);
+        if (!prog->consts) exception("realloc failed");
+    }
+    prog->consts[prog->const_count] = value;
+    return prog->const_count++;
+}
+
+static uint16_t operand_slot(calc_compiler* c, calc_operand op) {
+    return op.is_const ? add_const(c, op.value) : op.slot;
+}
+
+static void emit(calc_compiler* c, calc_opcode op, uint16_t dst, uint16_t a, uint16_t b) {
+    calc_program_t* prog = c->prog;
+    if (prog->count == c->code_cap) {
+        c->code_cap = c->code_cap ? c->code_cap * 2 : 16;
+        prog->code = realloc(prog->code, sizeof(calc_insn_t) * c->code_cap);
+        if (!prog->code) exception("realloc failed");
+    }
+    calc_insn_t* insn = &prog->code[prog->count++];
+    insn->op = (uint8_t)op;
+    insn->dst = dst;
+    insn->a = a;
+    insn->b = b;
+}
+
+static calc_opcode opcode_for(tag_t tag) {
+    switch (tag) {
+        case CALC_T_ADD: return CALC_OP_ADD;
+        case CALC_T_SUB: return CALC_OP_SUB;
+        case CALC_T_MUL: return CALC_OP_MUL;
+        case CALC_T_DIV: return CALC_OP_DIV;
+        default: return CALC_OP_NEG;
+    }
+}
+
+// Compiles `ast` with temporaries `temp` and up free for its use. Results
+// that are not constant land in temporary `temp`.
+static calc_operand compile_node(calc_compiler* c, ast_t* ast, uint16_t temp) {
+    calc_operand result = { true, 0, 0 };
+    if (c->error) return result;
+    if (temp >= CALC_MAX_SLOTS - 1) {
+        c->error = "Expression too complex";
+        return result;
+    }
+    if (temp + 1 > c->temps) c->temps = temp + 1;
     switch (ast->typ) {
-        case CALC_T_INT: return atol(ast->sym->name);
-        case CALC_T_ADD: return eval(ast->child) + eval(ast->child->next);
-        case CALC_T_SUB: return eval(ast->child) - eval(ast->child->next);
-        case CALC_T_MUL: return eval(ast->child) * eval(ast->child->next);
+        case CALC_T_INT:
+            if (!ast_int_value(ast, &result.value)) c->error = "Integer literal out of range";
+            return result;
+        case CALC_T_VAR:
+            for (size_t i = 0; i < c->column_count; i++) {
+                if (strcmp(c->columns[i], ast->sym->name) == 0) {
+                    result.is_const = false;
+                    result.slot = (uint16_t)i | CALC_COLUMN_BIT;
+                    return result;
+                }
+            }
+            c->error = "Unbound variable";
+            return result;
+        case CALC_T_ADD:
+        case CALC_T_SUB:
+        case CALC_T_MUL:
         case CALC_T_DIV: {
-            long divisor = eval(ast->child->next);
-            if (divisor == 0) {
-                fprintf(stderr, "FATAL: Division by zero in %s at %s:%d\n", __func__, __FILE__, __LINE__);
-                abort();
+            calc_operand a = compile_node(c, ast->child, temp);
+            bool a_in_temp = !a.is_const && (a.slot & CALC_TEMP_BIT);
+            calc_operand b = compile_node(c, ast->child->next, a_in_temp ? temp + 1 : temp);
+            if (c->error) return result;
+            // Operations that would fail are left for calc_run() to report.
+            if (a.is_const && b.is_const && apply_op(ast->typ, a.value, b.value, &result.value) == NULL) {
+                return result;
+            }
+            uint16_t sa = operand_slot(c, a);
+            uint16_t sb = operand_slot(c, b);
+            emit(c, opcode_for(ast->typ), temp | CALC_TEMP_BIT, sa, sb);
+            break;
+        }
+        case CALC_T_NEG: {
+            calc_operand a = compile_node(c, ast->child, temp);
+            if (c->error) return result;
+            if (a.is_const) {
+                apply_op(CALC_T_NEG, a.value, 0, &result.value);
+                return result;
             }
-            return eval(ast->child) / divisor;
+            emit(c, CALC_OP_NEG, temp | CALC_TEMP_BIT, a.slot, a.slot);
+            break;
         }
-        case CALC_T_NEG: return -eval(ast->child);
         default:
-            fprintf(stderr, "FATAL: Unknown AST node type: %d in %s at %s:%d\n", ast->typ, __func__, __FILE__, __LINE__);
-            abort();
+            c->error = "Unknown AST node type";
+            return result;
+    }
+    result.is_const = false;
+    result.slot = temp | CALC_TEMP_BIT;
+    return result;
+}
+
+static uint16_t resolve_slot(const calc_program_t* prog, uint16_t slot) {
+    if (slot & CALC_TEMP_BIT) return prog->const_count + prog->column_count + (slot & ~CALC_TEMP_BIT);
+    if (slot & CALC_COLUMN_BIT) return prog->const_count + (slot & ~CALC_COLUMN_BIT);
+    return slot;
+}
+
+calc_program_t* calc_compile(ast_t* ast, const char* const* columns, size_t column_count, const char** error) {
+    calc_program_t* prog = (calc_program_t*)safe_malloc(sizeof(calc_program_t));
+    memset(prog, 0, sizeof(*prog));
+    calc_compiler c = { prog, columns, column_count, 0, 0, 0, ast ? NULL : "NULL AST node" };
+    if (column_count > CALC_MAX_SLOTS) c.error = "Expression too complex";
+    calc_operand result = ast ? compile_node(&c, ast, 0) : (calc_operand){ true, 0, 0 };
+    if (!c.error) prog->result = operand_slot(&c, result);
+    if (!c.error && (uint32_t)prog->const_count + column_count + c.temps > 0xFFFFu) c.error = "Expression too complex";
+    if (error) *error = c.error;
+    if (c.error) {
+        calc_free_program(prog);
+        return NULL;
+    }
+    // Registers: constants, then one per column, then temporaries.
+    prog->column_count = (uint16_t)column_count;
+    prog->reg_count = prog->const_count + prog->column_count + c.temps;
+    for (uint32_t i = 0; i < prog->count; i++) {
+        calc_insn_t* insn = &prog->code[i];
+        insn->dst = resolve_slot(prog, insn->dst);
+        insn->a = resolve_slot(prog, insn->a);
+        insn->b = resolve_slot(prog, insn->b);
+    }
+    prog->result = resolve_slot(prog, prog->result);
+    return prog;
+}
+
+#define CALC_INLINE_REGS 64
+
+bool calc_run(const calc_program_t* prog, const int64_t* row, long* result, const char** error) {
+    int64_t inline_regs[CALC_INLINE_REGS];
+    int64_t* regs = prog->reg_count <= CALC_INLINE_REGS ? inline_regs : (int64_t*)safe_malloc(sizeof(int64_t) * prog->reg_count);
+    memcpy(regs, prog->consts, sizeof(int64_t) * prog->const_count);
+    if (prog->column_count) memcpy(regs + prog->const_count, row, sizeof(int64_t) * prog->column_count);
+    const char* err = NULL;
+    const calc_insn_t* insn = prog->code;
+    const calc_insn_t* end = insn + prog->count;
+    for (; insn < end; insn++) {
+        int64_t a = regs[insn->a], b = regs[insn->b];
+        switch ((calc_opcode)insn->op) {
+            case CALC_OP_ADD: regs[insn->dst] = (int64_t)((uint64_t)a + (uint64_t)b); break;
+            case CALC_OP_SUB: regs[insn->dst] = (int64_t)((uint64_t)a - (uint64_t)b); break;
+            case CALC_OP_MUL: regs[insn->dst] = (int64_t)((uint64_t)a * (uint64_t)b); break;
+            case CALC_OP_NEG: regs[insn->dst] = (int64_t)(0 - (uint64_t)a); break;
+            case CALC_OP_DIV:
+                if (b == 0 || (a == INT64_MIN && b == -1)) {
+                    err = b == 0 ? "Division by zero" : "Integer overflow";
+                    goto done;
+                }
+                regs[insn->dst] = a / b;
+                break;
+        }
+    }
+    *result = (long)regs[prog->result];
+done:
+    if (regs != inline_regs) free(regs);
+    if (error) *error = err;
+    return err == NULL;
+}
+
+// --- Block Evaluation ---
+// Runs the program over CALC_BLOCK_ROWS rows at a time. Every register is
+// a vector of that many values: constants are broadcast once per call,
+// column registers point straight into the caller's columns, and
+// temporaries get scratch vectors. Rows whose division fails are masked
+// out instead of stopping the block.
+#define CALC_BLOCK_ROWS 256
+
+#ifdef __SSE2__
+// Low 64 bits of a 64x64-bit product per lane, from 32x32->64 multiplies.
+static inline __m128i mul_epi64(__m128i a, __m128i b) {
+    __m128i lo = _mm_mul_epu32(a, b);
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+    return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+}
+#endif
+
+static void block_op(calc_opcode op, int64_t* dst, const int64_t* a, const int64_t* b, uint8_t* valid, size_t n) {
+    size_t i = 0;
+    switch (op) {
+        case CALC_OP_ADD:
+#ifdef __SSE2__
+            for (; i + 2 <= n; i += 2) {
+                __m128i r = _mm_add_epi64(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+                _mm_storeu_si128((__m128i*)(dst + i), r);
+            }
+#endif
+            for (; i < n; i++) dst[i] = (int64_t)((uint64_t)a[i] + (uint64_t)b[i]);
+            break;
+        case CALC_OP_SUB:
+#ifdef __SSE2__
+            for (; i + 2 <= n; i += 2) {
+                __m128i r = _mm_sub_epi64(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+                _mm_storeu_si128((__m128i*)(dst + i), r);
+            }
+#endif
+            for (; i < n; i++) dst[i] = (int64_t)((uint64_t)a[i] - (uint64_t)b[i]);
+            break;
+        case CALC_OP_MUL:
+#ifdef __SSE2__
+            for (; i + 2 <= n; i += 2) {
+                __m128i r = mul_epi64(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+                _mm_storeu_si128((__m128i*)(dst + i), r);
+            }
+#endif
+            for (; i < n; i++) dst[i] = (int64_t)((uint64_t)a[i] * (uint64_t)b[i]);
+            break;
+        case CALC_OP_NEG:
+#ifdef __SSE2__
+            for (; i + 2 <= n; i += 2) {
+                __m128i r = _mm_sub_epi64(_mm_setzero_si128(), _mm_loadu_si128((const __m128i*)(a + i)));
+                _mm_storeu_si128((__m128i*)(dst + i), r);
+            }
+#endif
+            for (; i < n; i++) dst[i] = (int64_t)(0 - (uint64_t)a[i]);
+            break;
+        case CALC_OP_DIV:
+            // No SIMD integer division: failing lanes divide by 1 and are
+            // cleared from the mask, without branching.
+            for (; i < n; i++) {
+                int64_t x = a[i], y = b[i];
+                bool bad = (y == 0) | ((x == INT64_MIN) & (y == -1));
+                valid[i] &= (uint8_t)!bad;
+                dst[i] = x / (bad ? 1 : y);
+            }
+            break;
+    }
+}
+
+size_t calc_run_columns(const calc_program_t* prog, const int64_t* const* columns, size_t rows, int64_t* out, uint8_t* valid) {
+    size_t temp_base = (size_t)prog->const_count + prog->column_count;
+    size_t temps = prog->reg_count - temp_base;
+    int64_t* storage = (int64_t*)safe_malloc(sizeof(int64_t) * CALC_BLOCK_ROWS * (prog->const_count + temps + 1));
+    const int64_t** regs = (const int64_t**)safe_malloc(sizeof(int64_t*) * (prog->reg_count ? prog->reg_count : 1));
+    for (size_t r = 0; r < prog->const_count; r++) {
+        int64_t* v = storage + r * CALC_BLOCK_ROWS;
+        for (size_t i = 0; i < CALC_BLOCK_ROWS; i++) v[i] = prog->consts[r];
+        regs[r] = v;
+    }
+    int64_t* scratch = storage + (size_t)prog->const_count * CALC_BLOCK_ROWS;
+    for (size_t t = 0; t < temps; t++) regs[temp_base + t] = scratch + t * CALC_BLOCK_ROWS;
+    uint8_t mask[CALC_BLOCK_ROWS];
+    size_t failed = 0;
+
+    for (size_t start = 0; start < rows; start += CALC_BLOCK_ROWS) {
+        size_t n = rows - start < CALC_BLOCK_ROWS ? rows - start : CALC_BLOCK_ROWS;
+        for (size_t c = 0; c < prog->column_count; c++) regs[prog->const_count + c] = columns[c] + start;
+        memset(mask, 1, n);
+        for (uint32_t k = 0; k < prog->count; k++) {
+            const calc_insn_t* insn = &prog->code[k];
+            block_op((calc_opcode)insn->op, (int64_t*)regs[insn->dst], regs[insn->a], regs[insn->b], mask, n);
+        }
+        const int64_t* result = regs[prog->result];
+        for (size_t i = 0; i < n; i++) {
+            out[start + i] = mask[i] ? result[i] : 0;
+            failed += !mask[i];
+        }
+        if (valid) memcpy(valid + start, mask, n);
+    }
+    free(regs);
+    free(storage);
+    return failed;
+}
+
+void calc_free_program(calc_program_t* prog) {
+    if (prog == NULL) return;
+    free(prog->code);
+    free(prog->consts);
+    free(prog);
+}
+
+void calc_print_program(const calc_program_t* prog, FILE* out) {
+    static const char* names[] = { "add", "sub", "mul", "div", "neg" };
+    for (uint16_t i = 0; i < prog->const_count; i++) {
+        fprintf(out, "r%u = %lld\n", i, (long long)prog->consts[i]);
+    }
+    for (uint16_t i = 0; i < prog->column_count; i++) {
+        fprintf(out, "r%u = column %u\n", prog->const_count + i, i);
+    }
+    for (uint32_t i = 0; i < prog->count; i++) {
+        const calc_insn_t* insn = &prog->code[i];
+        if (insn->op == CALC_OP_NEG) {
+            fprintf(out, "r%u = neg r%u\n", insn->dst, insn->a);
+        } else {
+            fprintf(out, "r%u = %s r%u, r%u\n", insn->dst, names[insn->op], insn->a, insn->b);
+        }
     }
+    fprintf(out, "ret r%u\n", prog->result);
 }
 
 // --- AST Printing ---
@@ -54,6 +429,7 @@ const char* calc_tag_to_string(tag_t tag) {
         case CALC_T_MUL: return "MUL";
         case CALC_T_DIV: return "DIV";
         case CALC_T_NEG: return "NEG";
+        case CALC_T_VAR: return "VAR";
         default: return "UNKNOWN";
     }
 }
@@ -86,6 +462,7 @@ void print_calculator_ast(ast_t* ast) {
 void init_calculator_parser(combinator_t** p) {
     combinator_t *factor = expect(multi(new_combinator(), CALC_T_NONE,
         expect(token(integer(CALC_T_INT)), "Expected an integer"),
+        token(cident(CALC_T_VAR)),
         between(
             expect(token(match("(")), "Expected '('"),
             expect(token(match(")")), "Expected ')'"),
@@ -5,13 +5,64 @@
 
 // --- Custom Tags for Calculator ---
 typedef enum {
-    CALC_T_NONE, CALC_T_INT, CALC_T_ADD, CALC_T_SUB, CALC_T_MUL, CALC_T_DIV, CALC_T_NEG
+    CALC_T_NONE, CALC_T_INT, CALC_T_ADD, CALC_T_SUB, CALC_T_MUL, CALC_T_DIV, CALC_T_NEG, CALC_T_VAR
 } calc_tag_t;
 
+// Values for the variables of an expression: names[i] is bound to values[i].
+typedef struct {
+    const char* const* names;
+    const int64_t* values;
+    size_t count;
+} calc_bindings_t;
+
 // --- Function Declarations ---
 void init_calculator_parser(combinator_t** p);
+// Aborts on expressions that cannot be evaluated (division by zero, ...).
 long eval(ast_t *ast);
+// Like eval(), but reports such expressions instead: returns false and sets
+// *error (if given) to a static message.
+bool eval_checked(ast_t* ast, long* result, const char** error);
+// eval_checked() with variables; unbound ones are an error.
+bool eval_bound(ast_t* ast, const calc_bindings_t* vars, long* result, const char** error);
 void print_calculator_ast(ast_t* ast);
 const char* calc_tag_to_string(tag_t tag);
 
+// --- Bytecode ---
+// An expression compiled for repeated evaluation. Instructions work on a
+// file of 64-bit registers: constants first (preloaded from `consts`),
+// then one per input column (the expression's variables), then
+// temporaries. Constant subexpressions are folded at compile time; ones
+// that would fail (division by zero) are left for calc_run().
+typedef enum { CALC_OP_ADD, CALC_OP_SUB, CALC_OP_MUL, CALC_OP_DIV, CALC_OP_NEG } calc_opcode;
+
+typedef struct {
+    uint8_t op;               // calc_opcode
+    uint16_t dst, a, b;       // registers; b unused by NEG
+} calc_insn_t;
+
+typedef struct {
+    calc_insn_t* code;
+    uint32_t count;
+    int64_t* consts;
+    uint16_t const_count;
+    uint16_t column_count;
+    uint16_t reg_count;
+    uint16_t result;          // register holding the value at the end
+} calc_program_t;
+
+// Binds variable columns[i] to column i. Returns NULL and sets *error (if
+// given) for ASTs that cannot be compiled: out-of-range literals, unbound
+// variables, unknown nodes, more than 65535 registers.
+calc_program_t* calc_compile(ast_t* ast, const char* const* columns, size_t column_count, const char** error);
+// Evaluates one row; row[i] is the value of column i (NULL without
+// columns). Same result and errors as eval_bound().
+bool calc_run(const calc_program_t* prog, const int64_t* row, long* result, const char** error);
+// Evaluates `rows` rows of the columns (columns[i] has the values of
+// column i) into out[0, rows), a block of rows at a time. Rows that fail
+// get 0 in `out` and, if `valid` is given, 0 in valid[row] (1 otherwise).
+// Returns how many rows failed.
+size_t calc_run_columns(const calc_program_t* prog, const int64_t* const* columns, size_t rows, int64_t* out, uint8_t* valid);
+void calc_free_program(calc_program_t* prog);
+void calc_print_program(const calc_program_t* prog, FILE* out);
+
 #endif // CALCULATOR_LOGIC_H
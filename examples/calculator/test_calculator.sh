@@ -76,8 +76,20 @@ echo "[2] Testing failure cases..."
 check_fail "1 + * 2" "Syntax error (double operator)"
 check_fail "(1 + 2" "Syntax error (unmatched parenthesis)"
 check_fail "1 / 0" "Runtime error (division by zero)"
-check_fail "abc" "Syntax error (invalid characters)"
-
+check_fail "abc" "Runtime error (unbound variable)"
+check_fail "1 + \$" "Syntax error (invalid characters)"
+
+# --- Batch Mode ---
+echo "[3] Testing batch mode..."
+TEST_COUNT=$((TEST_COUNT + 1))
+BATCH_EXPECTED=$(printf '3\n9\nerror: line 4: Division by zero\n-2\n')
+BATCH_ACTUAL=$(printf '1 + 2\n(1 + 2) * 3\n\n1 / 0\n5 * -2 + 8\n' | "$CALCULATOR_EXEC" --batch 2>/dev/null || true)
+if [ "$BATCH_ACTUAL" = "$BATCH_EXPECTED" ]; then
+    echo "  [PASS] Batch: one result per expression, errors reported in place"
+else
+    echo "  [FAIL] Batch: Expected '$BATCH_EXPECTED', got '$BATCH_ACTUAL'"
+    FAIL_COUNT=$((FAIL_COUNT + 1))
+fi
 
 # --- Final Summary ---
 echo "--------------------"
@@ -0,0 +1,360 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "json_columns.h"
+#include "json_ondemand.h"
+
+static size_t value_size(json_column_type type) {
+    switch (type) {
+        case JSON_COLUMN_BOOL: return sizeof(uint8_t);
+        case JSON_COLUMN_INT: return sizeof(int64_t);
+        case JSON_COLUMN_DOUBLE: return sizeof(double);
+        case JSON_COLUMN_STRING: return sizeof(json_string_span_t);
+        default: return 0;
+    }
+}
+
+static size_t null_words(size_t rows) {
+    return (rows + 63) / 64;
+}
+
+static void set_type(json_table_t* table, json_column_t* column, json_column_type type) {
+    column->type = type;
+    if (table->capacity > 0) {
+        column->values.bools = (uint8_t*)safe_malloc(table->capacity * value_size(type));
+    }
+}
+
+static void grow_rows(json_table_t* table, size_t needed) {
+    if (needed <= table->capacity) return;
+    size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+    while (capacity < needed) capacity *= 2;
+    for (size_t i = 0; i < table->column_count; i++) {
+        json_column_t* c = &table->columns[i];
+        if (c->type != JSON_COLUMN_NULL) {
+            void* values = realloc(c->values.bools, capacity * value_size(c->type));
+            if (!values) exception("realloc failed");
+            c->values.bools = (uint8_t*)values;
+        }
+        uint64_t* nulls = realloc(c->nulls, null_words(capacity) * sizeof(uint64_t));
+        if (!nulls) exception("realloc failed");
+        memset(nulls + null_words(table->capacity), 0, (null_words(capacity) - null_words(table->capacity)) * sizeof(uint64_t));
+        c->nulls = nulls;
+    }
+    table->capacity = capacity;
+}
+
+static void set_null(json_column_t* column, size_t row) {
+    uint64_t bit = 1ull << (row % 64);
+    if (column->nulls[row / 64] & bit) return;
+    column->nulls[row / 64] |= bit;
+    column->null_count++;
+}
+
+static json_column_t* add_column(json_table_t* table, const char* name, size_t length, json_column_type type) {
+    json_column_t* columns = realloc(table->columns, (table->column_count + 1) * sizeof(json_column_t));
+    if (!columns) exception("realloc failed");
+    table->columns = columns;
+    json_column_t* c = &columns[table->column_count++];
+    memset(c, 0, sizeof(*c));
+    c->name = (char*)safe_malloc(length + 1);
+    memcpy(c->name, name, length);
+    c->name[length] = '\0';
+    c->name_length = length;
+    c->nulls = (uint64_t*)calloc(null_words(table->capacity) + 1, sizeof(uint64_t));
+    if (!c->nulls) exception("calloc failed");
+    if (type != JSON_COLUMN_NULL) set_type(table, c, type);
+    // Rows decoded before the column existed lack it.
+    for (size_t r = 0; r < table->rows; r++) set_null(c, r);
+    return c;
+}
+
+json_column_t* json_table_column(json_table_t* table, const char* name, size_t length) {
+    for (size_t i = 0; i < table->column_count; i++) {
+        json_column_t* c = &table->columns[i];
+        if (c->name_length == length && memcmp(c->name, name, length) == 0) return c;
+    }
+    return NULL;
+}
+
+// Whether `c` can take `v`, inferring its type if need be.
+static bool fits_column(const json_table_t* table, const json_column_t* c, const json_value_t* v) {
+    bool infer = !table->declared;
+    switch (v->kind) {
+        case JSON_VALUE_NULL:
+            return true;
+        case JSON_VALUE_BOOL:
+            return c->type == JSON_COLUMN_BOOL || (c->type == JSON_COLUMN_NULL && infer);
+        case JSON_VALUE_NUMBER:
+            return c->type == JSON_COLUMN_DOUBLE || (c->type == JSON_COLUMN_INT && (v->integral || infer)) ||
+                   (c->type == JSON_COLUMN_NULL && infer);
+        case JSON_VALUE_STRING:
+            return (c->type == JSON_COLUMN_STRING || (c->type == JSON_COLUMN_NULL && infer)) && v->length <= UINT32_MAX;
+        default:
+            return false;
+    }
+}
+
+// Stores `v`, which fits_column() accepted, in row `row`.
+static void store(json_table_t* table, json_column_t* c, size_t row, const json_value_t* v) {
+    switch (v->kind) {
+        case JSON_VALUE_NULL:
+            set_null(c, row);
+            break;
+        case JSON_VALUE_BOOL:
+            if (c->type == JSON_COLUMN_NULL) set_type(table, c, JSON_COLUMN_BOOL);
+            c->values.bools[row] = v->boolean;
+            break;
+        case JSON_VALUE_NUMBER:
+            if (c->type == JSON_COLUMN_NULL) set_type(table, c, v->integral ? JSON_COLUMN_INT : JSON_COLUMN_DOUBLE);
+            if (c->type == JSON_COLUMN_INT && !v->integral) {
+                // Promoted in place; both are eight bytes.
+                for (size_t r = 0; r < row; r++) c->values.reals[r] = (double)c->values.ints[r];
+                c->type = JSON_COLUMN_DOUBLE;
+            }
+            if (c->type == JSON_COLUMN_INT) {
+                c->values.ints[row] = v->integer;
+            } else {
+                c->values.reals[row] = v->real;
+            }
+            break;
+        case JSON_VALUE_STRING:
+            if (c->type == JSON_COLUMN_NULL) set_type(table, c, JSON_COLUMN_STRING);
+            c->values.strings[row] = (json_string_span_t){ v->text, (uint32_t)v->length, v->escaped };
+            break;
+        default:
+            break;
+    }
+}
+
+// Per-row state of decode_row(), one entry per column
+typedef struct {
+    uint8_t* seen;
+    json_value_t* values;
+    size_t capacity;
+} row_scratch;
+
+static void reserve_scratch(row_scratch* scratch, size_t columns) {
+    if (columns <= scratch->capacity) return;
+    size_t capacity = scratch->capacity ? scratch->capacity * 2 : 16;
+    while (capacity < columns) capacity *= 2;
+    uint8_t* seen = realloc(scratch->seen, capacity);
+    if (!seen) exception("realloc failed");
+    scratch->seen = seen;
+    json_value_t* values = realloc(scratch->values, capacity * sizeof(json_value_t));
+    if (!values) exception("realloc failed");
+    scratch->values = values;
+    memset(scratch->seen + scratch->capacity, 0, capacity - scratch->capacity);
+    scratch->capacity = capacity;
+}
+
+static void free_column(json_column_t* c) {
+    free(c->name);
+    free(c->values.bools);
+    free(c->nulls);
+}
+
+static size_t skip_space(const char* text, size_t length, size_t i) {
+    while (i < length && isspace((unsigned char)text[i])) i++;
+    return i;
+}
+
+// The decoded key, in `buf` if it has escapes. False if it does not fit.
+static bool key_name(const json_value_t* key, char* buf, size_t cap, const char** name, size_t* length) {
+    if (!key->escaped) {
+        *name = key->text;
+        *length = key->length;
+        return true;
+    }
+    if (key->length > cap) return false;
+    long n = json_value_string(key, buf);
+    if (n < 0) return false;
+    *name = buf;
+    *length = (size_t)n;
+    return true;
+}
+
+// Decodes the element at text[*pos] into row `row`. Returns false if it is
+// malformed; *fits is cleared, and *pos and the table left alone, if it
+// does not fit. The row is checked in full before anything is stored.
+static bool decode_row(json_table_t* table, const char* text, size_t length, size_t* pos, size_t row,
+                       row_scratch* scratch, bool* fits) {
+    size_t i = *pos;
+    *fits = false;
+    if (text[i] != '{') return true;
+    // Keys come from the first object that fits; until then there are no
+    // columns, and those of a row that turns out not to fit are dropped.
+    bool infer_keys = !table->declared && table->column_count == 0;
+    memset(scratch->seen, 0, table->column_count);
+    i = skip_space(text, length, i + 1);
+    size_t member = 0;
+    bool deviates = false;
+    if (i < length && text[i] == '}') {
+        i++;
+    } else {
+        while (1) {
+            if (i >= length || text[i] != '"') return false;
+            json_value_t key;
+            size_t n = json_read_value(text + i, length - i, &key);
+            if (n == 0) return false;
+            i += n;
+            i = skip_space(text, length, i);
+            if (i >= length || text[i] != ':') return false;
+            json_value_t* value = NULL;
+            json_value_t skipped;
+            if (!deviates) {
+                char buf[256];
+                const char* name;
+                size_t name_length;
+                json_column_t* c = NULL;
+                if (key_name(&key, buf, sizeof(buf), &name, &name_length)) {
+                    // Usually the keys come in the order of the columns.
+                    if (member < table->column_count && table->columns[member].name_length == name_length &&
+                        memcmp(table->columns[member].name, name, name_length) == 0) {
+                        c = &table->columns[member];
+                    } else {
+                        c = json_table_column(table, name, name_length);
+                    }
+                    if (c == NULL && infer_keys) {
+                        c = add_column(table, name, name_length, JSON_COLUMN_NULL);
+                        reserve_scratch(scratch, table->column_count);
+                        scratch->seen[table->column_count - 1] = 0;
+                    }
+                }
+                size_t j = c ? (size_t)(c - table->columns) : 0;
+                if (c == NULL || scratch->seen[j]) {
+                    deviates = true;
+                } else {
+                    scratch->seen[j] = 1;
+                    value = &scratch->values[j];
+                    member++;
+                }
+            }
+            // A deviating row is still read to its end to tell whether it
+            // is malformed.
+            n = json_read_value(text + i + 1, length - i - 1, value ? value : &skipped);
+            if (n == 0) return false;
+            i += 1 + n;
+            if (value != NULL && !fits_column(table, &table->columns[value - scratch->values], value)) deviates = true;
+
+            i = skip_space(text, length, i);
+            if (i < length && text[i] == ',') {
+                i = skip_space(text, length, i + 1);
+            } else if (i < length && text[i] == '}') {
+                i++;
+                break;
+            } else {
+                return false;
+            }
+        }
+    }
+    if (deviates) {
+        if (infer_keys) {
+            for (size_t j = 0; j < table->column_count; j++) free_column(&table->columns[j]);
+            table->column_count = 0;
+        }
+        return true;
+    }
+    for (size_t j = 0; j < table->column_count; j++) {
+        if (scratch->seen[j]) {
+            store(table, &table->columns[j], row, &scratch->values[j]);
+        } else {
+            set_null(&table->columns[j], row);
+        }
+    }
+    *pos = i;
+    *fits = true;
+    return true;
+}
+
+// Parses the element at text[*pos] into an AST of its own.
+static bool keep_other(json_table_t* table, const char* text, size_t length, size_t* pos, size_t row,
+                       combinator_t* parser) {
+    json_value_t v;
+    size_t n = json_read_value(text + *pos, length - *pos, &v);
+    if (n == 0) return false;
+    input_t in;
+    memset(&in, 0, sizeof(in));
+    init_input_buffer(&in, (char*)text + *pos, (int)n);
+    ParseResult res = parse(&in, parser);
+    if (!res.is_success) {
+        free_error(res.value.error);
+        return false;
+    }
+    if (in.start < in.length) {
+        free_ast(res.value.ast);
+        return false;
+    }
+    if (table->other_count == table->others_capacity) {
+        table->others_capacity = table->others_capacity ? table->others_capacity * 2 : 16;
+        json_other_row_t* others = realloc(table->others, table->others_capacity * sizeof(json_other_row_t));
+        if (!others) exception("realloc failed");
+        table->others = others;
+    }
+    table->others[table->other_count++] = (json_other_row_t){ row, res.value.ast };
+    for (size_t j = 0; j < table->column_count; j++) set_null(&table->columns[j], row);
+    *pos += n;
+    return true;
+}
+
+int json_columns_decode(const char* text, size_t length, const json_column_spec_t* shape, size_t shape_count,
+                        combinator_t* parser, json_table_t* table) {
+    memset(table, 0, sizeof(*table));
+    table->declared = shape != NULL;
+    for (size_t i = 0; i < shape_count; i++) add_column(table, shape[i].name, strlen(shape[i].name), shape[i].type);
+    row_scratch scratch = { NULL, NULL, 0 };
+    reserve_scratch(&scratch, table->column_count + 1);
+
+    size_t i = skip_space(text, length, 0);
+    if (i >= length || text[i] != '[') goto malformed;
+    i = skip_space(text, length, i + 1);
+    if (i < length && text[i] == ']') {
+        i++;
+    } else {
+        while (1) {
+            if (i >= length) goto malformed;
+            grow_rows(table, table->rows + 1);
+            bool fits;
+            if (!decode_row(table, text, length, &i, table->rows, &scratch, &fits)) goto malformed;
+            if (!fits && !keep_other(table, text, length, &i, table->rows, parser)) goto malformed;
+            table->rows++;
+            i = skip_space(text, length, i);
+            if (i < length && text[i] == ',') {
+                i = skip_space(text, length, i + 1);
+            } else if (i < length && text[i] == ']') {
+                i++;
+                break;
+            } else {
+                goto malformed;
+            }
+        }
+    }
+    if (skip_space(text, length, i) != length) goto malformed;
+    free(scratch.seen);
+    free(scratch.values);
+    return 0;
+
+malformed:
+    free(scratch.seen);
+    free(scratch.values);
+    json_table_free(table);
+    return -1;
+}
+
+void json_table_free(json_table_t* table) {
+    for (size_t i = 0; i < table->column_count; i++) free_column(&table->columns[i]);
+    free(table->columns);
+    for (size_t i = 0; i < table->other_count; i++) free_ast(table->others[i].ast);
+    free(table->others);
+    memset(table, 0, sizeof(*table));
+}
+
+size_t json_table_bytes(const json_table_t* table) {
+    size_t bytes = sizeof(*table) + table->column_count * sizeof(json_column_t) +
+                   table->others_capacity * sizeof(json_other_row_t);
+    for (size_t i = 0; i < table->column_count; i++) {
+        const json_column_t* c = &table->columns[i];
+        bytes += c->name_length + 1 + table->capacity * value_size(c->type) + null_words(table->capacity) * sizeof(uint64_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,84 @@
+#ifndef JSON_COLUMNS_H
+#define JSON_COLUMNS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "parser.h"
+#include "json_ondemand.h"
+
+// Columnar decoding of a JSON array of objects that share one key set, as
+// analytics exports are. Instead of an AST per element, each key becomes a
+// typed column with one entry per row and a null bitmap; key names are
+// stored once. Elements that do not fit the shape (a key the shape lacks,
+// a repeated key, a nested value, a value of another type, or no object at
+// all) are parsed into ordinary ASTs and kept aside; their row is null in
+// every column.
+
+typedef enum {
+    JSON_COLUMN_NULL,         // only nulls so far; no values array
+    JSON_COLUMN_BOOL,
+    JSON_COLUMN_INT,
+    JSON_COLUMN_DOUBLE,
+    JSON_COLUMN_STRING
+} json_column_type;
+
+typedef struct {
+    char* name;               // decoded key, NUL-terminated
+    size_t name_length;
+    json_column_type type;
+    union {
+        uint8_t* bools;
+        int64_t* ints;
+        double* reals;
+        json_string_span_t* strings;
+    } values;                 // `rows` entries; meaningless where null
+    uint64_t* nulls;          // bit r % 64 of word r / 64: row r is null
+    size_t null_count;
+} json_column_t;
+
+typedef struct {
+    size_t row;
+    ast_t* ast;
+} json_other_row_t;
+
+typedef struct {
+    size_t rows;
+    json_column_t* columns;
+    size_t column_count;
+    json_other_row_t* others; // in row order
+    size_t other_count;
+    // Internal
+    size_t capacity;
+    size_t others_capacity;
+    bool declared;
+} json_table_t;
+
+// A declared column: the type its values must have. Integers are accepted
+// for a JSON_COLUMN_DOUBLE column.
+typedef struct {
+    const char* name;
+    json_column_type type;
+} json_column_spec_t;
+
+// Decodes the JSON array text[0, length) into `table`. With shape == NULL
+// the columns are the keys of the first object that fits (scalar values,
+// no repeated key), typed by the first non-null value of each; an integer
+// column becomes a double column when a fraction turns up. A deviating
+// element changes no column. Missing keys are null. Deviating elements are parsed
+// with `parser` (see json_parser()). Strings point into `text`, which must
+// outlive the table. Returns 0, or -1 if the text is not an array or is
+// malformed.
+int json_columns_decode(const char* text, size_t length, const json_column_spec_t* shape, size_t shape_count,
+                        combinator_t* parser, json_table_t* table);
+void json_table_free(json_table_t* table);
+
+static inline bool json_column_is_null(const json_column_t* column, size_t row) {
+    return (column->nulls[row / 64] >> (row % 64)) & 1;
+}
+
+// Column named name[0, length), or NULL
+json_column_t* json_table_column(json_table_t* table, const char* name, size_t length);
+// Bytes held by the table, excluding the ASTs of deviating rows
+size_t json_table_bytes(const json_table_t* table);
+
+#endif // JSON_COLUMNS_H
@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "json_index.h"
+#include "json_parser.h"
+
+//=============================================================================
+// Stage 1: Structural Index
+//=============================================================================
+
+typedef struct {
+    uint64_t quote, backslash, op, space, newline;
+} block_classes;
+
+// Classifies p[0, 64). Whitespace is what isspace() accepts, as in the
+// grammar.
+static void classify_block(const char* p, block_classes* b) {
+    memset(b, 0, sizeof(*b));
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');      // '[' | 0x20
+    const __m128i close = _mm_set1_epi8('}');     // ']' | 0x20
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below_tab = _mm_set1_epi8('\t' - 1);
+    const __m128i above_cr = _mm_set1_epi8('\r' + 1);
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+        __m128i folded = _mm_or_si128(v, case_bit);
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        // Signed compares: bytes >= 0x80 are negative and never whitespace.
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                  _mm_and_si128(_mm_cmpgt_epi8(v, below_tab), _mm_cmplt_epi8(v, above_cr)));
+        int shift = 16 * k;
+        b->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        b->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << shift;
+        b->op |= (uint64_t)(unsigned)_mm_movemask_epi8(op) << shift;
+        b->space |= (uint64_t)(unsigned)_mm_movemask_epi8(ws) << shift;
+        b->newline |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << shift;
+    }
+#else
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ull << i;
+        unsigned char c = (unsigned char)p[i];
+        if (c == '"') b->quote |= bit;
+        else if (c == '\\') b->backslash |= bit;
+        else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') b->op |= bit;
+        else if (c == ' ' || (c >= '\t' && c <= '\r')) b->space |= bit;
+        if (c == '\n') b->newline |= bit;
+    }
+#endif
+}
+
+// Characters preceded by an odd-length run of backslashes. A run may carry
+// over from the previous block; *carry says whether it did.
+static uint64_t escaped_characters(uint64_t backslash, uint64_t* carry) {
+    const uint64_t even_bits = 0x5555555555555555ull;
+    const uint64_t odd_bits = ~even_bits;
+    uint64_t starts = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = even_bits ^ *carry;
+    uint64_t even_starts = starts & even_start_mask;
+    uint64_t odd_starts = starts & ~even_start_mask;
+    // Adding a run's start bit to it carries out just past its end.
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries;
+    bool overflow = __builtin_add_overflow(backslash, odd_starts, &odd_carries);
+    odd_carries |= *carry;
+    *carry = overflow ? 1 : 0;
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+    return (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+}
+
+// Bit i is the XOR of bits 0..i: set from an opening quote up to, but not
+// including, its closing quote.
+static uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+int json_index_build(json_index_t* index, const char* text, size_t length) {
+    index->count = 0;
+    if (length >= UINT32_MAX) return -1;
+    size_t blocks = (length + 63) / 64;
+    if (blocks > index->newline_capacity) {
+        uint64_t* words = realloc(index->newlines, sizeof(uint64_t) * blocks);
+        if (!words) exception("realloc failed");
+        index->newlines = words;
+        index->newline_capacity = blocks;
+    }
+
+    uint64_t escape_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    char tail[64];
+    for (size_t b = 0; b < blocks; b++) {
+        const char* p = text + b * 64;
+        if (length - b * 64 < 64) {
+            // Whitespace padding classifies as nothing.
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, length - b * 64);
+            p = tail;
+        }
+        block_classes c;
+        classify_block(p, &c);
+        uint64_t quotes = c.quote & ~escaped_characters(c.backslash, &escape_carry);
+        uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+        // Anything else outside strings belongs to a number or literal.
+        uint64_t scalar = ~(c.op | c.space | quotes | in_string);
+        uint64_t scalar_starts = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+        uint64_t structural = (c.op & ~in_string) | (quotes & in_string) | scalar_starts;
+        index->newlines[b] = c.newline;
+
+        if (index->count + 64 > index->capacity) {
+            size_t capacity = index->capacity ? index->capacity * 2 : 1024;
+            uint32_t* positions = realloc(index->positions, sizeof(uint32_t) * capacity);
+            if (!positions) exception("realloc failed");
+            index->positions = positions;
+            index->capacity = capacity;
+        }
+        uint32_t* out = index->positions + index->count;
+        uint32_t base = (uint32_t)(b * 64);
+        while (structural != 0) {
+            *out++ = base + (uint32_t)__builtin_ctzll(structural);
+            structural &= structural - 1;
+        }
+        index->count = (size_t)(out - index->positions);
+    }
+    return in_string_carry ? -1 : 0;
+}
+
+void json_index_free(json_index_t* index) {
+    free(index->positions);
+    free(index->newlines);
+    memset(index, 0, sizeof(*index));
+}
+
+//=============================================================================
+// Stage 2: AST Construction
+//=============================================================================
+
+typedef struct {
+    combinator_t* string;
+    combinator_t* number;
+    combinator_t* null;
+    combinator_t* boolean;
+    combinator_t* grammar;    // json_parser(), for everything stage 2 rejects
+    size_t indexed;
+    size_t fallbacks;
+} indexed_args;
+
+typedef struct {
+    ast_t* node;              // JSON_T_SEQ; NULL when recognizing only
+    ast_t* last;              // last element so far
+    ast_t* key;               // objects: key of the member being parsed
+    char close;               // ']' or '}'
+} index_frame;
+
+typedef struct {
+    indexed_args* args;
+    const json_index_t* index;
+    input_t* in;
+    int base;                 // input offset of index position 0
+    bool build;
+} index_walk;
+
+// Moves the input forward to `pos`, counting the newlines skipped with the
+// stage-1 bitmap instead of the bytes.
+static void skip_to(index_walk* w, int pos) {
+    input_t* in = w->in;
+    size_t from = (size_t)(in->start - w->base), to = (size_t)(pos - w->base);
+    if (from >= to) {
+        in->start = pos;
+        return;
+    }
+    int lines = 0;
+    size_t last = 0;
+    size_t first_word = from >> 6, last_word = (to - 1) >> 6;
+    for (size_t i = first_word; i <= last_word; i++) {
+        uint64_t bits = w->index->newlines[i];
+        if (i == first_word) bits &= ~0ull << (from & 63);
+        if (i == last_word && ((to - 1) & 63) != 63) bits &= (2ull << ((to - 1) & 63)) - 1;
+        if (bits != 0) {
+            lines += __builtin_popcountll(bits);
+            last = i * 64 + 63 - (size_t)__builtin_clzll(bits);
+        }
+    }
+    if (lines > 0) {
+        in->line += lines;
+        in->col = (int)(to - last);
+    } else {
+        in->col += (int)(to - from);
+    }
+    in->start = pos;
+}
+
+static int position_at(index_walk* w, size_t i) {
+    return i < w->index->count ? w->base + (int)w->index->positions[i] : w->in->length;
+}
+
+// Parses the string, number or literal at index position i with the
+// grammar's own scanner, which has to stop where the next structural
+// position or whitespace begins. Returns false if it does not.
+static bool parse_scalar(index_walk* w, size_t i, ast_t** out) {
+    input_t* in = w->in;
+    int at = position_at(w, i);
+    combinator_t* p;
+    switch (in->buffer[at]) {
+        case '"': p = w->args->string; break;
+        case 'n': p = w->args->null; break;
+        case 't': case 'f': p = w->args->boolean; break;
+        default: p = w->args->number; break;
+    }
+    skip_to(w, at);
+    ParseResult res = parse(in, p);
+    if (!res.is_success) {
+        free_error(res.value.error);
+        return false;
+    }
+    int next = position_at(w, i + 1);
+    if (in->start > next || (in->start < next && !isspace((unsigned char)in->buffer[in->start]))) {
+        free_ast(res.value.ast);
+        return false;
+    }
+    *out = w->build ? res.value.ast : NULL;
+    return true;
+}
+
+// Links a finished value into the innermost container.
+static void attach(index_frame* top, ast_t* value) {
+    if (top->close == '}') {
+        top->key->next = value;
+    } else {
+        if (top->last) top->last->next = value; else top->node->child = value;
+        top->last = value;
+    }
+}
+
+static ast_t* new_node(tag_t typ, ast_t* child) {
+    ast_t* ast = new_ast();
+    ast->typ = typ;
+    ast->child = child;
+    ast->next = NULL;
+    return ast;
+}
+
+enum { WALK_VALUE, WALK_MEMBER, WALK_AFTER };
+
+// Builds the value at in->start from an index of the input from there on.
+// Returns false as soon as the input deviates from the grammar; the caller
+// rewinds.
+static bool walk_index(index_walk* w, ast_t** out) {
+    const char* buf = w->in->buffer;
+    size_t count = w->index->count, i = 0;
+    index_frame* stack = NULL;
+    size_t depth = 0, capacity = 0;
+    ast_t* root = NULL;
+    bool ok = false;
+    int state = WALK_VALUE;
+
+    while (1) {
+        if (state == WALK_VALUE) {
+            if (i == count) break;
+            char c = buf[position_at(w, i)];
+            ast_t* value = NULL;
+            if (c == '{' || c == '[') {
+                if (w->build) value = new_node(JSON_T_SEQ, NULL);
+            } else if (c == '}' || c == ']' || c == ':' || c == ',') {
+                break;
+            } else if (!parse_scalar(w, i, &value)) {
+                break;
+            }
+            i++;
+            if (depth == 0) root = value; else if (w->build) attach(&stack[depth - 1], value);
+            if (c != '{' && c != '[') {
+                state = WALK_AFTER;
+                continue;
+            }
+            char close = c == '{' ? '}' : ']';
+            if (i < count && buf[position_at(w, i)] == close) {
+                // Empty; sep_by() yields ast_nil.
+                if (value) value->child = ast_nil;
+                i++;
+                state = WALK_AFTER;
+                continue;
+            }
+            if (depth == capacity) {
+                capacity = capacity ? capacity * 2 : 32;
+                index_frame* frames = realloc(stack, sizeof(index_frame) * capacity);
+                if (!frames) exception("realloc failed");
+                stack = frames;
+            }
+            stack[depth++] = (index_frame){ value, NULL, NULL, close };
+            state = close == '}' ? WALK_MEMBER : WALK_VALUE;
+        } else if (state == WALK_MEMBER) {
+            if (i == count || buf[position_at(w, i)] != '"') break;
+            ast_t* key = NULL;
+            if (!parse_scalar(w, i, &key)) break;
+            i++;
+            index_frame* top = &stack[depth - 1];
+            if (w->build) {
+                ast_t* member = new_node(JSON_T_ASSIGN, key);
+                if (top->last) top->last->next = member; else top->node->child = member;
+                top->last = member;
+                top->key = key;
+            }
+            if (i == count || buf[position_at(w, i)] != ':') break;
+            i++;
+            state = WALK_VALUE;
+        } else {
+            if (depth == 0) {
+                ok = true;
+                break;
+            }
+            if (i == count) break;
+            char c = buf[position_at(w, i++)];
+            index_frame* top = &stack[depth - 1];
+            if (c == ',') {
+                state = top->close == '}' ? WALK_MEMBER : WALK_VALUE;
+            } else if (c == top->close) {
+                depth--;
+            } else {
+                break;
+            }
+        }
+    }
+    free(stack);
+    if (!ok) {
+        if (root) free_ast(root);
+        return false;
+    }
+    // Trailing whitespace, as json_parser() consumes it
+    skip_to(w, position_at(w, i));
+    *out = w->build ? root : ast_nil;
+    return true;
+}
+
+static ParseResult indexed_fn(input_t* in, void* args, char* parser_name) {
+    (void)parser_name;
+    indexed_args* iargs = (indexed_args*)args;
+    // Sinks and limits see every combinator step, so those go the long way.
+    if (in->events == NULL && in->limits == NULL) {
+        json_index_t index;
+        memset(&index, 0, sizeof(index));
+        InputState state;
+        save_input_state(in, &state);
+        bool done = false;
+        ast_t* ast = NULL;
+        if (json_index_build(&index, in->buffer + in->start, (size_t)(in->length - in->start)) == 0) {
+            index_walk w = { iargs, &index, in, in->start, !in->recognize_only };
+            done = walk_index(&w, &ast);
+        }
+        json_index_free(&index);
+        if (done) {
+            __atomic_fetch_add(&iargs->indexed, 1, __ATOMIC_RELAXED);
+            return make_success(ast);
+        }
+        restore_input_state(in, &state);
+        __atomic_fetch_add(&iargs->fallbacks, 1, __ATOMIC_RELAXED);
+    }
+    return parse(in, iargs->grammar);
+}
+
+static void free_indexed_args(void* args) {
+    indexed_args* iargs = (indexed_args*)args;
+    free_combinator(iargs->string);
+    free_combinator(iargs->number);
+    free_combinator(iargs->null);
+    free_combinator(iargs->boolean);
+    free_combinator(iargs->grammar);
+    free(iargs);
+}
+
+combinator_t* json_indexed_parser(void) {
+    indexed_args* args = (indexed_args*)safe_malloc(sizeof(indexed_args));
+    // The same scanners and tags as json_parser()
+    args->string = json_string(JSON_T_STRING);
+    args->number = number(JSON_T_INT);
+    args->null = json_null(JSON_T_NONE);
+    args->boolean = json_bool(JSON_T_INT);
+    args->grammar = json_parser();
+    args->indexed = 0;
+    args->fallbacks = 0;
+
+    combinator_t* comb = new_combinator();
+    comb->args = args;
+    comb->free_args = free_indexed_args;
+    comb->fn = indexed_fn;
+    return comb;
+}
+
+void json_indexed_counts(combinator_t* p, size_t* indexed, size_t* fallbacks) {
+    indexed_args* args = (indexed_args*)p->args;
+    if (indexed) *indexed = __atomic_load_n(&args->indexed, __ATOMIC_RELAXED);
+    if (fallbacks) *fallbacks = __atomic_load_n(&args->fallbacks, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,40 @@
+#ifndef JSON_INDEX_H
+#define JSON_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "parser.h"
+
+// Two-stage JSON parsing in the style of simdjson. Stage 1 classifies the
+// input 64 bytes at a time into bitmasks (quotes, backslashes, structural
+// characters, whitespace) and turns them into an index of the positions
+// that matter. Stage 2 walks that index with an explicit stack and builds
+// the same AST as json_parser(), never looking at the whitespace between
+// tokens.
+
+typedef struct {
+    // Offsets of every '{', '}', '[', ']', ':' and ',' outside strings,
+    // every opening quote, and the first byte of every other scalar.
+    uint32_t* positions;
+    size_t count;
+    size_t capacity;
+    // Bit i % 64 of word i / 64 is set when text[i] is a newline.
+    uint64_t* newlines;
+    size_t newline_capacity;
+} json_index_t;
+
+// Stage 1 over text[0, length). Zero-initialize `index` before the first
+// call; its buffers are reused by later ones. Returns 0, or -1 if the text
+// ends inside a string or is 4 GiB or longer.
+int json_index_build(json_index_t* index, const char* text, size_t length);
+void json_index_free(json_index_t* index);
+
+// Drop-in replacement for json_parser(): parses the JSON value at the
+// current position through the structural index. Anything stage 2 does not
+// accept, and every parse with an event sink or resource limits, is handed
+// to the combinator grammar, so results and error reports are the same.
+combinator_t* json_indexed_parser(void);
+// How many parses with `p` took the index and how many fell back.
+void json_indexed_counts(combinator_t* p, size_t* indexed, size_t* fallbacks);
+
+#endif // JSON_INDEX_H
@@ -4,8 +4,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "parser.h"
 #include "json_parser.h"
+#include "json_ndjson.h"
+#include "json_index.h"
+#include "json_ondemand.h"
+#include "json_objects.h"
+#include "json_columns.h"
+#include "json_schema.h"
 
 void backtrace_handler(int sig) {
     unw_cursor_t cursor;
@@ -31,21 +38,499 @@ void backtrace_handler(int sig) {
     exit(sig);
 }
 
+// NDJSON mode: records arrive in file order; only failures are printed.
+static void print_record_error(const json_record_t* record, void* context) {
+    (void)context;
+    if (record->error == NULL) return;
+    printf("line %zu, col %d: %s\n", record->line, record->error->col, record->error->message);
+}
+
+static double seconds_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* read_file(const char* path, size_t* length) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) {
+        data[size] = '\0';
+        *length = (size_t)size;
+    }
+    return data;
+}
+
+// Best of `iterations` parses of the whole document with `parser`
+static double bench_parse(combinator_t* parser, char* data, size_t length, int iterations, bool* ok) {
+    double best = 0;
+    *ok = true;
+    for (int i = 0; i < iterations; i++) {
+        input_t in;
+        memset(&in, 0, sizeof(in));
+        init_input_buffer(&in, data, (int)length);
+        double start = seconds_now();
+        ParseResult res = parse(&in, parser);
+        double elapsed = seconds_now() - start;
+        if (res.is_success) free_ast(res.value.ast); else free_error(res.value.error);
+        if (!res.is_success || in.start < in.length) *ok = false;
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Compares the combinator grammar with the structural-index parser.
+static const char* find_status_name(json_find_status status) {
+    switch (status) {
+        case JSON_FIND_OK: return "found";
+        case JSON_FIND_MISSING: return "not found";
+        case JSON_FIND_BAD_PATH: return "bad path";
+        default: return "malformed document";
+    }
+}
+
+// Prints the value at `path`: decoded scalars, containers as written.
+static int print_found(const char* text, size_t length, const char* path) {
+    json_value_t v;
+    json_find_status status = json_find(text, length, path, &v);
+    if (status != JSON_FIND_OK) {
+        fprintf(stderr, "%s: %s\n", path, find_status_name(status));
+        return 1;
+    }
+    if (v.kind == JSON_VALUE_STRING) {
+        char* s = malloc(v.length + 1);
+        long n = s ? json_value_string(&v, s) : -1;
+        if (n >= 0) printf("\"%.*s\"\n", (int)n, s);
+        free(s);
+        if (n < 0) {
+            fprintf(stderr, "%s: %s\n", path, find_status_name(JSON_FIND_MALFORMED));
+            return 1;
+        }
+    } else if (v.kind == JSON_VALUE_NUMBER && v.integral) {
+        printf("%lld\n", (long long)v.integer);
+    } else if (v.kind == JSON_VALUE_NUMBER) {
+        printf("%.17g\n", v.real);
+    } else {
+        printf("%.*s\n", (int)v.length, v.text);
+    }
+    return 0;
+}
+
+static int run_bench(const char* path, int iterations, const char* find) {
+    size_t length = 0;
+    char* data = read_file(path, &length);
+    if (data == NULL) {
+        perror(path);
+        return 1;
+    }
+    ast_nil = new_ast();
+    ast_nil->typ = JSON_T_NONE;
+
+    double stage1 = 0;
+    json_index_t index;
+    memset(&index, 0, sizeof(index));
+    for (int i = 0; i < iterations; i++) {
+        double start = seconds_now();
+        json_index_build(&index, data, length);
+        double elapsed = seconds_now() - start;
+        if (i == 0 || elapsed < stage1) stage1 = elapsed;
+    }
+    size_t structurals = index.count;
+    json_index_free(&index);
+
+    combinator_t* grammar = json_parser();
+    combinator_t* indexed = json_indexed_parser();
+    bool grammar_ok, indexed_ok;
+    double slow = bench_parse(grammar, data, length, iterations, &grammar_ok);
+    double fast = bench_parse(indexed, data, length, iterations, &indexed_ok);
+    size_t fallbacks = 0;
+    json_indexed_counts(indexed, NULL, &fallbacks);
+
+    double mb = length / 1e6;
+    printf("Document: %zu bytes, %zu structural positions%s\n", length, structurals, grammar_ok ? "" : " (invalid)");
+    printf("Stage 1 only:     %8.2f MB/s\n", mb / stage1);
+    printf("Combinator parse: %8.2f MB/s\n", mb / slow);
+    printf("Indexed parse:    %8.2f MB/s (%.1fx)%s\n", mb / fast, slow / fast, fallbacks ? ", fell back to the grammar" : "");
+    if (find != NULL) {
+        double best = 0;
+        json_value_t v;
+        json_find_status status = JSON_FIND_OK;
+        for (int i = 0; i < iterations; i++) {
+            double start = seconds_now();
+            status = json_find(data, length, find, &v);
+            double elapsed = seconds_now() - start;
+            if (i == 0 || elapsed < best) best = elapsed;
+        }
+        printf("On-demand %s: %.3f ms (%s)\n", find, best * 1e3, find_status_name(status));
+    }
+
+    free_combinator(indexed);
+    free_combinator(grammar);
+    free(ast_nil);
+    free(data);
+    return grammar_ok == indexed_ok ? 0 : 1;
+}
+
+// Looks up every key of a generated object with `keys` members, by walking
+// and through the key index.
+static int run_key_bench(size_t keys, int iterations) {
+    size_t cap = keys * 40 + 16, len = 0;
+    char* doc = malloc(cap);
+    if (doc == NULL) return 1;
+    doc[len++] = '{';
+    for (size_t i = 0; i < keys; i++) {
+        len += (size_t)snprintf(doc + len, cap - len, "%s\"field_%zu\": %zu", i ? ", " : "", i, i);
+    }
+    doc[len++] = '}';
+    ast_nil = new_ast();
+    ast_nil->typ = JSON_T_NONE;
+    combinator_t* parser = json_parser();
+    input_t in;
+    memset(&in, 0, sizeof(in));
+    init_input_buffer(&in, doc, (int)len);
+    ParseResult res = parse(&in, parser);
+    if (!res.is_success) {
+        free_error(res.value.error);
+        free_combinator(parser);
+        free(doc);
+        return 1;
+    }
+    ast_t* obj = res.value.ast;
+
+    // Formatted up front so the timings are of the lookups alone
+    char* names = malloc(keys * 32);
+    size_t* lengths = malloc(keys * sizeof(size_t));
+    if (names == NULL || lengths == NULL) exception("malloc failed");
+    for (size_t i = 0; i < keys; i++) lengths[i] = (size_t)snprintf(names + i * 32, 32, "field_%zu", i);
+
+    double build = 0, walk = 0, hashed = 0;
+    size_t found = 0;
+    json_object_index_t* index = NULL;
+    for (int it = 0; it < iterations; it++) {
+        double start = seconds_now();
+        json_object_index_t* fresh = new_json_object_index(obj, 8);
+        double t1 = seconds_now();
+        free_json_object_index(index);
+        index = fresh;
+        for (size_t i = 0; i < keys; i++) found += json_get(NULL, obj, names + i * 32, lengths[i]) != NULL;
+        double t2 = seconds_now();
+        for (size_t i = 0; i < keys; i++) found += json_get(index, obj, names + i * 32, lengths[i]) != NULL;
+        double t3 = seconds_now();
+        if (it == 0 || t1 - start < build) build = t1 - start;
+        if (it == 0 || t2 - t1 < walk) walk = t2 - t1;
+        if (it == 0 || t3 - t2 < hashed) hashed = t3 - t2;
+    }
+    printf("Object with %zu keys\n", keys);
+    printf("Index build:   %10.3f ms\n", build * 1e3);
+    printf("Walk lookup:   %10.1f ns/key\n", walk * 1e9 / keys);
+    printf("Hashed lookup: %10.1f ns/key (%.0fx)\n", hashed * 1e9 / keys, walk / hashed);
+
+    free_json_object_index(index);
+    free(names);
+    free(lengths);
+    free_ast(obj);
+    free_combinator(parser);
+    free(ast_nil);
+    free(doc);
+    return found == 2 * keys * (size_t)iterations ? 0 : 1;
+}
+
+static const char* column_type_name(json_column_type type) {
+    switch (type) {
+        case JSON_COLUMN_BOOL: return "bool";
+        case JSON_COLUMN_INT: return "int64";
+        case JSON_COLUMN_DOUBLE: return "double";
+        case JSON_COLUMN_STRING: return "string";
+        default: return "null";
+    }
+}
+
+// Decodes an array of objects into columns, against a full AST parse.
+static int run_columns(const char* path) {
+    size_t length = 0;
+    char* data = read_file(path, &length);
+    if (data == NULL) {
+        perror(path);
+        return 1;
+    }
+    ast_nil = new_ast();
+    ast_nil->typ = JSON_T_NONE;
+    combinator_t* parser = json_parser();
+
+    double start = seconds_now();
+    json_table_t table;
+    int rc = json_columns_decode(data, length, NULL, 0, parser, &table);
+    double decode = seconds_now() - start;
+    if (rc != 0) {
+        fprintf(stderr, "%s: not an array of JSON values\n", path);
+    } else {
+        printf("Rows: %zu, deviating: %zu\n", table.rows, table.other_count);
+        for (size_t i = 0; i < table.column_count; i++) {
+            json_column_t* c = &table.columns[i];
+            printf("  %-20s %-7s %zu null\n", c->name, column_type_name(c->type), c->null_count);
+        }
+
+        ast_arena_t* arena = new_ast_arena();
+        ast_arena_t* previous = ast_arena_use(arena);
+        input_t in;
+        memset(&in, 0, sizeof(in));
+        init_input_buffer(&in, data, (int)length);
+        start = seconds_now();
+        ParseResult res = parse(&in, parser);
+        double full = seconds_now() - start;
+        ast_arena_use(previous);
+        if (!res.is_success) free_error(res.value.error);
+        printf("Columns: %8.1f ms, %8.2f MB\n", decode * 1e3, json_table_bytes(&table) / 1e6);
+        printf("AST:     %8.1f ms, %8.2f MB\n", full * 1e3, ast_arena_used(arena) / 1e6);
+        free_ast_arena(arena);
+        json_table_free(&table);
+    }
+    free_combinator(parser);
+    free(ast_nil);
+    free(data);
+    return rc != 0;
+}
+
+typedef struct {
+    int64_t id;
+    json_string_span_t name;
+} bench_account_t;
+
+typedef struct {
+    int64_t id;
+    json_string_span_t symbol;
+    double price;
+    int64_t quantity;
+    bool buy;
+    bench_account_t account;
+    json_string_span_t note;
+} bench_order_t;
+
+static const json_field_t bench_account_fields[] = {
+    JSON_FIELD(bench_account_t, id, JSON_FIELD_INT, false),
+    JSON_FIELD(bench_account_t, name, JSON_FIELD_STRING, false),
+    JSON_FIELDS_END
+};
+
+static const json_field_t bench_order_fields[] = {
+    JSON_FIELD(bench_order_t, id, JSON_FIELD_INT, false),
+    JSON_FIELD(bench_order_t, symbol, JSON_FIELD_STRING, false),
+    JSON_FIELD(bench_order_t, price, JSON_FIELD_DOUBLE, false),
+    JSON_FIELD(bench_order_t, quantity, JSON_FIELD_INT, false),
+    JSON_FIELD(bench_order_t, buy, JSON_FIELD_BOOL, false),
+    JSON_OBJECT_FIELD(bench_order_t, account, bench_account_fields, false),
+    JSON_FIELD(bench_order_t, note, JSON_FIELD_STRING, true),
+    JSON_FIELDS_END
+};
+
+static json_string_span_t ast_span(const ast_t* value) {
+    return (json_string_span_t){ value->sym->name, (uint32_t)value->sym->length, false };
+}
+
+// What filling the struct from a generic parse takes
+static bool walk_account(const ast_t* obj, bench_account_t* out) {
+    if (obj->typ != JSON_T_SEQ) return false;
+    for (const ast_t* m = obj->child; m != NULL && m != ast_nil; m = m->next) {
+        const char* key = m->child->sym->name;
+        const ast_t* value = m->child->next;
+        if (strcmp(key, "id") == 0) {
+            if (!ast_int_value(value, &out->id)) return false;
+        } else if (strcmp(key, "name") == 0) {
+            if (value->typ != JSON_T_STRING) return false;
+            out->name = ast_span(value);
+        }
+    }
+    return true;
+}
+
+static bool walk_order(const ast_t* obj, bench_order_t* out) {
+    if (obj->typ != JSON_T_SEQ) return false;
+    for (const ast_t* m = obj->child; m != NULL && m != ast_nil; m = m->next) {
+        const char* key = m->child->sym->name;
+        const ast_t* value = m->child->next;
+        bool ok = true;
+        if (strcmp(key, "id") == 0) {
+            ok = ast_int_value(value, &out->id);
+        } else if (strcmp(key, "symbol") == 0) {
+            ok = value->typ == JSON_T_STRING;
+            if (ok) out->symbol = ast_span(value);
+        } else if (strcmp(key, "price") == 0) {
+            ok = ast_double_value(value, &out->price);
+        } else if (strcmp(key, "quantity") == 0) {
+            ok = ast_int_value(value, &out->quantity);
+        } else if (strcmp(key, "buy") == 0) {
+            ok = value->typ == JSON_T_INT && value->sym != NULL;
+            if (ok) out->buy = strcmp(value->sym->name, "1") == 0;
+        } else if (strcmp(key, "account") == 0) {
+            ok = walk_account(value, &out->account);
+        } else if (strcmp(key, "note") == 0) {
+            ok = value->typ == JSON_T_STRING;
+            if (ok) out->note = ast_span(value);
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Fills structs from N order messages, through the schema parser and
+// through json_parser() and a walk of the AST.
+static int run_schema_bench(size_t messages, int iterations) {
+    size_t cap = messages * 192 + 16, len = 0;
+    char* doc = malloc(cap);
+    size_t* starts = malloc((messages + 1) * sizeof(size_t));
+    if (doc == NULL || starts == NULL) exception("malloc failed");
+    for (size_t i = 0; i < messages; i++) {
+        starts[i] = len;
+        len += (size_t)snprintf(doc + len, cap - len,
+                                "{\"id\": %zu, \"symbol\": \"SYM%zu\", \"price\": %zu.%02zu, \"quantity\": %zu, \"buy\": %s, "
+                                "\"account\": {\"id\": %zu, \"name\": \"acct-%zu\"}%s}",
+                                i, i % 500, 10 + i % 90, i % 100, 1 + i % 1000, i % 3 ? "true" : "false", i % 64, i % 64,
+                                i % 4 ? "" : ", \"note\": \"rush\"");
+    }
+    starts[messages] = len;
+
+    ast_nil = new_ast();
+    ast_nil->typ = JSON_T_NONE;
+    combinator_t* parser = json_parser();
+    json_schema_t* schema = json_schema_compile(bench_order_fields);
+    int64_t check_schema = 0, check_walk = 0;
+    double best_schema = 0, best_walk = 0;
+    bool ok = true;
+    for (int it = 0; it < iterations && ok; it++) {
+        double start = seconds_now();
+        for (size_t i = 0; i < messages; i++) {
+            bench_order_t order;
+            memset(&order, 0, sizeof(order));
+            ok &= json_schema_parse(schema, doc + starts[i], starts[i + 1] - starts[i], &order, NULL) == JSON_SCHEMA_OK;
+            check_schema += order.quantity + order.account.id + order.symbol.length + order.note.length;
+        }
+        double t1 = seconds_now();
+        for (size_t i = 0; i < messages; i++) {
+            bench_order_t order;
+            memset(&order, 0, sizeof(order));
+            input_t in;
+            memset(&in, 0, sizeof(in));
+            init_input_buffer(&in, doc + starts[i], (int)(starts[i + 1] - starts[i]));
+            ParseResult res = parse(&in, parser);
+            if (!res.is_success) {
+                free_error(res.value.error);
+                ok = false;
+                continue;
+            }
+            ok &= walk_order(res.value.ast, &order);
+            check_walk += order.quantity + order.account.id + order.symbol.length + order.note.length;
+            free_ast(res.value.ast);
+        }
+        double t2 = seconds_now();
+        if (it == 0 || t1 - start < best_schema) best_schema = t1 - start;
+        if (it == 0 || t2 - t1 < best_walk) best_walk = t2 - t1;
+    }
+    ok &= check_schema == check_walk;
+    if (ok) {
+        printf("%zu messages, %.2f MB\n", messages, len / 1e6);
+        printf("json_parser() + walk: %10.1f ns/message\n", best_walk * 1e9 / messages);
+        printf("Schema parser:        %10.1f ns/message (%.1fx)\n", best_schema * 1e9 / messages, best_walk / best_schema);
+    } else {
+        fprintf(stderr, "The two parses disagree\n");
+    }
+
+    json_schema_free(schema);
+    free_combinator(parser);
+    free(ast_nil);
+    free(starts);
+    free(doc);
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
     signal(SIGSEGV, backtrace_handler);
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s \"<json_string>\"\n", argv[0]);
+    bool validate = false;
+    bool ndjson = false;
+    bool bench = false;
+    int iterations = 5;
+    const char* find = NULL;
+    size_t bench_keys = 0;
+    size_t bench_schema = 0;
+    bool columns = false;
+    json_ndjson_options_t options = { 0, 0, false };
+    char *json_str = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--validate") == 0) {
+            validate = true;
+        } else if (strcmp(argv[i], "--ndjson") == 0) {
+            ndjson = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--columns") == 0) {
+            columns = true;
+        } else if (strcmp(argv[i], "--bench-schema") == 0 && i + 1 < argc) {
+            bench_schema = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--bench-keys") == 0 && i + 1 < argc) {
+            bench_keys = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--get") == 0 && i + 1 < argc) {
+            find = argv[++i];
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+            if (iterations < 1) iterations = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else {
+            json_str = argv[i];
+        }
+    }
+
+    if (bench_keys > 0) return run_key_bench(bench_keys, iterations);
+    if (bench_schema > 0) return run_schema_bench(bench_schema, iterations);
+
+    if (json_str == NULL) {
+        fprintf(stderr, "Usage: %s [--validate] \"<json_string>\"\n", argv[0]);
+        fprintf(stderr, "       %s --ndjson [--validate] [--threads N] <file>   (one JSON value per line)\n", argv[0]);
+        fprintf(stderr, "       %s --bench [--iterations N] [--get PATH] <file>   (combinator vs. structural-index parser)\n", argv[0]);
+        fprintf(stderr, "       %s --columns <file>   (array of objects into typed columns)\n", argv[0]);
+        fprintf(stderr, "       %s --bench-keys N [--iterations N]   (key lookup in an object with N keys)\n", argv[0]);
+        fprintf(stderr, "       %s --bench-schema N [--iterations N]   (N messages into structs: schema parser vs. AST walk)\n", argv[0]);
+        fprintf(stderr, "       %s --get PATH \"<json_string>\"   (on-demand lookup, e.g. a.b[3].c)\n", argv[0]);
         return 1;
     }
 
+    if (bench) return run_bench(json_str, iterations, find);
+    if (columns) return run_columns(json_str);
+    if (find != NULL) return print_found(json_str, strlen(json_str), find);
+
     // --- Parser Definition ---
     combinator_t *parser = json_parser();
 
+    if (ndjson) {
+        options.validate = validate;
+        json_ndjson_stats_t stats;
+        int rc = json_ndjson_ingest_file(json_str, parser, &options, print_record_error, NULL, &stats);
+        fflush(stdout);
+        if (rc != 0) {
+            perror(json_str);
+        } else {
+            json_ndjson_print_stats(&stats, stderr);
+        }
+        free_combinator(parser);
+        free(ast_nil);
+        return rc != 0 || stats.failed > 0 ? 1 : 0;
+    }
+
     // --- Parsing ---
     input_t *in = new_input();
-    in->buffer = argv[1];
-    in->length = strlen(argv[1]);
+    in->buffer = json_str;
+    in->length = strlen(json_str);
+    // Only report whether the document is valid; no AST is built
+    in->recognize_only = validate;
 
     ast_nil = new_ast();
     ast_nil->typ = JSON_T_NONE;
@@ -58,7 +543,7 @@ int main(int argc, char *argv[]) {
             fprintf(stderr, "Error: Parser did not consume entire input. Trailing characters: '%s'\n", in->buffer + in->start);
             free_ast(result.value.ast);
         } else {
-            printf("JSON parsed successfully.\n");
+            printf(validate ? "JSON is valid.\n" : "JSON parsed successfully.\n");
             // AST is not printed because it can be very large.
             free_ast(result.value.ast);
         }
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "json_ndjson.h"
+#include "json_parser.h"
+
+#define NDJSON_DEFAULT_CHUNK_BYTES (1u << 20)
+
+typedef struct {
+    size_t offset;            // of the line in the input
+    size_t length;
+    size_t line;              // lines before it in its chunk
+    ParseResult result;
+} ndjson_result;
+
+// One chunk in flight. Chunk k uses slot k % slot_count, so a slot is
+// reused only after its previous chunk has been delivered.
+typedef struct {
+    size_t chunk;
+    size_t start, end;
+    bool ready;               // parsed, waiting for delivery
+    size_t lines;             // lines the chunk spans
+    ndjson_result* results;
+    size_t count, cap;
+    ast_arena_t* arena;       // holds the chunk's ASTs until delivery
+} ndjson_slot;
+
+typedef struct {
+    const char* data;
+    size_t length;
+    combinator_t* parser;
+    bool validate;
+    size_t chunk_bytes;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t next_start;        // where the next chunk begins
+    size_t next_chunk;        // chunks handed out so far
+    size_t delivered;         // chunks delivered so far
+    ndjson_slot* slots;
+    size_t slot_count;
+} ndjson_job;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool is_blank(const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] != ' ' && s[i] != '\t' && s[i] != '\r') return false;
+    }
+    return true;
+}
+
+static void push_result(ndjson_slot* slot, size_t offset, size_t length, size_t line, ParseResult result) {
+    if (slot->count == slot->cap) {
+        slot->cap = slot->cap ? slot->cap * 2 : 256;
+        slot->results = realloc(slot->results, sizeof(ndjson_result) * slot->cap);
+        if (!slot->results) exception("realloc failed");
+    }
+    ndjson_result* r = &slot->results[slot->count++];
+    r->offset = offset;
+    r->length = length;
+    r->line = line;
+    r->result = result;
+}
+
+static void parse_chunk(ndjson_job* job, ndjson_slot* slot) {
+    ast_arena_t* previous = ast_arena_use(slot->arena);
+    input_t in;
+    memset(&in, 0, sizeof(in));
+    in.recognize_only = job->validate;
+
+    size_t p = slot->start, line = 0;
+    while (p < slot->end) {
+        // glibc's memchr scans a vector register at a time.
+        const char* nl = memchr(job->data + p, '\n', slot->end - p);
+        size_t line_end = nl ? (size_t)(nl - job->data) : slot->end;
+        size_t length = line_end - p;
+        if (length > 0 && job->data[p + length - 1] == '\r') length--;
+        if (!is_blank(job->data + p, length)) {
+            init_input_buffer(&in, (char*)job->data + p, (int)length);
+            ParseResult res = parse(&in, job->parser);
+            if (res.is_success && in.start < in.length) {
+                free_ast(res.value.ast);
+                res = make_failure_v2(&in, NULL, strdup("Trailing characters after JSON value."), NULL);
+            }
+            push_result(slot, p, length, line, res);
+        }
+        line++;
+        p = nl ? line_end + 1 : slot->end;
+    }
+    slot->lines = line;
+    ast_arena_use(previous);
+}
+
+static void* ndjson_worker(void* arg) {
+    ndjson_job* job = (ndjson_job*)arg;
+    pthread_mutex_lock(&job->lock);
+    while (1) {
+        while (job->next_start < job->length && job->next_chunk >= job->delivered + job->slot_count) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->next_start >= job->length) break;
+
+        // Cut the next chunk at the first newline past the target size.
+        size_t start = job->next_start;
+        size_t end = job->length - start > job->chunk_bytes ? start + job->chunk_bytes : job->length;
+        if (end < job->length) {
+            const char* nl = memchr(job->data + end, '\n', job->length - end);
+            end = nl ? (size_t)(nl - job->data) + 1 : job->length;
+        }
+        ndjson_slot* slot = &job->slots[job->next_chunk % job->slot_count];
+        slot->chunk = job->next_chunk++;
+        slot->start = start;
+        slot->end = end;
+        slot->ready = false;
+        job->next_start = end;
+        pthread_mutex_unlock(&job->lock);
+
+        parse_chunk(job, slot);
+
+        pthread_mutex_lock(&job->lock);
+        slot->ready = true;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+int json_ndjson_ingest(const char* data, size_t length, combinator_t* parser, const json_ndjson_options_t* options,
+                       json_record_fn sink, void* context, json_ndjson_stats_t* stats) {
+    json_ndjson_options_t defaults = { 0, 0, false };
+    if (options == NULL) options = &defaults;
+    unsigned threads = options->threads;
+    if (threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (unsigned)n : 1;
+    }
+    uint64_t start_ns = now_ns();
+
+    // Shared by all workers, so it must exist before they start.
+    if (ast_nil == NULL) {
+        ast_arena_t* arena = ast_arena_use(NULL);
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+        ast_arena_use(arena);
+    }
+
+    ndjson_job job;
+    memset(&job, 0, sizeof(job));
+    job.data = data;
+    job.length = length;
+    job.parser = parser;
+    job.validate = options->validate;
+    job.chunk_bytes = options->chunk_bytes ? options->chunk_bytes : NDJSON_DEFAULT_CHUNK_BYTES;
+    job.slot_count = (size_t)threads * 2;
+    job.slots = (ndjson_slot*)safe_malloc(sizeof(ndjson_slot) * job.slot_count);
+    memset(job.slots, 0, sizeof(ndjson_slot) * job.slot_count);
+    for (size_t i = 0; i < job.slot_count; i++) job.slots[i].arena = new_ast_arena();
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    pthread_t* workers = (pthread_t*)safe_malloc(sizeof(pthread_t) * threads);
+    unsigned started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, ndjson_worker, &job) == 0) started++;
+
+    json_ndjson_stats_t totals = { 0, 0, length, 0.0 };
+    size_t line_base = 1;
+    for (size_t chunk = 0; started > 0; chunk++) {
+        ndjson_slot* slot = &job.slots[chunk % job.slot_count];
+        pthread_mutex_lock(&job.lock);
+        while (!(chunk < job.next_chunk && slot->chunk == chunk && slot->ready) &&
+               !(job.next_start >= job.length && chunk >= job.next_chunk)) {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        bool done = chunk >= job.next_chunk;
+        pthread_mutex_unlock(&job.lock);
+        if (done) break;
+
+        for (size_t i = 0; i < slot->count; i++) {
+            ndjson_result* r = &slot->results[i];
+            json_record_t record;
+            record.line = line_base + r->line;
+            record.text = data + r->offset;
+            record.length = r->length;
+            record.ast = r->result.is_success ? r->result.value.ast : NULL;
+            record.error = r->result.is_success ? NULL : r->result.value.error;
+            totals.records++;
+            if (record.error) totals.failed++;
+            if (sink) sink(&record, context);
+            // AST nodes go with the arena; errors are on the heap.
+            if (record.error) free_error(record.error);
+        }
+        line_base += slot->lines;
+        slot->count = 0;
+        ast_arena_reset(slot->arena);
+
+        pthread_mutex_lock(&job.lock);
+        slot->ready = false;
+        job.delivered++;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (unsigned i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    for (size_t i = 0; i < job.slot_count; i++) {
+        free(job.slots[i].results);
+        free_ast_arena(job.slots[i].arena);
+    }
+    free(job.slots);
+    pthread_cond_destroy(&job.changed);
+    pthread_mutex_destroy(&job.lock);
+
+    totals.seconds = (now_ns() - start_ns) / 1e9;
+    if (stats) *stats = totals;
+    return started > 0 || length == 0 ? 0 : -1;
+}
+
+int json_ndjson_ingest_file(const char* path, combinator_t* parser, const json_ndjson_options_t* options,
+                            json_record_fn sink, void* context, json_ndjson_stats_t* stats) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = NULL;
+    if (size > 0) {
+        mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    int rc = json_ndjson_ingest((const char*)mapping, size, parser, options, sink, context, stats);
+    if (mapping) munmap(mapping, size);
+    return rc;
+}
+
+void json_ndjson_print_stats(const json_ndjson_stats_t* stats, FILE* out) {
+    double seconds = stats->seconds > 0 ? stats->seconds : 1e-9;
+    fprintf(out, "Records: %zu (%zu failed)\n", stats->records, stats->failed);
+    fprintf(out, "Bytes: %llu in %.3f s\n", (unsigned long long)stats->bytes, stats->seconds);
+    fprintf(out, "Throughput: %.2f MB/s, %.0f records/s\n", stats->bytes / seconds / 1e6, stats->records / seconds);
+}
@@ -0,0 +1,49 @@
+#ifndef JSON_NDJSON_H
+#define JSON_NDJSON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "parser.h"
+
+// NDJSON / JSON Lines ingest: one JSON value per line, parsed in parallel.
+// The input is cut into chunks at newlines; worker threads parse whole
+// chunks, each into its own AST arena, and the calling thread hands the
+// records to a sink strictly in file order. Blank lines are skipped.
+
+typedef struct {
+    size_t line;              // 1-based line number in the input
+    const char* text;         // the line, without its line terminator
+    size_t length;
+    // Exactly one of these is set. The AST (ast_nil when validating) and
+    // the error belong to the ingest and are only valid during the call.
+    ast_t* ast;
+    ParseError* error;        // line/col are relative to the line
+} json_record_t;
+
+typedef void (*json_record_fn)(const json_record_t* record, void* context);
+
+typedef struct {
+    unsigned threads;         // workers; 0 means one per online CPU
+    size_t chunk_bytes;       // target chunk size; 0 means 1 MiB
+    bool validate;            // recognize-only parsing, no ASTs
+} json_ndjson_options_t;
+
+typedef struct {
+    size_t records;
+    size_t failed;
+    uint64_t bytes;
+    double seconds;
+} json_ndjson_stats_t;
+
+// Parses every line of data[0, length) with `parser` (see json_parser())
+// and calls `sink` for each record in order. `options` and `stats` may be
+// NULL. Returns 0, or -1 if the workers could not be started.
+int json_ndjson_ingest(const char* data, size_t length, combinator_t* parser, const json_ndjson_options_t* options,
+                       json_record_fn sink, void* context, json_ndjson_stats_t* stats);
+// Maps the file at `path` and ingests it. Returns -1 if it cannot be read.
+int json_ndjson_ingest_file(const char* path, combinator_t* parser, const json_ndjson_options_t* options,
+                            json_record_fn sink, void* context, json_ndjson_stats_t* stats);
+
+void json_ndjson_print_stats(const json_ndjson_stats_t* stats, FILE* out);
+
+#endif // JSON_NDJSON_H
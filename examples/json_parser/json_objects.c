@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_objects.h"
+#include "json_parser.h"
+
+typedef struct {
+    uint64_t hash;
+    const char* name;         // borrowed from the AST
+    size_t length;
+} key_entry;
+
+typedef struct {
+    ast_t* node;
+    size_t slot_base;         // its table in `slots`
+    uint32_t mask;            // table size - 1
+    size_t member_base;       // its members in member_keys/member_values
+} object_entry;
+
+struct json_object_index {
+    size_t min_members;
+    // Interned keys. key_slots holds key id + 1, 0 when empty.
+    key_entry* keys;
+    size_t key_count, key_cap;
+    uint32_t* key_slots;
+    size_t key_mask;
+    // Indexed objects. object_slots holds object id + 1, keyed by node.
+    object_entry* objects;
+    size_t object_count, object_cap;
+    uint32_t* object_slots;
+    size_t object_mask;
+    // Per-object tables back to back; a slot holds member number + 1.
+    uint32_t* slots;
+    size_t slot_count, slot_cap;
+    // Per-object members back to back, first occurrence of each key only
+    uint32_t* member_keys;
+    ast_t** member_values;
+    size_t member_count, member_cap;
+};
+
+static uint64_t key_hash(const char* key, size_t length) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static size_t node_hash(const ast_t* node) {
+    return (size_t)(((uint64_t)(uintptr_t)node * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static void* grow(void* items, size_t* cap, size_t needed, size_t size) {
+    if (needed <= *cap) return items;
+    size_t n = *cap ? *cap : 64;
+    while (n < needed) n *= 2;
+    items = realloc(items, n * size);
+    if (!items) exception("realloc failed");
+    *cap = n;
+    return items;
+}
+
+static uint32_t* new_slots(size_t count) {
+    uint32_t* slots = (uint32_t*)calloc(count, sizeof(uint32_t));
+    if (!slots) exception("calloc failed");
+    return slots;
+}
+
+// Id of key[0, length), or -1 if no indexed object has it.
+static long find_key(const json_object_index_t* index, const char* key, size_t length, uint64_t hash) {
+    for (size_t pos = hash & index->key_mask;; pos = (pos + 1) & index->key_mask) {
+        uint32_t slot = index->key_slots[pos];
+        if (slot == 0) return -1;
+        const key_entry* e = &index->keys[slot - 1];
+        if (e->hash == hash && e->length == length && memcmp(e->name, key, length) == 0) return (long)(slot - 1);
+    }
+}
+
+static uint32_t intern_key(json_object_index_t* index, const sym_t* sym) {
+    uint64_t hash = key_hash(sym->name, sym->length);
+    long id = find_key(index, sym->name, sym->length, hash);
+    if (id >= 0) return (uint32_t)id;
+    // Load factor of at most one half
+    if (2 * (index->key_count + 1) > index->key_mask + 1) {
+        size_t mask = index->key_mask * 2 + 1;
+        free(index->key_slots);
+        index->key_slots = new_slots(mask + 1);
+        index->key_mask = mask;
+        for (size_t i = 0; i < index->key_count; i++) {
+            size_t pos = index->keys[i].hash & mask;
+            while (index->key_slots[pos] != 0) pos = (pos + 1) & mask;
+            index->key_slots[pos] = (uint32_t)i + 1;
+        }
+    }
+    index->keys = grow(index->keys, &index->key_cap, index->key_count + 1, sizeof(key_entry));
+    index->keys[index->key_count] = (key_entry){ hash, sym->name, sym->length };
+    size_t pos = hash & index->key_mask;
+    while (index->key_slots[pos] != 0) pos = (pos + 1) & index->key_mask;
+    index->key_slots[pos] = (uint32_t)++index->key_count;
+    return (uint32_t)(index->key_count - 1);
+}
+
+static const object_entry* find_object(const json_object_index_t* index, const ast_t* node) {
+    for (size_t pos = node_hash(node) & index->object_mask;; pos = (pos + 1) & index->object_mask) {
+        uint32_t slot = index->object_slots[pos];
+        if (slot == 0) return NULL;
+        if (index->objects[slot - 1].node == node) return &index->objects[slot - 1];
+    }
+}
+
+static void add_object(json_object_index_t* index, ast_t* node, size_t members) {
+    if (2 * (index->object_count + 1) > index->object_mask + 1) {
+        size_t mask = index->object_mask * 2 + 1;
+        free(index->object_slots);
+        index->object_slots = new_slots(mask + 1);
+        index->object_mask = mask;
+        for (size_t i = 0; i < index->object_count; i++) {
+            size_t pos = node_hash(index->objects[i].node) & mask;
+            while (index->object_slots[pos] != 0) pos = (pos + 1) & mask;
+            index->object_slots[pos] = (uint32_t)i + 1;
+        }
+    }
+    size_t size = 16;
+    while (size < 2 * members) size *= 2;
+    index->slots = grow(index->slots, &index->slot_cap, index->slot_count + size, sizeof(uint32_t));
+    index->member_keys = grow(index->member_keys, &index->member_cap, index->member_count + members, sizeof(uint32_t));
+    size_t member_cap = index->member_cap;
+    // Grown to the same capacity as member_keys
+    index->member_values = realloc(index->member_values, member_cap * sizeof(ast_t*));
+    if (!index->member_values) exception("realloc failed");
+
+    object_entry o = { node, index->slot_count, (uint32_t)(size - 1), index->member_count };
+    uint32_t* table = index->slots + o.slot_base;
+    memset(table, 0, size * sizeof(uint32_t));
+    size_t count = 0;
+    for (ast_t* m = node->child; m != NULL && m != ast_nil; m = m->next) {
+        uint32_t id = intern_key(index, m->child->sym);
+        size_t pos = index->keys[id].hash & o.mask;
+        bool duplicate = false;
+        while (table[pos] != 0) {
+            if (index->member_keys[o.member_base + table[pos] - 1] == id) {
+                duplicate = true;
+                break;
+            }
+            pos = (pos + 1) & o.mask;
+        }
+        if (duplicate) continue;
+        index->member_keys[o.member_base + count] = id;
+        index->member_values[o.member_base + count] = m->child->next;
+        table[pos] = (uint32_t)++count;
+    }
+    index->slot_count += size;
+    index->member_count += count;
+
+    index->objects = grow(index->objects, &index->object_cap, index->object_count + 1, sizeof(object_entry));
+    index->objects[index->object_count] = o;
+    size_t pos = node_hash(node) & index->object_mask;
+    while (index->object_slots[pos] != 0) pos = (pos + 1) & index->object_mask;
+    index->object_slots[pos] = (uint32_t)++index->object_count;
+}
+
+static bool is_member(const ast_t* m) {
+    return m->typ == JSON_T_ASSIGN && m->child != NULL && m->child->sym != NULL;
+}
+
+static void index_visitor(ast_t* node, void* context) {
+    json_object_index_t* index = (json_object_index_t*)context;
+    if (node->typ != JSON_T_SEQ || node->child == NULL || node->child == ast_nil || !is_member(node->child)) return;
+    size_t members = 0;
+    for (ast_t* m = node->child; m != NULL && m != ast_nil; m = m->next) {
+        if (!is_member(m)) return;
+        members++;
+    }
+    if (members >= index->min_members) add_object(index, node, members);
+}
+
+json_object_index_t* new_json_object_index(ast_t* root, size_t min_members) {
+    json_object_index_t* index = (json_object_index_t*)safe_malloc(sizeof(json_object_index_t));
+    memset(index, 0, sizeof(*index));
+    index->min_members = min_members > 0 ? min_members : 1;
+    index->key_mask = 63;
+    index->key_slots = new_slots(index->key_mask + 1);
+    index->object_mask = 15;
+    index->object_slots = new_slots(index->object_mask + 1);
+    parser_walk_ast(root, index_visitor, index);
+    return index;
+}
+
+void free_json_object_index(json_object_index_t* index) {
+    if (index == NULL) return;
+    free(index->keys);
+    free(index->key_slots);
+    free(index->objects);
+    free(index->object_slots);
+    free(index->slots);
+    free(index->member_keys);
+    free(index->member_values);
+    free(index);
+}
+
+ast_t* json_get(const json_object_index_t* index, ast_t* obj, const char* key, size_t length) {
+    if (obj == NULL || obj == ast_nil || obj->typ != JSON_T_SEQ) return NULL;
+    const object_entry* o = index ? find_object(index, obj) : NULL;
+    if (o != NULL) {
+        uint64_t hash = key_hash(key, length);
+        long id = find_key(index, key, length, hash);
+        if (id < 0) return NULL;
+        const uint32_t* table = index->slots + o->slot_base;
+        for (size_t pos = hash & o->mask; table[pos] != 0; pos = (pos + 1) & o->mask) {
+            size_t member = o->member_base + table[pos] - 1;
+            if (index->member_keys[member] == (uint32_t)id) return index->member_values[member];
+        }
+        return NULL;
+    }
+    for (ast_t* m = obj->child; m != NULL && m != ast_nil; m = m->next) {
+        if (!is_member(m)) return NULL;
+        const sym_t* k = m->child->sym;
+        if (k->length == length && memcmp(k->name, key, length) == 0) return m->child->next;
+    }
+    return NULL;
+}
+
+size_t json_object_index_objects(const json_object_index_t* index) {
+    return index->object_count;
+}
+
+size_t json_object_index_keys(const json_object_index_t* index) {
+    return index->key_count;
+}
@@ -0,0 +1,31 @@
+#ifndef JSON_OBJECTS_H
+#define JSON_OBJECTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "parser.h"
+
+// Key lookup in parsed JSON objects. An object is a JSON_T_SEQ node whose
+// children are JSON_T_ASSIGN pairs, so finding a member means walking the
+// list. The index below gives every object with at least `min_members`
+// members an open-addressing table from key to member. Keys are interned
+// once for the whole tree: a lookup hashes the key once, finds its id in
+// the dictionary, then probes the object's table comparing ids only.
+// Smaller objects are searched by walking and cost no memory.
+//
+// The index borrows the AST, which must outlive it and not change.
+typedef struct json_object_index json_object_index_t;
+
+json_object_index_t* new_json_object_index(ast_t* root, size_t min_members);
+void free_json_object_index(json_object_index_t* index);
+
+// The value of the first member of `obj` named key[0, length), or NULL if
+// there is none or `obj` is not an object. `index` may be NULL, and `obj`
+// need not be in it.
+ast_t* json_get(const json_object_index_t* index, ast_t* obj, const char* key, size_t length);
+
+// Objects given a table, and distinct keys interned
+size_t json_object_index_objects(const json_object_index_t* index);
+size_t json_object_index_keys(const json_object_index_t* index);
+
+#endif // JSON_OBJECTS_H
@@ -0,0 +1,285 @@
+#include <string.h>
+#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "parser.h"
+#include "json_parser.h"
+#include "json_ondemand.h"
+
+typedef struct {
+    const char* text;
+    size_t length;
+    size_t pos;
+} cursor;
+
+static void skip_space(cursor* c) {
+    while (c->pos < c->length && isspace((unsigned char)c->text[c->pos])) c->pos++;
+}
+
+static bool at(cursor* c, char ch) {
+    return c->pos < c->length && c->text[c->pos] == ch;
+}
+
+// Offset of the first byte in text[from, length) that matters to a skip:
+// a quote or backslash inside a string, a quote or bracket outside one.
+// Returns length if there is none.
+static size_t find_special(const char* text, size_t from, size_t length, bool in_string) {
+    size_t i = from;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');      // '[' | 0x20
+    const __m128i close = _mm_set1_epi8('}');     // ']' | 0x20
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i hit;
+        if (in_string) {
+            hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        } else {
+            __m128i folded = _mm_or_si128(v, case_bit);
+            hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                               _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+        }
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+#endif
+    for (; i < length; i++) {
+        char ch = text[i];
+        if (ch == '"') return i;
+        if (in_string ? ch == '\\' : ch == '{' || ch == '}' || ch == '[' || ch == ']') return i;
+    }
+    return length;
+}
+
+// Moves past the string whose opening quote is at the cursor.
+static bool skip_string(cursor* c, bool* escaped) {
+    size_t i = c->pos + 1;
+    *escaped = false;
+    while (1) {
+        i = find_special(c->text, i, c->length, true);
+        if (i >= c->length) return false;
+        if (c->text[i] == '"') break;
+        *escaped = true;
+        i += 2;
+    }
+    c->pos = i + 1;
+    return true;
+}
+
+// Moves past the object or array at the cursor by counting brackets
+// outside strings. Whether they pair up is not checked.
+static bool skip_container(cursor* c) {
+    size_t i = c->pos;
+    size_t depth = 0;
+    while (1) {
+        i = find_special(c->text, i, c->length, false);
+        if (i >= c->length) return false;
+        char ch = c->text[i];
+        if (ch == '"') {
+            cursor s = { c->text, c->length, i };
+            bool escaped;
+            if (!skip_string(&s, &escaped)) return false;
+            i = s.pos;
+            continue;
+        }
+        if (ch == '{' || ch == '[') {
+            depth++;
+        } else if (depth == 0) {
+            return false;
+        } else if (--depth == 0) {
+            c->pos = i + 1;
+            return true;
+        }
+        i++;
+    }
+}
+
+static bool is_delimiter(char ch) {
+    return ch == ',' || ch == '}' || ch == ']' || isspace((unsigned char)ch);
+}
+
+// A number or literal ends at the next delimiter.
+static size_t scalar_end(cursor* c) {
+    size_t i = c->pos;
+    while (i < c->length && !is_delimiter(c->text[i])) i++;
+    return i;
+}
+
+static bool skip_value(cursor* c) {
+    if (c->pos >= c->length) return false;
+    char ch = c->text[c->pos];
+    if (ch == '"') {
+        bool escaped;
+        return skip_string(c, &escaped);
+    }
+    if (ch == '{' || ch == '[') return skip_container(c);
+    size_t end = scalar_end(c);
+    if (end == c->pos) return false;
+    c->pos = end;
+    return true;
+}
+
+static bool match_word(cursor* c, const char* word, size_t len) {
+    return scalar_end(c) - c->pos == len && memcmp(c->text + c->pos, word, len) == 0;
+}
+
+// Fully reads the value at the cursor.
+static bool read_value(cursor* c, json_value_t* out) {
+    memset(out, 0, sizeof(*out));
+    if (c->pos >= c->length) return false;
+    size_t start = c->pos;
+    char ch = c->text[start];
+    if (ch == '"') {
+        if (!skip_string(c, &out->escaped)) return false;
+        out->kind = JSON_VALUE_STRING;
+        out->text = c->text + start + 1;
+        out->length = c->pos - start - 2;
+        return true;
+    }
+    if (ch == '{' || ch == '[') {
+        if (!skip_container(c)) return false;
+        out->kind = ch == '{' ? JSON_VALUE_OBJECT : JSON_VALUE_ARRAY;
+    } else if (match_word(c, "null", 4)) {
+        out->kind = JSON_VALUE_NULL;
+        c->pos += 4;
+    } else if (match_word(c, "true", 4) || match_word(c, "false", 5)) {
+        out->kind = JSON_VALUE_BOOL;
+        out->boolean = ch == 't';
+        c->pos += out->boolean ? 4 : 5;
+    } else {
+        json_number_t num;
+        size_t end = scalar_end(c);
+        if (!json_scan_number(c->text + start, (int)(end - start), &num) || (size_t)num.length != end - start) return false;
+        out->kind = JSON_VALUE_NUMBER;
+        out->integral = num.integral;
+        out->integer = num.integer;
+        out->real = num.real;
+        c->pos = end;
+    }
+    out->text = c->text + start;
+    out->length = c->pos - start;
+    return true;
+}
+
+// Compares a key as written, escapes and all, with key[0, len).
+static bool key_equals(const char* raw, size_t raw_length, bool escaped, const char* key, size_t len) {
+    if (!escaped) return raw_length == len && memcmp(raw, key, len) == 0;
+    // An escape is at most six bytes per decoded byte. Escaped keys longer
+    // than the buffer never match.
+    char decoded[1024];
+    if (raw_length > sizeof(decoded) || raw_length > 6 * len) return false;
+    int bad;
+    long n = decode_string(raw, (int)raw_length, decoded, &bad);
+    return n == (long)len && memcmp(decoded, key, len) == 0;
+}
+
+// A value that is not a container of the kind the path wants
+static json_find_status wrong_kind(cursor* c) {
+    return skip_value(c) ? JSON_FIND_MISSING : JSON_FIND_MALFORMED;
+}
+
+// Moves to the value of member `key` of the object at the cursor.
+static json_find_status enter_member(cursor* c, const char* key, size_t len) {
+    if (!at(c, '{')) return wrong_kind(c);
+    c->pos++;
+    skip_space(c);
+    if (at(c, '}')) return JSON_FIND_MISSING;
+    while (1) {
+        if (!at(c, '"')) return JSON_FIND_MALFORMED;
+        size_t start = c->pos + 1;
+        bool escaped;
+        if (!skip_string(c, &escaped)) return JSON_FIND_MALFORMED;
+        bool found = key_equals(c->text + start, c->pos - 1 - start, escaped, key, len);
+        skip_space(c);
+        if (!at(c, ':')) return JSON_FIND_MALFORMED;
+        c->pos++;
+        skip_space(c);
+        if (found) return JSON_FIND_OK;
+        if (!skip_value(c)) return JSON_FIND_MALFORMED;
+        skip_space(c);
+        if (at(c, '}')) return JSON_FIND_MISSING;
+        if (!at(c, ',')) return JSON_FIND_MALFORMED;
+        c->pos++;
+        skip_space(c);
+    }
+}
+
+// Moves to element `index` of the array at the cursor.
+static json_find_status enter_element(cursor* c, size_t index) {
+    if (!at(c, '[')) return wrong_kind(c);
+    c->pos++;
+    skip_space(c);
+    if (at(c, ']')) return JSON_FIND_MISSING;
+    for (size_t i = 0;; i++) {
+        if (i == index) return JSON_FIND_OK;
+        if (!skip_value(c)) return JSON_FIND_MALFORMED;
+        skip_space(c);
+        if (at(c, ']')) return JSON_FIND_MISSING;
+        if (!at(c, ',')) return JSON_FIND_MALFORMED;
+        c->pos++;
+        skip_space(c);
+    }
+}
+
+typedef enum { PATH_END, PATH_KEY, PATH_INDEX, PATH_BAD } path_step;
+
+// Reads the path component at *p: a key (after a '.' unless it is the
+// first) or a bracketed index.
+static path_step next_step(const char** p, const char* path, const char** key, size_t* len, size_t* index) {
+    const char* s = *p;
+    if (*s == '\0') return PATH_END;
+    if (*s == '[') {
+        s++;
+        if (!isdigit((unsigned char)*s)) return PATH_BAD;
+        *index = 0;
+        while (isdigit((unsigned char)*s)) {
+            if (*index > SIZE_MAX / 10 - 1) return PATH_BAD;
+            *index = *index * 10 + (size_t)(*s++ - '0');
+        }
+        if (*s++ != ']') return PATH_BAD;
+        *p = s;
+        return PATH_INDEX;
+    }
+    if (s != path && *s++ != '.') return PATH_BAD;
+    *key = s;
+    while (*s != '\0' && *s != '.' && *s != '[') s++;
+    if (s == *key) return PATH_BAD;
+    *len = (size_t)(s - *key);
+    *p = s;
+    return PATH_KEY;
+}
+
+json_find_status json_find(const char* text, size_t length, const char* path, json_value_t* out) {
+    const char* key;
+    size_t len, index;
+    path_step step;
+    for (const char* p = path; (step = next_step(&p, path, &key, &len, &index)) != PATH_END;) {
+        if (step == PATH_BAD) return JSON_FIND_BAD_PATH;
+    }
+
+    cursor c = { text, length, 0 };
+    skip_space(&c);
+    for (const char* p = path; (step = next_step(&p, path, &key, &len, &index)) != PATH_END;) {
+        json_find_status status = step == PATH_KEY ? enter_member(&c, key, len) : enter_element(&c, index);
+        if (status != JSON_FIND_OK) return status;
+    }
+    return read_value(&c, out) ? JSON_FIND_OK : JSON_FIND_MALFORMED;
+}
+
+size_t json_read_value(const char* text, size_t length, json_value_t* out) {
+    cursor c = { text, length, 0 };
+    skip_space(&c);
+    return read_value(&c, out) ? c.pos : 0;
+}
+
+long json_value_string(const json_value_t* value, char* out) {
+    if (!value->escaped) {
+        memcpy(out, value->text, value->length);
+        return (long)value->length;
+    }
+    int bad;
+    return decode_string(value->text, (int)value->length, out, &bad);
+}
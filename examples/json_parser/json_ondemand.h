@@ -0,0 +1,59 @@
+#ifndef JSON_ONDEMAND_H
+#define JSON_ONDEMAND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// On-demand access to a JSON document: json_find() follows a path such as
+// "a.b[3].c" and fully reads only the value it names. Everything it passes
+// on the way is skipped by scanning for brackets and quotes, without
+// decoding or allocating, so the cost follows the path rather than the
+// document size. Only what is read is validated.
+
+typedef enum {
+    JSON_VALUE_NULL, JSON_VALUE_BOOL, JSON_VALUE_NUMBER, JSON_VALUE_STRING, JSON_VALUE_ARRAY, JSON_VALUE_OBJECT
+} json_value_kind;
+
+// A value found in the document. Spans point into the document text.
+typedef struct {
+    json_value_kind kind;
+    const char* text;         // the value as written; strings without quotes
+    size_t length;
+    bool escaped;             // strings: the span contains escapes
+    bool boolean;
+    bool integral;            // numbers: `integer` holds the exact value
+    int64_t integer;
+    double real;              // numbers, always set
+} json_value_t;
+
+// A string as written in the input, without its quotes
+typedef struct {
+    const char* text;
+    uint32_t length;
+    bool escaped;             // decode with json_value_string() semantics
+} json_string_span_t;
+
+typedef enum {
+    JSON_FIND_OK,
+    JSON_FIND_MISSING,        // no such key or index, or the wrong kind of container
+    JSON_FIND_BAD_PATH,       // the path does not parse
+    JSON_FIND_MALFORMED       // the document is broken along the way
+} json_find_status;
+
+// Looks up `path` in the JSON value text[0, length). Path components are
+// keys, separated by '.', and array indexes in brackets; "" is the value
+// itself. Keys are compared with their escapes decoded. Lookups relative to
+// a container found before are cheaper: pass its text and length.
+json_find_status json_find(const char* text, size_t length, const char* path, json_value_t* out);
+
+// Reads the value text[0, length) starts with, after any whitespace, the
+// way json_find() reads the value at the end of a path. Returns the bytes
+// consumed up to the end of the value, or 0 if it is malformed.
+size_t json_read_value(const char* text, size_t length, json_value_t* out);
+
+// Decodes a string value into `out`, which needs value->length bytes.
+// Returns the decoded length, or -1 if an escape is malformed.
+long json_value_string(const json_value_t* value, char* out);
+
+#endif // JSON_ONDEMAND_H
@@ -18,52 +18,93 @@ static ParseResult number_fn(input_t* in, void* args, char* parser_name);
 static ParseResult null_core_fn(input_t* in, void* args, char* parser_name);
 static ParseResult bool_core_fn(input_t* in, void* args, char* parser_name);
 
-combinator_t* number(tag_t tag);
-combinator_t* json_null(tag_t tag);
-combinator_t* json_bool(tag_t tag);
-combinator_t* json_string(tag_t tag);
 
+// Accumulates up to 19 significant digits; later ones only move the
+// decimal exponent (integer part) or are dropped (fraction).
+static int scan_digits(const char* text, int i, int length, uint64_t* mantissa, int* digits, int* exp10, bool fraction, bool* truncated) {
+    while (i < length && isdigit((unsigned char)text[i])) {
+        unsigned d = (unsigned)(text[i++] - '0');
+        if (*digits < 19) {
+            *mantissa = *mantissa * 10 + d;
+            if (*mantissa != 0) (*digits)++;
+            if (fraction) (*exp10)--;
+        } else {
+            if (d != 0) *truncated = true;
+            if (!fraction) (*exp10)++;
+        }
+    }
+    return i;
+}
 
-static ParseResult number_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
-    InputState state;
-    save_input_state(in, &state);
-    int start_pos = in->start;
-    char c = read1(in);
-    if (!isdigit(c) && c != '-') { restore_input_state(in, &state); return make_failure_v2(in, parser_name, strdup("Expected a number."), NULL); }
-    if (c == '-') {
-        c = read1(in);
-        if (!isdigit(c)) { restore_input_state(in, &state); return make_failure_v2(in, parser_name, strdup("Expected a digit after minus."), NULL); }
+bool json_scan_number(const char* text, int length, json_number_t* out) {
+    memset(out, 0, sizeof(*out));
+    int i = 0;
+    bool negative = i < length && text[i] == '-';
+    if (negative) i++;
+    if (i >= length || !isdigit((unsigned char)text[i])) {
+        out->error = negative ? "Expected a digit after minus." : "Expected a number.";
+        return false;
     }
-    // consume digits
-    while (in->start < in->length && isdigit(in->buffer[in->start])) in->start++;
+    // The value is decoded in the same pass that finds the number's end.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool truncated = false;
+    bool integral = true;
+    i = scan_digits(text, i, length, &mantissa, &digits, &exp10, false, &truncated);
     // check for .
-    if (in->start < in->length && in->buffer[in->start] == '.') {
-        in->start++; // consume .
-        if (in->start >= in->length || !isdigit(in->buffer[in->start])) { restore_input_state(in, &state); return make_failure_v2(in, parser_name, strdup("Invalid fractional part."), NULL); }
-        while (in->start < in->length && isdigit(in->buffer[in->start])) in->start++;
+    if (i < length && text[i] == '.') {
+        i++; // consume .
+        if (i >= length || !isdigit((unsigned char)text[i])) { out->error = "Invalid fractional part."; return false; }
+        integral = false;
+        i = scan_digits(text, i, length, &mantissa, &digits, &exp10, true, &truncated);
     }
     // check for e or E
-    if (in->start < in->length && (in->buffer[in->start] == 'e' || in->buffer[in->start] == 'E')) {
-        in->start++; // consume e/E
-        if (in->start < in->length && (in->buffer[in->start] == '+' || in->buffer[in->start] == '-')) in->start++; // consume +/-
-        if (in->start >= in->length || !isdigit(in->buffer[in->start])) { restore_input_state(in, &state); return make_failure_v2(in, parser_name, strdup("Invalid exponent part."), NULL); }
-        while (in->start < in->length && isdigit(in->buffer[in->start])) in->start++;
+    if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+        i++; // consume e/E
+        bool exp_negative = false;
+        if (i < length && (text[i] == '+' || text[i] == '-')) exp_negative = text[i++] == '-'; // consume +/-
+        if (i >= length || !isdigit((unsigned char)text[i])) { out->error = "Invalid exponent part."; return false; }
+        integral = false;
+        int exponent = 0;
+        while (i < length && isdigit((unsigned char)text[i])) {
+            if (exponent < 100000) exponent = exponent * 10 + (text[i] - '0');
+            i++;
+        }
+        exp10 += exp_negative ? -exponent : exponent;
+    }
+    out->length = i;
+    // Integers that fit int64 keep exact values; everything else is a double.
+    if (integral && exp10 == 0 && mantissa <= (uint64_t)INT64_MAX + negative) {
+        out->integral = true;
+        out->integer = negative ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
+        out->real = (double)out->integer;
+    } else {
+        out->real = decimal_to_double(negative, mantissa, exp10, truncated, text, i);
+    }
+    return true;
+}
+
+static ParseResult number_fn(input_t* in, void* args, char* parser_name) {
+    prim_args* pargs = (prim_args*)args;
+    int start_pos = in->start;
+    json_number_t num;
+    if (!json_scan_number(in->buffer + start_pos, in->length - start_pos, &num)) {
+        return make_failure_literal(in, parser_name, num.error);
     }
-    int len = in->start - start_pos;
-    if (len == 0 || (len == 1 && in->buffer[start_pos] == '-')) { restore_input_state(in, &state); return make_failure_v2(in, parser_name, strdup("Invalid number."), NULL); }
-    char* text = (char*)safe_malloc(len + 1);
-    strncpy(text, in->buffer + start_pos, len);
-    text[len] = '\0';
+    in->start += num.length;
+    in->col += num.length;
+    parse_emit_token(in, pargs->tag, start_pos, in->start);
+    if (in->recognize_only) return make_success(ast_nil);
     ast_t* ast = new_ast();
     ast->typ = pargs->tag;
-    ast->sym = sym_lookup(text);
-    free(text);
+    ast->sym = sym_lookup_n(in->buffer + start_pos, num.length);
+    if (num.integral) ast_set_int(ast, num.integer); else ast_set_double(ast, num.real);
     return make_success(ast);
 }
 
 combinator_t* number(tag_t tag) {
-    combinator_t* ws = many(satisfy(is_whitespace, JSON_T_NONE));
+    combinator_t* ws = skip_while(is_whitespace);
     prim_args* args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t* num = new_combinator();
@@ -73,20 +114,31 @@ combinator_t* number(tag_t tag) {
     return right(ws, num);
 }
 
+// Consumes `word` if the input continues with it. Keywords contain no
+// newlines, so only the column moves.
+static bool consume_word(input_t* in, const char* word, int len) {
+    if (in->length - in->start < len || memcmp(in->buffer + in->start, word, len) != 0) return false;
+    in->start += len;
+    in->col += len;
+    return true;
+}
+
 static ParseResult null_core_fn(input_t* in, void* args, char* parser_name) {
     prim_args* pargs = (prim_args*)args;
-    ParseResult result = parse(in, match("null"));
-    if (result.is_success) {
-        free_ast(result.value.ast);
-        ast_t* ast = new_ast();
-        ast->typ = pargs->tag;
-        return make_success(ast);
+    int start = in->start;
+    if (!consume_word(in, "null", 4)) {
+        if (in->recognize_only) return make_position_failure(in);
+        return make_failure_v2(in, parser_name, strdup("Expected 'null'."), input_excerpt(in, in->start, 10));
     }
-    return result;
+    parse_emit_token(in, pargs->tag, start, in->start);
+    if (in->recognize_only) return make_success(ast_nil);
+    ast_t* ast = new_ast();
+    ast->typ = pargs->tag;
+    return make_success(ast);
 }
 
 combinator_t* json_null(tag_t tag) {
-    combinator_t* ws = many(satisfy(is_whitespace, JSON_T_NONE));
+    combinator_t* ws = skip_while(is_whitespace);
     prim_args* args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t* null_core = new_combinator();
@@ -98,31 +150,22 @@ combinator_t* json_null(tag_t tag) {
 
 static ParseResult bool_core_fn(input_t* in, void* args, char* parser_name) {
     prim_args* pargs = (prim_args*)args;
-    InputState state;
-    save_input_state(in, &state);
-    ParseResult res_true = parse(in, match("true"));
-    if (res_true.is_success) {
-        free_ast(res_true.value.ast);
-        ast_t* ast = new_ast();
-        ast->typ = pargs->tag;
-        ast->sym = sym_lookup("1");
-        return make_success(ast);
-    }
-    free_error(res_true.value.error);
-    restore_input_state(in, &state);
-    ParseResult res_false = parse(in, match("false"));
-    if (res_false.is_success) {
-        free_ast(res_false.value.ast);
-        ast_t* ast = new_ast();
-        ast->typ = pargs->tag;
-        ast->sym = sym_lookup("0");
-        return make_success(ast);
-    }
-    return res_false;
+    int start = in->start;
+    const char* value;
+    if (consume_word(in, "true", 4)) value = "1";
+    else if (consume_word(in, "false", 5)) value = "0";
+    else if (in->recognize_only) return make_position_failure(in);
+    else return make_failure_v2(in, parser_name, strdup("Expected 'true' or 'false'."), input_excerpt(in, in->start, 10));
+    parse_emit_token(in, pargs->tag, start, in->start);
+    if (in->recognize_only) return make_success(ast_nil);
+    ast_t* ast = new_ast();
+    ast->typ = pargs->tag;
+    ast->sym = sym_lookup(value);
+    return make_success(ast);
 }
 
 combinator_t* json_bool(tag_t tag) {
-    combinator_t* ws = many(satisfy(is_whitespace, JSON_T_NONE));
+    combinator_t* ws = skip_while(is_whitespace);
     prim_args* args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t* bool_core = new_combinator();
@@ -133,10 +176,15 @@ combinator_t* json_bool(tag_t tag) {
 }
 
 combinator_t* json_string(tag_t tag) {
-    combinator_t* ws = many(satisfy(is_whitespace, JSON_T_NONE));
+    combinator_t* ws = skip_while(is_whitespace);
     return right(ws, string(tag));
 }
 
+// Structural characters may be preceded by whitespace.
+static combinator_t* json_punct(char* str) {
+    return right(skip_while(is_whitespace), match(str));
+}
+
 //=============================================================================
 // The Complete JSON Grammar
 //=============================================================================
@@ -153,13 +201,16 @@ combinator_t* json_parser() {
     combinator_t* j_null = json_null(JSON_T_NONE);
     combinator_t* j_bool = json_bool(JSON_T_INT); // Using INT for bool
 
-    // Recursive definitions for array and object, using new lazy proxies each time
-    combinator_t* kv_pair = seq(new_combinator(), JSON_T_ASSIGN, json_string(JSON_T_STRING), expect(match(":"), "Expected ':'"), lazy(p_json_value), NULL);
-    combinator_t* j_array = seq(new_combinator(), JSON_T_SEQ, match("["), sep_by(lazy(p_json_value), match(",")), expect(match("]"), "Expected ']'"), NULL);
-    combinator_t* j_object = seq(new_combinator(), JSON_T_SEQ, match("{"), sep_by(kv_pair, match(",")), expect(match("}"), "Expected '}'"), NULL);
+    // Recursive definitions for array and object, using new lazy proxies each time.
+    // Committing after the opening bracket lets event-sink parses stream
+    // elements out instead of holding the whole container for backtracking.
+    combinator_t* kv_pair = seq(new_combinator(), JSON_T_ASSIGN, json_string(JSON_T_STRING), expect(json_punct(":"), "Expected ':'"), lazy(p_json_value), NULL);
+    combinator_t* j_array = seq(new_combinator(), JSON_T_SEQ, commit(json_punct("[")), sep_by(lazy(p_json_value), json_punct(",")), expect(json_punct("]"), "Expected ']'"), NULL);
+    combinator_t* j_object = seq(new_combinator(), JSON_T_SEQ, commit(json_punct("{")), sep_by(kv_pair, json_punct(",")), expect(json_punct("}"), "Expected '}'"), NULL);
 
     // The main json_value parser is a `multi` choice between all possible types.
     multi(*p_json_value, JSON_T_NONE, j_string, j_number, j_null, j_bool, j_array, j_object, NULL);
 
-    return *p_json_value;
+    // Trailing whitespace after the document
+    return left(*p_json_value, skip_while(is_whitespace));
 }
@@ -11,4 +11,24 @@ typedef enum {
 // Returns a combinator that can parse a complete JSON value.
 combinator_t* json_parser();
 
+// The value parsers json_parser() is built from. Each skips leading
+// whitespace.
+combinator_t* number(tag_t tag);
+combinator_t* json_null(tag_t tag);
+combinator_t* json_bool(tag_t tag);
+combinator_t* json_string(tag_t tag);
+
+// A number as number() decodes it
+typedef struct {
+    int length;               // bytes it spans
+    bool integral;            // an integer that fits int64, held in `integer`
+    int64_t integer;
+    double real;              // the value as a double, always set
+    const char* error;        // static message when there is no number
+} json_number_t;
+
+// Scans the number text[0, length) starts with. Returns false if it does
+// not start with a valid one.
+bool json_scan_number(const char* text, int length, json_number_t* out);
+
 #endif // JSON_PARSER_H
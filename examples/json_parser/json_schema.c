@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "parser.h"
+#include "json_schema.h"
+
+typedef struct schema_object schema_object;
+struct schema_object {
+    const json_field_t* fields;
+    size_t count;
+    size_t* name_lengths;
+    uint64_t required;        // bit i: field i is required
+    // Switch table: slot switch_hash() holds field index + 1, 0 when empty.
+    uint32_t seed;
+    uint32_t shift;           // 32 - log2(table size)
+    bool full_hash;           // hash every byte; the sampled bytes collide
+    uint8_t* slots;
+    schema_object** nested;   // per field; JSON_FIELD_OBJECT only
+};
+
+struct json_schema {
+    schema_object* root;
+};
+
+typedef struct {
+    const char* text;
+    size_t length;
+    size_t pos;
+} cursor;
+
+// Keys of one message type mostly differ in length or in their first,
+// middle or last byte, so those are all that is hashed unless that is not
+// enough to tell them apart.
+static uint32_t switch_hash(const schema_object* o, const char* key, size_t length) {
+    uint32_t h = (uint32_t)length;
+    if (o->full_hash) {
+        for (size_t i = 0; i < length; i++) h = (h ^ (unsigned char)key[i]) * 16777619u;
+    } else if (length > 0) {
+        h ^= (uint32_t)(unsigned char)key[0] << 8 ^ (uint32_t)(unsigned char)key[length / 2] << 16 ^
+             (uint32_t)(unsigned char)key[length - 1] << 24;
+    }
+    return (h * o->seed) >> o->shift;
+}
+
+// Looks for a seed under which no two fields share a slot.
+static bool find_seed(schema_object* o, uint8_t* slots, size_t size) {
+    uint32_t seed = 0x9E3779B9u;
+    for (int attempt = 0; attempt < 256; attempt++) {
+        o->seed = seed | 1;
+        memset(slots, 0, size);
+        size_t i;
+        for (i = 0; i < o->count; i++) {
+            uint32_t slot = switch_hash(o, o->fields[i].name, o->name_lengths[i]);
+            if (slots[slot] != 0) break;
+            slots[slot] = (uint8_t)(i + 1);
+        }
+        if (i == o->count) return true;
+        seed = seed * 1664525u + 1013904223u;
+    }
+    return false;
+}
+
+static void free_object(schema_object* o) {
+    if (o == NULL) return;
+    for (size_t i = 0; i < o->count && o->nested; i++) free_object(o->nested[i]);
+    free(o->nested);
+    free(o->name_lengths);
+    free(o->slots);
+    free(o);
+}
+
+static schema_object* compile_object(const json_field_t* fields) {
+    schema_object* o = (schema_object*)safe_malloc(sizeof(schema_object));
+    memset(o, 0, sizeof(*o));
+    o->fields = fields;
+    while (fields[o->count].name != NULL) o->count++;
+    if (o->count > 64) goto invalid;
+    o->name_lengths = (size_t*)safe_malloc((o->count + 1) * sizeof(size_t));
+    o->nested = (schema_object**)calloc(o->count + 1, sizeof(schema_object*));
+    if (!o->nested) exception("calloc failed");
+    for (size_t i = 0; i < o->count; i++) {
+        o->name_lengths[i] = strlen(fields[i].name);
+        for (size_t j = 0; j < i; j++) {
+            if (o->name_lengths[j] == o->name_lengths[i] && memcmp(fields[j].name, fields[i].name, o->name_lengths[i]) == 0) goto invalid;
+        }
+        if (!fields[i].optional) o->required |= 1ull << i;
+        if (fields[i].type == JSON_FIELD_OBJECT) {
+            if (fields[i].fields == NULL) goto invalid;
+            o->nested[i] = compile_object(fields[i].fields);
+            if (o->nested[i] == NULL) goto invalid;
+        }
+    }
+
+    // From twice the fields up to 256 slots, sampled bytes first.
+    for (int full = 0; full < 2; full++) {
+        o->full_hash = full;
+        for (uint32_t bits = 1; bits <= 8; bits++) {
+            size_t size = (size_t)1 << bits;
+            if (size < 2 * o->count) continue;
+            o->slots = (uint8_t*)realloc(o->slots, size);
+            if (!o->slots) exception("realloc failed");
+            o->shift = 32 - bits;
+            if (find_seed(o, o->slots, size)) return o;
+        }
+    }
+
+invalid:
+    free_object(o);
+    return NULL;
+}
+
+json_schema_t* json_schema_compile(const json_field_t* fields) {
+    schema_object* root = compile_object(fields);
+    if (root == NULL) return NULL;
+    json_schema_t* schema = (json_schema_t*)safe_malloc(sizeof(json_schema_t));
+    schema->root = root;
+    return schema;
+}
+
+void json_schema_free(json_schema_t* schema) {
+    if (schema == NULL) return;
+    free_object(schema->root);
+    free(schema);
+}
+
+static void skip_space(cursor* c) {
+    while (c->pos < c->length && isspace((unsigned char)c->text[c->pos])) c->pos++;
+}
+
+static bool read_value(cursor* c, json_value_t* v) {
+    size_t n = json_read_value(c->text + c->pos, c->length - c->pos, v);
+    c->pos += n;
+    return n != 0;
+}
+
+static const json_field_t* find_field(const schema_object* o, const char* key, size_t length, size_t* index) {
+    uint8_t slot = o->slots[switch_hash(o, key, length)];
+    if (slot == 0) return NULL;
+    *index = slot - 1;
+    if (o->name_lengths[*index] != length || memcmp(o->fields[*index].name, key, length) != 0) return NULL;
+    return &o->fields[*index];
+}
+
+// Stores the scalar `v` in `field` of the struct at `out`.
+static json_schema_status store(const json_field_t* field, const json_value_t* v, char* out) {
+    if (v->kind == JSON_VALUE_NULL) return field->optional ? JSON_SCHEMA_OK : JSON_SCHEMA_MISMATCH;
+    switch (field->type) {
+        case JSON_FIELD_BOOL:
+            if (v->kind != JSON_VALUE_BOOL) return JSON_SCHEMA_MISMATCH;
+            *(bool*)(out + field->offset) = v->boolean;
+            return JSON_SCHEMA_OK;
+        case JSON_FIELD_INT:
+            if (v->kind != JSON_VALUE_NUMBER || !v->integral) return JSON_SCHEMA_MISMATCH;
+            *(int64_t*)(out + field->offset) = v->integer;
+            return JSON_SCHEMA_OK;
+        case JSON_FIELD_DOUBLE:
+            if (v->kind != JSON_VALUE_NUMBER) return JSON_SCHEMA_MISMATCH;
+            *(double*)(out + field->offset) = v->real;
+            return JSON_SCHEMA_OK;
+        case JSON_FIELD_STRING:
+            if (v->kind != JSON_VALUE_STRING || v->length > UINT32_MAX) return JSON_SCHEMA_MISMATCH;
+            *(json_string_span_t*)(out + field->offset) = (json_string_span_t){ v->text, (uint32_t)v->length, v->escaped };
+            return JSON_SCHEMA_OK;
+        default:
+            return JSON_SCHEMA_MISMATCH;
+    }
+}
+
+// Parses the object at the cursor into `out`. On failure c->pos is the
+// offset of the failing value.
+static json_schema_status parse_object(const schema_object* o, cursor* c, char* out) {
+    size_t start = c->pos;
+    if (c->pos >= c->length) return JSON_SCHEMA_MALFORMED;
+    if (c->text[c->pos] != '{') return JSON_SCHEMA_MISMATCH;
+    c->pos++;
+    skip_space(c);
+    uint64_t seen = 0;
+    if (c->pos < c->length && c->text[c->pos] == '}') {
+        c->pos++;
+    } else {
+        while (1) {
+            json_value_t key, v;
+            if (c->pos >= c->length || c->text[c->pos] != '"' || !read_value(c, &key)) return JSON_SCHEMA_MALFORMED;
+            char buf[256];
+            const char* name = key.text;
+            size_t name_length = key.length;
+            if (key.escaped) {
+                // Longer keys are not in any schema
+                long n = key.length <= sizeof(buf) ? json_value_string(&key, buf) : -1;
+                name = n < 0 ? NULL : buf;
+                name_length = n < 0 ? 0 : (size_t)n;
+            }
+            size_t index = 0;
+            const json_field_t* field = name ? find_field(o, name, name_length, &index) : NULL;
+
+            skip_space(c);
+            if (c->pos >= c->length || c->text[c->pos] != ':') return JSON_SCHEMA_MALFORMED;
+            c->pos++;
+            skip_space(c);
+            size_t value_start = c->pos;
+            if (field != NULL && field->type == JSON_FIELD_OBJECT && c->pos < c->length && c->text[c->pos] == '{') {
+                json_schema_status status = parse_object(o->nested[index], c, out + field->offset);
+                if (status != JSON_SCHEMA_OK) return status;
+            } else {
+                if (!read_value(c, &v)) {
+                    c->pos = value_start;
+                    return JSON_SCHEMA_MALFORMED;
+                }
+                if (field != NULL) {
+                    json_schema_status status = store(field, &v, out);
+                    if (status != JSON_SCHEMA_OK) {
+                        c->pos = value_start;
+                        return status;
+                    }
+                    // A null leaves an optional field missing.
+                    if (v.kind == JSON_VALUE_NULL) field = NULL;
+                }
+            }
+            if (field != NULL) seen |= 1ull << index;
+
+            skip_space(c);
+            if (c->pos < c->length && c->text[c->pos] == ',') {
+                c->pos++;
+                skip_space(c);
+            } else if (c->pos < c->length && c->text[c->pos] == '}') {
+                c->pos++;
+                break;
+            } else {
+                return JSON_SCHEMA_MALFORMED;
+            }
+        }
+    }
+    if (o->required & ~seen) {
+        c->pos = start;
+        return JSON_SCHEMA_MISSING;
+    }
+    return JSON_SCHEMA_OK;
+}
+
+json_schema_status json_schema_parse(const json_schema_t* schema, const char* text, size_t length, void* out,
+                                     size_t* error_offset) {
+    cursor c = { text, length, 0 };
+    skip_space(&c);
+    json_schema_status status = parse_object(schema->root, &c, (char*)out);
+    if (status == JSON_SCHEMA_OK) {
+        skip_space(&c);
+        if (c.pos != length) status = JSON_SCHEMA_MALFORMED;
+    }
+    if (status != JSON_SCHEMA_OK && error_offset != NULL) *error_offset = c.pos;
+    return status;
+}
@@ -0,0 +1,70 @@
+#ifndef JSON_SCHEMA_H
+#define JSON_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "json_ondemand.h"
+
+// Parsing JSON messages of a known shape straight into C structs. The
+// shape is a table of fields, one per struct member, with nested objects
+// pointing at tables of their own:
+//
+//     typedef struct { int64_t id; json_string_span_t name; } user_t;
+//     static const json_field_t user_fields[] = {
+//         JSON_FIELD(user_t, id, JSON_FIELD_INT, false),
+//         JSON_FIELD(user_t, name, JSON_FIELD_STRING, true),
+//         JSON_FIELDS_END
+//     };
+//
+// json_schema_compile() specializes a parser for it: each object gets a
+// collision-free switch table from key to field, so a member costs one
+// hash and one compare before its value is stored at the field's offset.
+// No AST is built and nothing is allocated per message.
+
+typedef enum {
+    JSON_FIELD_BOOL,          // bool
+    JSON_FIELD_INT,           // int64_t; the number must be an integer
+    JSON_FIELD_DOUBLE,        // double; integers are accepted
+    JSON_FIELD_STRING,        // json_string_span_t into the message
+    JSON_FIELD_OBJECT         // a struct described by `fields`
+} json_field_type;
+
+typedef struct json_field json_field_t;
+struct json_field {
+    const char* name;         // NULL ends the table
+    json_field_type type;
+    size_t offset;            // offsetof() the member
+    bool optional;            // may be missing or null; the member is left alone then
+    const json_field_t* fields;
+};
+
+#define JSON_FIELD(type_, member, kind, optional) \
+    { #member, kind, offsetof(type_, member), optional, NULL }
+#define JSON_OBJECT_FIELD(type_, member, nested, optional) \
+    { #member, JSON_FIELD_OBJECT, offsetof(type_, member), optional, nested }
+#define JSON_FIELDS_END { NULL, JSON_FIELD_BOOL, 0, false, NULL }
+
+typedef struct json_schema json_schema_t;
+
+// Compiles the field table of the top-level object. The tables must
+// outlive the schema. Returns NULL if a table repeats a key or has more
+// than 64 fields.
+json_schema_t* json_schema_compile(const json_field_t* fields);
+void json_schema_free(json_schema_t* schema);
+
+typedef enum {
+    JSON_SCHEMA_OK,
+    JSON_SCHEMA_MALFORMED,    // not JSON
+    JSON_SCHEMA_MISMATCH,     // a value of the wrong type, or not an object
+    JSON_SCHEMA_MISSING       // a required field is missing
+} json_schema_status;
+
+// Parses the object text[0, length) into the struct at `out`. Members the
+// schema lacks are skipped; a key given twice takes the last value.
+// Strings point into `text`. On failure `out` may be partly written and,
+// if `error_offset` is not NULL, it gets the offset of the failing value.
+json_schema_status json_schema_parse(const json_schema_t* schema, const char* text, size_t length, void* out,
+                                     size_t* error_offset);
+
+#endif // JSON_SCHEMA_H
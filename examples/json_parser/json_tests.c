@@ -2,10 +2,17 @@
 #include "parser.h"
 #include "combinators.h"
 #include "json_parser.h"
+#include "json_ndjson.h"
+#include "json_index.h"
+#include "json_ondemand.h"
+#include "json_objects.h"
+#include "json_columns.h"
+#include "json_schema.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 // --- Test Helpers ---
 
@@ -118,6 +125,8 @@ void test_json_successes(void) {
     run_json_success_test("{}", check_empty_object, "empty object");
     run_json_success_test("[1, \"two\", true]", check_simple_array, "simple array");
     run_json_success_test("{\"key\": \"value\", \"n\": 123}", check_simple_object, "simple object");
+    run_json_success_test(" [ 1 , \"two\",\n\ttrue ] \n", check_simple_array, "array with whitespace");
+    run_json_success_test("{\n  \"key\" : \"value\",\n  \"n\" : 123\n}\n", check_simple_object, "pretty-printed object");
 }
 
 void test_json_failures(void) {
@@ -146,8 +155,757 @@ void test_json_failures(void) {
     run_json_fail_test("{\"a\": 1", "unclosed object with value");
 }
 
+void test_json_nesting_limit(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    // Unterminated, so without a limit the whole input would be explored
+    size_t depth = 1000000;
+    input_t* input = new_input();
+    input->buffer = safe_malloc(depth + 1);
+    memset(input->buffer, '[', depth);
+    input->buffer[depth] = '\0';
+    input->length = (int)depth;
+
+    parse_limits_t limits = { .max_depth = 512 };
+    input->limits = &limits;
+    combinator_t* p = json_parser();
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->limit == PARSE_LIMIT_DEPTH);
+    free_error(res.value.error);
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+void test_json_deep_nesting(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    size_t depth = 20000;
+    input_t* input = new_input();
+    input->buffer = safe_malloc(2 * depth + 1);
+    memset(input->buffer, '[', depth);
+    memset(input->buffer + depth, ']', depth);
+    input->buffer[2 * depth] = '\0';
+    input->length = (int)(2 * depth);
+
+    combinator_t* p = json_parser();
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == input->length);
+    free_ast(res.value.ast);
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+void test_json_validate(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* p = json_parser();
+    const char* docs[] = {
+        "{\"a\":[1, -2.5e3, true, false, null],\"b\":{\"c\": \"d\"}}",
+        "{\"a\":[1, 2,],\"b\": 3}",
+    };
+    for (int i = 0; i < 2; i++) {
+        input_t* input = new_input();
+        input->buffer = strdup(docs[i]);
+        input->length = strlen(docs[i]);
+        input->recognize_only = true;
+        ParseResult res = parse(input, p);
+        if (i == 0) {
+            TEST_ASSERT(res.is_success);
+            TEST_CHECK(res.value.ast == ast_nil);
+            TEST_CHECK(input->start == input->length);
+        } else {
+            TEST_ASSERT(!res.is_success);
+            free_error(res.value.error);
+        }
+        free(input->buffer);
+        free(input);
+    }
+    free_combinator(p);
+}
+
+typedef struct {
+    size_t tokens;
+    int depth;
+    int max_depth;
+} json_event_counts;
+
+static void count_json_event(const parse_event_t* event, void* context) {
+    json_event_counts* c = (json_event_counts*)context;
+    if (event->kind == PARSE_EVENT_TOKEN) c->tokens++;
+    else if (event->kind == PARSE_EVENT_ENTER && ++c->depth > c->max_depth) c->max_depth = c->depth;
+    else if (event->kind == PARSE_EVENT_LEAVE) c->depth--;
+}
+
+void test_json_event_stream(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    // [[1,true,"s"],[1,true,"s"],...]
+    const int rows = 100000;
+    const char* row = "[1,true,\"s\"],";
+    size_t row_len = strlen(row);
+    char* text = (char*)safe_malloc(rows * row_len + 2);
+    text[0] = '[';
+    for (int i = 0; i < rows; i++) memcpy(text + 1 + i * row_len, row, row_len);
+    text[rows * row_len] = ']';
+    text[rows * row_len + 1] = '\0';
+
+    combinator_t* p = json_parser();
+    input_t* input = new_input();
+    input->buffer = text;
+    input->length = strlen(text);
+    json_event_counts counts = {0};
+    parse_events_t events = {0};
+    events.sink = count_json_event;
+    events.context = &counts;
+    input->events = &events;
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == input->length);
+    TEST_CHECK(counts.tokens == (size_t)rows * 3);
+    TEST_CHECK(counts.depth == 0 && counts.max_depth == 2);
+    // Elements are delivered as the array is parsed, not at the end.
+    TEST_CHECK(events.peak < 64);
+    TEST_MSG("journal peak: %zu events", events.peak);
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+// Parses a JSON string literal and returns its symbol (NULL on failure).
+static ast_t* parse_json_string(const char* text, combinator_t* p) {
+    input_t* input = new_input();
+    input->buffer = strdup(text);
+    input->length = strlen(text);
+    ParseResult res = parse(input, p);
+    ast_t* ast = NULL;
+    if (res.is_success) ast = res.value.ast;
+    else free_error(res.value.error);
+    free(input->buffer);
+    free(input);
+    return ast;
+}
+
+void test_json_string_escapes(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* p = json_parser();
+    struct { const char* text; const char* expected; size_t length; } cases[] = {
+        { "\"plain text that is longer than one vector\"", "plain text that is longer than one vector", 41 },
+        { "\"tab\\there \\\"quoted\\\" back\\\\slash \\/ \\b\\f\\r\\n\"", "tab\there \"quoted\" back\\slash / \b\f\r\n", 35 },
+        { "\"caf\\u00e9 \\u20AC\"", "caf\xc3\xa9 \xe2\x82\xac", 9 },
+        { "\"\\ud83d\\ude00 smile\"", "\xf0\x9f\x98\x80 smile", 10 },
+        { "\"lone \\ud83d surrogate\"", "lone \xef\xbf\xbd surrogate", 18 },
+        { "\"nul\\u0000byte\"", "nul", 8 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TEST_CASE(cases[i].text);
+        ast_t* ast = parse_json_string(cases[i].text, p);
+        TEST_ASSERT(ast != NULL);
+        TEST_CHECK(ast->typ == JSON_T_STRING);
+        TEST_CHECK(ast->sym->length == cases[i].length);
+        TEST_MSG("length %zu, expected %zu", ast->sym->length, cases[i].length);
+        TEST_CHECK(memcmp(ast->sym->name, cases[i].expected, strlen(cases[i].expected)) == 0);
+        free_ast(ast);
+    }
+    TEST_CHECK(parse_json_string("\"bad \\u12x4\"", p) == NULL);
+    TEST_CHECK(parse_json_string("\"short \\u12\"", p) == NULL);
+    TEST_CHECK(parse_json_string("\"ends in backslash\\\"", p) == NULL);
+    free_combinator(p);
+}
+
+void test_json_number_values(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* p = json_parser();
+    const char* ints[] = { "0", "-7", "9223372036854775807", "-9223372036854775808" };
+    for (int i = 0; i < 4; i++) {
+        TEST_CASE(ints[i]);
+        ast_t* ast = parse_json_string(ints[i], p);
+        TEST_ASSERT(ast != NULL);
+        int64_t v = 0;
+        TEST_CHECK(ast->value_kind == AST_VALUE_INT);
+        TEST_CHECK(ast_int_value(ast, &v) && v == strtoll(ints[i], NULL, 10));
+        free_ast(ast);
+    }
+    // Fast-path and fallback doubles must both round exactly like strtod
+    const char* doubles[] = {
+        "0.1", "-123.45", "6.022e23", "1e22", "1e23", "9223372036854775808",
+        "123456789012345678901234567890", "0.30000000000000004", "1.7976931348623157e308",
+        "5e-324", "2.2250738585072014e-308", "0.0000000000000000000000000001", "1e400", "-1e-400",
+    };
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        TEST_CASE(doubles[i]);
+        ast_t* ast = parse_json_string(doubles[i], p);
+        TEST_ASSERT(ast != NULL);
+        double d = 0;
+        TEST_CHECK(ast->value_kind == AST_VALUE_DOUBLE);
+        TEST_CHECK(ast_double_value(ast, &d) && d == strtod(doubles[i], NULL));
+        TEST_MSG("got %.17g, expected %.17g", d, strtod(doubles[i], NULL));
+        free_ast(ast);
+    }
+    free_combinator(p);
+}
+
+typedef struct {
+    size_t lines[16];
+    bool ok[16];
+    tag_t tags[16];
+    size_t count;
+} ndjson_capture;
+
+static void capture_record(const json_record_t* record, void* context) {
+    ndjson_capture* c = (ndjson_capture*)context;
+    if (c->count == 16) return;
+    c->lines[c->count] = record->line;
+    c->ok[c->count] = record->error == NULL;
+    c->tags[c->count] = record->ast ? record->ast->typ : JSON_T_NONE;
+    c->count++;
+}
+
+void test_json_ndjson(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* p = json_parser();
+    // Blank lines, CRLF, a bad record, trailing garbage, no final newline
+    const char* data =
+        "{\"a\": 1}\n"
+        "\n"
+        "[1, 2, 3]\r\n"
+        "  \"text\"  \n"
+        "{\"b\": }\n"
+        "42 43\n"
+        "   \n"
+        "{\"c\": {\"d\": [true, false, null]}}";
+    size_t expected_lines[] = { 1, 3, 4, 5, 6, 8 };
+    bool expected_ok[] = { true, true, true, false, false, true };
+
+    // Tiny chunks so records spread over many chunks and slots
+    unsigned thread_counts[] = { 1, 3 };
+    for (int t = 0; t < 2; t++) {
+        for (int validate = 0; validate < 2; validate++) {
+            ndjson_capture c;
+            memset(&c, 0, sizeof(c));
+            json_ndjson_options_t options = { thread_counts[t], 8, validate != 0 };
+            json_ndjson_stats_t stats;
+            TEST_CHECK(json_ndjson_ingest(data, strlen(data), p, &options, capture_record, &c, &stats) == 0);
+            TEST_CHECK(stats.records == 6 && stats.failed == 2 && stats.bytes == strlen(data));
+            TEST_ASSERT(c.count == 6);
+            for (size_t i = 0; i < 6; i++) {
+                TEST_CHECK(c.lines[i] == expected_lines[i]);
+                TEST_CHECK(c.ok[i] == expected_ok[i]);
+                TEST_MSG("threads %u, validate %d, record %zu: line %zu", thread_counts[t], validate, i, c.lines[i]);
+            }
+            if (!validate) TEST_CHECK(c.tags[0] == JSON_T_SEQ || c.tags[0] == JSON_T_ASSIGN);
+        }
+    }
+    free_combinator(p);
+}
+
+// Structural positions by a plain byte loop, with the same rules as stage 1:
+// a quote after an odd run of backslashes is escaped, wherever it is.
+static int reference_index(const char* text, size_t length, uint32_t* out, size_t* count) {
+    bool in_string = false, escaped = false, scalar = false;
+    *count = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        bool quote = c == '"' && !escaped;
+        escaped = c == '\\' && !escaped;
+        if (in_string) {
+            if (quote) in_string = false;
+            scalar = false;
+        } else if (quote) {
+            out[(*count)++] = (uint32_t)i;
+            in_string = true;
+            scalar = false;
+        } else if (strchr("{}[]:,", c) != NULL) {
+            out[(*count)++] = (uint32_t)i;
+            scalar = false;
+        } else if (isspace((unsigned char)c)) {
+            scalar = false;
+        } else {
+            if (!scalar) out[(*count)++] = (uint32_t)i;
+            scalar = true;
+        }
+    }
+    return in_string ? -1 : 0;
+}
+
+void test_json_index_stage1(void) {
+    // Few distinct bytes, so backslash runs and quotes straddle blocks often
+    const char alphabet[] = "\"\"\\\\\\a1 \n{}[]:,";
+    char text[400];
+    uint32_t expected[400];
+    json_index_t index;
+    memset(&index, 0, sizeof(index));
+    srand(46);
+    for (int round = 0; round < 2000; round++) {
+        size_t length = (size_t)(rand() % (int)sizeof(text));
+        for (size_t i = 0; i < length; i++) text[i] = alphabet[rand() % (int)(sizeof(alphabet) - 1)];
+        size_t count = 0;
+        int rc = reference_index(text, length, expected, &count);
+        TEST_CHECK(json_index_build(&index, text, length) == rc);
+        if (rc != 0) continue;
+        TEST_CHECK(index.count == count);
+        TEST_CHECK(index.count == count && memcmp(index.positions, expected, count * sizeof(uint32_t)) == 0);
+        TEST_MSG("round %d: %.*s", round, (int)length, text);
+    }
+    json_index_free(&index);
+}
+
+static bool same_ast(ast_t* a, ast_t* b) {
+    for (; a != NULL || b != NULL; a = a->next, b = b->next) {
+        if (a == NULL || b == NULL) return false;
+        if (a == ast_nil || b == ast_nil) {
+            if (a != b) return false;
+            continue;
+        }
+        if (a->typ != b->typ || a->line != b->line || a->col != b->col || a->value_kind != b->value_kind) return false;
+        if ((a->sym == NULL) != (b->sym == NULL)) return false;
+        if (a->sym && (a->sym->length != b->sym->length || memcmp(a->sym->name, b->sym->name, a->sym->length) != 0)) return false;
+        if (a->value_kind != AST_VALUE_NONE && memcmp(&a->value, &b->value, sizeof(a->value)) != 0) return false;
+        if (!same_ast(a->child, b->child)) return false;
+    }
+    return true;
+}
+
+// Both parsers must agree on the result, the AST, the end position and any
+// error report.
+static void check_indexed_matches(const char* text, combinator_t* grammar, combinator_t* indexed, bool validate) {
+    input_t a, b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    init_input_buffer(&a, (char*)text, (int)strlen(text));
+    init_input_buffer(&b, (char*)text, (int)strlen(text));
+    a.recognize_only = b.recognize_only = validate;
+    ParseResult ra = parse(&a, grammar);
+    ParseResult rb = parse(&b, indexed);
+    TEST_CHECK(ra.is_success == rb.is_success);
+    TEST_MSG("%s", text);
+    if (ra.is_success && rb.is_success) {
+        TEST_CHECK(same_ast(ra.value.ast, rb.value.ast));
+        TEST_CHECK(a.start == b.start && a.line == b.line && a.col == b.col);
+        TEST_MSG("%s: end %d:%d/%d vs %d:%d/%d", text, a.line, a.col, a.start, b.line, b.col, b.start);
+    } else if (!ra.is_success && !rb.is_success) {
+        TEST_CHECK(ra.value.error->line == rb.value.error->line && ra.value.error->col == rb.value.error->col);
+        TEST_CHECK(strcmp(ra.value.error->message, rb.value.error->message) == 0);
+    }
+    if (ra.is_success) free_ast(ra.value.ast); else free_error(ra.value.error);
+    if (rb.is_success) free_ast(rb.value.ast); else free_error(rb.value.error);
+}
+
+void test_json_indexed_parser(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* grammar = json_parser();
+    combinator_t* indexed = json_indexed_parser();
+    const char* valid[] = {
+        "{}", "[]", " [ ] ", "42", "-0.5e3", "\"text\"", "true", "false", "null",
+        "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\"}}",
+        "[[[]], [{}], {\"x\": []}]",
+        "{\n  \"key\": \"multi\\nline\",\n  \"list\": [\n    1,\n    \"two\"\n  ]\n}\n",
+        "[\"a\\\\\", \"b\\\\\\\"c\", \"\\u00e9\\ud83d\\ude00\"]",
+        "[\"a long string that runs across the first sixty-four byte block\", \"\\\\\\\\\", 1.5]",
+        "\t\r\n\v\f[1,2]\f",
+        "[\"str\n\nwith raw newlines\", \n\"after\"]",
+        "{} x", "[1] [2]", "1 2", "\"a\" }",
+    };
+    const char* invalid[] = {
+        "", "   ", "[", "]", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "[1,]", "[1 2]", "{1: 2}",
+        "[\"unterminated]", "[01x]", "[1-2]", "[nul]", "[truex]", "[\"a\"b]", "[-]", "{,}",
+        "[\"bad \\u12x4\"]", "{\"a\": 1,}", "[1}", "{\"a\": 1]", "\\[1]",
+    };
+    size_t valid_count = sizeof(valid) / sizeof(valid[0]);
+    for (int validate = 0; validate < 2; validate++) {
+        for (size_t i = 0; i < valid_count; i++) check_indexed_matches(valid[i], grammar, indexed, validate);
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            check_indexed_matches(invalid[i], grammar, indexed, validate);
+        }
+    }
+    size_t fast = 0, fallbacks = 0;
+    json_indexed_counts(indexed, &fast, &fallbacks);
+    TEST_CHECK(fast == 2 * valid_count);
+    TEST_MSG("%zu indexed, %zu fell back", fast, fallbacks);
+
+    // A larger document, pretty-printed so there are newlines to count
+    size_t cap = 1 << 16, len = 0;
+    char* doc = safe_malloc(cap);
+    len += (size_t)snprintf(doc + len, cap - len, "[\n");
+    for (int i = 0; i < 300; i++) {
+        len += (size_t)snprintf(doc + len, cap - len,
+            "  {\"id\": %d, \"name\": \"item \\\"%d\\\"\", \"tags\": [\"t%d\", null, %s], \"score\": %d.%de%d}%s\n",
+            i, i, i % 7, i % 2 ? "true" : "false", i * 31, i % 10, i % 5 - 2, i < 299 ? "," : "");
+    }
+    len += (size_t)snprintf(doc + len, cap - len, "]\n");
+    TEST_ASSERT(len < cap);
+    check_indexed_matches(doc, grammar, indexed, false);
+    free(doc);
+
+    free_combinator(indexed);
+    free_combinator(grammar);
+}
+
+void test_json_ondemand(void) {
+    const char* doc =
+        "{\"skip\": {\"deep\": [1, {\"x\": \"}]\\\"{[\"}], \"s\": \"\\\\\"},\n"
+        " \"a\": {\"b\": [10, -2.5e1, \"three\", {\"c\": true, \"d\": null}, [\"x\", [7]]]},\n"
+        " \"caf\\u00e9\": \"tab\\there\", \"empty\": {}, \"list\": [], \"big\": 123456789012345678901}";
+    size_t len = strlen(doc);
+    json_value_t v;
+
+    TEST_CHECK(json_find(doc, len, "a.b[0]", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_NUMBER && v.integral && v.integer == 10);
+    TEST_CHECK(json_find(doc, len, "a.b[1]", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_NUMBER && !v.integral && v.real == -25.0);
+    TEST_CHECK(v.length == 6 && memcmp(v.text, "-2.5e1", 6) == 0);
+    TEST_CHECK(json_find(doc, len, "a.b[2]", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_STRING && v.length == 5 && memcmp(v.text, "three", 5) == 0 && !v.escaped);
+    TEST_CHECK(json_find(doc, len, "a.b[3].c", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_BOOL && v.boolean);
+    TEST_CHECK(json_find(doc, len, "a.b[3].d", &v) == JSON_FIND_OK && v.kind == JSON_VALUE_NULL);
+    TEST_CHECK(json_find(doc, len, "a.b[4][1][0]", &v) == JSON_FIND_OK && v.integer == 7);
+    TEST_CHECK(json_find(doc, len, "big", &v) == JSON_FIND_OK && !v.integral && v.real == 123456789012345678901.0);
+
+    // Containers come back as spans that can be searched in turn.
+    TEST_CHECK(json_find(doc, len, "a.b[3]", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_OBJECT && v.length == 22 && v.text[0] == '{' && v.text[21] == '}');
+    json_value_t inner;
+    TEST_CHECK(json_find(v.text, v.length, "c", &inner) == JSON_FIND_OK && inner.boolean);
+    TEST_CHECK(json_find(doc, len, "", &v) == JSON_FIND_OK && v.kind == JSON_VALUE_OBJECT && v.length == len);
+
+    // Keys and string values with escapes
+    TEST_CHECK(json_find(doc, len, "caf\xc3\xa9", &v) == JSON_FIND_OK);
+    TEST_CHECK(v.kind == JSON_VALUE_STRING && v.escaped);
+    char decoded[32];
+    long n = json_value_string(&v, decoded);
+    TEST_CHECK(n == 8 && memcmp(decoded, "tab\there", 8) == 0);
+    TEST_CHECK(json_find(doc, len, "skip.s", &v) == JSON_FIND_OK && v.length == 2);
+
+    TEST_CHECK(json_find(doc, len, "a.missing", &v) == JSON_FIND_MISSING);
+    TEST_CHECK(json_find(doc, len, "a.b[9]", &v) == JSON_FIND_MISSING);
+    TEST_CHECK(json_find(doc, len, "a.b.c", &v) == JSON_FIND_MISSING);
+    TEST_CHECK(json_find(doc, len, "a[0]", &v) == JSON_FIND_MISSING);
+    TEST_CHECK(json_find(doc, len, "empty.x", &v) == JSON_FIND_MISSING);
+    TEST_CHECK(json_find(doc, len, "list[0]", &v) == JSON_FIND_MISSING);
+    const char* bad_paths[] = { ".a", "a..b", "a.", "a[", "a[x]", "a[1", "a.[1]", "a[1]b" };
+    for (size_t i = 0; i < sizeof(bad_paths) / sizeof(bad_paths[0]); i++) {
+        TEST_CHECK(json_find(doc, len, bad_paths[i], &v) == JSON_FIND_BAD_PATH);
+        TEST_MSG("%s", bad_paths[i]);
+    }
+    const char* broken[] = { "{\"a\" 1}", "{\"x\": [1, 2, \"a\": 1}", "{\"x\": \"open, \"a\": 1", "[1 2]", "{\"a\": tru}", "{\"a\": 1x}" };
+    const char* paths[] = { "a", "a", "a", "[1]", "a", "a" };
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        TEST_CHECK(json_find(broken[i], strlen(broken[i]), paths[i], &v) == JSON_FIND_MALFORMED);
+        TEST_MSG("%s", broken[i]);
+    }
+}
+
+void test_json_get(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    // One wide object with a duplicate key, small ones nested in it, and
+    // keys that differ only past an embedded NUL
+    size_t cap = 1 << 16, len = 0;
+    char* doc = safe_malloc(cap);
+    len += (size_t)snprintf(doc + len, cap - len, "{\"dup\": 1, \"nul\\u0000a\": 2, \"nul\\u0000b\": 3, ");
+    for (int i = 0; i < 1000; i++) {
+        len += (size_t)snprintf(doc + len, cap - len, "\"k%d\": {\"id\": %d, \"k%d\": [%d]}, ", i, i, i, i);
+    }
+    len += (size_t)snprintf(doc + len, cap - len, "\"dup\": 2, \"list\": [{\"x\": 1}], \"empty\": {}}");
+    TEST_ASSERT(len < cap);
+
+    input_t in;
+    memset(&in, 0, sizeof(in));
+    init_input_buffer(&in, doc, (int)len);
+    combinator_t* p = json_parser();
+    ParseResult res = parse(&in, p);
+    TEST_ASSERT(res.is_success);
+    ast_t* root = res.value.ast;
+
+    json_object_index_t* index = new_json_object_index(root, 4);
+    TEST_CHECK(json_object_index_objects(index) == 1);
+    // dup, two nul keys, k0..k999, list, empty
+    TEST_CHECK(json_object_index_keys(index) == 1005);
+    for (int with_index = 0; with_index < 2; with_index++) {
+        const json_object_index_t* idx = with_index ? index : NULL;
+        char key[16];
+        for (int i = 0; i < 1000; i += 7) {
+            int n = snprintf(key, sizeof(key), "k%d", i);
+            ast_t* inner = json_get(idx, root, key, (size_t)n);
+            TEST_ASSERT(inner != NULL && inner->typ == JSON_T_SEQ);
+            ast_t* id = json_get(idx, inner, "id", 2);
+            int64_t v = -1;
+            TEST_CHECK(id != NULL && ast_int_value(id, &v) && v == i);
+            // Small objects are searched by walking, keys shared or not
+            ast_t* list = json_get(idx, inner, key, (size_t)n);
+            TEST_CHECK(list != NULL && list->typ == JSON_T_SEQ);
+        }
+        ast_t* dup = json_get(idx, root, "dup", 3);
+        int64_t v = 0;
+        TEST_CHECK(dup != NULL && ast_int_value(dup, &v) && v == 1);
+        ast_t* nul = json_get(idx, root, "nul\0b", 5);
+        TEST_CHECK(nul != NULL && ast_int_value(nul, &v) && v == 3);
+        TEST_CHECK(json_get(idx, root, "nul", 3) == NULL);
+        TEST_CHECK(json_get(idx, root, "missing", 7) == NULL);
+        TEST_CHECK(json_get(idx, root, "id", 2) == NULL);
+        ast_t* list = json_get(idx, root, "list", 4);
+        TEST_CHECK(list != NULL && json_get(idx, list, "x", 1) == NULL);
+        ast_t* empty = json_get(idx, root, "empty", 5);
+        TEST_CHECK(empty != NULL && json_get(idx, empty, "x", 1) == NULL);
+    }
+    free_json_object_index(index);
+    free_ast(root);
+    free_combinator(p);
+    free(doc);
+}
+
+void test_json_columns(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = JSON_T_NONE;
+    }
+    combinator_t* p = json_parser();
+    size_t cap = 1 << 16, len = 0;
+    char* doc = safe_malloc(cap);
+    len += (size_t)snprintf(doc + len, cap - len, "[\n");
+    for (int i = 0; i < 300; i++) {
+        const char* sep = i < 299 ? "," : "";
+        if (i == 50) {
+            len += (size_t)snprintf(doc + len, cap - len, "  {\"id\": 50, \"nested\": {\"x\": 1}}%s\n", sep);
+        } else if (i == 51) {
+            len += (size_t)snprintf(doc + len, cap - len, "  [51]%s\n", sep);
+        } else if (i == 52) {
+            len += (size_t)snprintf(doc + len, cap - len, "  {\"id\": \"fifty-two\"}%s\n", sep);
+        } else if (i % 10 == 7) {
+            // Other key order, one key missing
+            len += (size_t)snprintf(doc + len, cap - len, "  {\"ok\": false, \"name\": \"n%d\", \"id\": %d}%s\n", i, i, sep);
+        } else {
+            len += (size_t)snprintf(doc + len, cap - len, "  {\"id\": %d, \"name\": \"n\\\"%d\", \"score\": %d%s, \"ok\": true, \"opt\": null}%s\n",
+                                    i, i, i, i == 120 ? ".5" : "", sep);
+        }
+    }
+    len += (size_t)snprintf(doc + len, cap - len, "]");
+    TEST_ASSERT(len < cap);
+
+    json_table_t table;
+    TEST_ASSERT(json_columns_decode(doc, len, NULL, 0, p, &table) == 0);
+    TEST_CHECK(table.rows == 300);
+    TEST_CHECK(table.column_count == 5);
+    json_column_t* id = json_table_column(&table, "id", 2);
+    json_column_t* name = json_table_column(&table, "name", 4);
+    json_column_t* score = json_table_column(&table, "score", 5);
+    json_column_t* ok = json_table_column(&table, "ok", 2);
+    json_column_t* opt = json_table_column(&table, "opt", 3);
+    TEST_ASSERT(id && name && score && ok && opt);
+    TEST_CHECK(id->type == JSON_COLUMN_INT);
+    TEST_CHECK(name->type == JSON_COLUMN_STRING);
+    TEST_CHECK(score->type == JSON_COLUMN_DOUBLE);
+    TEST_CHECK(ok->type == JSON_COLUMN_BOOL);
+    TEST_CHECK(opt->type == JSON_COLUMN_NULL && opt->null_count == 300);
+
+    TEST_ASSERT(table.other_count == 3);
+    TEST_CHECK(table.others[0].row == 50 && table.others[0].ast->typ == JSON_T_SEQ);
+    TEST_CHECK(table.others[1].row == 51 && table.others[1].ast->typ == JSON_T_SEQ);
+    TEST_CHECK(table.others[2].row == 52);
+    TEST_CHECK(id->null_count == 3);
+    TEST_CHECK(score->null_count == 3 + 30);
+    for (size_t r = 0; r < 300; r++) {
+        bool other = r >= 50 && r <= 52;
+        TEST_CHECK(json_column_is_null(id, r) == other);
+        if (other) continue;
+        TEST_CHECK(id->values.ints[r] == (int64_t)r);
+        TEST_CHECK(ok->values.bools[r] == (r % 10 != 7));
+        TEST_CHECK(json_column_is_null(score, r) == (r % 10 == 7));
+        if (r % 10 != 7) {
+            TEST_CHECK(score->values.reals[r] == (r == 120 ? 120.5 : (double)r));
+            TEST_MSG("row %zu: %g", r, score->values.reals[r]);
+        }
+        char expected[16], decoded[16];
+        int n = snprintf(expected, sizeof(expected), r % 10 == 7 ? "n%zu" : "n\"%zu", r);
+        json_value_t v = { .kind = JSON_VALUE_STRING, .text = name->values.strings[r].text,
+                           .length = name->values.strings[r].length, .escaped = name->values.strings[r].escaped };
+        TEST_CHECK(json_value_string(&v, decoded) == n && memcmp(decoded, expected, (size_t)n) == 0);
+    }
+    json_table_free(&table);
+
+    // A declared shape: integers widen into a double column, and strings
+    // where integers are declared make the row deviate.
+    json_column_spec_t shape[] = { { "id", JSON_COLUMN_DOUBLE }, { "name", JSON_COLUMN_INT } };
+    TEST_ASSERT(json_columns_decode(doc, len, shape, 2, p, &table) == 0);
+    TEST_CHECK(table.column_count == 2 && table.rows == 300);
+    TEST_CHECK(table.columns[0].type == JSON_COLUMN_DOUBLE && table.columns[1].type == JSON_COLUMN_INT);
+    TEST_CHECK(table.other_count == 300);
+    json_table_free(&table);
+    json_column_spec_t full_shape[] = { { "id", JSON_COLUMN_DOUBLE }, { "name", JSON_COLUMN_STRING },
+                                        { "score", JSON_COLUMN_DOUBLE }, { "ok", JSON_COLUMN_BOOL },
+                                        { "opt", JSON_COLUMN_INT } };
+    TEST_ASSERT(json_columns_decode(doc, len, full_shape, 5, p, &table) == 0);
+    TEST_CHECK(table.other_count == 3 && table.columns[0].values.reals[10] == 10.0);
+    TEST_CHECK(table.columns[4].type == JSON_COLUMN_INT && table.columns[4].null_count == 300);
+    json_table_free(&table);
+
+    const char* malformed[] = { "", "{}", "[{\"a\": 1}", "[1,]", "[{\"a\" 1}]", "[{\"a\": tru}]", "[] x", "[{\"a\": [}]" };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        TEST_CHECK(json_columns_decode(malformed[i], strlen(malformed[i]), NULL, 0, p, &table) == -1);
+        TEST_MSG("%s", malformed[i]);
+    }
+    TEST_CHECK(json_columns_decode(" [ ] ", 5, NULL, 0, p, &table) == 0 && table.rows == 0);
+    json_table_free(&table);
+
+    // Keys come from the first element that fits, not from element 0.
+    const char* late = "[null, {\"a\": 1}, {\"a\": 2}, {\"a\": 3}]";
+    TEST_ASSERT(json_columns_decode(late, strlen(late), NULL, 0, p, &table) == 0);
+    TEST_CHECK(table.column_count == 1 && table.other_count == 1 && table.others[0].row == 0);
+    id = json_table_column(&table, "a", 1);
+    TEST_ASSERT(id != NULL);
+    TEST_CHECK(json_column_is_null(id, 0) && id->values.ints[1] == 1 && id->values.ints[3] == 3);
+    json_table_free(&table);
+
+    // A deviating row leaves no columns or types behind.
+    const char* odd = "[{\"a\": 1, \"n\": [1], \"b\": 2}, {\"a\": 2, \"b\": 3}, {\"a\": 2.5, \"b\": {}},"
+                      " {\"a\": 4, \"b\": 5}]";
+    TEST_ASSERT(json_columns_decode(odd, strlen(odd), NULL, 0, p, &table) == 0);
+    TEST_CHECK(table.column_count == 2 && table.other_count == 2);
+    TEST_CHECK(table.others[0].row == 0 && table.others[1].row == 2);
+    id = json_table_column(&table, "a", 1);
+    score = json_table_column(&table, "b", 1);
+    TEST_ASSERT(id && score);
+    TEST_CHECK(id->type == JSON_COLUMN_INT && score->type == JSON_COLUMN_INT);
+    TEST_CHECK(id->values.ints[1] == 2 && id->values.ints[3] == 4 && score->values.ints[3] == 5);
+    TEST_CHECK(id->null_count == 2 && json_column_is_null(id, 0) && json_column_is_null(score, 2));
+    json_table_free(&table);
+    free(doc);
+    free_combinator(p);
+}
+
+typedef struct {
+    json_string_span_t city;
+    int64_t zip;
+} test_address_t;
+
+typedef struct {
+    int64_t id;
+    double price;
+    bool active;
+    json_string_span_t name;
+    test_address_t address;
+    int64_t abcd;
+    int64_t aecd;
+} test_order_t;
+
+static const json_field_t test_address_fields[] = {
+    JSON_FIELD(test_address_t, city, JSON_FIELD_STRING, false),
+    JSON_FIELD(test_address_t, zip, JSON_FIELD_INT, true),
+    JSON_FIELDS_END
+};
+
+static const json_field_t test_order_fields[] = {
+    JSON_FIELD(test_order_t, id, JSON_FIELD_INT, false),
+    JSON_FIELD(test_order_t, price, JSON_FIELD_DOUBLE, false),
+    JSON_FIELD(test_order_t, active, JSON_FIELD_BOOL, true),
+    JSON_FIELD(test_order_t, name, JSON_FIELD_STRING, true),
+    JSON_OBJECT_FIELD(test_order_t, address, test_address_fields, true),
+    // Same length, first, middle and last byte
+    JSON_FIELD(test_order_t, abcd, JSON_FIELD_INT, true),
+    JSON_FIELD(test_order_t, aecd, JSON_FIELD_INT, true),
+    JSON_FIELDS_END
+};
+
+void test_json_schema(void) {
+    json_schema_t* schema = json_schema_compile(test_order_fields);
+    TEST_ASSERT(schema != NULL);
+
+    const char* doc = " {\"extra\": [1, {\"id\": 2}], \"price\": 12, \"id\": 7, \"n\\u0061me\": \"a\\\"b\","
+                      " \"address\": {\"zip\": 1234, \"city\": \"Delft\", \"more\": {}}, \"abcd\": 1, \"aecd\": 2,"
+                      " \"active\": null} ";
+    test_order_t order;
+    memset(&order, 0, sizeof(order));
+    order.active = true;
+    TEST_ASSERT(json_schema_parse(schema, doc, strlen(doc), &order, NULL) == JSON_SCHEMA_OK);
+    TEST_CHECK(order.id == 7);
+    TEST_CHECK(order.price == 12.0);
+    TEST_CHECK(order.active);                 // null leaves it alone
+    TEST_CHECK(order.name.length == 4 && order.name.escaped && memcmp(order.name.text, "a\\\"b", 4) == 0);
+    TEST_CHECK(order.address.zip == 1234);
+    TEST_CHECK(order.address.city.length == 5 && memcmp(order.address.city.text, "Delft", 5) == 0);
+    TEST_CHECK(order.abcd == 1 && order.aecd == 2);
+
+    memset(&order, 0, sizeof(order));
+    TEST_CHECK(json_schema_parse(schema, "{\"price\": 1.5, \"id\": 1}", 23, &order, NULL) == JSON_SCHEMA_OK);
+    TEST_CHECK(order.id == 1 && order.price == 1.5 && order.name.text == NULL);
+
+    struct {
+        const char* text;
+        json_schema_status status;
+        size_t offset;
+    } failures[] = {
+        { "{\"id\": 1}", JSON_SCHEMA_MISSING, 0 },
+        { "{\"id\": 1.5, \"price\": 1}", JSON_SCHEMA_MISMATCH, 7 },
+        { "{\"id\": 1, \"price\": \"1\"}", JSON_SCHEMA_MISMATCH, 19 },
+        { "{\"id\": 1, \"price\": 1, \"address\": {\"zip\": 1}}", JSON_SCHEMA_MISSING, 33 },
+        { "{\"id\": 1, \"price\": 1, \"address\": 5}", JSON_SCHEMA_MISMATCH, 33 },
+        { "{\"id\": null, \"price\": 1}", JSON_SCHEMA_MISMATCH, 7 },
+        { "[1]", JSON_SCHEMA_MISMATCH, 0 },
+        { "{\"id\": 1, \"price\": 1", JSON_SCHEMA_MALFORMED, 20 },
+        { "{\"id\": 1, \"price\": 1} x", JSON_SCHEMA_MALFORMED, 22 },
+        { "{\"id\" 1}", JSON_SCHEMA_MALFORMED, 6 },
+        { "", JSON_SCHEMA_MALFORMED, 0 },
+    };
+    for (size_t i = 0; i < sizeof(failures) / sizeof(failures[0]); i++) {
+        size_t offset = 999;
+        json_schema_status status = json_schema_parse(schema, failures[i].text, strlen(failures[i].text), &order, &offset);
+        TEST_CHECK(status == failures[i].status && offset == failures[i].offset);
+        TEST_MSG("%s: status %d at %zu", failures[i].text, (int)status, offset);
+    }
+    json_schema_free(schema);
+
+    static const json_field_t repeated[] = {
+        JSON_FIELD(test_order_t, id, JSON_FIELD_INT, false),
+        { "id", JSON_FIELD_INT, offsetof(test_order_t, abcd), false, NULL },
+        JSON_FIELDS_END
+    };
+    TEST_CHECK(json_schema_compile(repeated) == NULL);
+}
+
 TEST_LIST = {
     { "json_successes", test_json_successes },
     { "json_failures", test_json_failures },
+    { "json_string_escapes", test_json_string_escapes },
+    { "json_number_values", test_json_number_values },
+    { "json_nesting_limit", test_json_nesting_limit },
+    { "json_deep_nesting", test_json_deep_nesting },
+    { "json_validate", test_json_validate },
+    { "json_event_stream", test_json_event_stream },
+    { "json_ndjson", test_json_ndjson },
+    { "json_index_stage1", test_json_index_stage1 },
+    { "json_indexed_parser", test_json_indexed_parser },
+    { "json_ondemand", test_json_ondemand },
+    { "json_get", test_json_get },
+    { "json_columns", test_json_columns },
+    { "json_schema", test_json_schema },
     { NULL, NULL }
 };
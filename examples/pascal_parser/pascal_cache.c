@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "pascal_cache.h"
+#include "pascal_parser.h"
+#include "ast_binary.h"
+
+#define CACHE_ENTRY_MAGIC 0x32434350u  // "PCC2"
+#define CACHE_ENTRY_SUFFIX ".ast"
+
+// Precedes the source and the AST image in every cache file. The source is
+// padded to 8 bytes so the image stays aligned inside the mapping.
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t length;          // source length
+    uint64_t parse_ns;        // what the original parse cost
+} cache_entry_header;
+
+// An entry in the in-memory index: chained by key, and in a list from
+// least to most recently used.
+typedef struct cache_entry {
+    uint64_t key;
+    uint64_t size;
+    struct cache_entry* bucket_next;
+    struct cache_entry* older;
+    struct cache_entry* newer;
+} cache_entry;
+
+struct pascal_cache_index {
+    cache_entry** buckets;
+    size_t mask;
+    size_t count;
+    cache_entry* oldest;
+    cache_entry* newest;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+static char* entry_path(const pascal_cache_t* cache, uint64_t key) {
+    char* path;
+    if (asprintf(&path, "%s/%016llx" CACHE_ENTRY_SUFFIX, cache->dir, (unsigned long long)key) < 0) {
+        exception("asprintf failed");
+    }
+    return path;
+}
+
+//=============================================================================
+// INDEX
+//=============================================================================
+
+static size_t bucket_of(const pascal_cache_index_t* index, uint64_t key) {
+    // Keys are already hashes.
+    return (size_t)key & index->mask;
+}
+
+static cache_entry* index_find(const pascal_cache_index_t* index, uint64_t key) {
+    for (cache_entry* e = index->buckets[bucket_of(index, key)]; e != NULL; e = e->bucket_next) {
+        if (e->key == key) return e;
+    }
+    return NULL;
+}
+
+static void unlink_recency(pascal_cache_index_t* index, cache_entry* e) {
+    if (e->older) e->older->newer = e->newer; else index->oldest = e->newer;
+    if (e->newer) e->newer->older = e->older; else index->newest = e->older;
+    e->older = e->newer = NULL;
+}
+
+static void make_newest(pascal_cache_index_t* index, cache_entry* e) {
+    e->older = index->newest;
+    e->newer = NULL;
+    if (index->newest) index->newest->newer = e; else index->oldest = e;
+    index->newest = e;
+}
+
+static void index_touch(pascal_cache_index_t* index, cache_entry* e) {
+    if (index->newest == e) return;
+    unlink_recency(index, e);
+    make_newest(index, e);
+}
+
+static void index_grow(pascal_cache_index_t* index) {
+    size_t mask = index->mask * 2 + 1;
+    cache_entry** buckets = (cache_entry**)calloc(mask + 1, sizeof(cache_entry*));
+    if (!buckets) exception("calloc failed");
+    for (size_t b = 0; b <= index->mask; b++) {
+        cache_entry* e = index->buckets[b];
+        while (e != NULL) {
+            cache_entry* next = e->bucket_next;
+            e->bucket_next = buckets[(size_t)e->key & mask];
+            buckets[(size_t)e->key & mask] = e;
+            e = next;
+        }
+    }
+    free(index->buckets);
+    index->buckets = buckets;
+    index->mask = mask;
+}
+
+// Records `key` as the most recently used entry, `size` bytes on disk.
+static void index_put(pascal_cache_t* cache, uint64_t key, uint64_t size) {
+    pascal_cache_index_t* index = cache->index;
+    cache_entry* e = index_find(index, key);
+    if (e != NULL) {
+        cache->total_bytes -= e->size;
+        index_touch(index, e);
+    } else {
+        if (index->count > index->mask) index_grow(index);
+        e = (cache_entry*)safe_malloc(sizeof(cache_entry));
+        e->key = key;
+        size_t b = bucket_of(index, key);
+        e->bucket_next = index->buckets[b];
+        index->buckets[b] = e;
+        make_newest(index, e);
+        index->count++;
+    }
+    e->size = size;
+    cache->total_bytes += size;
+}
+
+static void index_remove(pascal_cache_t* cache, cache_entry* e) {
+    pascal_cache_index_t* index = cache->index;
+    cache_entry** link = &index->buckets[bucket_of(index, e->key)];
+    while (*link != e) link = &(*link)->bucket_next;
+    *link = e->bucket_next;
+    unlink_recency(index, e);
+    index->count--;
+    cache->total_bytes -= e->size;
+    free(e);
+}
+
+typedef struct {
+    uint64_t key;
+    uint64_t size;
+    struct timespec mtime;
+} cache_file;
+
+static int compare_by_mtime(const void* a, const void* b) {
+    const cache_file* fa = (const cache_file*)a;
+    const cache_file* fb = (const cache_file*)b;
+    if (fa->mtime.tv_sec != fb->mtime.tv_sec) return fa->mtime.tv_sec < fb->mtime.tv_sec ? -1 : 1;
+    if (fa->mtime.tv_nsec != fb->mtime.tv_nsec) return fa->mtime.tv_nsec < fb->mtime.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+// Indexes the entries already in the directory, oldest modification first;
+// loads refresh the modification time, so that is the order of last use.
+static void scan_entries(pascal_cache_t* cache) {
+    DIR* d = opendir(cache->dir);
+    if (d == NULL) return;
+    cache_file* files = NULL;
+    size_t count = 0, cap = 0;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        char* end;
+        unsigned long long key = strtoull(ent->d_name, &end, 16);
+        if (end != ent->d_name + 16 || strcmp(end, CACHE_ENTRY_SUFFIX) != 0) continue;
+        char* path = entry_path(cache, key);
+        struct stat st;
+        int found = stat(path, &st) == 0 && S_ISREG(st.st_mode);
+        free(path);
+        if (!found) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            files = realloc(files, sizeof(cache_file) * cap);
+            if (!files) exception("realloc failed");
+        }
+        files[count].key = key;
+        files[count].size = (uint64_t)st.st_size;
+        files[count].mtime = st.st_mtim;
+        count++;
+    }
+    closedir(d);
+    if (count > 1) qsort(files, count, sizeof(cache_file), compare_by_mtime);
+    for (size_t i = 0; i < count; i++) index_put(cache, files[i].key, files[i].size);
+    free(files);
+}
+
+static void enforce_size_cap(pascal_cache_t* cache) {
+    if (cache->max_bytes == 0) return;
+    while (cache->total_bytes > cache->max_bytes && cache->index->oldest != NULL) {
+        cache_entry* e = cache->index->oldest;
+        char* path = entry_path(cache, e->key);
+        // An entry removed behind our back no longer counts either.
+        if (unlink(path) == 0) cache->evictions++;
+        free(path);
+        index_remove(cache, e);
+    }
+}
+
+//=============================================================================
+// CACHE
+//=============================================================================
+
+int pascal_cache_init(pascal_cache_t* cache, const char* dir, uint64_t max_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) return -1;
+    struct stat st;
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) return -1;
+    cache->dir = strdup(dir);
+    cache->max_bytes = max_bytes;
+    cache->index = (pascal_cache_index_t*)safe_malloc(sizeof(pascal_cache_index_t));
+    memset(cache->index, 0, sizeof(*cache->index));
+    cache->index->mask = 63;
+    cache->index->buckets = (cache_entry**)calloc(cache->index->mask + 1, sizeof(cache_entry*));
+    if (!cache->index->buckets) exception("calloc failed");
+    scan_entries(cache);
+    return 0;
+}
+
+void pascal_cache_destroy(pascal_cache_t* cache) {
+    if (cache->index != NULL) {
+        cache_entry* e = cache->index->oldest;
+        while (e != NULL) {
+            cache_entry* newer = e->newer;
+            free(e);
+            e = newer;
+        }
+        free(cache->index->buckets);
+        free(cache->index);
+        cache->index = NULL;
+    }
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+uint64_t pascal_cache_key(const char* content, size_t length) {
+    // FNV-1a over the grammar version followed by the source bytes.
+    uint64_t h = 1469598103934665603ull;
+    for (const char* v = PASCAL_GRAMMAR_VERSION; *v; v++) {
+        h ^= (unsigned char)*v;
+        h *= 1099511628211ull;
+    }
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)content[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+ast_t* pascal_cache_load(pascal_cache_t* cache, uint64_t key, const char* content, size_t length) {
+    uint64_t start = now_ns();
+    char* path = entry_path(cache, key);
+    ast_t* ast = NULL;
+    uint64_t parse_ns = 0;
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size > sizeof(cache_entry_header)) {
+        void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            const cache_entry_header* h = (const cache_entry_header*)mapping;
+            size_t available = (size_t)st.st_size - sizeof(*h);
+            const char* source = (const char*)mapping + sizeof(*h);
+            // The key is a 64-bit hash; only the stored source proves a match.
+            ast_image_t img;
+            if (h->magic == CACHE_ENTRY_MAGIC && h->key == key && h->length == length &&
+                align8(length) <= available && memcmp(source, content, length) == 0 &&
+                ast_image_open(&img, source + align8(length), available - align8(length)) == 0) {
+                ast = ast_image_to_ast(&img);
+                parse_ns = h->parse_ns;
+            }
+            munmap(mapping, (size_t)st.st_size);
+        }
+    }
+    if (fd >= 0) close(fd);
+
+    if (ast != NULL) {
+        // Refresh the modification time, which orders the next scan.
+        utimensat(AT_FDCWD, path, NULL, 0);
+        index_put(cache, key, (uint64_t)st.st_size);
+        cache->hits++;
+        uint64_t load_ns = now_ns() - start;
+        if (parse_ns > load_ns) cache->saved_ns += parse_ns - load_ns;
+    } else {
+        cache->misses++;
+    }
+    free(path);
+    return ast;
+}
+
+int pascal_cache_store(pascal_cache_t* cache, uint64_t key, const char* content, size_t length, ast_t* ast,
+                       uint64_t parse_ns) {
+    char* path = entry_path(cache, key);
+    char* tmp_path;
+    if (asprintf(&tmp_path, "%s.tmp.%ld", path, (long)getpid()) < 0) exception("asprintf failed");
+
+    int rc = -1;
+    long size = 0;
+    FILE* out = fopen(tmp_path, "wb");
+    if (out != NULL) {
+        static const char zeros[8] = {0};
+        cache_entry_header h;
+        memset(&h, 0, sizeof(h));
+        h.magic = CACHE_ENTRY_MAGIC;
+        h.key = key;
+        h.length = length;
+        h.parse_ns = parse_ns;
+        size_t padding = (size_t)(align8(length) - length);
+        rc = fwrite(&h, sizeof(h), 1, out) == 1 ? 0 : -1;
+        if (rc == 0 && length > 0 && fwrite(content, 1, length, out) != length) rc = -1;
+        if (rc == 0 && padding > 0 && fwrite(zeros, 1, padding, out) != padding) rc = -1;
+        if (rc == 0) rc = ast_binary_write(out, ast, pascal_tag_to_string);
+        if (rc == 0 && (size = ftell(out)) < 0) rc = -1;
+        if (fclose(out) != 0) rc = -1;
+        // Readers only ever see complete entries.
+        if (rc == 0 && rename(tmp_path, path) != 0) rc = -1;
+        if (rc != 0) unlink(tmp_path);
+    }
+    if (rc == 0) {
+        cache->stores++;
+        index_put(cache, key, (uint64_t)size);
+        enforce_size_cap(cache);
+    }
+    free(tmp_path);
+    free(path);
+    return rc;
+}
+
+void pascal_cache_print_stats(const pascal_cache_t* cache, FILE* out) {
+    fprintf(out, "Cache hits: %u\n", cache->hits);
+    fprintf(out, "Cache misses: %u\n", cache->misses);
+    fprintf(out, "Cache stores: %u\n", cache->stores);
+    fprintf(out, "Cache evictions: %u\n", cache->evictions);
+    fprintf(out, "Time saved: %.3f ms\n", cache->saved_ns / 1e6);
+}
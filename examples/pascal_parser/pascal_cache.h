@@ -0,0 +1,47 @@
+#ifndef PASCAL_CACHE_H
+#define PASCAL_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "parser.h"
+
+// Identifies the grammar that produced a cached AST. Bump it whenever the
+// Pascal grammar or tag numbering changes so stale entries stop matching.
+#define PASCAL_GRAMMAR_VERSION "pascal-grammar-1"
+
+// On-disk parse cache. Entries are named after a hash of the grammar version
+// and the source contents, hold the source and a binary AST image (see
+// ast_binary.h), and are evicted least-recently-used first once the
+// directory exceeds max_bytes. The directory is scanned once, at init; after
+// that sizes and recency are tracked in memory, so entries other processes
+// add in the meantime are only counted once they are loaded or stored here.
+typedef struct pascal_cache_index pascal_cache_index_t;
+
+typedef struct {
+    char* dir;
+    uint64_t max_bytes;       // 0 means no size cap
+    uint64_t total_bytes;     // size of the entries in the index
+    pascal_cache_index_t* index;
+    unsigned hits;
+    unsigned misses;
+    unsigned stores;
+    unsigned evictions;
+    uint64_t saved_ns;        // original parse time of hits minus load time
+} pascal_cache_t;
+
+// Creates `dir` if needed. Returns 0 on success, -1 if it is unusable.
+int pascal_cache_init(pascal_cache_t* cache, const char* dir, uint64_t max_bytes);
+void pascal_cache_destroy(pascal_cache_t* cache);
+
+uint64_t pascal_cache_key(const char* content, size_t length);
+
+// Returns the cached AST for `content`, whose key is `key`, or NULL on a
+// miss. Entries only match the exact source they were stored for.
+ast_t* pascal_cache_load(pascal_cache_t* cache, uint64_t key, const char* content, size_t length);
+// Stores `ast` for `content`, recording how long the parse took. Returns 0 on success.
+int pascal_cache_store(pascal_cache_t* cache, uint64_t key, const char* content, size_t length, ast_t* ast,
+                       uint64_t parse_ns);
+
+void pascal_cache_print_stats(const pascal_cache_t* cache, FILE* out);
+
+#endif // PASCAL_CACHE_H
@@ -30,37 +30,14 @@ combinator_t* create_pascal_param_parser(void) {
 // Bring in the global sentinel value for an empty AST node
 extern ast_t* ast_nil;
 
-// Custom parser for main block content that parses statements properly
-static ParseResult main_block_content_fn(input_t* in, void* args, char* parser_name) {
-    // Parse statements until we can't parse any more
-    // Don't look for "end" - that's handled by the parent main_block parser
-
-    // Create statement parser to parse the content
-    combinator_t* stmt_parser = new_combinator();
-    init_pascal_statement_parser(&stmt_parser);
-
-    // Parse as many statements as possible, separated by semicolons
-    combinator_t* stmt_list = many(seq(new_combinator(), PASCAL_T_NONE,
-        stmt_parser,
+// Main block content: as many statements as possible, each optionally
+// followed by a semicolon. "end" is left to the enclosing main_block parser.
+static combinator_t* main_block_content(combinator_t** stmt_parser) {
+    return many(seq(new_combinator(), PASCAL_T_NONE,
+        lazy(stmt_parser),
         optional(token(match(";"))),  // optional semicolon after each statement
         NULL
     ));
-
-    ParseResult stmt_result = parse(in, stmt_list);
-
-    // Clean up
-    free_combinator(stmt_list);
-
-    return stmt_result;
-}
-
-static combinator_t* main_block_content(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
-    args->tag = tag;
-    comb->args = args;
-    comb->fn = main_block_content_fn;
-    return comb;
 }
 
 // Helper function to wrap the content of a begin-end block in a PASCAL_T_MAIN_BLOCK node
@@ -75,11 +52,7 @@ static ast_t* build_main_block_ast(ast_t* ast) {
 
 // Pascal Program/Terminated Statement Parser - for standalone statements with semicolons
 void init_pascal_program_parser(combinator_t** p) {
-    // Create the base statement parser
-    combinator_t** base_stmt = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *base_stmt = new_combinator();
-    (*base_stmt)->extra_to_free = base_stmt;
-    init_pascal_statement_parser(base_stmt);
+    combinator_t** base_stmt = shared_pascal_statement_parser();
 
     // Terminated statement: statement followed by semicolon
     seq(*p, PASCAL_T_NONE,
@@ -91,10 +64,7 @@ void init_pascal_program_parser(combinator_t** p) {
 
 // Pascal Unit Parser
 void init_pascal_unit_parser(combinator_t** p) {
-    combinator_t** stmt_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *stmt_parser = new_combinator();
-    (*stmt_parser)->extra_to_free = stmt_parser;
-    init_pascal_statement_parser(stmt_parser);
+    combinator_t** stmt_parser = shared_pascal_statement_parser();
 
     // Uses section: uses unit1, unit2, unit3;
     combinator_t* uses_unit = token(cident(PASCAL_T_USES_UNIT));
@@ -329,17 +299,8 @@ void init_pascal_unit_parser(combinator_t** p) {
 
 // Pascal Procedure/Function Declaration Parser
 void init_pascal_procedure_parser(combinator_t** p) {
-    // Create expression parser for default values and type references
-    combinator_t** expr_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *expr_parser = new_combinator();
-    (*expr_parser)->extra_to_free = expr_parser;
-    init_pascal_expression_parser(expr_parser);
-
-    // Create statement parser for procedure/function bodies
-    combinator_t** stmt_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *stmt_parser = new_combinator();
-    (*stmt_parser)->extra_to_free = stmt_parser;
-    init_pascal_statement_parser(stmt_parser);
+    // Statement parser for procedure/function bodies
+    combinator_t** stmt_parser = shared_pascal_statement_parser();
 
     // Parameter: [const|var] identifier1,identifier2,... : type
     combinator_t* param_name_list = sep_by(token(cident(PASCAL_T_IDENTIFIER)), token(match(",")));
@@ -397,11 +358,8 @@ void init_pascal_procedure_parser(combinator_t** p) {
 
 // Pascal Method Implementation Parser - for constructor/destructor/procedure implementations
 void init_pascal_method_implementation_parser(combinator_t** p) {
-    // Create statement parser for method bodies
-    combinator_t** stmt_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *stmt_parser = new_combinator();
-    (*stmt_parser)->extra_to_free = stmt_parser;
-    init_pascal_statement_parser(stmt_parser);
+    // Statement parser for method bodies
+    combinator_t** stmt_parser = shared_pascal_statement_parser();
 
     // Parameter: [const|var] identifier1,identifier2,... : type
     combinator_t* param_name_list = sep_by(token(cident(PASCAL_T_IDENTIFIER)), token(match(",")));
@@ -473,8 +431,11 @@ void init_pascal_method_implementation_parser(combinator_t** p) {
 
 // Pascal Complete Program Parser - for full Pascal programs
 void init_pascal_complete_program_parser(combinator_t** p) {
+    // Statement parser shared by the main block, procedures and methods
+    combinator_t** stmt_parser = shared_pascal_statement_parser();
+
     // Use `between` to parse the content inside `begin` and `end`, then `map` to wrap it.
-    combinator_t* main_block_content_parser = main_block_content(PASCAL_T_NONE);
+    combinator_t* main_block_content_parser = main_block_content(stmt_parser);
     combinator_t* main_block_body = between(
         token(keyword_ci("begin")),
         token(keyword_ci("end")),
@@ -585,10 +546,6 @@ void init_pascal_complete_program_parser(combinator_t** p) {
 
     // Create procedure/function parsers for use in complete program
     // Need to create a modified procedure parser that supports var parameters
-    combinator_t** stmt_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *stmt_parser = new_combinator();
-    (*stmt_parser)->extra_to_free = stmt_parser;
-    init_pascal_statement_parser(stmt_parser);
 
     // Enhanced parameter: [const|var] identifier1,identifier2,... : type
     combinator_t* param_name_list = sep_by(token(cident(PASCAL_T_IDENTIFIER)), token(match(",")));
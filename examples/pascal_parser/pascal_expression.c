@@ -19,7 +19,7 @@ static ParseResult pascal_identifier_fn(input_t* in, void* args, char* parser_na
     // Must start with letter or underscore
     if (c != '_' && !isalpha((unsigned char)c)) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected identifier"), NULL);
+        return make_failure_literal(in, parser_name, "Expected identifier");
     }
 
     // Continue with alphanumeric or underscore
@@ -34,24 +34,27 @@ static ParseResult pascal_identifier_fn(input_t* in, void* args, char* parser_na
     }
     if (c != EOF) in->start--;
 
-    // Extract the identifier text
+    // Reserved words all fit in `word`; longer identifiers need no check
     int len = in->start - start_pos;
-    char* text = (char*)safe_malloc(len + 1);
-    strncpy(text, in->buffer + start_pos, len);
-    text[len] = '\0';
+    char word[16];
+    bool keyword = false;
+    if (len < (int)sizeof(word)) {
+        memcpy(word, in->buffer + start_pos, len);
+        word[len] = '\0';
+        keyword = is_pascal_keyword(word);
+    }
 
     // Check if it's a reserved keyword
-    if (is_pascal_keyword(text)) {
-        free(text);
+    if (keyword) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Identifier cannot be a reserved keyword"), NULL);
+        return make_failure_literal(in, parser_name, "Identifier cannot be a reserved keyword");
     }
+    if (in->recognize_only) return make_success(ast_nil);
 
     // Create AST node for valid identifier (following original cident_fn pattern)
     ast_t* ast = new_ast();
     ast->typ = pargs->tag;
-    ast->sym = sym_lookup(text);
-    free(text);
+    ast->sym = sym_lookup_n(in->buffer + start_pos, len);
     ast->child = NULL;
     ast->next = NULL;
     set_ast_position(ast, in);
@@ -100,7 +103,7 @@ static ParseResult pascal_expression_identifier_fn(input_t* in, void* args, char
     // Must start with letter or underscore
     if (c != '_' && !isalpha((unsigned char)c)) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected identifier"), NULL);
+        return make_failure_literal(in, parser_name, "Expected identifier");
     }
 
     // Continue with alphanumeric or underscore
@@ -115,24 +118,27 @@ static ParseResult pascal_expression_identifier_fn(input_t* in, void* args, char
     }
     if (c != EOF) in->start--;
 
-    // Extract the identifier text
+    // Reserved words all fit in `word`; longer identifiers need no check
     int len = in->start - start_pos;
-    char* text = (char*)safe_malloc(len + 1);
-    strncpy(text, in->buffer + start_pos, len);
-    text[len] = '\0';
+    char word[16];
+    bool keyword = false;
+    if (len < (int)sizeof(word)) {
+        memcpy(word, in->buffer + start_pos, len);
+        word[len] = '\0';
+        keyword = is_pascal_keyword(word) && !is_expression_allowed_keyword(word);
+    }
 
     // Check if it's a reserved keyword that's NOT allowed in expressions
-    if (is_pascal_keyword(text) && !is_expression_allowed_keyword(text)) {
-        free(text);
+    if (keyword) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Identifier cannot be a reserved keyword"), NULL);
+        return make_failure_literal(in, parser_name, "Identifier cannot be a reserved keyword");
     }
+    if (in->recognize_only) return make_success(ast_nil);
 
     // Create AST node for valid identifier
     ast_t* ast = new_ast();
     ast->typ = pargs->tag;
-    ast->sym = sym_lookup(text);
-    free(text);
+    ast->sym = sym_lookup_n(in->buffer + start_pos, len);
     ast->child = NULL;
     ast->next = NULL;
     set_ast_position(ast, in);
@@ -162,7 +168,7 @@ static ParseResult real_fn(input_t* in, void* args, char* parser_name) {
     char c = read1(in);
     if (!isdigit((unsigned char)c)) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected digit"), NULL);
+        return make_failure_literal(in, parser_name, "Expected digit");
     }
 
     while (1) {
@@ -176,14 +182,14 @@ static ParseResult real_fn(input_t* in, void* args, char* parser_name) {
     // Must have decimal point
     if (read1(in) != '.') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected decimal point"), NULL);
+        return make_failure_literal(in, parser_name, "Expected decimal point");
     }
 
     // Parse fractional part (at least one digit required)
     c = read1(in);
     if (!isdigit((unsigned char)c)) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected digit after decimal point"), NULL);
+        return make_failure_literal(in, parser_name, "Expected digit after decimal point");
     }
 
     while (1) {
@@ -206,7 +212,7 @@ static ParseResult real_fn(input_t* in, void* args, char* parser_name) {
         // Must have at least one digit after E/e
         if (!isdigit((unsigned char)c)) {
             restore_input_state(in, &state);
-            return make_failure_v2(in, parser_name, strdup("Expected digit after exponent"), NULL);
+            return make_failure_literal(in, parser_name, "Expected digit after exponent");
         }
 
         // Parse remaining exponent digits
@@ -221,6 +227,8 @@ static ParseResult real_fn(input_t* in, void* args, char* parser_name) {
         in->start--; // Back up if we didn't find exponent
     }
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     // Create AST node with the real number value
     int len = in->start - start_pos;
     char* text = (char*)safe_malloc(len + 1);
@@ -260,14 +268,14 @@ static ParseResult hex_integer_fn(input_t* in, void* args, char* parser_name) {
     // Must start with $
     if (c != '$') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '$' for hex literal"), NULL);
+        return make_failure_literal(in, parser_name, "Expected '$' for hex literal");
     }
 
     // Must have at least one hex digit after $
     c = read1(in);
     if (c == EOF || !isxdigit((unsigned char)c)) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected hex digit after '$'"), NULL);
+        return make_failure_literal(in, parser_name, "Expected hex digit after '$'");
     }
 
     // Continue reading hex digits
@@ -275,6 +283,8 @@ static ParseResult hex_integer_fn(input_t* in, void* args, char* parser_name) {
         ;
     if (c != EOF) in->start--;
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     // Extract the hex text (including the $)
     int len = in->start - start_pos;
     char* text = (char*)safe_malloc(len + 1);
@@ -312,22 +322,24 @@ static ParseResult char_fn(input_t* in, void* args, char* parser_name) {
     // Must start with single quote
     if (read1(in) != '\'') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected single quote"), NULL);
+        return make_failure_literal(in, parser_name, "Expected single quote");
     }
 
     // Must have at least one character
     char char_value = read1(in);
     if (char_value == EOF) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Unterminated character literal"), NULL);
+        return make_failure_literal(in, parser_name, "Unterminated character literal");
     }
 
     // Must end with single quote
     if (read1(in) != '\'') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected closing single quote"), NULL);
+        return make_failure_literal(in, parser_name, "Expected closing single quote");
     }
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     // Create AST node with the character value
     char text[2];
     text[0] = char_value;
@@ -363,9 +375,11 @@ static ParseResult range_fn(input_t* in, void* args, char* parser_name) {
     // We just need to consume the ".." token
     if (read1(in) != '.' || read1(in) != '.') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '..'"), NULL);
+        return make_failure_literal(in, parser_name, "Expected '..'");
     }
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     // Create a placeholder AST node - the actual range will be built by the expression parser
     ast_t* ast = new_ast();
     ast->typ = pargs->tag;
@@ -396,15 +410,18 @@ static ParseResult set_fn(input_t* in, void* args, char* parser_name) {
     // Must start with '['
     if (read1(in) != '[') {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '['"), NULL);
+        return make_failure_literal(in, parser_name, "Expected '['");
     }
 
-    ast_t* set_node = new_ast();
-    set_node->typ = sargs->tag;
-    set_node->sym = NULL;
-    set_node->child = NULL;
-    set_node->next = NULL;
-    set_ast_position(set_node, in);
+    // No set node when only recognizing; elements are dropped as parsed
+    ast_t* set_node = in->recognize_only ? NULL : new_ast();
+    if (set_node != NULL) {
+        set_node->typ = sargs->tag;
+        set_node->sym = NULL;
+        set_node->child = NULL;
+        set_node->next = NULL;
+        set_ast_position(set_node, in);
+    }
 
     // Skip whitespace manually
     char c;
@@ -419,12 +436,12 @@ static ParseResult set_fn(input_t* in, void* args, char* parser_name) {
     // Check for empty set
     c = read1(in);
     if (c == ']') {
-        return make_success(set_node);
+        return make_success(set_node ? set_node : ast_nil);
     }
     if (c != EOF) in->start--; // Back up
 
     // Parse set elements using the provided expression parser
-    combinator_t* expr_parser = lazy(sargs->expr_parser);
+    combinator_t* expr_parser = sargs->element;
 
     // Parse comma-separated expressions
     ast_t* first_element = NULL;
@@ -442,14 +459,16 @@ static ParseResult set_fn(input_t* in, void* args, char* parser_name) {
 
         ParseResult elem_result = parse(in, expr_parser);
         if (!elem_result.is_success) {
+            free_error(elem_result.value.error);
             free_ast(set_node);
-            free_combinator(expr_parser);
             restore_input_state(in, &state);
-            return make_failure_v2(in, parser_name, strdup("Expected set element"), NULL);
+            return make_failure_literal(in, parser_name, "Expected set element");
         }
 
         // Add element to set
-        if (!first_element) {
+        if (set_node == NULL) {
+            free_ast(elem_result.value.ast);
+        } else if (!first_element) {
             first_element = elem_result.value.ast;
             current_element = elem_result.value.ast;
             set_node->child = elem_result.value.ast;
@@ -475,24 +494,31 @@ static ParseResult set_fn(input_t* in, void* args, char* parser_name) {
             continue; // Parse next element
         } else {
             free_ast(set_node);
-            free_combinator(expr_parser);
             restore_input_state(in, &state);
-            return make_failure_v2(in, parser_name, strdup("Expected ',' or ']'"), NULL);
+            return make_failure_literal(in, parser_name, "Expected ',' or ']'");
         }
     }
 
-    free_combinator(expr_parser);
-    return make_success(set_node);
+    return make_success(set_node ? set_node : ast_nil);
+}
+
+static void free_set_args(void* args) {
+    set_args* sargs = (set_args*)args;
+    free_combinator(sargs->element);
+    free(sargs);
 }
 
 combinator_t* set_constructor(tag_t tag, combinator_t** expr_parser) {
     set_args* args = (set_args*)safe_malloc(sizeof(set_args));
     args->tag = tag;
     args->expr_parser = expr_parser;
+    // Resolved lazily: the expression parser is still being built
+    args->element = lazy(expr_parser);
     combinator_t* comb = new_combinator();
     comb->type = P_SATISFY;
     comb->fn = set_fn;
     comb->args = args;
+    comb->free_args = free_set_args;
     return comb;
 }
 
@@ -528,6 +554,8 @@ static ParseResult pascal_single_quoted_content_fn(input_t* in, void* args, char
         }
     }
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     int len = in->start - start_offset;
     char* text = (char*)safe_malloc(len + 1);
     strncpy(text, in->buffer + start_offset, len);
@@ -593,6 +621,8 @@ static ParseResult pascal_double_quoted_content_fn(input_t* in, void* args, char
         }
     }
 
+    if (in->recognize_only) return make_success(ast_nil);
+
     int len = in->start - start_offset;
     char* text = (char*)safe_malloc(len + 1);
     strncpy(text, in->buffer + start_offset, len);
@@ -829,6 +859,19 @@ void init_pascal_expression_parser(combinator_t** p) {
     expr_insert(*p, 9, PASCAL_T_DEREF, EXPR_POSTFIX, ASSOC_LEFT, token(match("^")));
 }
 
+// The expression grammar every statement grammar refers to. Built on first
+// use and never freed, like the intern table its nodes live in.
+combinator_t** shared_pascal_expression_parser(void) {
+    static combinator_t** shared = NULL;
+    if (shared == NULL) {
+        shared = (combinator_t**)safe_malloc(sizeof(combinator_t*));
+        *shared = new_combinator();
+        (*shared)->extra_to_free = shared;
+        init_pascal_expression_parser(shared);
+    }
+    return shared;
+}
+
 // --- Utility Functions ---
 ParseResult parse_pascal_expression(input_t* input, combinator_t* parser) {
     ParseResult result = parse(input, parser);
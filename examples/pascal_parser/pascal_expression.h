@@ -4,9 +4,10 @@
 #include "parser.h"
 #include "combinators.h"
 
-typedef struct { tag_t tag; combinator_t** expr_parser; } set_args;
+typedef struct { tag_t tag; combinator_t** expr_parser; combinator_t* element; } set_args;
 
 void init_pascal_expression_parser(combinator_t** p);
+combinator_t** shared_pascal_expression_parser(void);
 ParseResult parse_pascal_expression(input_t* input, combinator_t* parser);
 combinator_t* pascal_identifier(tag_t tag);
 combinator_t* pascal_expression_identifier(tag_t tag);
@@ -40,6 +40,7 @@ static ParseResult keyword_ci_fn(input_t* in, void* args, char* parser_name) {
         char c = read1(in);
         if (tolower((unsigned char)c) != tolower((unsigned char)str[i])) {
             restore_input_state(in, &state);
+            if (in->recognize_only) return make_position_failure(in);
             char* err_msg;
             asprintf(&err_msg, "Expected keyword '%s' (case-insensitive)", str);
             return make_failure_v2(in, parser_name, err_msg, NULL);
@@ -51,6 +52,7 @@ static ParseResult keyword_ci_fn(input_t* in, void* args, char* parser_name) {
         char next_char = in->buffer[in->start];
         if (isalnum((unsigned char)next_char) || next_char == '_') {
             restore_input_state(in, &state);
+            if (in->recognize_only) return make_position_failure(in);
             char* err_msg;
             asprintf(&err_msg, "Expected keyword '%s', not part of identifier", str);
             return make_failure_v2(in, parser_name, err_msg, NULL);
@@ -68,7 +70,7 @@ combinator_t* keyword_ci(char* str) {
     comb->type = P_CI_KEYWORD;
     comb->fn = keyword_ci_fn;
     comb->args = args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 // New argument struct for the custom parser function
@@ -84,6 +86,7 @@ static ParseResult match_keyword_fn(input_t* in, void* args, char* parser_name)
     int len = strlen(keyword);
 
     if (in->start + len > in->length || strncasecmp(in->buffer + in->start, keyword, len) != 0) {
+        if (in->recognize_only) return make_position_failure(in);
         char* err_msg;
         asprintf(&err_msg, "Expected keyword '%s'", keyword);
         return make_failure_v2(in, parser_name, err_msg, NULL);
@@ -92,12 +95,18 @@ static ParseResult match_keyword_fn(input_t* in, void* args, char* parser_name)
     if (in->start + len < in->length) {
         char next_char = in->buffer[in->start + len];
         if (isalnum((unsigned char)next_char) || next_char == '_') {
+            if (in->recognize_only) return make_position_failure(in);
             char* err_msg;
             asprintf(&err_msg, "Expected keyword '%s', not part of identifier", keyword);
             return make_failure_v2(in, parser_name, err_msg, NULL);
         }
     }
 
+    if (in->recognize_only) {
+        for (int i = 0; i < len; i++) read1(in);
+        return make_success(ast_nil);
+    }
+
     char* matched_text = (char*)safe_malloc(len + 1);
     strncpy(matched_text, in->buffer + in->start, len);
     matched_text[len] = '\0';
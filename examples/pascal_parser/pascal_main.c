@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "pascal_parser.h"
+#include "pascal_cache.h"
 
 // Forward declaration
 static void print_ast_indented(ast_t* ast, int depth);
@@ -48,23 +50,13 @@ static void print_ast_indented(ast_t* ast, int depth) {
 }
 
 
-int main(int argc, char *argv[]) {
-    bool print_ast = false;
-    char *filename = NULL;
-
-    for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--print-ast") == 0) {
-            print_ast = true;
-        } else {
-            filename = argv[i];
-        }
-    }
-
-    if (filename == NULL) {
-        fprintf(stderr, "Usage: %s [--print-ast] <filename>\n", argv[0]);
-        return 1;
-    }
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
+static int parse_file(const char* filename, combinator_t* parser, bool print_ast, bool validate, pascal_cache_t* cache) {
     // Read file content
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
@@ -100,21 +92,36 @@ int main(int argc, char *argv[]) {
     file_content[bytes_read] = '\0';
     fclose(file);
 
-    combinator_t *parser = new_combinator();
-    // Use unit parser instead of expression parser for full Pascal units
-    init_pascal_unit_parser(&parser);
-    
     printf("Parsing file: %s\n", filename);
     printf("File size: %zu bytes\n", bytes_read);
     printf("First 100 characters: '%.100s'\n", file_content);
 
+    uint64_t key = 0;
+    // Validation builds no AST, so there is nothing to cache
+    if (validate) cache = NULL;
+    if (cache) {
+        key = pascal_cache_key(file_content, bytes_read);
+        ast_t* cached = pascal_cache_load(cache, key, file_content, bytes_read);
+        if (cached) {
+            printf("Loaded AST from cache.\n");
+            printf("Parse completed. Success: YES\n");
+            if (print_ast) {
+                print_pascal_ast(cached);
+            }
+            free_ast(cached);
+            free(file_content);
+            return 0;
+        }
+    }
+
     input_t *in = new_input();
     in->buffer = file_content;
     in->length = bytes_read;
-    ast_nil = new_ast();
-    ast_nil->typ = PASCAL_T_NONE;
+    in->recognize_only = validate;
 
+    uint64_t start = now_ns();
     ParseResult result = parse(in, parser);
+    uint64_t parse_ns = now_ns() - start;
     
     printf("Parse completed. Success: %s\n", result.is_success ? "YES" : "NO");
     if (!result.is_success && result.value.error) {
@@ -124,27 +131,94 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    int rc = 0;
     if (result.is_success) {
         if (in->start < in->length) {
             fprintf(stderr, "Error: Parser did not consume entire input. Trailing characters: '%s'\n", in->buffer + in->start);
-            free_ast(result.value.ast);
-            return 1;
-        }
-        if (print_ast) {
-            print_pascal_ast(result.value.ast);
+            rc = 1;
+        } else {
+            if (cache && pascal_cache_store(cache, key, file_content, bytes_read, result.value.ast, parse_ns) != 0) {
+                fprintf(stderr, "Warning: could not write cache entry for '%s'\n", filename);
+            }
+            if (print_ast && !validate) {
+                print_pascal_ast(result.value.ast);
+            }
         }
         free_ast(result.value.ast);
     } else {
         print_error_with_partial_ast(result.value.error);
         free_error(result.value.error);
-        free(file_content);
+        rc = 1;
+    }
+
+    free(in);
+    free(file_content);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    bool print_ast = false;
+    bool print_stats = false;
+    bool validate = false;
+    const char *cache_dir = NULL;
+    unsigned long long cache_max_bytes = 0;
+    char **filenames = malloc(sizeof(char*) * (argc > 1 ? argc : 1));
+    int file_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--print-ast") == 0) {
+            print_ast = true;
+        } else if (strcmp(argv[i], "--validate") == 0) {
+            validate = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            print_stats = true;
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-max-bytes") == 0 && i + 1 < argc) {
+            cache_max_bytes = strtoull(argv[++i], NULL, 10);
+        } else {
+            filenames[file_count++] = argv[i];
+        }
+    }
+
+    if (file_count == 0) {
+        fprintf(stderr, "Usage: %s [--print-ast] [--validate] [--cache-dir DIR [--cache-max-bytes N]] [--stats] <filename>...\n", argv[0]);
+        free(filenames);
         return 1;
     }
 
+    pascal_cache_t cache;
+    if (cache_dir && pascal_cache_init(&cache, cache_dir, cache_max_bytes) != 0) {
+        fprintf(stderr, "Error: Cannot use cache directory '%s'\n", cache_dir);
+        free(filenames);
+        return 1;
+    }
+
+    combinator_t *parser = new_combinator();
+    // Use unit parser instead of expression parser for full Pascal units
+    init_pascal_unit_parser(&parser);
+    ast_nil = new_ast();
+    ast_nil->typ = PASCAL_T_NONE;
+
+    int rc = 0;
+    for (int i = 0; i < file_count; i++) {
+        if (parse_file(filenames[i], parser, print_ast, validate, cache_dir ? &cache : NULL) != 0) {
+            rc = 1;
+        }
+    }
+
+    if (print_stats) {
+        if (cache_dir) {
+            pascal_cache_print_stats(&cache, stdout);
+        } else {
+            printf("Cache disabled (use --cache-dir)\n");
+        }
+    }
+
+    if (cache_dir) pascal_cache_destroy(&cache);
     free_combinator(parser);
-    free(in);
     free(ast_nil);
-    free(file_content);
+    free(filenames);
 
-    return 0;
+    return rc;
 }
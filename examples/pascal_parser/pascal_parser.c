@@ -60,22 +60,22 @@ combinator_t* compiler_directive(tag_t tag) {
     );
 }
 
-// Enhanced whitespace parser that handles whitespace, Pascal comments, C++ comments, and compiler directives
+// Enhanced whitespace parser that handles whitespace, Pascal comments, C++ comments, and compiler directives.
+// Runs of whitespace are skipped without trying the comment parsers, and nothing is built.
 combinator_t* pascal_whitespace() {
-    combinator_t* ws_char = satisfy(is_whitespace_char, PASCAL_T_NONE);
+    combinator_t* ws_chars = skip_while(is_whitespace_char);
     combinator_t* pascal_comment_parser = pascal_comment();
     combinator_t* pascal_paren_comment_parser = pascal_paren_comment();
     combinator_t* cpp_comment_parser = cpp_comment();
     combinator_t* directive = compiler_directive(PASCAL_T_NONE);  // Treat directives as ignorable whitespace
-    combinator_t* ws_or_comment = multi(new_combinator(), PASCAL_T_NONE,
-        ws_char,
+    combinator_t* comment = multi(new_combinator(), PASCAL_T_NONE,
         pascal_comment_parser,
         pascal_paren_comment_parser,
         cpp_comment_parser,
         directive,  // Include compiler directives in whitespace
         NULL
     );
-    return many(ws_or_comment);
+    return right(ws_chars, skip_many(right(comment, ws_chars)));
 }
 
 // Renamed token parser with better Pascal-aware whitespace handling
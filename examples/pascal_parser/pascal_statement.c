@@ -14,11 +14,8 @@ static combinator_t* asm_body(tag_t tag) {
 
 // --- Pascal Statement Parser Implementation ---
 void init_pascal_statement_parser(combinator_t** p) {
-    // First create the expression parser to use within statements
-    combinator_t** expr_parser = (combinator_t**)safe_malloc(sizeof(combinator_t*));
-    *expr_parser = new_combinator();
-    (*expr_parser)->extra_to_free = expr_parser;
-    init_pascal_expression_parser(expr_parser);
+    // Expressions within statements all use the one shared grammar
+    combinator_t** expr_parser = shared_pascal_expression_parser();
 
     // Create the main statement parser pointer for recursive references
     combinator_t** stmt_parser = p;
@@ -94,7 +91,7 @@ void init_pascal_statement_parser(combinator_t** p) {
 
     // If statement: if expression then statement [else statement]
     combinator_t* if_stmt = seq(new_combinator(), PASCAL_T_IF_STMT,
-        token(keyword_ci("if")),                     // if keyword (case-insensitive)
+        commit(token(keyword_ci("if"))),             // if keyword (case-insensitive); no other statement starts with it
         lazy(expr_parser),                         // condition
         token(keyword_ci("then")),                   // then keyword (case-insensitive)
         lazy(stmt_parser),                         // then statement
@@ -113,7 +110,7 @@ void init_pascal_statement_parser(combinator_t** p) {
         NULL
     );
     combinator_t* for_stmt = seq(new_combinator(), PASCAL_T_FOR_STMT,
-        token(keyword_ci("for")),                // for keyword (case-insensitive)
+        commit(token(keyword_ci("for"))),        // for keyword (case-insensitive)
         token(cident(PASCAL_T_IDENTIFIER)),    // loop variable
         token(match(":=")),                    // assignment
         lazy(expr_parser),                     // start expression
@@ -126,7 +123,7 @@ void init_pascal_statement_parser(combinator_t** p) {
 
     // While statement: while expression do statement
     combinator_t* while_stmt = seq(new_combinator(), PASCAL_T_WHILE_STMT,
-        token(keyword_ci("while")),              // while keyword (case-insensitive)
+        commit(token(keyword_ci("while"))),      // while keyword (case-insensitive)
         lazy(expr_parser),                     // condition
         token(keyword_ci("do")),                 // do keyword (case-insensitive)
         lazy(stmt_parser),                     // body statement
@@ -135,7 +132,7 @@ void init_pascal_statement_parser(combinator_t** p) {
 
     // With statement: with expression do statement
     combinator_t* with_stmt = seq(new_combinator(), PASCAL_T_WITH_STMT,
-        token(keyword_ci("with")),               // with keyword (case-insensitive)
+        commit(token(keyword_ci("with"))),       // with keyword (case-insensitive)
         lazy(expr_parser),                     // expression
         token(keyword_ci("do")),                 // do keyword (case-insensitive)
         lazy(stmt_parser),                     // body statement
@@ -255,7 +252,7 @@ void init_pascal_statement_parser(combinator_t** p) {
     );
     
     combinator_t* case_stmt = seq(new_combinator(), PASCAL_T_CASE_STMT,
-        token(keyword_ci("case")),             // case keyword
+        commit(token(keyword_ci("case"))),     // case keyword
         lazy(expr_parser),                     // case expression
         token(keyword_ci("of")),               // of keyword
         sep_end_by(case_branch, token(match(";"))), // case branches with optional trailing semicolon
@@ -288,3 +285,15 @@ void init_pascal_statement_parser(combinator_t** p) {
         NULL
     );
 }
+
+// The statement grammar all declaration parsers share, built on first use.
+combinator_t** shared_pascal_statement_parser(void) {
+    static combinator_t** shared = NULL;
+    if (shared == NULL) {
+        shared = (combinator_t**)safe_malloc(sizeof(combinator_t*));
+        *shared = new_combinator();
+        (*shared)->extra_to_free = shared;
+        init_pascal_statement_parser(shared);
+    }
+    return shared;
+}
@@ -5,5 +5,6 @@
 #include "combinators.h"
 
 void init_pascal_statement_parser(combinator_t** p);
+combinator_t** shared_pascal_statement_parser(void);
 
 #endif // PASCAL_STATEMENT_H
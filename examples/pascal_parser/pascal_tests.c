@@ -3,7 +3,23 @@
 #include "combinators.h"
 #include "pascal_parser.h"
 #include "pascal_keywords.h"
+#include "ast_binary.h"
+#include "pascal_cache.h"
 #include <stdio.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+// Counts heap allocations for tests that require none. glibc's allocator
+// stays underneath.
+#define COUNTS_HEAP_ALLOCATIONS
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+static size_t heap_allocations = 0;
+void* malloc(size_t size) { heap_allocations++; return __libc_malloc(size); }
+void* calloc(size_t count, size_t size) { heap_allocations++; return __libc_calloc(count, size); }
+void* realloc(void* ptr, size_t size) { heap_allocations++; return __libc_realloc(ptr, size); }
+#endif
 
 void test_pascal_integer_parsing(void) {
     combinator_t* p = new_combinator();
@@ -2425,6 +2441,512 @@ void test_complex_fpc_rax64int_unit(void) {
     free(input);
 }
 
+// Runs print_pascal_ast with stdout redirected and returns what it printed.
+static char* capture_pascal_ast(ast_t* ast) {
+    FILE* tmp = tmpfile();
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    dup2(fileno(tmp), fileno(stdout));
+    print_pascal_ast(ast);
+    fflush(stdout);
+    dup2(saved, fileno(stdout));
+    close(saved);
+
+    long size = ftell(tmp);
+    char* text = (char*)malloc(size + 1);
+    rewind(tmp);
+    size_t got = fread(text, 1, size, tmp);
+    text[got] = '\0';
+    fclose(tmp);
+    return text;
+}
+
+void test_pascal_ast_binary_round_trip(void) {
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+
+    input_t* input = new_input();
+    char* program = "program Test;\n"
+                   "type\n"
+                   "  TRange = 1..10;\n"
+                   "  TColor = (Red, Green, Blue);\n"
+                   "var\n"
+                   "  a, b: integer;\n"
+                   "  s: string;\n"
+                   "begin\n"
+                   "  a := 1 + 2 * b;\n"
+                   "  if a > b then s := 'big' else s := 'small';\n"
+                   "  writeln(s, a)\n"
+                   "end.\n";
+    input->buffer = strdup(program);
+    input->length = strlen(program);
+
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    ast_t* ast = res.value.ast;
+
+    char path[] = "/tmp/pascal_ast_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    FILE* out = fdopen(fd, "wb");
+    TEST_ASSERT(ast_binary_write(out, ast, pascal_tag_to_string) == 0);
+    fclose(out);
+
+    ast_image_t img;
+    TEST_ASSERT(ast_image_map(&img, path) == 0);
+    uint32_t root = ast_image_root(&img);
+    TEST_ASSERT(ast_image_tag(&img, root) == PASCAL_T_PROGRAM_DECL);
+    TEST_ASSERT(strcmp(ast_image_tag_name(&img, root), "PROGRAM_DECL") == 0);
+
+    // Symbols are stored once in the pool however often they occur.
+    uint32_t a_offset = AST_BINARY_NONE;
+    int a_count = 0;
+    for (uint32_t i = 0; i < img.header->node_count; i++) {
+        const char* name = ast_image_name(&img, i);
+        if (name && strcmp(name, "a") == 0) {
+            if (a_offset == AST_BINARY_NONE) a_offset = img.nodes[i].name;
+            TEST_ASSERT(img.nodes[i].name == a_offset);
+            a_count++;
+        }
+    }
+    TEST_ASSERT(a_count > 1);
+
+    ast_t* loaded = ast_image_to_ast(&img);
+    char* expected = capture_pascal_ast(ast);
+    char* actual = capture_pascal_ast(loaded);
+    TEST_ASSERT(strcmp(expected, actual) == 0);
+
+    // Truncated images are rejected.
+    ast_image_t truncated;
+    TEST_ASSERT(ast_image_open(&truncated, img.mapping, img.header->strings_offset) != 0);
+
+    free(expected);
+    free(actual);
+    free_ast(loaded);
+    ast_image_close(&img);
+    unlink(path);
+    free_ast(ast);
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+// Opens `size` bytes of `image` after corrupting them; an image that is
+// accepted must rebuild into a tree that frees cleanly.
+static int open_corrupt_image(const uint8_t* image, size_t size, void (*corrupt)(uint8_t*, size_t, unsigned), unsigned seed) {
+    uint64_t* copy = (uint64_t*)safe_malloc(size + 8);
+    memcpy(copy, image, size);
+    corrupt((uint8_t*)copy, size, seed);
+    ast_image_t img;
+    int rc = ast_image_open(&img, copy, size);
+    if (rc == 0) {
+        ast_t* ast = ast_image_to_ast(&img);
+        free_ast(ast);
+    }
+    free(copy);
+    return rc;
+}
+
+static void wrap_strings_size(uint8_t* image, size_t size, unsigned seed) {
+    (void)size; (void)seed;
+    ast_binary_header_t* h = (ast_binary_header_t*)image;
+    h->strings_size = (uint64_t)0 - h->strings_offset;
+}
+
+static void wrap_tags_offset(uint8_t* image, size_t size, unsigned seed) {
+    (void)size; (void)seed;
+    ast_binary_header_t* h = (ast_binary_header_t*)image;
+    h->tags_offset = ~(uint64_t)7;
+}
+
+static void wrap_nodes_offset(uint8_t* image, size_t size, unsigned seed) {
+    (void)size; (void)seed;
+    ast_binary_header_t* h = (ast_binary_header_t*)image;
+    h->nodes_offset = (uint64_t)0 - 8;
+}
+
+// Makes a node's next link share the target of its child link.
+static void share_link(uint8_t* image, size_t size, unsigned seed) {
+    (void)size; (void)seed;
+    ast_binary_header_t* h = (ast_binary_header_t*)image;
+    ast_binary_node_t* nodes = (ast_binary_node_t*)(image + h->nodes_offset);
+    for (uint32_t i = 0; i < h->node_count; i++) {
+        if (nodes[i].child != 0 && nodes[i].child != AST_BINARY_NIL) {
+            nodes[i].next = nodes[i].child;
+            return;
+        }
+    }
+}
+
+// Points the root's child link at a node that is not its first child.
+static void skip_link(uint8_t* image, size_t size, unsigned seed) {
+    (void)size; (void)seed;
+    ast_binary_header_t* h = (ast_binary_header_t*)image;
+    ast_binary_node_t* nodes = (ast_binary_node_t*)(image + h->nodes_offset);
+    nodes[h->root].child++;
+}
+
+static void flip_bytes(uint8_t* image, size_t size, unsigned seed) {
+    srand(seed);
+    for (int k = 0; k < 4; k++) image[(size_t)rand() % size] ^= (uint8_t)(1 + rand() % 255);
+}
+
+void test_pascal_ast_binary_corrupt(void) {
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+    input_t* input = new_input();
+    char* program = "program Test;\n"
+                   "var a, b: integer;\n"
+                   "begin\n"
+                   "  a := 1 + 2 * b;\n"
+                   "  if a > b then writeln('big') else writeln('small')\n"
+                   "end.\n";
+    input->buffer = strdup(program);
+    input->length = strlen(program);
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+
+    FILE* out = tmpfile();
+    TEST_ASSERT(out != NULL);
+    TEST_ASSERT(ast_binary_write(out, res.value.ast, pascal_tag_to_string) == 0);
+    size_t size = (size_t)ftell(out);
+    uint64_t* image = (uint64_t*)safe_malloc(size + 8);
+    rewind(out);
+    TEST_ASSERT(fread(image, 1, size, out) == size);
+    fclose(out);
+
+    ast_image_t img;
+    TEST_ASSERT(ast_image_open(&img, image, size) == 0);
+    TEST_CHECK(open_corrupt_image((uint8_t*)image, size, wrap_strings_size, 0) != 0);
+    TEST_CHECK(open_corrupt_image((uint8_t*)image, size, wrap_tags_offset, 0) != 0);
+    TEST_CHECK(open_corrupt_image((uint8_t*)image, size, wrap_nodes_offset, 0) != 0);
+    TEST_CHECK(open_corrupt_image((uint8_t*)image, size, share_link, 0) != 0);
+    TEST_CHECK(open_corrupt_image((uint8_t*)image, size, skip_link, 0) != 0);
+    // Random damage is either rejected or yields a tree that frees cleanly.
+    for (unsigned seed = 1; seed <= 2000; seed++) {
+        open_corrupt_image((uint8_t*)image, size, flip_bytes, seed);
+    }
+
+    free(image);
+    free_ast(res.value.ast);
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+void test_pascal_parse_cache(void) {
+    char dir[] = "/tmp/pascal_cache_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL);
+    pascal_cache_t cache;
+    TEST_ASSERT(pascal_cache_init(&cache, dir, 0) == 0);
+
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+    const char* source = "program Test;\nbegin\n  x := 1 + 2\nend.\n";
+    size_t length = strlen(source);
+    uint64_t key = pascal_cache_key(source, length);
+    TEST_ASSERT(key != pascal_cache_key(source, length - 1));
+
+    TEST_ASSERT(pascal_cache_load(&cache, key, source, length) == NULL);
+    TEST_ASSERT(cache.misses == 1);
+
+    input_t* input = new_input();
+    input->buffer = strdup(source);
+    input->length = length;
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_ASSERT(pascal_cache_store(&cache, key, source, length, res.value.ast, 1000000000ull) == 0);
+
+    ast_t* cached = pascal_cache_load(&cache, key, source, length);
+    TEST_ASSERT(cached != NULL);
+    TEST_ASSERT(cache.hits == 1);
+    TEST_ASSERT(cache.saved_ns > 0);
+    char* expected = capture_pascal_ast(res.value.ast);
+    char* actual = capture_pascal_ast(cached);
+    TEST_ASSERT(strcmp(expected, actual) == 0);
+
+    // A colliding key only matches the source it was stored for.
+    const char* other = "program Tess;\nbegin\n  x := 1 + 2\nend.\n";
+    TEST_ASSERT(pascal_cache_load(&cache, key, source, length + 1) == NULL);
+    TEST_ASSERT(pascal_cache_load(&cache, key, other, length) == NULL);
+
+    // With a one-byte cap every store evicts the whole directory.
+    cache.max_bytes = 1;
+    TEST_ASSERT(pascal_cache_store(&cache, key + 1, source, length, res.value.ast, 0) == 0);
+    TEST_ASSERT(cache.evictions == 2);
+    TEST_ASSERT(cache.total_bytes == 0);
+    TEST_ASSERT(pascal_cache_load(&cache, key, source, length) == NULL);
+
+    free(expected);
+    free(actual);
+    free_ast(cached);
+    free_ast(res.value.ast);
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+    pascal_cache_destroy(&cache);
+    rmdir(dir);
+}
+
+void test_pascal_parse_cache_lru(void) {
+    char dir[] = "/tmp/pascal_cache_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL);
+    pascal_cache_t cache;
+    TEST_ASSERT(pascal_cache_init(&cache, dir, 0) == 0);
+
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+    const char* source = "program Test;\nbegin\n  x := 1 + 2\nend.\n";
+    size_t length = strlen(source);
+    input_t* input = new_input();
+    input->buffer = strdup(source);
+    input->length = length;
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+
+    // Three entries of one size under a cap that holds two and a half.
+    TEST_ASSERT(pascal_cache_store(&cache, 1, source, length, res.value.ast, 0) == 0);
+    uint64_t entry = cache.total_bytes;
+    TEST_ASSERT(pascal_cache_store(&cache, 2, source, length, res.value.ast, 0) == 0);
+    TEST_ASSERT(cache.total_bytes == 2 * entry);
+    cache.max_bytes = 2 * entry + entry / 2;
+    ast_t* loaded = pascal_cache_load(&cache, 1, source, length);
+    TEST_ASSERT(loaded != NULL);
+    free_ast(loaded);
+    TEST_ASSERT(pascal_cache_store(&cache, 3, source, length, res.value.ast, 0) == 0);
+    TEST_CHECK(cache.evictions == 1);
+    TEST_CHECK(cache.total_bytes == 2 * entry);
+
+    // Entry 2 was the least recently used.
+    TEST_CHECK((loaded = pascal_cache_load(&cache, 2, source, length)) == NULL);
+    TEST_CHECK((loaded = pascal_cache_load(&cache, 1, source, length)) != NULL);
+    free_ast(loaded);
+    TEST_CHECK((loaded = pascal_cache_load(&cache, 3, source, length)) != NULL);
+    free_ast(loaded);
+    pascal_cache_destroy(&cache);
+
+    // A new cache over the directory picks the entries up, 1 now oldest.
+    TEST_ASSERT(pascal_cache_init(&cache, dir, 2 * entry + entry / 2) == 0);
+    TEST_CHECK(cache.total_bytes == 2 * entry);
+    TEST_ASSERT(pascal_cache_store(&cache, 4, source, length, res.value.ast, 0) == 0);
+    TEST_CHECK(cache.evictions == 1);
+    TEST_CHECK((loaded = pascal_cache_load(&cache, 1, source, length)) == NULL);
+    TEST_CHECK((loaded = pascal_cache_load(&cache, 3, source, length)) != NULL);
+    free_ast(loaded);
+
+    cache.max_bytes = 1;
+    TEST_ASSERT(pascal_cache_store(&cache, 5, source, length, res.value.ast, 0) == 0);
+    TEST_CHECK(cache.total_bytes == 0);
+    free_ast(res.value.ast);
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+    pascal_cache_destroy(&cache);
+    rmdir(dir);
+}
+
+void test_pascal_parsers_share_statement_grammar(void) {
+    typedef void (*init_fn)(combinator_t**);
+    init_fn inits[] = {
+        init_pascal_unit_parser,
+        init_pascal_complete_program_parser,
+        init_pascal_program_parser,
+        init_pascal_procedure_parser,
+        init_pascal_method_implementation_parser,
+    };
+    combinator_t* parsers[5];
+    for (int i = 0; i < 5; i++) {
+        parsers[i] = new_combinator();
+        inits[i](&parsers[i]);
+    }
+
+    // What one more statement grammar costs
+    size_t before = combinator_allocation_count();
+    combinator_t* stmt = new_combinator();
+    init_pascal_statement_parser(&stmt);
+    size_t statement_cost = combinator_allocation_count() - before;
+
+    // Once the shared grammar exists, parsers that only wrap statements
+    // build less than that.
+    init_fn small[] = { init_pascal_program_parser, init_pascal_procedure_parser, init_pascal_method_implementation_parser };
+    for (int i = 0; i < 3; i++) {
+        before = combinator_allocation_count();
+        combinator_t* p = new_combinator();
+        small[i](&p);
+        size_t cost = combinator_allocation_count() - before;
+        TEST_CHECK(cost < statement_cost);
+        TEST_MSG("parser %d built %zu combinators, a statement grammar %zu", i, cost, statement_cost);
+        free_combinator(p);
+    }
+
+    input_t* input = new_input();
+    input->buffer = strdup("procedure P; begin x := 1 end");
+    input->length = strlen(input->buffer);
+    ParseResult res = parse(input, parsers[3]);
+    TEST_ASSERT(res.is_success);
+    free_ast(res.value.ast);
+
+    free_combinator(stmt);
+    for (int i = 0; i < 5; i++) free_combinator(parsers[i]);
+    free(input->buffer);
+    free(input);
+}
+
+void test_pascal_parse_allocates_no_combinators(void) {
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+
+    input_t* input = new_input();
+    char* program = "program Test;\n"
+                   "type\n"
+                   "  TColor = (Red, Green, Blue);\n"
+                   "  TSmall = 1..10;\n"
+                   "  TNeg = -5..5;\n"
+                   "  TGrid = array[1..3, TSmall] of integer;\n"
+                   "  TColors = set of TColor;\n"
+                   "var\n"
+                   "  x: integer;\n"
+                   "begin\n"
+                   "  x := 1;\n"
+                   "  if x in [1, 2, 3] then x := 2;\n"
+                   "  x := x + 1\n"
+                   "end.\n";
+    input->buffer = strdup(program);
+    input->length = strlen(program);
+
+    // Every sub-grammar is built by init_pascal_complete_program_parser
+    size_t before = combinator_allocation_count();
+    ParseResult res = parse(input, p);
+    TEST_CHECK(combinator_allocation_count() == before);
+    TEST_MSG("parse allocated %zu combinators", combinator_allocation_count() - before);
+
+    TEST_ASSERT(res.is_success);
+    free_ast(res.value.ast);
+
+    // Failing parses must not build anything either
+    char* broken = "program Test;\n"
+                   "type\n"
+                   "  TGrid = array[1..3 of integer;\n"
+                   "begin\n"
+                   "end.\n";
+    free(input->buffer);
+    input->buffer = strdup(broken);
+    input->length = strlen(broken);
+    input->start = 0;
+    input->line = 1;
+    input->col = 1;
+
+    before = combinator_allocation_count();
+    res = parse(input, p);
+    TEST_CHECK(combinator_allocation_count() == before);
+    TEST_CHECK(!res.is_success);
+    if (res.is_success) {
+        free_ast(res.value.ast);
+    } else {
+        free_error(res.value.error);
+    }
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+void test_pascal_commit_after_keyword(void) {
+    combinator_t* p = new_combinator();
+    init_pascal_statement_parser(&p);
+
+    input_t* input = new_input();
+    input->buffer = strdup("begin x := 1; while x > 0 do end");
+    input->length = strlen(input->buffer);
+
+    // The while body is missing; once 'while' matched no other statement
+    // form is tried and the failure reaches the caller as committed.
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->committed);
+    free_error(res.value.error);
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
+void test_pascal_validate_only(void) {
+    combinator_t* p = new_combinator();
+    init_pascal_complete_program_parser(&p);
+
+    char* program = "program Test;\n"
+                   "type\n"
+                   "  TColor = (Red, Green, Blue);\n"
+                   "  TGrid = array[1..3, TColor] of integer;\n"
+                   "  TColors = set of TColor;\n"
+                   "  TPoint = record x: integer; y: integer; end;\n"
+                   "var\n"
+                   "  x: integer;\n"
+                   "begin\n"
+                   "  x := -1;\n"
+                   "  if x in [1, 2..4] then x := $FF else x := 'a';\n"
+                   "  while x > 0 do x := x - 1\n"
+                   "end.\n";
+    input_t* input = new_input();
+    input->buffer = strdup(program);
+    input->length = strlen(program);
+    input->recognize_only = true;
+
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(input->start == input->length);
+
+#ifdef COUNTS_HEAP_ALLOCATIONS
+    // Failed alternatives included, validating allocates nothing once the
+    // first parse on this thread has looked up its stack.
+    input->start = 0;
+    input->line = 1;
+    input->col = 1;
+    size_t before = heap_allocations;
+    res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(heap_allocations == before);
+    TEST_MSG("validating allocated %zu times", heap_allocations - before);
+#endif
+
+    // Invalid programs fail where the full parse fails. Validation shares one
+    // failure record per thread, so this also catches a combinator that keeps
+    // a failure across another sub-parse and sees it overwritten.
+    const char* broken[] = {
+        "program Test;\nbegin\n  x := 1;\n  while x > 0 do\nend.\n",
+        "program Test;\nvar a, b: integer\nbegin end.\n",
+        "program Test;\ntype T = record x: integer; y: ; end;\nbegin end.\n",
+        "program Test;\nbegin\n  x := (1 + [2, 3;\nend.\n",
+        "program Test;\nbegin\n  x := 'abc\nend.\n",
+        "program Test;\nbegin\n  if x then else\nend\n",
+    };
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        free(input->buffer);
+        input->buffer = strdup(broken[i]);
+        input->length = strlen(broken[i]);
+        int line[2], col[2];
+        for (int mode = 0; mode < 2; mode++) {
+            input->start = 0;
+            input->line = 1;
+            input->col = 1;
+            input->recognize_only = mode == 1;
+            res = parse(input, p);
+            TEST_ASSERT(!res.is_success);
+            line[mode] = res.value.error->line;
+            col[mode] = res.value.error->col;
+            free_error(res.value.error);
+        }
+        TEST_CHECK(line[0] == line[1] && col[0] == col[1]);
+        TEST_MSG("program %zu: full %d:%d, validate %d:%d", i, line[0], col[0], line[1], col[1]);
+    }
+
+    free_combinator(p);
+    free(input->buffer);
+    free(input);
+}
+
 TEST_LIST = {
     { "test_pascal_integer_parsing", test_pascal_integer_parsing },
     { "test_pascal_invalid_input", test_pascal_invalid_input },
@@ -2502,5 +3024,13 @@ TEST_LIST = {
     { "test_pascal_var_section", test_pascal_var_section },
     { "test_fpc_style_unit_parsing", test_fpc_style_unit_parsing },
     { "test_complex_fpc_rax64int_unit", test_complex_fpc_rax64int_unit },
+    { "test_pascal_ast_binary_round_trip", test_pascal_ast_binary_round_trip },
+    { "test_pascal_ast_binary_corrupt", test_pascal_ast_binary_corrupt },
+    { "test_pascal_parse_cache", test_pascal_parse_cache },
+    { "test_pascal_parse_cache_lru", test_pascal_parse_cache_lru },
+    { "test_pascal_parsers_share_statement_grammar", test_pascal_parsers_share_statement_grammar },
+    { "test_pascal_parse_allocates_no_combinators", test_pascal_parse_allocates_no_combinators },
+    { "test_pascal_commit_after_keyword", test_pascal_commit_after_keyword },
+    { "test_pascal_validate_only", test_pascal_validate_only },
     { NULL, NULL }
 };
@@ -7,160 +7,182 @@
 #include <string.h>
 #include <ctype.h>
 
+// Sub-parsers of the custom type parsers below are built once, when the type
+// parser itself is constructed, and owned through its args.
+typedef struct {
+    tag_t tag;
+    combinator_t* bound;      // range start/end value
+    combinator_t* sep;        // ".."
+} range_type_args;
+
+static void free_range_type_args(void* args) {
+    range_type_args* rargs = (range_type_args*)args;
+    free_combinator(rargs->bound);
+    free_combinator(rargs->sep);
+    free(rargs);
+}
+
 // Range type parser: start..end (e.g., -1..1)
 static ParseResult range_type_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
+    range_type_args* rargs = (range_type_args*)args;
     InputState state;
     save_input_state(in, &state);
 
-    // Try parsing integer (including negative) or identifier for start value
-    combinator_t* start_parser = multi(new_combinator(), PASCAL_T_NONE,
-        integer(PASCAL_T_INTEGER),
-        seq(new_combinator(), PASCAL_T_INTEGER,
-            match("-"),
-            integer(PASCAL_T_INTEGER),
-            NULL),
-        cident(PASCAL_T_IDENTIFIER),
-        NULL);
-
-    ParseResult start_result = parse(in, start_parser);
+    ParseResult start_result = parse(in, rargs->bound);
     if (!start_result.is_success) {
-        free_combinator(start_parser);
+        free_error(start_result.value.error);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected range start value"), NULL);
+        return make_failure_literal(in, parser_name, "Expected range start value");
     }
 
     // Parse the ".." separator with whitespace handling
-    combinator_t* range_sep = token(match(".."));
-    ParseResult sep_result = parse(in, range_sep);
+    ParseResult sep_result = parse(in, rargs->sep);
     if (!sep_result.is_success) {
+        free_error(sep_result.value.error);
         free_ast(start_result.value.ast);
-        free_combinator(start_parser);
-        free_combinator(range_sep);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '..' in range type"), NULL);
+        return make_failure_literal(in, parser_name, "Expected '..' in range type");
     }
-    free_combinator(range_sep);
     free_ast(sep_result.value.ast);
 
     // Parse end value using the same parser
-    ParseResult end_result = parse(in, start_parser);
+    ParseResult end_result = parse(in, rargs->bound);
     if (!end_result.is_success) {
+        free_error(end_result.value.error);
         free_ast(start_result.value.ast);
-        free_combinator(start_parser);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected range end value"), NULL);
+        return make_failure_literal(in, parser_name, "Expected range end value");
+    }
+
+    if (in->recognize_only) {
+        free_ast(start_result.value.ast);
+        free_ast(end_result.value.ast);
+        return make_success(ast_nil);
     }
 
     // Create range AST
     ast_t* range_ast = new_ast();
-    range_ast->typ = pargs->tag;
+    range_ast->typ = rargs->tag;
     range_ast->child = start_result.value.ast;
     start_result.value.ast->next = end_result.value.ast;
     range_ast->sym = NULL;
     range_ast->next = NULL;
 
-    free_combinator(start_parser);
     set_ast_position(range_ast, in);
     return make_success(range_ast);
 }
 
 combinator_t* range_type(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
+    range_type_args* args = safe_malloc(sizeof(range_type_args));
     args->tag = tag;
+    // Integer (including negative) or identifier
+    args->bound = multi(new_combinator(), PASCAL_T_NONE,
+        integer(PASCAL_T_INTEGER),
+        seq(new_combinator(), PASCAL_T_INTEGER,
+            match("-"),
+            integer(PASCAL_T_INTEGER),
+            NULL),
+        cident(PASCAL_T_IDENTIFIER),
+        NULL);
+    args->sep = token(match(".."));
+
+    combinator_t* comb = new_combinator();
     comb->args = args;
+    comb->free_args = free_range_type_args;
     comb->fn = range_type_fn;
     return comb;
 }
 
+typedef struct {
+    tag_t tag;
+    combinator_t* keyword;    // "array"
+    combinator_t* open;       // "["
+    combinator_t* indices;    // range or identifier, comma separated
+    combinator_t* close;      // "]"
+    combinator_t* of;         // "of"
+    combinator_t* element;    // element type
+} array_type_args;
+
+static void free_array_type_args(void* args) {
+    array_type_args* aargs = (array_type_args*)args;
+    free_combinator(aargs->keyword);
+    free_combinator(aargs->open);
+    free_combinator(aargs->indices);
+    free_combinator(aargs->close);
+    free_combinator(aargs->of);
+    free_combinator(aargs->element);
+    free(aargs);
+}
+
+// Runs `p` and discards its result. Returns false (with the input rewound to
+// `state`) if it fails.
+static bool skip_part(input_t* in, combinator_t* p, InputState* state) {
+    ParseResult res = parse(in, p);
+    if (!res.is_success) {
+        free_error(res.value.error);
+        restore_input_state(in, state);
+        return false;
+    }
+    free_ast(res.value.ast);
+    return true;
+}
+
 // Array type parser: ARRAY[range1,range2,...] OF element_type
 static ParseResult array_type_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
+    array_type_args* aargs = (array_type_args*)args;
     InputState state;
     save_input_state(in, &state);
 
     // Parse "ARRAY" keyword (case insensitive)
-    combinator_t* array_keyword = token(keyword_ci("array"));
-    ParseResult array_res = parse(in, array_keyword);
-    if (!array_res.is_success) {
-        free_combinator(array_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'array'"), NULL);
+    if (!skip_part(in, aargs->keyword, &state)) {
+        return make_failure_literal(in, parser_name, "Expected 'array'");
     }
-    free_ast(array_res.value.ast);
-    free_combinator(array_keyword);
 
     // Parse [
-    combinator_t* open_bracket = token(match("["));
-    ParseResult open_res = parse(in, open_bracket);
-    if (!open_res.is_success) {
-        free_combinator(open_bracket);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '[' after 'array'"), NULL);
+    if (!skip_part(in, aargs->open, &state)) {
+        return make_failure_literal(in, parser_name, "Expected '[' after 'array'");
     }
-    free_ast(open_res.value.ast);
-    free_combinator(open_bracket);
 
     // Parse ranges/indices (simplified - just accept any identifiers/ranges for now)
-    combinator_t* array_index = multi(new_combinator(), PASCAL_T_NONE,
-        range_type(PASCAL_T_RANGE_TYPE),
-        token(cident(PASCAL_T_IDENTIFIER)),
-        NULL
-    );
-    combinator_t* index_list = sep_by(array_index, token(match(",")));
-    ParseResult indices_res = parse(in, index_list);
-    ast_t* indices_ast = NULL;
-    if (indices_res.is_success) {
-        indices_ast = indices_res.value.ast;
-    } else {
-        free_combinator(index_list);
+    ParseResult indices_res = parse(in, aargs->indices);
+    if (!indices_res.is_success) {
+        free_error(indices_res.value.error);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected array indices"), NULL);
+        return make_failure_literal(in, parser_name, "Expected array indices");
     }
-    free_combinator(index_list);
+    ast_t* indices_ast = indices_res.value.ast;
 
     // Parse ]
-    combinator_t* close_bracket = token(match("]"));
-    ParseResult close_res = parse(in, close_bracket);
-    if (!close_res.is_success) {
+    if (!skip_part(in, aargs->close, &state)) {
         free_ast(indices_ast);
-        free_combinator(close_bracket);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected ']'"), NULL);
+        return make_failure_literal(in, parser_name, "Expected ']'");
     }
-    free_ast(close_res.value.ast);
-    free_combinator(close_bracket);
 
     // Parse OF
-    combinator_t* of_keyword = token(keyword_ci("of"));
-    ParseResult of_res = parse(in, of_keyword);
-    if (!of_res.is_success) {
+    if (!skip_part(in, aargs->of, &state)) {
         free_ast(indices_ast);
-        free_combinator(of_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'OF' after array indices"), NULL);
+        return make_failure_literal(in, parser_name, "Expected 'OF' after array indices");
     }
-    free_ast(of_res.value.ast);
-    free_combinator(of_keyword);
 
     // Parse element type (simplified)
-    combinator_t* element_type = token(cident(PASCAL_T_IDENTIFIER));
-    ParseResult elem_res = parse(in, element_type);
-    ast_t* element_ast = NULL;
-    if (elem_res.is_success) {
-        element_ast = elem_res.value.ast;
-    } else {
+    ParseResult elem_res = parse(in, aargs->element);
+    if (!elem_res.is_success) {
+        free_error(elem_res.value.error);
         free_ast(indices_ast);
-        free_combinator(element_type);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected element type after 'OF'"), NULL);
+        return make_failure_literal(in, parser_name, "Expected element type after 'OF'");
+    }
+    ast_t* element_ast = elem_res.value.ast;
+
+    if (in->recognize_only) {
+        free_ast(indices_ast);
+        free_ast(element_ast);
+        return make_success(ast_nil);
     }
-    free_combinator(element_type);
 
     // Build AST
     ast_t* array_ast = new_ast();
-    array_ast->typ = pargs->tag;
+    array_ast->typ = aargs->tag;
     array_ast->sym = NULL;
     array_ast->child = indices_ast;
     if (indices_ast) {
@@ -178,10 +200,23 @@ static ParseResult array_type_fn(input_t* in, void* args, char* parser_name) {
 }
 
 combinator_t* array_type(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
+    array_type_args* args = safe_malloc(sizeof(array_type_args));
     args->tag = tag;
+    args->keyword = token(keyword_ci("array"));
+    args->open = token(match("["));
+    combinator_t* array_index = multi(new_combinator(), PASCAL_T_NONE,
+        range_type(PASCAL_T_RANGE_TYPE),
+        token(cident(PASCAL_T_IDENTIFIER)),
+        NULL
+    );
+    args->indices = sep_by(array_index, token(match(",")));
+    args->close = token(match("]"));
+    args->of = token(keyword_ci("of"));
+    args->element = token(cident(PASCAL_T_IDENTIFIER));
+
+    combinator_t* comb = new_combinator();
     comb->args = args;
+    comb->free_args = free_array_type_args;
     comb->fn = array_type_fn;
     return comb;
 }
@@ -357,59 +392,56 @@ combinator_t* type_name(tag_t tag) {
     );
 }
 
+typedef struct {
+    tag_t tag;
+    combinator_t* keyword;    // "record"
+    combinator_t* fields;     // many field declarations
+    combinator_t* end;        // "end"
+} record_type_args;
+
+static void free_record_type_args(void* args) {
+    record_type_args* rargs = (record_type_args*)args;
+    free_combinator(rargs->keyword);
+    free_combinator(rargs->fields);
+    free_combinator(rargs->end);
+    free(rargs);
+}
+
 // Record type parser: RECORD field1: type1; field2: type2; ... END
 static ParseResult record_type_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
+    record_type_args* rargs = (record_type_args*)args;
     InputState state;
     save_input_state(in, &state);
 
     // Parse "RECORD" keyword (case insensitive)
-    combinator_t* record_keyword = token(keyword_ci("record"));
-    ParseResult record_res = parse(in, record_keyword);
-    if (!record_res.is_success) {
-        free_combinator(record_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'record'"), NULL);
+    if (!skip_part(in, rargs->keyword, &state)) {
+        return make_failure_literal(in, parser_name, "Expected 'record'");
     }
-    free_ast(record_res.value.ast);
-    free_combinator(record_keyword);
-
-    // Field declaration: field_name: Type;
-    combinator_t* field_name = token(cident(PASCAL_T_IDENTIFIER));
-    combinator_t* field_type = token(cident(PASCAL_T_IDENTIFIER)); // simplified type for now
-    combinator_t* field_decl = seq(new_combinator(), PASCAL_T_FIELD_DECL,
-        field_name,
-        token(match(":")),
-        field_type,
-        token(match(";")),
-        NULL
-    );
 
     // Parse field list - many field declarations
-    combinator_t* field_list = many(field_decl);
-    ParseResult fields_res = parse(in, field_list);
+    ParseResult fields_res = parse(in, rargs->fields);
     ast_t* fields_ast = NULL;
     if (fields_res.is_success) {
         fields_ast = fields_res.value.ast;
+    } else {
+        free_error(fields_res.value.error);
     }
     // Note: Empty record is allowed in Pascal, so we don't require fields
-    free_combinator(field_list);
 
     // Parse "END" keyword
-    combinator_t* end_keyword = token(keyword_ci("end"));
-    ParseResult end_res = parse(in, end_keyword);
-    if (!end_res.is_success) {
+    if (!skip_part(in, rargs->end, &state)) {
         if (fields_ast) free_ast(fields_ast);
-        free_combinator(end_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'end' after record fields"), NULL);
+        return make_failure_literal(in, parser_name, "Expected 'end' after record fields");
+    }
+
+    if (in->recognize_only) {
+        if (fields_ast) free_ast(fields_ast);
+        return make_success(ast_nil);
     }
-    free_ast(end_res.value.ast);
-    free_combinator(end_keyword);
 
     // Build AST
     ast_t* record_ast = new_ast();
-    record_ast->typ = pargs->tag;
+    record_ast->typ = rargs->tag;
     record_ast->sym = NULL;
     record_ast->child = fields_ast;
     record_ast->next = NULL;
@@ -419,10 +451,26 @@ static ParseResult record_type_fn(input_t* in, void* args, char* parser_name) {
 }
 
 combinator_t* record_type(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
+    record_type_args* args = safe_malloc(sizeof(record_type_args));
     args->tag = tag;
+    args->keyword = token(keyword_ci("record"));
+
+    // Field declaration: field_name: Type;
+    combinator_t* field_name = token(cident(PASCAL_T_IDENTIFIER));
+    combinator_t* field_type = token(cident(PASCAL_T_IDENTIFIER)); // simplified type for now
+    combinator_t* field_decl = seq(new_combinator(), PASCAL_T_FIELD_DECL,
+        field_name,
+        token(match(":")),
+        field_type,
+        token(match(";")),
+        NULL
+    );
+    args->fields = many(field_decl);
+    args->end = token(keyword_ci("end"));
+
+    combinator_t* comb = new_combinator();
     comb->args = args;
+    comb->free_args = free_record_type_args;
     comb->fn = record_type_fn;
     return comb;
 }
@@ -436,52 +484,55 @@ combinator_t* pointer_type(tag_t tag) {
     );
 }
 
+typedef struct {
+    tag_t tag;
+    combinator_t* open;       // "("
+    combinator_t* values;     // identifiers, comma separated
+    combinator_t* close;      // ")"
+} enumerated_type_args;
+
+static void free_enumerated_type_args(void* args) {
+    enumerated_type_args* eargs = (enumerated_type_args*)args;
+    free_combinator(eargs->open);
+    free_combinator(eargs->values);
+    free_combinator(eargs->close);
+    free(eargs);
+}
+
 // Enumerated type parser: (Value1, Value2, Value3)
 static ParseResult enumerated_type_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
+    enumerated_type_args* eargs = (enumerated_type_args*)args;
     InputState state;
     save_input_state(in, &state);
 
     // Parse opening parenthesis
-    combinator_t* open_paren = token(match("("));
-    ParseResult open_res = parse(in, open_paren);
-    if (!open_res.is_success) {
-        free_combinator(open_paren);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected '(' for enumerated type"), NULL);
+    if (!skip_part(in, eargs->open, &state)) {
+        return make_failure_literal(in, parser_name, "Expected '(' for enumerated type");
     }
-    free_ast(open_res.value.ast);
-    free_combinator(open_paren);
 
     // Parse enumerated values: identifier, identifier, ...
-    combinator_t* enum_value = token(cident(PASCAL_T_IDENTIFIER));
-    combinator_t* value_list = sep_by(enum_value, token(match(",")));
-    ParseResult values_res = parse(in, value_list);
-    ast_t* values_ast = NULL;
-    if (values_res.is_success) {
-        values_ast = values_res.value.ast;
-    } else {
-        free_combinator(value_list);
+    ParseResult values_res = parse(in, eargs->values);
+    if (!values_res.is_success) {
+        free_error(values_res.value.error);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected enumerated values"), NULL);
+        return make_failure_literal(in, parser_name, "Expected enumerated values");
     }
-    free_combinator(value_list);
+    ast_t* values_ast = values_res.value.ast;
 
     // Parse closing parenthesis
-    combinator_t* close_paren = token(match(")"));
-    ParseResult close_res = parse(in, close_paren);
-    if (!close_res.is_success) {
+    if (!skip_part(in, eargs->close, &state)) {
         free_ast(values_ast);
-        free_combinator(close_paren);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected ')' after enumerated values"), NULL);
+        return make_failure_literal(in, parser_name, "Expected ')' after enumerated values");
+    }
+
+    if (in->recognize_only) {
+        free_ast(values_ast);
+        return make_success(ast_nil);
     }
-    free_ast(close_res.value.ast);
-    free_combinator(close_paren);
 
     // Build AST
     ast_t* enum_ast = new_ast();
-    enum_ast->typ = pargs->tag;
+    enum_ast->typ = eargs->tag;
     enum_ast->sym = NULL;
     enum_ast->child = values_ast;
     enum_ast->next = NULL;
@@ -491,55 +542,66 @@ static ParseResult enumerated_type_fn(input_t* in, void* args, char* parser_name
 }
 
 combinator_t* enumerated_type(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
+    enumerated_type_args* args = safe_malloc(sizeof(enumerated_type_args));
     args->tag = tag;
+    args->open = token(match("("));
+    args->values = sep_by(token(cident(PASCAL_T_IDENTIFIER)), token(match(",")));
+    args->close = token(match(")"));
+
+    combinator_t* comb = new_combinator();
     comb->args = args;
+    comb->free_args = free_enumerated_type_args;
     comb->fn = enumerated_type_fn;
     return comb;
 }
 
+typedef struct {
+    tag_t tag;
+    combinator_t* keyword;    // "set"
+    combinator_t* of;         // "of"
+    combinator_t* element;    // element type
+} set_type_args;
+
+static void free_set_type_args(void* args) {
+    set_type_args* sargs = (set_type_args*)args;
+    free_combinator(sargs->keyword);
+    free_combinator(sargs->of);
+    free_combinator(sargs->element);
+    free(sargs);
+}
+
 // Set type parser: set of TypeName (e.g., set of TAsmSehDirective)
 static ParseResult set_type_fn(input_t* in, void* args, char* parser_name) {
-    prim_args* pargs = (prim_args*)args;
+    set_type_args* sargs = (set_type_args*)args;
     InputState state;
     save_input_state(in, &state);
 
     // Parse "set"
-    combinator_t* set_keyword = token(keyword_ci("set"));
-    ParseResult set_result = parse(in, set_keyword);
-    if (!set_result.is_success) {
-        free_combinator(set_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'set'"), NULL);
+    if (!skip_part(in, sargs->keyword, &state)) {
+        return make_failure_literal(in, parser_name, "Expected 'set'");
     }
-    free_combinator(set_keyword);
-    free_ast(set_result.value.ast);
 
     // Parse "of"
-    combinator_t* of_keyword = token(keyword_ci("of"));
-    ParseResult of_result = parse(in, of_keyword);
-    if (!of_result.is_success) {
-        free_combinator(of_keyword);
-        restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected 'of' after 'set'"), NULL);
+    if (!skip_part(in, sargs->of, &state)) {
+        return make_failure_literal(in, parser_name, "Expected 'of' after 'set'");
     }
-    free_combinator(of_keyword);
-    free_ast(of_result.value.ast);
 
     // Parse element type (usually an identifier)
-    combinator_t* element_type = token(cident(PASCAL_T_IDENTIFIER));
-    ParseResult element_result = parse(in, element_type);
+    ParseResult element_result = parse(in, sargs->element);
     if (!element_result.is_success) {
-        free_combinator(element_type);
+        free_error(element_result.value.error);
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected element type after 'of'"), NULL);
+        return make_failure_literal(in, parser_name, "Expected element type after 'of'");
+    }
+
+    if (in->recognize_only) {
+        free_ast(element_result.value.ast);
+        return make_success(ast_nil);
     }
-    free_combinator(element_type);
 
     // Create set type AST node
     ast_t* set_ast = new_ast();
-    set_ast->typ = pargs->tag;
+    set_ast->typ = sargs->tag;
     set_ast->child = element_result.value.ast;
     set_ast_position(set_ast, in);
 
@@ -547,10 +609,15 @@ static ParseResult set_type_fn(input_t* in, void* args, char* parser_name) {
 }
 
 combinator_t* set_type(tag_t tag) {
-    combinator_t* comb = new_combinator();
-    prim_args* args = safe_malloc(sizeof(prim_args));
+    set_type_args* args = safe_malloc(sizeof(set_type_args));
     args->tag = tag;
+    args->keyword = token(keyword_ci("set"));
+    args->of = token(keyword_ci("of"));
+    args->element = token(cident(PASCAL_T_IDENTIFIER));
+
+    combinator_t* comb = new_combinator();
     comb->args = args;
+    comb->free_args = free_set_type_args;
     comb->fn = set_type_fn;
     return comb;
 }
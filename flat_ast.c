@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser.h"
+#include "flat_ast.h"
+
+static void* grow_array(void* ptr, size_t elem_size, size_t count) {
+    void* grown = realloc(ptr, elem_size * count);
+    if (!grown) exception("realloc failed");
+    return grown;
+}
+
+static void flat_ast_reserve(flat_ast_t* fa, flat_index_t needed) {
+    if (needed <= fa->capacity) return;
+    flat_index_t capacity = fa->capacity ? fa->capacity : 64;
+    while (capacity < needed) {
+        /* HARDENED: Indices must stay below the FLAT_AST_NIL/NONE markers. */
+        if (capacity >= FLAT_AST_NIL / 2) exception("flat AST exceeds 32-bit index space");
+        capacity *= 2;
+    }
+    fa->tag = grow_array(fa->tag, sizeof(tag_t), capacity);
+    fa->first_child = grow_array(fa->first_child, sizeof(flat_index_t), capacity);
+    fa->next_sibling = grow_array(fa->next_sibling, sizeof(flat_index_t), capacity);
+    fa->parent = grow_array(fa->parent, sizeof(flat_index_t), capacity);
+    fa->last_child = grow_array(fa->last_child, sizeof(flat_index_t), capacity);
+    fa->span = grow_array(fa->span, sizeof(flat_span_t), capacity);
+    fa->name = grow_array(fa->name, sizeof(uint32_t), capacity);
+    fa->name_length = grow_array(fa->name_length, sizeof(uint32_t), capacity);
+    fa->capacity = capacity;
+}
+
+static uint32_t flat_ast_intern_name(flat_ast_t* fa, const char* name, size_t length) {
+    size_t len = length + 1;
+    if (fa->strings_len + len > fa->strings_cap) {
+        size_t cap = fa->strings_cap ? fa->strings_cap : 256;
+        while (cap < fa->strings_len + len) cap *= 2;
+        fa->strings = grow_array(fa->strings, 1, cap);
+        fa->strings_cap = cap;
+    }
+    if (fa->strings_len + len >= FLAT_AST_NIL) exception("flat AST string pool exceeds 32-bit offsets");
+    uint32_t offset = (uint32_t)fa->strings_len;
+    memcpy(fa->strings + offset, name, length);
+    fa->strings[offset + length] = '\0';
+    fa->strings_len += len;
+    return offset;
+}
+
+flat_ast_t* new_flat_ast(void) {
+    flat_ast_t* fa = (flat_ast_t*)safe_malloc(sizeof(flat_ast_t));
+    memset(fa, 0, sizeof(flat_ast_t));
+    fa->root = FLAT_AST_NONE;
+    fa->last_root = FLAT_AST_NONE;
+    return fa;
+}
+
+void free_flat_ast(flat_ast_t* fa) {
+    if (fa == NULL) return;
+    free(fa->tag);
+    free(fa->first_child);
+    free(fa->next_sibling);
+    free(fa->parent);
+    free(fa->last_child);
+    free(fa->span);
+    free(fa->name);
+    free(fa->name_length);
+    free(fa->strings);
+    free(fa);
+}
+
+flat_index_t flat_ast_append(flat_ast_t* fa, flat_index_t parent, tag_t tag, const char* name, int line, int col) {
+    return flat_ast_append_n(fa, parent, tag, name, name ? strlen(name) : 0, line, col);
+}
+
+flat_index_t flat_ast_append_n(flat_ast_t* fa, flat_index_t parent, tag_t tag, const char* name, size_t length,
+                               int line, int col) {
+    flat_ast_reserve(fa, fa->count + 1);
+    flat_index_t idx = fa->count++;
+    fa->tag[idx] = tag;
+    fa->first_child[idx] = FLAT_AST_NONE;
+    fa->next_sibling[idx] = FLAT_AST_NONE;
+    fa->parent[idx] = parent;
+    fa->last_child[idx] = FLAT_AST_NONE;
+    fa->span[idx].line = line;
+    fa->span[idx].col = col;
+    fa->name[idx] = name ? flat_ast_intern_name(fa, name, length) : FLAT_AST_NONE;
+    fa->name_length[idx] = name ? (uint32_t)length : 0;
+
+    // Link as the last sibling through the parent's append cursor.
+    flat_index_t* first = parent == FLAT_AST_NONE ? &fa->root : &fa->first_child[parent];
+    flat_index_t* last = parent == FLAT_AST_NONE ? &fa->last_root : &fa->last_child[parent];
+    if (*last == FLAT_AST_NONE) {
+        *first = idx;
+    } else {
+        fa->next_sibling[*last] = idx;
+    }
+    *last = idx;
+    return idx;
+}
+
+//=============================================================================
+// CONVERSION
+//=============================================================================
+
+typedef struct { ast_t* next; flat_index_t parent; } flatten_frame;
+
+flat_ast_t* flat_ast_from_ast(ast_t* ast) {
+    flat_ast_t* fa = new_flat_ast();
+    int cap = 64, depth = 0;
+    flatten_frame* stack = (flatten_frame*)safe_malloc(sizeof(flatten_frame) * cap);
+
+    ast_t* cur = ast;
+    flat_index_t parent = FLAT_AST_NONE;
+    while (1) {
+        while (cur != NULL && cur != ast_nil) {
+            flat_index_t idx = flat_ast_append_n(fa, parent, cur->typ, cur->sym ? cur->sym->name : NULL,
+                                                 cur->sym ? cur->sym->length : 0, cur->line, cur->col);
+            if (cur->child == NULL || cur->child == ast_nil) {
+                if (cur->child == ast_nil && ast_nil != NULL) fa->first_child[idx] = FLAT_AST_NIL;
+                cur = cur->next;
+                continue;
+            }
+            // Descend into the children; resume with the next sibling afterwards.
+            if (depth == cap) {
+                cap *= 2;
+                stack = grow_array(stack, sizeof(flatten_frame), cap);
+            }
+            stack[depth].next = cur->next;
+            stack[depth].parent = parent;
+            depth++;
+            parent = idx;
+            cur = cur->child;
+        }
+        if (depth == 0) break;
+        depth--;
+        cur = stack[depth].next;
+        parent = stack[depth].parent;
+    }
+    free(stack);
+    return fa;
+}
+
+ast_t* flat_ast_to_ast(const flat_ast_t* fa) {
+    if (fa->count == 0) return NULL;
+    ast_t** nodes = (ast_t**)safe_malloc(sizeof(ast_t*) * fa->count);
+    for (flat_index_t i = 0; i < fa->count; i++) {
+        ast_t* node = new_ast();
+        node->typ = fa->tag[i];
+        node->line = fa->span[i].line;
+        node->col = fa->span[i].col;
+        const char* name = flat_ast_name(fa, i);
+        node->sym = name ? sym_lookup_n(name, flat_ast_name_length(fa, i)) : NULL;
+        nodes[i] = node;
+    }
+    for (flat_index_t i = 0; i < fa->count; i++) {
+        flat_index_t child = fa->first_child[i];
+        if (child == FLAT_AST_NIL) {
+            nodes[i]->child = ensure_ast_nil_initialized();
+        } else if (child != FLAT_AST_NONE) {
+            nodes[i]->child = nodes[child];
+        }
+        if (fa->next_sibling[i] != FLAT_AST_NONE) {
+            nodes[i]->next = nodes[fa->next_sibling[i]];
+        }
+    }
+    ast_t* root = nodes[fa->root];
+    free(nodes);
+    return root;
+}
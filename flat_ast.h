@@ -0,0 +1,84 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <stdint.h>
+#include "parser.h"
+
+//=============================================================================
+// Flat (structure-of-arrays) AST
+//=============================================================================
+//
+// An alternative to the pointer-linked ast_t tree. Nodes are appended in
+// parse (pre-)order into parallel arrays and refer to each other by 32-bit
+// index, so analysis passes can walk contiguous memory instead of chasing
+// heap pointers. The first entry of each sibling list is reached through
+// first_child (or root for the top level) and the rest through next_sibling.
+
+typedef uint32_t flat_index_t;
+
+// Marks a missing link (no child, no sibling, no parent, no name).
+#define FLAT_AST_NONE ((flat_index_t)0xFFFFFFFFu)
+// first_child value of a node whose child is the ast_nil sentinel
+// (e.g. an empty JSON array), so the distinction survives a round trip.
+#define FLAT_AST_NIL  ((flat_index_t)0xFFFFFFFEu)
+
+typedef struct {
+    int line;
+    int col;
+} flat_span_t;
+
+typedef struct flat_ast_t {
+    flat_index_t count;
+    flat_index_t capacity;
+
+    // Per-node columns, all `capacity` long.
+    tag_t* tag;
+    flat_index_t* first_child;
+    flat_index_t* next_sibling;
+    flat_index_t* parent;
+    flat_index_t* last_child;   // append cursor, keeps sibling appends O(1)
+    flat_span_t* span;
+    uint32_t* name;             // offset into `strings`, FLAT_AST_NONE if no symbol
+    uint32_t* name_length;      // bytes, which may include NULs
+
+    // Symbol names, back to back, each followed by a NUL.
+    char* strings;
+    size_t strings_len;
+    size_t strings_cap;
+
+    // Top-level sibling list.
+    flat_index_t root;
+    flat_index_t last_root;
+} flat_ast_t;
+
+flat_ast_t* new_flat_ast(void);
+void free_flat_ast(flat_ast_t* fa);
+
+// Appends a node as the last child of `parent` (FLAT_AST_NONE appends to the
+// top-level list) and returns its index. `name` may be NULL.
+flat_index_t flat_ast_append(flat_ast_t* fa, flat_index_t parent, tag_t tag, const char* name, int line, int col);
+// The same with a name of `length` bytes, which may contain NULs.
+flat_index_t flat_ast_append_n(flat_ast_t* fa, flat_index_t parent, tag_t tag, const char* name, size_t length,
+                               int line, int col);
+
+// Child of node `i`, with the ast_nil marker folded into FLAT_AST_NONE.
+static inline flat_index_t flat_ast_child(const flat_ast_t* fa, flat_index_t i) {
+    flat_index_t c = fa->first_child[i];
+    return c == FLAT_AST_NIL ? FLAT_AST_NONE : c;
+}
+
+static inline const char* flat_ast_name(const flat_ast_t* fa, flat_index_t i) {
+    return fa->name[i] == FLAT_AST_NONE ? NULL : fa->strings + fa->name[i];
+}
+
+static inline size_t flat_ast_name_length(const flat_ast_t* fa, flat_index_t i) {
+    return fa->name[i] == FLAT_AST_NONE ? 0 : fa->name_length[i];
+}
+
+// --- Conversion ---
+// Flattens the sibling list starting at `ast`.
+flat_ast_t* flat_ast_from_ast(ast_t* ast);
+// Rebuilds the top-level sibling list as ast_t nodes owned by the caller.
+ast_t* flat_ast_to_ast(const flat_ast_t* fa);
+
+#endif // FLAT_AST_H
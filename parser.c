@@ -2,10 +2,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "parser.h"
 #include "combinator_internals.h"
 
@@ -16,6 +24,7 @@
 // --- Argument Structs ---
 typedef struct { char * str; } match_args;
 typedef struct { combinator_t* delimiter; tag_t tag; } until_args;
+typedef struct { char_predicate pred; } skip_while_args;
 typedef struct op_t { tag_t tag; combinator_t * comb; struct op_t * next; } op_t;
 typedef struct expr_list { op_t * op; expr_fix fix; expr_assoc assoc; combinator_t * comb; struct expr_list * next; } expr_list;
 
@@ -28,8 +37,8 @@ static ParseResult string_fn(input_t * in, void * args, char* parser_name);
 static ParseResult until_fn(input_t * in, void * args, char* parser_name);
 static ParseResult any_char_fn(input_t * in, void * args, char* parser_name);
 static ParseResult satisfy_fn(input_t * in, void * args, char* parser_name);
+static ParseResult skip_while_fn(input_t * in, void * args, char* parser_name);
 static ParseResult expr_fn(input_t * in, void * args, char* parser_name);
-static ast_t* ensure_ast_nil_initialized();
 
 
 //=============================================================================
@@ -43,7 +52,13 @@ ParseResult make_success(ast_t* ast) {
     return (ParseResult){ .is_success = true, .value.ast = ast };
 }
 
-ParseResult make_failure_v2(input_t* in, char* parser_name, char* message, char* unexpected) {
+char* input_excerpt(input_t* in, int start, int max) {
+    int avail = in->length - start;
+    if (avail < 0) avail = 0;
+    return strndup(in->buffer + start, (size_t)(avail < max ? avail : max));
+}
+
+static ParseError* new_error(input_t* in, char* parser_name, char* message, char* unexpected) {
     ParseError* err = (ParseError*)safe_malloc(sizeof(ParseError));
     err->line = in->line;
     err->col = in->col;
@@ -52,20 +67,67 @@ ParseResult make_failure_v2(input_t* in, char* parser_name, char* message, char*
     err->unexpected = unexpected;
     err->cause = NULL;
     err->partial_ast = NULL;
-    return (ParseResult){ .is_success = false, .value.error = err };
+    err->committed = false;
+    err->limit = PARSE_LIMIT_NONE;
+    return err;
+}
+
+// Recognize-only failures inside a parse all use this record, so failed
+// alternatives allocate nothing. Only one failure is live at a time: each
+// is returned or freed before the next alternative runs. parse() hands the
+// caller a copy of it.
+static _Thread_local ParseError position_failure;
+static _Thread_local unsigned parse_nesting = 0;
+
+ParseResult make_position_failure(input_t* in) {
+    if (parse_nesting == 0) return (ParseResult){ .is_success = false, .value.error = new_error(in, NULL, strdup("Syntax error."), NULL) };
+    position_failure = (ParseError){ .line = in->line, .col = in->col, .limit = PARSE_LIMIT_NONE };
+    return (ParseResult){ .is_success = false, .value.error = &position_failure };
+}
+
+ParseResult make_failure_v2(input_t* in, char* parser_name, char* message, char* unexpected) {
+    if (in->recognize_only && parse_nesting > 0) {
+        free(message);
+        free(unexpected);
+        return make_position_failure(in);
+    }
+    return (ParseResult){ .is_success = false, .value.error = new_error(in, parser_name, message, unexpected) };
+}
+
+ParseResult make_failure_literal(input_t* in, char* parser_name, const char* message) {
+    if (in->recognize_only && parse_nesting > 0) return make_position_failure(in);
+    return make_failure_v2(in, parser_name, strdup(message), NULL);
 }
 
 ParseResult make_failure(input_t* in, char* message) {
     return make_failure_v2(in, NULL, message, NULL);
 }
 
+// Gives the caller of the outermost parse() its own copy of the shared
+// record, wherever it sits in the error chain.
+static ParseError* detach_failure(ParseError* err) {
+    for (ParseError** link = &err; *link != NULL; link = &(*link)->cause) {
+        if (*link != &position_failure) continue;
+        ParseError* copy = (ParseError*)safe_malloc(sizeof(ParseError));
+        *copy = position_failure;
+        if (copy->message == NULL) copy->message = strdup("Syntax error.");
+        *link = copy;
+        break;
+    }
+    return err;
+}
+
 ParseResult make_failure_with_ast(input_t* in, char* message, ast_t* partial_ast) {
     ParseError* err = (ParseError*)safe_malloc(sizeof(ParseError));
     err->line = in->line;
     err->col = in->col;
     err->message = message;
+    err->parser_name = NULL;
+    err->unexpected = NULL;
     err->cause = NULL;
     err->partial_ast = partial_ast;
+    err->committed = false;
+    err->limit = PARSE_LIMIT_NONE;
     return (ParseResult){ .is_success = false, .value.error = err };
 }
 
@@ -73,6 +135,13 @@ ParseResult wrap_failure_with_ast(input_t* in, char* message, ParseResult origin
     if (original_result.is_success) {
         return original_result;
     }
+    if (in->recognize_only && original_result.value.error != NULL) {
+        // Only the position would change
+        free_ast(partial_ast);
+        original_result.value.error->line = in->line;
+        original_result.value.error->col = in->col;
+        return original_result;
+    }
     
     // Validate input parameters
     if (original_result.value.error == NULL) {
@@ -100,11 +169,19 @@ ParseResult wrap_failure_with_ast(input_t* in, char* message, ParseResult origin
     new_err->partial_ast = partial_ast;
     new_err->parser_name = NULL;
     new_err->unexpected = NULL;
+    new_err->committed = original_error->committed;
+    new_err->limit = original_error->limit;
     
     return (ParseResult){ .is_success = false, .value.error = new_err };
 }
 
 ParseResult wrap_failure(input_t* in, char* message, char* parser_name, ParseResult cause) {
+    if (in->recognize_only && cause.value.error != NULL) {
+        free(message);
+        cause.value.error->line = in->line;
+        cause.value.error->col = in->col;
+        return cause;
+    }
     ParseError* err = (ParseError*)safe_malloc(sizeof(ParseError));
     err->line = in->line;
     err->col = in->col;
@@ -113,21 +190,145 @@ ParseResult wrap_failure(input_t* in, char* message, char* parser_name, ParseRes
     err->partial_ast = NULL;
     err->parser_name = parser_name ? strdup(parser_name) : NULL;
     err->unexpected = NULL; // The unexpected token is now part of the message in expect_fn
+    err->committed = cause.value.error != NULL && cause.value.error->committed;
+    err->limit = cause.value.error != NULL ? cause.value.error->limit : PARSE_LIMIT_NONE;
     return (ParseResult){ .is_success = false, .value.error = err };
 }
 
+// --- Event Journal ---
+// Each parse() call on an input with an event sink gets a frame recording
+// the lowest journal position the input states it saved may roll back to.
+// `floor` also covers the enclosing frames, so journal entries below the
+// innermost frame's floor can no longer be undone and go to the sink.
+struct parse_event_frame {
+    size_t saved;   // lowest mark of an ordinary save in this frame
+    size_t loop;    // mark of the current loop iteration
+    size_t floor;
+};
+
+#define EVENTS_NO_MARK SIZE_MAX
+
+static inline size_t events_end(parse_events_t* ev) {
+    return ev->base + ev->count;
+}
+
+static void events_reserve(parse_events_t* ev) {
+    if (ev->count < ev->cap) return;
+    ev->cap = ev->cap ? ev->cap * 2 : 64;
+    parse_event_t* journal = realloc(ev->journal, sizeof(parse_event_t) * ev->cap);
+    if (!journal) exception("realloc failed");
+    ev->journal = journal;
+}
+
+static void events_push(parse_events_t* ev, parse_event_kind kind, tag_t tag, int start, int end) {
+    events_reserve(ev);
+    ev->journal[ev->count++] = (parse_event_t){ kind, tag, start, end };
+    if (ev->count > ev->peak) ev->peak = ev->count;
+}
+
+static void events_deliver(parse_events_t* ev, size_t upto) {
+    if (upto > events_end(ev)) upto = events_end(ev);
+    if (upto <= ev->base) return;
+    size_t n = upto - ev->base;
+    if (ev->sink != NULL) {
+        for (size_t i = 0; i < n; i++) ev->sink(&ev->journal[i], ev->context);
+    }
+    ev->count -= n;
+    memmove(ev->journal, ev->journal + n, sizeof(parse_event_t) * ev->count);
+    ev->base = upto;
+}
+
+static void events_truncate(parse_events_t* ev, size_t mark) {
+    // Events already delivered cannot be taken back; that only happens
+    // when a committed failure is unwinding anyway.
+    if (mark < events_end(ev)) ev->count = mark > ev->base ? mark - ev->base : 0;
+}
+
+void events_enter(input_t* in, tag_t tag) {
+    if (in->events != NULL && tag != 0) events_push(in->events, PARSE_EVENT_ENTER, tag, in->start, in->start);
+}
+
+void events_leave(input_t* in, tag_t tag, int start) {
+    if (in->events != NULL && tag != 0) events_push(in->events, PARSE_EVENT_LEAVE, tag, start, in->start);
+}
+
+void parse_emit_token(input_t* in, tag_t tag, int start, int end) {
+    if (in->events != NULL && tag != 0) events_push(in->events, PARSE_EVENT_TOKEN, tag, start, end);
+}
+
+size_t events_mark(input_t* in) {
+    return in->events != NULL ? events_end(in->events) : 0;
+}
+
+void events_discard(input_t* in, size_t mark) {
+    if (in->events != NULL) events_truncate(in->events, mark);
+}
+
+void events_wrap(input_t* in, size_t mark, tag_t tag, int start) {
+    parse_events_t* ev = in->events;
+    if (ev == NULL || tag == 0) return;
+    if (mark < ev->base) mark = ev->base;
+    size_t at = mark - ev->base;
+    events_reserve(ev);
+    memmove(ev->journal + at + 1, ev->journal + at, sizeof(parse_event_t) * (ev->count - at));
+    ev->journal[at] = (parse_event_t){ PARSE_EVENT_ENTER, tag, start, start };
+    ev->count++;
+    events_push(ev, PARSE_EVENT_LEAVE, tag, start, in->start);
+}
+
+void events_commit(input_t* in) {
+    parse_events_t* ev = in->events;
+    if (ev == NULL || ev->depth == 0) return;
+    for (unsigned i = 1; i <= ev->depth; i++) {
+        ev->frames[i].saved = ev->frames[i].loop = ev->frames[i].floor = EVENTS_NO_MARK;
+    }
+    events_deliver(ev, events_end(ev));
+}
+
 // --- Input State Management ---
 void save_input_state(input_t* in, InputState* state) {
     state->start = in->start; state->line = in->line; state->col = in->col;
+    state->mark = 0;
+    parse_events_t* ev = in->events;
+    if (ev != NULL) {
+        state->mark = events_end(ev);
+        if (ev->depth > 0) {
+            struct parse_event_frame* f = &ev->frames[ev->depth];
+            if (state->mark < f->saved) f->saved = state->mark;
+            if (state->mark < f->floor) f->floor = state->mark;
+        }
+    }
+}
+
+void save_iteration_state(input_t* in, InputState* state) {
+    parse_events_t* ev = in->events;
+    if (ev == NULL || ev->depth == 0) {
+        save_input_state(in, state);
+        return;
+    }
+    state->start = in->start; state->line = in->line; state->col = in->col;
+    state->mark = events_end(ev);
+    // Replaces the previous iteration's mark instead of lowering the floor
+    struct parse_event_frame* f = &ev->frames[ev->depth];
+    f->loop = state->mark;
+    size_t floor = ev->frames[ev->depth - 1].floor;
+    if (f->saved < floor) floor = f->saved;
+    if (f->loop < floor) floor = f->loop;
+    f->floor = floor;
 }
 
 void restore_input_state(input_t* in, InputState* state) {
     in->start = state->start; in->line = state->line; in->col = state->col;
+    if (in->events != NULL) events_truncate(in->events, state->mark);
 }
 
 // --- Public Helpers ---
+// Limits of the parse running on this thread, for allocation accounting
+static _Thread_local parse_limits_t* active_limits = NULL;
+
 /* HARDENED: Changed exit(1) to abort() for immediate crash. */
 void* safe_malloc(size_t size) {
+    if (active_limits != NULL) active_limits->bytes += size;
     void* ptr = malloc(size);
     if (!ptr) {
         fprintf(stderr, "FATAL: safe_malloc failed to allocate %zu bytes at %s:%d\n", size, __FILE__, __LINE__);
@@ -142,17 +343,180 @@ void exception(const char * err) {
    abort();
 }
 
+// --- AST Arenas ---
+
+#define AST_ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    size_t size;              // usable bytes after the header
+} arena_chunk;
+
+struct ast_arena {
+    arena_chunk* chunks;      // in allocation order; `current` and later are free
+    arena_chunk* current;
+    size_t offset;            // into current
+    size_t used;
+};
+
+static _Thread_local ast_arena_t* active_arena = NULL;
+
+ast_arena_t* new_ast_arena(void) {
+    ast_arena_t* arena = (ast_arena_t*)safe_malloc(sizeof(ast_arena_t));
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->offset = 0;
+    arena->used = 0;
+    return arena;
+}
+
+void free_ast_arena(ast_arena_t* arena) {
+    if (arena == NULL) return;
+    if (active_arena == arena) active_arena = NULL;
+    arena_chunk* c = arena->chunks;
+    while (c != NULL) {
+        arena_chunk* next = c->next;
+        free(c);
+        c = next;
+    }
+    free(arena);
+}
+
+ast_arena_t* ast_arena_use(ast_arena_t* arena) {
+    ast_arena_t* previous = active_arena;
+    active_arena = arena;
+    return previous;
+}
+
+void ast_arena_reset(ast_arena_t* arena) {
+    arena->current = arena->chunks;
+    arena->offset = 0;
+    arena->used = 0;
+}
+
+size_t ast_arena_used(const ast_arena_t* arena) {
+    return arena->used;
+}
+
+static void* arena_alloc(ast_arena_t* arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    // Counted against the parse's memory limit like heap allocations.
+    if (active_limits != NULL) active_limits->bytes += size;
+    arena->used += size;
+    while (arena->current != NULL && arena->offset + size > arena->current->size) {
+        arena->current = arena->current->next;
+        arena->offset = 0;
+    }
+    if (arena->current == NULL) {
+        size_t chunk_size = size > AST_ARENA_CHUNK_SIZE ? size : AST_ARENA_CHUNK_SIZE;
+        arena_chunk* c = (arena_chunk*)malloc(sizeof(arena_chunk) + 16 + chunk_size);
+        if (!c) exception("malloc failed");
+        c->next = NULL;
+        c->size = chunk_size;
+        // Append so chunks kept by a reset are reused in order.
+        arena_chunk** tail = &arena->chunks;
+        while (*tail != NULL) tail = &(*tail)->next;
+        *tail = c;
+        arena->current = c;
+        arena->offset = 0;
+    }
+    char* base = (char*)(((uintptr_t)(arena->current + 1) + 15) & ~(uintptr_t)15);
+    void* ptr = base + arena->offset;
+    arena->offset += size;
+    return ptr;
+}
+
+// Symbols come from the same place as the nodes that will own them.
+static sym_t* alloc_sym(size_t length) {
+    size_t size = sizeof(sym_t) + length + 1;
+    sym_t* sym = (sym_t*)(active_arena ? arena_alloc(active_arena, size) : safe_malloc(size));
+    sym->name = (char*)(sym + 1);
+    return sym;
+}
+
+static void free_sym(sym_t* sym) {
+    if (active_arena == NULL) free(sym);
+}
+
 ast_t * new_ast() {
-    ast_t* ast = (ast_t *) safe_malloc(sizeof(ast_t));
+    ast_t* ast;
+    if (active_arena != NULL) {
+        ast = (ast_t*)arena_alloc(active_arena, sizeof(ast_t));
+        ast->in_arena = true;
+    } else {
+        ast = (ast_t*)safe_malloc(sizeof(ast_t));
+        ast->in_arena = false;
+    }
     ast->typ = 0; // Default tag
     ast->child = NULL;
     ast->next = NULL;
     ast->sym = NULL;
     ast->line = 0;
     ast->col = 0;
+    ast->value_kind = AST_VALUE_NONE;
     return ast;
 }
 
+void ast_set_int(ast_t* ast, int64_t value) {
+    ast->value_kind = AST_VALUE_INT;
+    ast->value.i = value;
+}
+
+void ast_set_double(ast_t* ast, double value) {
+    ast->value_kind = AST_VALUE_DOUBLE;
+    ast->value.d = value;
+}
+
+bool ast_int_value(const ast_t* ast, int64_t* out) {
+    if (ast->value_kind == AST_VALUE_INT) {
+        *out = ast->value.i;
+        return true;
+    }
+    if (ast->value_kind != AST_VALUE_NONE || ast->sym == NULL || ast->sym->length == 0) return false;
+    char* end;
+    errno = 0;
+    long long v = strtoll(ast->sym->name, &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+    *out = (int64_t)v;
+    return true;
+}
+
+bool ast_double_value(const ast_t* ast, double* out) {
+    switch (ast->value_kind) {
+        case AST_VALUE_DOUBLE: *out = ast->value.d; return true;
+        case AST_VALUE_INT: *out = (double)ast->value.i; return true;
+        default: break;
+    }
+    if (ast->sym == NULL || ast->sym->length == 0) return false;
+    char* end;
+    double d = strtod(ast->sym->name, &end);
+    if (*end != '\0') return false;
+    *out = d;
+    return true;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+double decimal_to_double(bool negative, uint64_t mantissa, int exp10, bool truncated, const char* text, int len) {
+    // Clinger's fast path: both operands are exact doubles, so the single
+    // rounding of the multiply or divide gives the correctly rounded result.
+    if (!truncated && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        double d = (double)mantissa;
+        d = exp10 < 0 ? d / exact_powers_of_ten[-exp10] : d * exact_powers_of_ten[exp10];
+        return negative ? -d : d;
+    }
+    char small[64];
+    char* copy = len < (int)sizeof(small) ? small : (char*)safe_malloc(len + 1);
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    double d = strtod(copy, NULL);
+    if (copy != small) free(copy);
+    return d;
+}
+
 // Set AST node position from current input state
 void set_ast_position(ast_t* ast, input_t* in) {
     if (ast != NULL && in != NULL) {
@@ -168,14 +532,41 @@ ast_t* ast1(tag_t typ, ast_t* a1) {
 }
 
 ast_t* copy_ast(ast_t* orig) {
-    if (orig == NULL) return NULL;
-    if (orig == ensure_ast_nil_initialized()) return ensure_ast_nil_initialized();
-    ast_t* new = new_ast();
-    new->typ = orig->typ;
-    new->sym = orig->sym ? sym_lookup(orig->sym->name) : NULL;
-    new->child = copy_ast(orig->child);
-    new->next = copy_ast(orig->next);
-    return new;
+    ast_t* nil = ensure_ast_nil_initialized();
+    ast_t* root = NULL;
+    // Pending originals, each with the slot its copy is stored into
+    struct { ast_t* node; ast_t** slot; }* pending = NULL;
+    size_t count = 0, cap = 0;
+    ast_t* node = orig;
+    ast_t** slot = &root;
+    while (1) {
+        if (node == NULL || node == nil) {
+            *slot = node;
+            if (count == 0) break;
+            count--;
+            node = pending[count].node;
+            slot = pending[count].slot;
+            continue;
+        }
+        ast_t* new = new_ast();
+        new->typ = node->typ;
+        new->sym = node->sym ? sym_lookup_n(node->sym->name, node->sym->length) : NULL;
+        new->value_kind = node->value_kind;
+        new->value = node->value;
+        *slot = new;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            pending = realloc(pending, sizeof(*pending) * cap);
+            if (!pending) exception("realloc failed");
+        }
+        pending[count].node = node->next;
+        pending[count].slot = &new->next;
+        count++;
+        node = node->child;
+        slot = &new->child;
+    }
+    free(pending);
+    return root;
 }
 
 ast_t* ast2(tag_t typ, ast_t* a1, ast_t* a2) {
@@ -185,15 +576,23 @@ ast_t* ast2(tag_t typ, ast_t* a1, ast_t* a2) {
 }
 
 sym_t * sym_lookup(const char * name) {
-   sym_t * sym = (sym_t *) safe_malloc(sizeof(sym_t));
-   sym->name = (char *) safe_malloc(strlen(name) + 1);
-   strcpy(sym->name, name);
+   return sym_lookup_n(name, strlen(name));
+}
+
+sym_t * sym_lookup_n(const char * name, size_t length) {
+   sym_t * sym = alloc_sym(length);
+   sym->length = length;
+   memcpy(sym->name, name, length);
+   sym->name[length] = '\0';
    return sym;
 }
 
 input_t * new_input() {
     input_t * in = (input_t *) safe_malloc(sizeof(input_t));
     in->buffer = NULL; in->alloc = 0; in->length = 0; in->start = 0; in->line = 1; in->col = 1;
+    in->limits = NULL;
+    in->recognize_only = false;
+    in->events = NULL;
     return in;
 }
 
@@ -237,12 +636,22 @@ char read1(input_t * in) {
 // PRIMITIVE PARSING FUNCTIONS (THE `_fn` IMPLEMENTATIONS)
 //=============================================================================
 
+static size_t combinators_allocated = 0;
+
+size_t combinator_allocation_count(void) {
+    return combinators_allocated;
+}
+
 combinator_t * new_combinator() {
+    combinators_allocated++;
     combinator_t *comb = (combinator_t *) safe_malloc(sizeof(combinator_t));
     // Explicitly zero out the entire struct to avoid uninitialised value warnings
     memset(comb, 0, sizeof(combinator_t));
     comb->type = P_MATCH; // Default value, will be overridden
     comb->extra_to_free = NULL;
+    // Owned by the caller until a parent adopts it
+    comb->refcount = 1;
+    comb->floating = 1;
     return comb;
 }
 
@@ -253,7 +662,8 @@ static ParseResult match_ci_fn(input_t * in, void * args, char* parser_name) {
         char c = read1(in);
         if (tolower((unsigned char)c) != tolower((unsigned char)str[i])) {
             restore_input_state(in, &state);
-            char* unexpected = strndup(in->buffer + state.start, 10);
+            if (in->recognize_only) return make_position_failure(in);
+            char* unexpected = input_excerpt(in, state.start, 10);
             char* err_msg;
             if (asprintf(&err_msg, "Parser '%s' Expected '%s' (case-insensitive) but found '%.10s...'", parser_name ? parser_name : "N/A", str, unexpected) < 0) {
                 err_msg = strdup("Expected token (case-insensitive)");
@@ -271,7 +681,8 @@ static ParseResult match_fn(input_t * in, void * args, char* parser_name) {
         char c = read1(in);
         if (c != str[i]) {
             restore_input_state(in, &state);
-            char* unexpected = strndup(in->buffer + state.start, 10);
+            if (in->recognize_only) return make_position_failure(in);
+            char* unexpected = input_excerpt(in, state.start, 10);
             char* err_msg;
             if (asprintf(&err_msg, "Parser '%s' Expected '%s' but found '%.10s...'", parser_name ? parser_name : "N/A", str, unexpected) < 0) {
                 err_msg = strdup("Expected token");
@@ -289,23 +700,28 @@ static ParseResult integer_fn(input_t * in, void * args, char* parser_name) {
    char c = read1(in);
    if (!isdigit((unsigned char)c)) {
        restore_input_state(in, &state);
-       char* unexpected = strndup(in->buffer + state.start, 10);
+       if (in->recognize_only) return make_position_failure(in);
+       char* unexpected = input_excerpt(in, state.start, 10);
        return make_failure_v2(in, parser_name, strdup("Expected a digit."), unexpected);
    }
-   while (1) {
-       c = read1(in);
-       if (c == EOF || !isdigit((unsigned char)c)) {
-           break;
-       }
+   // Decode while scanning; the payload is dropped if it overflows.
+   uint64_t value = (uint64_t)(c - '0');
+   bool overflow = false;
+   const char* buf = in->buffer;
+   int i = in->start;
+   while (i < in->length && isdigit((unsigned char)buf[i])) {
+       unsigned digit = (unsigned)(buf[i++] - '0');
+       if (value > ((uint64_t)INT64_MAX - digit) / 10) overflow = true;
+       else value = value * 10 + digit;
    }
-   if (c != EOF) in->start--;
-   int len = in->start - start_pos_ws;
-   char * text = (char*)safe_malloc(len + 1);
-   strncpy(text, in->buffer + start_pos_ws, len);
-   text[len] = '\0';
+   in->col += i - in->start;
+   in->start = i;
+   parse_emit_token(in, pargs->tag, start_pos_ws, in->start);
+   if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
    ast_t * ast = new_ast();
-   ast->typ = pargs->tag; ast->sym = sym_lookup(text); free(text);
+   ast->typ = pargs->tag; ast->sym = sym_lookup_n(buf + start_pos_ws, in->start - start_pos_ws);
    ast->child = NULL; ast->next = NULL;
+   if (!overflow) ast_set_int(ast, (int64_t)value);
    set_ast_position(ast, in);
    return make_success(ast);
 }
@@ -317,7 +733,8 @@ static ParseResult cident_fn(input_t * in, void * args, char* parser_name) {
    char c = read1(in);
    if (c != '_' && !isalpha((unsigned char)c)) {
        restore_input_state(in, &state);
-       char* unexpected = strndup(in->buffer + state.start, 10);
+       if (in->recognize_only) return make_position_failure(in);
+       char* unexpected = input_excerpt(in, state.start, 10);
        return make_failure_v2(in, parser_name, strdup("Expected identifier."), unexpected);
    }
    while (1) {
@@ -327,6 +744,8 @@ static ParseResult cident_fn(input_t * in, void * args, char* parser_name) {
        }
    }
    if (c != EOF) in->start--;
+   parse_emit_token(in, pargs->tag, start_pos_ws, in->start);
+   if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
    int len = in->start - start_pos_ws;
    char * text = (char*)safe_malloc(len + 1);
    strncpy(text, in->buffer + start_pos_ws, len);
@@ -338,44 +757,173 @@ static ParseResult cident_fn(input_t * in, void * args, char* parser_name) {
    return make_success(ast);
 }
 
+// Moves the input forward to `end`, updating line/col as read1() would.
+static void advance_to(input_t* in, int end) {
+    const char* p = in->buffer + in->start;
+    const char* stop = in->buffer + end;
+    const char* last_newline = NULL;
+    int newlines = 0;
+    while (p < stop && (p = memchr(p, '\n', stop - p)) != NULL) {
+        newlines++;
+        last_newline = p++;
+    }
+    if (last_newline != NULL) {
+        in->line += newlines;
+        in->col = (int)(stop - last_newline);
+    } else {
+        in->col += end - in->start;
+    }
+    in->start = end;
+}
+
+// Offset of the first '"' or '\\' in buf[from, len), or len.
+static int find_quote_or_escape(const char* buf, int from, int len) {
+    int i = from;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(buf + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) return i + __builtin_ctz((unsigned)mask);
+    }
+#endif
+    while (i < len && buf[i] != '"' && buf[i] != '\\') i++;
+    return i;
+}
+
+static int hex4(const char* p) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0) return -1;
+        v = v * 16 + d;
+    }
+    return v;
+}
+
+static size_t put_utf8(char* out, unsigned cp) {
+    if (cp < 0x80) { out[0] = (char)cp; return 1; }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Decodes a string body src[0, len) into `out`, which needs at most len
+// bytes (NULL only validates). Clean runs are copied whole. Returns the
+// decoded length, or -1 with *bad set to the offset of a malformed \u
+// escape. Unpaired surrogates become U+FFFD; unknown escapes keep the
+// escaped character.
+long decode_string(const char* src, int len, char* out, int* bad) {
+    size_t n = 0;
+    int i = 0;
+    while (i < len) {
+        int run = find_quote_or_escape(src, i, len);
+        if (out) memcpy(out + n, src + i, run - i);
+        n += run - i;
+        if (run == len) break;
+        // A backslash; the body never ends in an unpaired one.
+        char c = src[run + 1];
+        i = run + 2;
+        char utf8[4];
+        size_t w = 1;
+        switch (c) {
+            case 'n': utf8[0] = '\n'; break;
+            case 't': utf8[0] = '\t'; break;
+            case 'r': utf8[0] = '\r'; break;
+            case 'b': utf8[0] = '\b'; break;
+            case 'f': utf8[0] = '\f'; break;
+            case 'u': {
+                int cp = i + 4 <= len ? hex4(src + i) : -1;
+                if (cp < 0) { *bad = run; return -1; }
+                i += 4;
+                unsigned code = (unsigned)cp;
+                if (code >= 0xD800 && code < 0xDC00) {
+                    int low = i + 6 <= len && src[i] == '\\' && src[i + 1] == 'u' ? hex4(src + i + 2) : -1;
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned)low - 0xDC00);
+                        i += 6;
+                    } else {
+                        code = 0xFFFD;
+                    }
+                } else if (code >= 0xDC00 && code < 0xE000) {
+                    code = 0xFFFD;
+                }
+                w = put_utf8(utf8, code);
+                break;
+            }
+            default: utf8[0] = c; break;
+        }
+        if (out) memcpy(out + n, utf8, w);
+        n += w;
+    }
+    return (long)n;
+}
+
 static ParseResult string_fn(input_t * in, void * args, char* parser_name) {
    prim_args* pargs = (prim_args*)args;
    InputState state; save_input_state(in, &state);
    if (read1(in) != '"') {
        restore_input_state(in, &state);
-       char* unexpected = strndup(in->buffer + state.start, 10);
+       if (in->recognize_only) return make_position_failure(in);
+       char* unexpected = input_excerpt(in, state.start, 10);
        return make_failure_v2(in, parser_name, strdup("Expected '\"'."), unexpected);
    }
-   int capacity = 64;
-   char * str_val = (char *) safe_malloc(capacity);
-   int len = 0; char c;
-   while ((c = read1(in)) != '"') {
-      if (c == EOF) {
-          free(str_val);
-          return make_failure_v2(in, parser_name, strdup("Unterminated string."), NULL);
-      }
-      if (c == '\\') {
-         c = read1(in);
-         if (c == EOF) {
-             free(str_val);
-             return make_failure_v2(in, parser_name, strdup("Unterminated string."), NULL);
-         }
-         switch (c) {
-            case 'n': c = '\n'; break; case 't': c = '\t'; break;
-            case '"': c = '"'; break; case '\\': c = '\\'; break;
-         }
-      }
-      if (len + 1 >= capacity) {
-         capacity *= 2;
-         char* new_str_val = realloc(str_val, capacity);
-         if (!new_str_val) { free(str_val); exception("realloc failed"); }
-         str_val = new_str_val;
-      }
-      str_val[len++] = c;
+   // Find the closing quote, stepping over escaped characters.
+   const char* buf = in->buffer;
+   int body = in->start;
+   int end = find_quote_or_escape(buf, body, in->length);
+   bool escaped = false;
+   while (end < in->length && buf[end] == '\\') {
+       escaped = true;
+       end = end + 2 >= in->length ? in->length : find_quote_or_escape(buf, end + 2, in->length);
+   }
+   if (end >= in->length) {
+       advance_to(in, in->length);
+       return make_failure_literal(in, parser_name, "Unterminated string.");
+   }
+   bool build = !in->recognize_only;
+   sym_t* sym = NULL;
+   if (!escaped) {
+       // Copied once, straight from the input.
+       if (build) sym = sym_lookup_n(buf + body, end - body);
+   } else {
+       if (build) {
+           sym = alloc_sym(end - body);
+       }
+       int bad = 0;
+       long n = decode_string(buf + body, end - body, sym ? sym->name : NULL, &bad);
+       if (n < 0) {
+           if (sym) free_sym(sym);
+           advance_to(in, body + bad);
+           if (in->recognize_only) return make_position_failure(in);
+           char* unexpected = input_excerpt(in, body + bad, 6);
+           return make_failure_v2(in, parser_name, strdup("Invalid \\u escape."), unexpected);
+       }
+       if (sym) {
+           sym->length = (size_t)n;
+           sym->name[n] = '\0';
+       }
    }
-   str_val[len] = '\0';
+   advance_to(in, end + 1);
+   parse_emit_token(in, pargs->tag, state.start, in->start);
+   if (!build) return make_success(ensure_ast_nil_initialized());
    ast_t * ast = new_ast();
-   ast->typ = pargs->tag; ast->sym = sym_lookup(str_val); free(str_val);
+   ast->typ = pargs->tag; ast->sym = sym;
    ast->child = NULL; ast->next = NULL;
    set_ast_position(ast, in);
    return make_success(ast);
@@ -387,8 +935,10 @@ static ParseResult any_char_fn(input_t * in, void * args, char* parser_name) {
     char c = read1(in);
     if (c == EOF) {
         restore_input_state(in, &state);
-        return make_failure_v2(in, parser_name, strdup("Expected any character, but found EOF."), NULL);
+        return make_failure_literal(in, parser_name, "Expected any character, but found EOF.");
     }
+    parse_emit_token(in, pargs->tag, state.start, in->start);
+    if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
     char str[2] = {c, '\0'};
     ast_t* ast = new_ast();
     ast->typ = pargs->tag;
@@ -405,9 +955,12 @@ static ParseResult satisfy_fn(input_t * in, void * args, char* parser_name) {
     char c = read1(in);
     if (c == EOF || !sargs->pred(c)) {
         restore_input_state(in, &state);
-        char* unexpected = strndup(in->buffer + state.start, 10);
+        if (in->recognize_only) return make_position_failure(in);
+        char* unexpected = input_excerpt(in, state.start, 10);
         return make_failure_v2(in, parser_name, strdup("Predicate not satisfied."), unexpected);
     }
+    parse_emit_token(in, sargs->tag, state.start, in->start);
+    if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
     char str[2] = {c, '\0'};
     ast_t* ast = new_ast();
     ast->typ = sargs->tag;
@@ -418,20 +971,67 @@ static ParseResult satisfy_fn(input_t * in, void * args, char* parser_name) {
     return make_success(ast);
 }
 
+static ParseResult skip_while_fn(input_t * in, void * args, char* parser_name) {
+    char_predicate pred = ((skip_while_args*)args)->pred;
+    const char* buf = in->buffer;
+    int i = in->start, line = in->line, col = in->col;
+    while (i < in->length && pred(buf[i])) {
+        if (buf[i++] == '\n') { line++; col = 1; } else { col++; }
+    }
+    in->start = i; in->line = line; in->col = col;
+    return make_success(ensure_ast_nil_initialized());
+}
+
+// Offset of the first occurrence of `str` at or after in->start, or
+// in->length if there is none.
+static int find_literal(input_t* in, const char* str, bool case_insensitive) {
+    const char* buf = in->buffer;
+    size_t len = strlen(str);
+    size_t from = (size_t)in->start, n = (size_t)in->length;
+    if (len == 0) return in->start;
+    if (!case_insensitive) {
+        const char* hit = memmem(buf + from, n - from, str, len);
+        return hit ? (int)(hit - buf) : in->length;
+    }
+    unsigned char lower = (unsigned char)tolower((unsigned char)str[0]);
+    unsigned char upper = (unsigned char)toupper((unsigned char)str[0]);
+    while (from + len <= n) {
+        const char* hit = memchr(buf + from, lower, n - from);
+        if (upper != lower) {
+            size_t limit = hit ? (size_t)(hit - buf) : n;
+            const char* other = memchr(buf + from, upper, limit - from);
+            if (other != NULL) hit = other;
+        }
+        if (hit == NULL || (size_t)(hit - buf) + len > n) break;
+        if (strncasecmp(hit, str, len) == 0) return (int)(hit - buf);
+        from = (size_t)(hit - buf) + 1;
+    }
+    return in->length;
+}
+
 static ParseResult until_fn(input_t* in, void* args, char* parser_name) {
     until_args* uargs = (until_args*)args;
     int start_offset = in->start;
-    while(1) {
-        InputState current_state; save_input_state(in, &current_state);
-        ParseResult res = parse(in, uargs->delimiter);
-        if (res.is_success) {
-            if (res.value.ast != ensure_ast_nil_initialized()) free_ast(res.value.ast);
-            restore_input_state(in, &current_state); break;
+    combinator_t* delimiter = uargs->delimiter;
+    // Literal delimiters are searched for directly rather than attempted
+    // (and failed, allocating an error) at every position.
+    if (in->buffer != NULL && (delimiter->fn == match_fn || delimiter->fn == match_ci_fn)) {
+        advance_to(in, find_literal(in, ((match_args*)delimiter->args)->str, delimiter->fn == match_ci_fn));
+    } else {
+        while(1) {
+            InputState current_state; save_input_state(in, &current_state);
+            ParseResult res = parse(in, delimiter);
+            if (res.is_success) {
+                if (res.value.ast != ensure_ast_nil_initialized()) free_ast(res.value.ast);
+                restore_input_state(in, &current_state); break;
+            }
+            free_error(res.value.error);
+            restore_input_state(in, &current_state);
+            if (read1(in) == EOF) break;
         }
-        free_error(res.value.error);
-        restore_input_state(in, &current_state);
-        if (read1(in) == EOF) break;
     }
+    parse_emit_token(in, uargs->tag, start_offset, in->start);
+    if (in->recognize_only) return make_success(ensure_ast_nil_initialized());
     int len = in->start - start_offset;
     char* text = (char*)safe_malloc(len + 1);
     strncpy(text, in->buffer + start_offset, len);
@@ -444,21 +1044,41 @@ static ParseResult until_fn(input_t* in, void* args, char* parser_name) {
 
 static ParseResult expr_fn(input_t * in, void * args, char* parser_name) {
    expr_list * list = (expr_list *) args;
-   if (list == NULL) return make_failure_v2(in, parser_name, strdup("Invalid expression grammar."), NULL);
+   if (list == NULL) return make_failure_literal(in, parser_name, "Invalid expression grammar.");
    if (list->fix == EXPR_BASE) return parse(in, list->comb);
+   // Operator nodes wrap operand events after the fact; holding a saved
+   // state keeps those events in the journal until then.
+   InputState entry;
+   if (in->events != NULL) save_input_state(in, &entry);
+   else entry.start = in->start, entry.mark = 0;
    if (list->fix == EXPR_PREFIX) {
        op_t* op = list->op;
        if (op) {
-           InputState state; save_input_state(in, &state);
-           ParseResult op_res = parse(in, op->comb);
-           if (op_res.is_success) {
+           // Count repeated prefix operators rather than recursing per operator
+           size_t prefixes = 0;
+           while (1) {
+               InputState state; save_input_state(in, &state);
+               ParseResult op_res = parse(in, op->comb);
+               if (!op_res.is_success) {
+                   free_error(op_res.value.error);
+                   restore_input_state(in, &state);
+                   break;
+               }
                free_ast(op_res.value.ast);
-               ParseResult rhs_res = expr_fn(in, args, parser_name);
+               prefixes++;
+               if (in->start == state.start) break;
+           }
+           if (prefixes > 0) {
+               ParseResult rhs_res = expr_fn(in, (void *) list->next, parser_name);
                if (!rhs_res.is_success) return rhs_res;
-               return make_success(ast1(op->tag, rhs_res.value.ast));
+               ast_t* ast = rhs_res.value.ast;
+               if (in->recognize_only) {
+                   while (prefixes-- > 0) events_wrap(in, entry.mark, op->tag, entry.start);
+                   return make_success(ast);
+               }
+               while (prefixes-- > 0) ast = ast1(op->tag, ast);
+               return make_success(ast);
            }
-               free_error(op_res.value.error);
-           restore_input_state(in, &state);
        }
    }
    ParseResult res = expr_fn(in, (void *) list->next, parser_name);
@@ -480,10 +1100,21 @@ static ParseResult expr_fn(input_t * in, void * args, char* parser_name) {
                        if (rhs_res.value.error) {
                            rhs_res.value.error->partial_ast = NULL;
                        }
-                       ast_t* new_partial_ast = ast2(op_tag, lhs, rhs_partial_ast);
+                       ast_t* new_partial_ast = NULL;
+                       if (in->recognize_only) {
+                           free_ast(lhs);
+                           free_ast(rhs_partial_ast);
+                       } else {
+                           new_partial_ast = ast2(op_tag, lhs, rhs_partial_ast);
+                       }
                        return wrap_failure_with_ast(in, "Failed to parse right-hand side of infix operator", rhs_res, new_partial_ast);
                    }
-                   lhs = ast2(op_tag, lhs, rhs_res.value.ast);
+                   if (in->recognize_only) {
+                       free_ast(rhs_res.value.ast);
+                       events_wrap(in, entry.mark, op_tag, entry.start);
+                   } else {
+                       lhs = ast2(op_tag, lhs, rhs_res.value.ast);
+                   }
                    found_op = true;
                    break;
                }
@@ -503,7 +1134,8 @@ static ParseResult expr_fn(input_t * in, void * args, char* parser_name) {
                if (op_res.is_success) {
                    tag_t op_tag = op->tag;
                    free_ast(op_res.value.ast);
-                   lhs = ast1(op_tag, lhs);
+                   if (in->recognize_only) events_wrap(in, entry.mark, op_tag, entry.start);
+                   else lhs = ast1(op_tag, lhs);
                    found_op = true;
                    break;
                }
@@ -527,10 +1159,6 @@ static ParseResult lazy_fn(input_t * in, void * args, char* parser_name) {
         fprintf(stderr, "Lazy parser's fn is NULL for parser at %p\n", lazy_parser);
         exception("Lazy parser's fn is NULL.");
     }
-    // If the lazy parser has no name, give it the name of the lazy combinator
-    if (lazy_parser->name == NULL && parser_name != NULL) {
-        lazy_parser->name = strdup(parser_name);
-    }
     return parse(in, lazy_parser);
 }
 
@@ -538,58 +1166,66 @@ static ParseResult eoi_fn(input_t * in, void * args, char* parser_name) {
     if (in->start == in->length) {
         return make_success(ast_nil);
     }
-    return make_failure_v2(in, parser_name, strdup("Expected end of input."), NULL);
+    return make_failure_literal(in, parser_name, "Expected end of input.");
 }
 
 //=============================================================================
 // PRIMITIVE PARSER CREATION FUNCTIONS (THE PUBLIC API)
 //=============================================================================
 
+// Interns a freshly built primitive and names it unless it already existed.
+static combinator_t* named_primitive(combinator_t* comb, const char* name) {
+    comb = intern_combinator(comb);
+    if (comb->name == NULL) {
+        comb->name = (char*)name;
+        comb->flags |= COMB_FLAG_STATIC_NAME;
+    }
+    return comb;
+}
+
 combinator_t * match(char * str) {
     match_args * args = (match_args*)safe_malloc(sizeof(match_args));
     args->str = str;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("match");
-    comb->type = P_MATCH; comb->fn = match_fn; comb->args = args; return comb;
+    comb->type = P_MATCH; comb->fn = match_fn; comb->args = args;
+    return named_primitive(comb, "match");
 }
 combinator_t * match_ci(char * str) {
     match_args * args = (match_args*)safe_malloc(sizeof(match_args));
     args->str = str;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("match_ci");
-    comb->type = P_CI_KEYWORD; comb->fn = match_ci_fn; comb->args = args; return comb;
+    comb->type = P_CI_KEYWORD; comb->fn = match_ci_fn; comb->args = args;
+    return named_primitive(comb, "match_ci");
 }
 combinator_t * integer(tag_t tag) {
     prim_args * args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("integer");
-    comb->type = P_INTEGER; comb->fn = integer_fn; comb->args = args; return comb;
+    comb->type = P_INTEGER; comb->fn = integer_fn; comb->args = args;
+    return named_primitive(comb, "integer");
 }
 combinator_t * cident(tag_t tag) {
     prim_args * args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("cident");
-    comb->type = P_CIDENT; comb->fn = cident_fn; comb->args = args; return comb;
+    comb->type = P_CIDENT; comb->fn = cident_fn; comb->args = args;
+    return named_primitive(comb, "cident");
 }
 combinator_t * string(tag_t tag) {
     prim_args * args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("string");
     comb->type = P_STRING;
     comb->fn = string_fn;
     comb->args = args;
-    return comb;
+    return named_primitive(comb, "string");
 }
 combinator_t * eoi() {
     combinator_t * comb = new_combinator();
-    comb->name = strdup("eoi");
     comb->type = P_EOI;
     comb->fn = eoi_fn;
     comb->args = NULL;
-    return comb;
+    return named_primitive(comb, "eoi");
 }
 
 combinator_t * satisfy(char_predicate pred, tag_t tag) {
@@ -597,39 +1233,51 @@ combinator_t * satisfy(char_predicate pred, tag_t tag) {
     args->pred = pred;
     args->tag = tag;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("satisfy");
     comb->type = P_SATISFY;
     comb->fn = satisfy_fn;
     comb->args = (void*)args;
-    return comb;
+    return named_primitive(comb, "satisfy");
+}
+combinator_t * skip_while(char_predicate pred) {
+    skip_while_args* args = (skip_while_args*)safe_malloc(sizeof(skip_while_args));
+    args->pred = pred;
+    combinator_t * comb = new_combinator();
+    comb->type = P_SKIP_WHILE;
+    comb->fn = skip_while_fn;
+    comb->args = (void*)args;
+    return named_primitive(comb, "skip_while");
 }
 combinator_t* until(combinator_t* p, tag_t tag) {
     until_args* args = (until_args*)safe_malloc(sizeof(until_args));
     args->delimiter = p;
     args->tag = tag;
     combinator_t* comb = new_combinator();
-    comb->type = P_UNTIL; comb->fn = until_fn; comb->args = args; return comb;
+    comb->type = P_UNTIL; comb->fn = until_fn; comb->args = args;
+    return intern_combinator(comb);
 }
 
 combinator_t * any_char(tag_t tag) {
     prim_args * args = (prim_args*)safe_malloc(sizeof(prim_args));
     args->tag = tag;
     combinator_t * comb = new_combinator();
-    comb->name = strdup("any_char");
     comb->type = P_ANY_CHAR;
     comb->fn = any_char_fn;
     comb->args = args;
-    return comb;
+    return named_primitive(comb, "any_char");
 }
 combinator_t * expr(combinator_t * exp, combinator_t * base) {
    expr_list * args = (expr_list*)safe_malloc(sizeof(expr_list));
    args->next = NULL; args->fix = EXPR_BASE; args->comb = base; args->op = NULL;
-   exp->type = COMB_EXPR; exp->fn = expr_fn; exp->args = args; return exp;
+   combinator_adopt(base);
+   exp->type = COMB_EXPR; exp->fn = expr_fn; exp->args = args;
+   combinator_note_cycles(exp);
+   return exp;
 }
 void expr_insert(combinator_t * exp, int prec, tag_t tag, expr_fix fix, expr_assoc assoc, combinator_t * comb) {
     expr_list *node = (expr_list*)safe_malloc(sizeof(expr_list));
     op_t *op = (op_t*)safe_malloc(sizeof(op_t));
     op->tag = tag; op->comb = comb; op->next = NULL;
+    combinator_adopt(comb);
     node->op = op; node->fix = fix; node->assoc = assoc; node->comb = NULL;
     expr_list **p_list = (expr_list**)&exp->args;
     for (int i = 0; i < prec; i++) {
@@ -637,6 +1285,7 @@ void expr_insert(combinator_t * exp, int prec, tag_t tag, expr_fix fix, expr_ass
         p_list = &(*p_list)->next;
     }
     node->next = *p_list; *p_list = node;
+    combinator_note_cycles(exp);
 }
 void expr_altern(combinator_t * exp, int prec, tag_t tag, combinator_t * comb) {
     expr_list* list = (expr_list*)exp->args;
@@ -647,15 +1296,246 @@ void expr_altern(combinator_t * exp, int prec, tag_t tag, combinator_t * comb) {
     if (list->fix == EXPR_BASE || list == NULL) exception("Invalid precedence");
     op_t* op = (op_t*)safe_malloc(sizeof(op_t));
     op->tag = tag; op->comb = comb; op->next = list->op;
+    combinator_adopt(comb);
     list->op = op;
+    combinator_note_cycles(exp);
 }
 
 //=============================================================================
 // THE UNIVERSAL PARSE FUNCTION
 //=============================================================================
+// Wrappers that report failures under their own name; every other failure
+// keeps whatever name the combinator that created it gave it.
+static bool names_own_failures(combinator_t * comb) {
+    return comb->type == COMB_NOT || comb->type == COMB_EXPECT || comb->type == COMB_CHAINL1;
+}
+
+static inline ParseResult run_combinator(input_t * in, combinator_t * comb) {
+    char* name = __atomic_load_n(&comb->name, __ATOMIC_ACQUIRE);
+    // Recognize-only failures carry no name
+    if (name == NULL && !in->recognize_only && names_own_failures(comb)) name = (char*)combinator_name(comb);
+    return comb->fn(in, (void *)comb->args, name);
+}
+
+static parse_limit_kind check_limits(parse_limits_t* limits) {
+    if (limits->cancel != NULL && atomic_load_explicit(limits->cancel, memory_order_relaxed)) return PARSE_LIMIT_CANCELLED;
+    if (limits->max_steps != 0 && limits->steps >= limits->max_steps) return PARSE_LIMIT_STEPS;
+    if (limits->max_depth != 0 && limits->depth >= limits->max_depth) return PARSE_LIMIT_DEPTH;
+    if (limits->max_bytes != 0 && limits->bytes > limits->max_bytes) return PARSE_LIMIT_MEMORY;
+    return PARSE_LIMIT_NONE;
+}
+
+static ParseResult limit_failure(input_t * in, parse_limit_kind kind) {
+    static const char* messages[] = {
+        [PARSE_LIMIT_STEPS] = "Parse step limit exceeded.",
+        [PARSE_LIMIT_DEPTH] = "Parse depth limit exceeded.",
+        [PARSE_LIMIT_MEMORY] = "Parse memory limit exceeded.",
+        [PARSE_LIMIT_CANCELLED] = "Parse cancelled.",
+    };
+    // Kept in recognize-only mode too: the caller needs the kind
+    ParseError* err = new_error(in, NULL, strdup(messages[kind]), NULL);
+    // Nothing may backtrack past a tripped limit
+    err->committed = true;
+    err->limit = kind;
+    return (ParseResult){ .is_success = false, .value.error = err };
+}
+
+static ParseResult parse_limited(input_t * in, combinator_t * comb, parse_limits_t* limits) {
+    parse_limits_t* outer = active_limits;
+    if (limits->depth == 0) {
+        // A new top-level parse gets a fresh budget.
+        limits->steps = 0;
+        limits->bytes = 0;
+        limits->stopped = PARSE_LIMIT_NONE;
+        active_limits = limits;
+    }
+    // Once a limit has tripped every further call fails straight away, so
+    // combinators that swallow failures still unwind quickly.
+    parse_limit_kind kind = limits->stopped != PARSE_LIMIT_NONE ? limits->stopped : check_limits(limits);
+    ParseResult res;
+    if (kind != PARSE_LIMIT_NONE) {
+        limits->stopped = kind;
+        res = limit_failure(in, kind);
+    } else {
+        limits->steps++;
+        limits->depth++;
+        res = run_combinator(in, comb);
+        limits->depth--;
+    }
+    if (limits->depth == 0) {
+        active_limits = outer;
+        // Whatever the combinators made of it, the caller sees the limit.
+        if (limits->stopped != PARSE_LIMIT_NONE) {
+            if (res.is_success) {
+                free_ast(res.value.ast);
+                res = limit_failure(in, limits->stopped);
+            } else if (res.value.error->limit == PARSE_LIMIT_NONE) {
+                free_error(res.value.error);
+                res = limit_failure(in, limits->stopped);
+            }
+        }
+    }
+    return res;
+}
+
+//=============================================================================
+// PARSE STACK SEGMENTS
+//=============================================================================
+// Every grammar level costs a few C frames, so deep input would overflow the
+// thread's stack. parse() instead checks how much stack is left and, once it
+// runs low, carries on in a heap-allocated segment. Shallow parses never
+// leave the thread's own stack; depth is bounded by memory alone.
+
+#define PARSE_STACK_SEGMENT_SIZE ((size_t)8 << 20)
+// Headroom kept for combinator bodies and callbacks between two parse() calls
+#define PARSE_STACK_RED_ZONE ((size_t)256 << 10)
+
+typedef struct stack_segment {
+    struct stack_segment* next;
+    size_t size;
+} stack_segment;
+
+typedef struct {
+    input_t* in;
+    combinator_t* comb;
+    ParseResult res;
+    ucontext_t caller;
+} segment_call;
+
+// Lowest usable address of the stack this thread is running on; NULL when
+// it is unknown, in which case segments are never used.
+static _Thread_local char* stack_low = NULL;
+static _Thread_local bool stack_low_known = false;
+static _Thread_local stack_segment* spare_segments = NULL;
+static _Thread_local unsigned segments_in_use = 0;
+static _Thread_local segment_call* entering_segment = NULL;
+
+static void find_thread_stack(void) {
+    stack_low_known = true;
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+    void* addr;
+    size_t size;
+    if (pthread_attr_getstack(&attr, &addr, &size) == 0) stack_low = (char*)addr;
+    pthread_attr_destroy(&attr);
+}
+
+static inline bool stack_running_low(void) {
+    if (!stack_low_known) find_thread_stack();
+    char* sp = (char*)__builtin_frame_address(0);
+    return stack_low != NULL && (size_t)(sp - stack_low) < PARSE_STACK_RED_ZONE;
+}
+
+static stack_segment* take_segment(void) {
+    stack_segment* seg = spare_segments;
+    if (seg != NULL) {
+        spare_segments = seg->next;
+        return seg;
+    }
+    // Pages are only committed as the parse touches them
+    void* mem = mmap(NULL, PARSE_STACK_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (mem == MAP_FAILED) exception("Failed to allocate a parse stack segment.");
+    seg = (stack_segment*)mem;
+    seg->size = PARSE_STACK_SEGMENT_SIZE;
+    return seg;
+}
+
+static void release_segments(stack_segment* seg) {
+    seg->next = spare_segments;
+    spare_segments = seg;
+    if (segments_in_use > 0) return;
+    // Keep one segment for the next deep parse on this thread
+    while (spare_segments->next != NULL) {
+        stack_segment* extra = spare_segments->next;
+        spare_segments->next = extra->next;
+        munmap(extra, extra->size);
+    }
+}
+
+static void segment_entry(void) {
+    segment_call* call = entering_segment;
+    call->res = parse(call->in, call->comb);
+    // Returning resumes call->caller through uc_link
+}
+
+static ParseResult parse_on_new_segment(input_t * in, combinator_t * comb) {
+    stack_segment* seg = take_segment();
+    segment_call call;
+    call.in = in;
+    call.comb = comb;
+    ucontext_t ctx;
+    if (getcontext(&ctx) != 0) exception("getcontext failed");
+    ctx.uc_stack.ss_sp = (char*)seg + sizeof(stack_segment);
+    ctx.uc_stack.ss_size = seg->size - sizeof(stack_segment);
+    ctx.uc_link = &call.caller;
+    makecontext(&ctx, segment_entry, 0);
+
+    char* outer_low = stack_low;
+    stack_low = (char*)ctx.uc_stack.ss_sp;
+    segments_in_use++;
+    entering_segment = &call;
+    if (swapcontext(&call.caller, &ctx) != 0) exception("swapcontext failed");
+    segments_in_use--;
+    stack_low = outer_low;
+    release_segments(seg);
+    return call.res;
+}
+
+static ParseResult parse_with_events(input_t * in, combinator_t * comb, parse_events_t* ev) {
+    bool top = ev->depth == 0;
+    bool recognize_only = in->recognize_only;
+    if (top) {
+        ev->count = 0;
+        ev->base = 0;
+        ev->peak = 0;
+        in->recognize_only = true;
+    }
+    if (ev->depth + 2 > ev->frame_cap) {
+        ev->frame_cap = ev->frame_cap ? ev->frame_cap * 2 : 64;
+        struct parse_event_frame* frames = realloc(ev->frames, sizeof(struct parse_event_frame) * ev->frame_cap);
+        if (!frames) exception("realloc failed");
+        ev->frames = frames;
+    }
+    if (top) ev->frames[0] = (struct parse_event_frame){ EVENTS_NO_MARK, EVENTS_NO_MARK, EVENTS_NO_MARK };
+    ev->depth++;
+    struct parse_event_frame* f = &ev->frames[ev->depth];
+    f->saved = f->loop = EVENTS_NO_MARK;
+    f->floor = ev->frames[ev->depth - 1].floor;
+
+    ParseResult res = in->limits != NULL ? parse_limited(in, comb, in->limits) : run_combinator(in, comb);
+
+    ev->depth--;
+    if (!top) {
+        events_deliver(ev, ev->frames[ev->depth].floor);
+        return res;
+    }
+    if (res.is_success) events_deliver(ev, events_end(ev));
+    free(ev->journal);
+    free(ev->frames);
+    ev->journal = NULL;
+    ev->frames = NULL;
+    ev->count = ev->cap = 0;
+    ev->frame_cap = 0;
+    in->recognize_only = recognize_only;
+    return res;
+}
+
+static inline ParseResult parse_nested(input_t * in, combinator_t * comb) {
+    if (stack_running_low()) return parse_on_new_segment(in, comb);
+    if (in->events != NULL) return parse_with_events(in, comb, in->events);
+    if (in->limits != NULL) return parse_limited(in, comb, in->limits);
+    return run_combinator(in, comb);
+}
+
 ParseResult parse(input_t * in, combinator_t * comb) {
     if (!comb || !comb->fn) exception("Attempted to parse with a NULL or uninitialized combinator.");
-    return comb->fn(in, (void *)comb->args, comb->name);
+    if (parse_nesting > 0) return parse_nested(in, comb);
+    parse_nesting++;
+    ParseResult res = parse_nested(in, comb);
+    parse_nesting--;
+    if (!res.is_success) res.value.error = detach_failure(res.value.error);
+    return res;
 }
 
 combinator_t * lazy(combinator_t** parser_ptr) {
@@ -665,7 +1545,7 @@ combinator_t * lazy(combinator_t** parser_ptr) {
     comb->type = COMB_LAZY;
     comb->fn = lazy_fn;
     comb->args = args;
-    return comb;
+    return intern_combinator(comb);
 }
 
 //=============================================================================
@@ -673,249 +1553,801 @@ combinator_t * lazy(combinator_t** parser_ptr) {
 //=============================================================================
 
 void free_error(ParseError* err) {
-    if (err == NULL) return;
-    if (err->parser_name) free(err->parser_name);
-    if (err->unexpected) free(err->unexpected);
-    free(err->message);
-    free_error(err->cause);
-    if (err->partial_ast != NULL) {
-        free_ast(err->partial_ast);
+    while (err != NULL) {
+        // The shared record owns nothing and ends its chain
+        if (err == &position_failure) break;
+        ParseError* cause = err->cause;
+        if (err->parser_name) free(err->parser_name);
+        if (err->unexpected) free(err->unexpected);
+        free(err->message);
+        if (err->partial_ast != NULL) {
+            free_ast(err->partial_ast);
+        }
+        free(err);
+        err = cause;
     }
-    free(err);
 }
 
 void free_ast(ast_t* ast) {
-    if (ast == NULL || ast == ensure_ast_nil_initialized()) return;
-    free_ast(ast->child);
-    free_ast(ast->next);
-    if (ast->sym) { free(ast->sym->name); free(ast->sym); }
-    free(ast);
+    ast_t* nil = ensure_ast_nil_initialized();
+    // Rotate each child up into the sibling chain until the current node has
+    // none, then free it and move along. Needs no stack however deep the tree.
+    while (ast != NULL && ast != nil) {
+        ast_t* child = ast->child;
+        if (child != NULL && child != nil) {
+            ast->child = child->next;
+            child->next = ast;
+            ast = child;
+        } else {
+            ast_t* next = ast->next;
+            if (!ast->in_arena) {
+                free(ast->sym);
+                free(ast);
+            }
+            ast = next;
+        }
+    }
 }
 
-// Initialize ast_nil if not already initialized
-static ast_t* ensure_ast_nil_initialized() {
+ast_t* ensure_ast_nil_initialized(void) {
     if (ast_nil == NULL) {
+        // Outlives any arena
+        ast_arena_t* arena = ast_arena_use(NULL);
         ast_nil = new_ast();
         ast_nil->typ = 0;
+        ast_arena_use(arena);
     }
     return ast_nil;
 }
 
 
+// Growable stack of AST nodes for parser_walk_ast.
+typedef struct {
+    ast_t** items;
+    size_t count, cap;
+} ast_stack;
+
+static void ast_stack_push(ast_stack* st, ast_t* ast) {
+    if (st->count == st->cap) {
+        st->cap = st->cap ? st->cap * 2 : 64;
+        ast_t** items = realloc(st->items, sizeof(ast_t*) * st->cap);
+        if (!items) exception("realloc failed");
+        st->items = items;
+    }
+    st->items[st->count++] = ast;
+}
+
 void parser_walk_ast(ast_t* ast, ast_visitor_fn visitor, void* context) {
-    if (ast == NULL || ast == ensure_ast_nil_initialized()) {
-        return;
+    ast_t* nil = ensure_ast_nil_initialized();
+    ast_stack pending = {0};
+    // Pre-order: a node, then its children, then its later siblings
+    while (ast != NULL && ast != nil) {
+        visitor(ast, context);
+        if (ast->next != NULL && ast->next != nil) ast_stack_push(&pending, ast->next);
+        if (ast->child != NULL && ast->child != nil) {
+            ast = ast->child;
+        } else {
+            ast = pending.count > 0 ? pending.items[--pending.count] : NULL;
+        }
     }
+    free(pending.items);
+}
 
-    visitor(ast, context);
+//=============================================================================
+// COMBINATOR SHARING
+//=============================================================================
+//
+// Constructors register what they build in a global intern table keyed by
+// (type, fn, scalar args, child pointers). Building the same subgraph twice
+// then yields the same node, so grammars that call e.g. a whitespace helper
+// once per token share a single copy of it. Grammar construction is not
+// thread-safe, and neither is parsing through flatMap(), which builds and
+// frees a continuation parser on every match.
+//
+// Ownership: every combinator counts its parent edges plus the references
+// still held by whoever constructed it ("floating"). A constructor adopts a
+// floating reference as its edge, or adds an edge when the child is already
+// owned by another parent. free_combinator() drops the caller's reference.
+
+typedef void (*edge_visitor)(combinator_t* child);
 
-    if (ast->child) {
-        parser_walk_ast(ast->child, visitor, context);
+// Calls `visit` on every child edge a combinator of a built-in type owns.
+static void for_each_child(combinator_t* comb, edge_visitor visit) {
+    if (comb->args == NULL || (comb->flags & COMB_FLAG_ALIAS)) return;
+    switch (comb->type) {
+        case COMB_EXPECT: visit(((expect_args*)comb->args)->comb); break;
+        case COMB_OPTIONAL: visit(((optional_args*)comb->args)->p); break;
+        case COMB_ERRMAP: visit(((errmap_args*)comb->args)->parser); break;
+        case COMB_MAP: visit(((map_args*)comb->args)->parser); break;
+        case COMB_FLATMAP: visit(((flatMap_args*)comb->args)->parser); break;
+        case COMB_NOT: visit(((not_args*)comb->args)->p); break;
+        case COMB_PEEK: visit(((peek_args*)comb->args)->p); break;
+        case COMB_COMMIT: visit(((commit_args*)comb->args)->p); break;
+        case COMB_SKIP: visit(((skip_args*)comb->args)->p); break;
+        case COMB_SKIP_MANY: visit(((skip_args*)comb->args)->p); break;
+        case COMB_MANY: visit((combinator_t*)comb->args); break;
+        case P_UNTIL: visit(((until_args*)comb->args)->delimiter); break;
+        case COMB_CHAINL1: {
+            chainl1_args* args = (chainl1_args*)comb->args;
+            visit(args->p); visit(args->op);
+            break;
+        }
+        case COMB_SEP_BY: {
+            sep_by_args* args = (sep_by_args*)comb->args;
+            visit(args->p); visit(args->sep);
+            break;
+        }
+        case COMB_SEP_END_BY: {
+            sep_end_by_args* args = (sep_end_by_args*)comb->args;
+            visit(args->p); visit(args->sep);
+            break;
+        }
+        case COMB_BETWEEN: {
+            between_args* args = (between_args*)comb->args;
+            visit(args->open); visit(args->close); visit(args->p);
+            break;
+        }
+        case COMB_LEFT:
+        case COMB_RIGHT: {
+            pair_args* args = (pair_args*)comb->args;
+            visit(args->p1); visit(args->p2);
+            break;
+        }
+        case COMB_GSEQ:
+        case COMB_SEQ:
+        case COMB_MULTI:
+            for (seq_list* l = ((seq_args*)comb->args)->list; l != NULL; l = l->next) visit(l->comb);
+            break;
+        case COMB_EXPR:
+            for (expr_list* l = (expr_list*)comb->args; l != NULL; l = l->next) {
+                if (l->fix == EXPR_BASE) visit(l->comb);
+                for (op_t* op = l->op; op != NULL; op = op->next) visit(op->comb);
+            }
+            break;
+        default:
+            break;
     }
+}
+
+// A parent adopts `child`: the constructor's floating reference becomes the
+// edge, or a new edge is counted when the child already has an owner.
+static void adopt_child(combinator_t* child) {
+    if (child == NULL) return;
+    if (child->floating > 0) child->floating--;
+    else child->refcount++;
+}
 
-    if (ast->next) {
-        parser_walk_ast(ast->next, visitor, context);
+// The caller's reference is consumed without creating an edge (the node it
+// was passed to turned out to exist already).
+static void drop_floating(combinator_t* child) {
+    if (child != NULL && child->floating > 0) {
+        child->floating--;
+        child->refcount--;
     }
 }
 
-typedef struct visited_node { const void* ptr; struct visited_node* next; } visited_node;
+static void release_combinator(combinator_t* comb);
 
-void free_combinator_recursive(combinator_t* comb, visited_node** visited);
+// A node that was adopted before an in-place constructor filled it in may
+// be reachable from its own children. Such loops never reach refcount zero,
+// so the node records how many of its edges come from below and is freed
+// once only those remain. The walk stops at the node and does not follow
+// lazy().
+static combinator_t* cycle_target;
+static int cycle_edges;
 
-bool is_visited(const void* ptr, visited_node* list) {
-    for (visited_node* current = list; current != NULL; current = current->next) {
-        if (current->ptr == ptr) return true;
+static void count_cycle_edges(combinator_t* child) {
+    if (child == NULL) return;
+    if (child == cycle_target) {
+        cycle_edges++;
+        return;
     }
-    return false;
+    if (child->flags & COMB_FLAG_VISITED) return;
+    child->flags |= COMB_FLAG_VISITED;
+    for_each_child(child, count_cycle_edges);
 }
 
-void free_combinator(combinator_t* comb) {
-    visited_node* visited = NULL;
-    free_combinator_recursive(comb, &visited);
-    visited_node* current = visited;
-    while (current != NULL) {
-        visited_node* temp = current;
-        current = current->next;
-        free(temp);
+static void clear_visited(combinator_t* child) {
+    if (child == NULL || !(child->flags & COMB_FLAG_VISITED)) return;
+    child->flags &= ~COMB_FLAG_VISITED;
+    for_each_child(child, clear_visited);
+}
+
+void combinator_note_cycles(combinator_t* comb) {
+    // Only a node referenced before it was built can be its own descendant
+    if (comb->refcount <= comb->floating) return;
+    cycle_target = comb;
+    cycle_edges = 0;
+    for_each_child(comb, count_cycle_edges);
+    for_each_child(comb, clear_visited);
+    cycle_target = NULL;
+    comb->cycle_refs = cycle_edges;
+}
+
+static combinator_t** intern_buckets = NULL;
+static size_t intern_bucket_count = 0;
+static size_t intern_size = 0;
+
+static uint64_t hash_word(uint64_t h, uint64_t v) {
+    h ^= v;
+    h *= 1099511628211ull;
+    return h ^ (h >> 29);
+}
+
+static uint64_t hash_str(uint64_t h, const char* s) {
+    if (s == NULL) return hash_word(h, 0);
+    while (*s) h = hash_word(h, (unsigned char)*s++);
+    return hash_word(h, 0xff);
+}
+
+static uint64_t hash_child(uint64_t h, combinator_t* child) {
+    return hash_word(h, (uint64_t)(uintptr_t)child);
+}
+
+// Computes the structural hash of `comb`. Returns false for combinators
+// that must keep their identity (mutable expr grammars, succeed() which
+// owns its AST, aliases and unknown types).
+static bool intern_hash(combinator_t* comb, unsigned int* out) {
+    if ((comb->flags & COMB_FLAG_ALIAS) || comb->free_args != NULL) return false;
+    uint64_t h = hash_word(1469598103934665603ull, (uint64_t)comb->type);
+    h = hash_word(h, (uint64_t)(uintptr_t)comb->fn);
+    void* a = comb->args;
+    switch (comb->type) {
+        case P_MATCH:
+        case P_CI_KEYWORD:
+            if (a == NULL) return false;
+            h = hash_str(h, ((match_args*)a)->str);
+            break;
+        case P_INTEGER:
+        case P_CIDENT:
+        case P_STRING:
+        case P_ANY_CHAR:
+            if (a == NULL) return false;
+            h = hash_word(h, ((prim_args*)a)->tag);
+            break;
+        case P_SATISFY:
+            h = hash_word(h, (uint64_t)(uintptr_t)((satisfy_args*)a)->pred);
+            h = hash_word(h, ((satisfy_args*)a)->tag);
+            break;
+        case P_SKIP_WHILE:
+            h = hash_word(h, (uint64_t)(uintptr_t)((skip_while_args*)a)->pred);
+            break;
+        case P_UNTIL:
+            h = hash_child(h, ((until_args*)a)->delimiter);
+            h = hash_word(h, ((until_args*)a)->tag);
+            break;
+        case P_EOI:
+            break;
+        case COMB_LAZY:
+            h = hash_word(h, (uint64_t)(uintptr_t)((lazy_args*)a)->parser_ptr);
+            break;
+        case COMB_EXPECT:
+            h = hash_child(h, ((expect_args*)a)->comb);
+            h = hash_str(h, ((expect_args*)a)->msg);
+            break;
+        case COMB_GSEQ:
+        case COMB_SEQ:
+        case COMB_MULTI:
+            h = hash_word(h, ((seq_args*)a)->typ);
+            for (seq_list* l = ((seq_args*)a)->list; l != NULL; l = l->next) h = hash_child(h, l->comb);
+            break;
+        case COMB_FLATMAP:
+            h = hash_child(h, ((flatMap_args*)a)->parser);
+            h = hash_word(h, (uint64_t)(uintptr_t)((flatMap_args*)a)->func);
+            break;
+        case COMB_MAP:
+            h = hash_child(h, ((map_args*)a)->parser);
+            h = hash_word(h, (uint64_t)(uintptr_t)((map_args*)a)->func);
+            break;
+        case COMB_ERRMAP:
+            h = hash_child(h, ((errmap_args*)a)->parser);
+            h = hash_word(h, (uint64_t)(uintptr_t)((errmap_args*)a)->func);
+            break;
+        case COMB_MANY:
+        case COMB_OPTIONAL:
+        case COMB_NOT:
+        case COMB_PEEK:
+        case COMB_COMMIT:
+        case COMB_SKIP:
+        case COMB_SKIP_MANY:
+        case COMB_SEP_BY:
+        case COMB_SEP_END_BY:
+        case COMB_CHAINL1:
+        case COMB_LEFT:
+        case COMB_RIGHT:
+        case COMB_BETWEEN: {
+            // Only child pointers; collect them in edge order.
+            combinator_t* children[3] = {NULL, NULL, NULL};
+            switch (comb->type) {
+                case COMB_MANY: children[0] = (combinator_t*)a; break;
+                case COMB_OPTIONAL: children[0] = ((optional_args*)a)->p; break;
+                case COMB_NOT: children[0] = ((not_args*)a)->p; break;
+                case COMB_PEEK: children[0] = ((peek_args*)a)->p; break;
+                case COMB_COMMIT: children[0] = ((commit_args*)a)->p; break;
+                case COMB_SKIP:
+                case COMB_SKIP_MANY: children[0] = ((skip_args*)a)->p; break;
+                case COMB_SEP_BY: children[0] = ((sep_by_args*)a)->p; children[1] = ((sep_by_args*)a)->sep; break;
+                case COMB_SEP_END_BY: children[0] = ((sep_end_by_args*)a)->p; children[1] = ((sep_end_by_args*)a)->sep; break;
+                case COMB_CHAINL1: children[0] = ((chainl1_args*)a)->p; children[1] = ((chainl1_args*)a)->op; break;
+                case COMB_BETWEEN:
+                    children[0] = ((between_args*)a)->open;
+                    children[1] = ((between_args*)a)->close;
+                    children[2] = ((between_args*)a)->p;
+                    break;
+                default:
+                    children[0] = ((pair_args*)a)->p1; children[1] = ((pair_args*)a)->p2; break;
+            }
+            for (int i = 0; i < 3; i++) h = hash_child(h, children[i]);
+            break;
+        }
+        default:
+            return false;
     }
+    *out = (unsigned int)(h ^ (h >> 32));
+    return true;
 }
 
-void free_combinator_recursive(combinator_t* comb, visited_node** visited) {
-    if (comb == NULL || is_visited(comb, *visited)) return;
-    visited_node* new_visited = (visited_node*)safe_malloc(sizeof(visited_node));
-    new_visited->ptr = comb;
-    new_visited->next = *visited;
-    *visited = new_visited;
+static bool same_str(const char* a, const char* b) {
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
 
-    // Ensure type is valid to avoid uninitialised value warnings
-    if (comb->type >= P_MATCH && comb->type <= COMB_ERRMAP) {
-        // Type is valid, proceed with normal logic
-    } else {
-        // Type is invalid/uninitialised, set to default and free args if present
-        comb->type = P_MATCH;
-        if (comb->args != NULL) {
-            free(comb->args);
-            comb->args = NULL;
+static bool intern_equal(combinator_t* x, combinator_t* y) {
+    if (x->type != y->type || x->fn != y->fn) return false;
+    void* a = x->args;
+    void* b = y->args;
+    switch (x->type) {
+        case P_MATCH:
+        case P_CI_KEYWORD:
+            return same_str(((match_args*)a)->str, ((match_args*)b)->str);
+        case P_INTEGER:
+        case P_CIDENT:
+        case P_STRING:
+        case P_ANY_CHAR:
+            return ((prim_args*)a)->tag == ((prim_args*)b)->tag;
+        case P_SATISFY:
+            return ((satisfy_args*)a)->pred == ((satisfy_args*)b)->pred && ((satisfy_args*)a)->tag == ((satisfy_args*)b)->tag;
+        case P_SKIP_WHILE:
+            return ((skip_while_args*)a)->pred == ((skip_while_args*)b)->pred;
+        case P_UNTIL:
+            return ((until_args*)a)->delimiter == ((until_args*)b)->delimiter && ((until_args*)a)->tag == ((until_args*)b)->tag;
+        case P_EOI:
+            return true;
+        case COMB_LAZY:
+            return ((lazy_args*)a)->parser_ptr == ((lazy_args*)b)->parser_ptr;
+        case COMB_EXPECT:
+            return ((expect_args*)a)->comb == ((expect_args*)b)->comb && same_str(((expect_args*)a)->msg, ((expect_args*)b)->msg);
+        case COMB_GSEQ:
+        case COMB_SEQ:
+        case COMB_MULTI: {
+            if (((seq_args*)a)->typ != ((seq_args*)b)->typ) return false;
+            seq_list* l1 = ((seq_args*)a)->list;
+            seq_list* l2 = ((seq_args*)b)->list;
+            while (l1 != NULL && l2 != NULL && l1->comb == l2->comb) { l1 = l1->next; l2 = l2->next; }
+            return l1 == NULL && l2 == NULL;
         }
-        free(comb);
-        return;
+        case COMB_FLATMAP:
+            return ((flatMap_args*)a)->parser == ((flatMap_args*)b)->parser && ((flatMap_args*)a)->func == ((flatMap_args*)b)->func;
+        case COMB_MAP:
+            return ((map_args*)a)->parser == ((map_args*)b)->parser && ((map_args*)a)->func == ((map_args*)b)->func;
+        case COMB_ERRMAP:
+            return ((errmap_args*)a)->parser == ((errmap_args*)b)->parser && ((errmap_args*)a)->func == ((errmap_args*)b)->func;
+        case COMB_MANY:
+            return a == b;
+        case COMB_OPTIONAL:
+            return ((optional_args*)a)->p == ((optional_args*)b)->p;
+        case COMB_NOT:
+            return ((not_args*)a)->p == ((not_args*)b)->p;
+        case COMB_PEEK:
+            return ((peek_args*)a)->p == ((peek_args*)b)->p;
+        case COMB_COMMIT:
+            return ((commit_args*)a)->p == ((commit_args*)b)->p;
+        case COMB_SKIP:
+        case COMB_SKIP_MANY:
+            return ((skip_args*)a)->p == ((skip_args*)b)->p;
+        case COMB_SEP_BY:
+            return ((sep_by_args*)a)->p == ((sep_by_args*)b)->p && ((sep_by_args*)a)->sep == ((sep_by_args*)b)->sep;
+        case COMB_SEP_END_BY:
+            return ((sep_end_by_args*)a)->p == ((sep_end_by_args*)b)->p && ((sep_end_by_args*)a)->sep == ((sep_end_by_args*)b)->sep;
+        case COMB_CHAINL1:
+            return ((chainl1_args*)a)->p == ((chainl1_args*)b)->p && ((chainl1_args*)a)->op == ((chainl1_args*)b)->op;
+        case COMB_LEFT:
+        case COMB_RIGHT:
+            return ((pair_args*)a)->p1 == ((pair_args*)b)->p1 && ((pair_args*)a)->p2 == ((pair_args*)b)->p2;
+        case COMB_BETWEEN:
+            return ((between_args*)a)->open == ((between_args*)b)->open &&
+                   ((between_args*)a)->close == ((between_args*)b)->close &&
+                   ((between_args*)a)->p == ((between_args*)b)->p;
+        default:
+            return false;
     }
+}
 
-    if (comb->name) {
-        free(comb->name);
-        comb->name = NULL;
+static void intern_grow(void) {
+    size_t count = intern_bucket_count ? intern_bucket_count * 2 : 1024;
+    combinator_t** buckets = (combinator_t**)safe_malloc(sizeof(combinator_t*) * count);
+    memset(buckets, 0, sizeof(combinator_t*) * count);
+    for (size_t i = 0; i < intern_bucket_count; i++) {
+        combinator_t* c = intern_buckets[i];
+        while (c != NULL) {
+            combinator_t* next = c->intern_next;
+            size_t b = c->hash & (count - 1);
+            c->intern_next = buckets[b];
+            buckets[b] = c;
+            c = next;
+        }
     }
-    if (comb->extra_to_free) {
-        free(comb->extra_to_free);
-        comb->extra_to_free = NULL;
+    free(intern_buckets);
+    intern_buckets = buckets;
+    intern_bucket_count = count;
+}
+
+static combinator_t* intern_find(combinator_t* comb, unsigned int hash) {
+    if (intern_bucket_count == 0) return NULL;
+    for (combinator_t* c = intern_buckets[hash & (intern_bucket_count - 1)]; c != NULL; c = c->intern_next) {
+        if (c->hash == hash && intern_equal(c, comb)) return c;
     }
+    return NULL;
+}
 
-    if (comb->args != NULL) {
-        switch (comb->type) {
-            case P_CI_KEYWORD:
-            case P_MATCH:
-                free((match_args*)comb->args);
-                break;
-            case COMB_EXPECT: {
-                expect_args* args = (expect_args*)comb->args;
-                free_combinator_recursive(args->comb, visited);
-                free(args);
-                break;
-            }
-            case COMB_OPTIONAL: {
-                optional_args* args = (optional_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free(args);
-                break;
-            }
-            case COMB_ERRMAP: {
-                errmap_args* args = (errmap_args*)comb->args;
-                free_combinator_recursive(args->parser, visited);
-                free(args);
-                break;
-            }
-            case COMB_MAP: {
-                map_args* args = (map_args*)comb->args;
-                free_combinator_recursive(args->parser, visited);
-                free(args);
-                break;
-            }
-            case P_SUCCEED: {
-                succeed_args* args = (succeed_args*)comb->args;
-                free_ast(args->ast);
-                free(args);
-                break;
-            }
-            case COMB_CHAINL1: {
-                chainl1_args* args = (chainl1_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free_combinator_recursive(args->op, visited);
-                free(args);
-                break;
-            }
-            case COMB_SEP_END_BY: {
-                sep_end_by_args* args = (sep_end_by_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free_combinator_recursive(args->sep, visited);
-                free(args);
-                break;
-            }
-            case COMB_SEP_BY: {
-                sep_by_args* args = (sep_by_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free_combinator_recursive(args->sep, visited);
-                free(args);
-                break;
-            }
-            case COMB_NOT: {
-                not_args* args = (not_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free(args);
-                break;
-            }
-            case COMB_PEEK: {
-                peek_args* args = (peek_args*)comb->args;
-                free_combinator_recursive(args->p, visited);
-                free(args);
-                break;
-            }
-            case COMB_BETWEEN: {
-                between_args* args = (between_args*)comb->args;
-                free_combinator_recursive(args->open, visited);
-                free_combinator_recursive(args->close, visited);
-                free_combinator_recursive(args->p, visited);
-                free(args);
-                break;
-            }
-            case COMB_GSEQ:
-            case COMB_SEQ:
-            case COMB_MULTI: {
-                seq_args* args = (seq_args*)comb->args;
-                seq_list* current = args->list;
-                while (current != NULL) {
-                    free_combinator_recursive(current->comb, visited);
-                    seq_list* temp = current;
-                    current = current->next;
-                    free(temp);
-                }
-                free(args);
-                break;
-            }
-            case COMB_FLATMAP: {
-                flatMap_args* args = (flatMap_args*)comb->args;
-                free_combinator_recursive(args->parser, visited);
-                free(args);
-                break;
-            }
-            case P_UNTIL: {
-                until_args* args = (until_args*)comb->args;
-                free_combinator_recursive(args->delimiter, visited);
-                free(args);
-                break;
-            }
-            case COMB_LAZY: {
-                free((lazy_args*)comb->args);
-                break;
+static void intern_insert(combinator_t* comb, unsigned int hash) {
+    if (intern_size >= intern_bucket_count) intern_grow();
+    size_t b = hash & (intern_bucket_count - 1);
+    comb->hash = hash;
+    comb->intern_next = intern_buckets[b];
+    intern_buckets[b] = comb;
+    comb->flags |= COMB_FLAG_INTERNED;
+    intern_size++;
+}
+
+static void intern_remove(combinator_t* comb) {
+    combinator_t** link = &intern_buckets[comb->hash & (intern_bucket_count - 1)];
+    while (*link != NULL && *link != comb) link = &(*link)->intern_next;
+    if (*link == comb) {
+        *link = comb->intern_next;
+        intern_size--;
+    }
+    comb->flags &= ~COMB_FLAG_INTERNED;
+}
+
+static void free_name(combinator_t* comb) {
+    if (!(comb->flags & COMB_FLAG_STATIC_NAME)) free(comb->name);
+    comb->name = NULL;
+}
+
+// Frees the argument block of a built-in combinator without touching the
+// children it points to.
+static void free_args_shallow(combinator_t* comb) {
+    if (comb->args == NULL) return;
+    if (comb->free_args != NULL) {
+        comb->free_args(comb->args);
+        comb->args = NULL;
+        return;
+    }
+    switch (comb->type) {
+        case COMB_GSEQ:
+        case COMB_SEQ:
+        case COMB_MULTI: {
+            seq_args* args = (seq_args*)comb->args;
+            seq_list* current = args->list;
+            while (current != NULL) {
+                seq_list* temp = current;
+                current = current->next;
+                free(temp);
             }
-            case COMB_EXPR: {
-                expr_list* list = (expr_list*)comb->args;
-                while (list != NULL) {
-                    if (list->fix == EXPR_BASE) {
-                        free_combinator_recursive(list->comb, visited);
-                    }
-                    op_t* op = list->op;
-                    while (op != NULL) {
-                        free_combinator_recursive(op->comb, visited);
-                        op_t* temp_op = op;
-                        op = op->next;
-                        free(temp_op);
-                    }
-                    expr_list* temp_list = list;
-                    list = list->next;
-                    free(temp_list);
+            free(args);
+            break;
+        }
+        case COMB_EXPR: {
+            expr_list* list = (expr_list*)comb->args;
+            while (list != NULL) {
+                op_t* op = list->op;
+                while (op != NULL) {
+                    op_t* temp_op = op;
+                    op = op->next;
+                    free(temp_op);
                 }
-                break;
+                expr_list* temp_list = list;
+                list = list->next;
+                free(temp_list);
             }
-            case P_SATISFY: {
-                free((satisfy_args*)comb->args);
-                break;
-            }
-            case COMB_LEFT:
-            case COMB_RIGHT: {
-                pair_args* args = (pair_args*)comb->args;
-                free_combinator_recursive(args->p1, visited);
-                free_combinator_recursive(args->p2, visited);
-                free(args);
-                break;
-            }
-            case COMB_MANY: {
-                free_combinator_recursive((combinator_t*)comb->args, visited);
-                break;
-            }
-            // P_INTEGER, P_CIDENT, P_STRING, P_ANY_CHAR have NULL args
-            default:
-                break;
+            break;
+        }
+        case P_SUCCEED: {
+            succeed_args* args = (succeed_args*)comb->args;
+            free_ast(args->ast);
+            free(args);
+            break;
+        }
+        case COMB_MANY:
+            // args is the child combinator itself
+            break;
+        default:
+            free(comb->args);
+            break;
+    }
+    comb->args = NULL;
+}
+
+combinator_t* intern_combinator(combinator_t* comb) {
+    unsigned int hash;
+    if (!intern_hash(comb, &hash)) {
+        for_each_child(comb, adopt_child);
+        return comb;
+    }
+    combinator_t* existing = intern_find(comb, hash);
+    if (existing == NULL) {
+        for_each_child(comb, adopt_child);
+        intern_insert(comb, hash);
+        return comb;
+    }
+    for_each_child(comb, drop_floating);
+    free_args_shallow(comb);
+    free_name(comb);
+    free(comb);
+    existing->refcount++;
+    existing->floating++;
+    return existing;
+}
+
+// Variant for constructors that fill in a caller-supplied node (seq, multi,
+// gseq): the caller may hold on to `ret`, so on a hit it becomes an alias
+// that borrows the existing node's fn and args instead of being replaced.
+combinator_t* intern_in_place(combinator_t* ret) {
+    unsigned int hash;
+    if (!intern_hash(ret, &hash)) {
+        for_each_child(ret, adopt_child);
+        combinator_note_cycles(ret);
+        return ret;
+    }
+    combinator_t* existing = intern_find(ret, hash);
+    if (existing == NULL) {
+        for_each_child(ret, adopt_child);
+        combinator_note_cycles(ret);
+        intern_insert(ret, hash);
+        return ret;
+    }
+    for_each_child(ret, drop_floating);
+    free_args_shallow(ret);
+    ret->type = existing->type;
+    ret->fn = existing->fn;
+    ret->args = existing->args;
+    ret->flags |= COMB_FLAG_ALIAS;
+    ret->alias_of = existing;
+    existing->refcount++;
+    return ret;
+}
+
+void combinator_adopt(combinator_t* child) {
+    adopt_child(child);
+}
+
+//=============================================================================
+// COMBINATOR NAMES
+//=============================================================================
+
+// Children nested deeper than this below the named combinator show as "...".
+#define COMBINATOR_NAME_DEPTH 4
+
+typedef struct {
+    char* data;
+    size_t len, cap;
+} name_buf;
+
+static void name_append(name_buf* b, const char* s) {
+    size_t n = strlen(s);
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 64;
+        while (cap < b->len + n + 1) cap *= 2;
+        char* data = realloc(b->data, cap);
+        if (!data) exception("realloc failed");
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n + 1);
+    b->len += n;
+}
+
+static void name_into(name_buf* b, combinator_t* comb, int depth);
+
+// Appends a child's name: explicit names as they are, generated ones rebuilt
+// within the remaining depth, `unnamed` if there is nothing to show.
+static void child_name_into(name_buf* b, combinator_t* child, int depth, const char* unnamed) {
+    if (child == NULL) {
+        name_append(b, unnamed);
+        return;
+    }
+    const char* name = __atomic_load_n(&child->name, __ATOMIC_ACQUIRE);
+    if (name != NULL && !(__atomic_load_n(&child->flags, __ATOMIC_RELAXED) & COMB_FLAG_NAME_GENERATED)) {
+        name_append(b, name);
+        return;
+    }
+    if (depth >= COMBINATOR_NAME_DEPTH) {
+        name_append(b, "...");
+        return;
+    }
+    size_t before = b->len;
+    name_into(b, child, depth + 1);
+    if (b->len == before) name_append(b, unnamed);
+}
+
+static void list_name_into(name_buf* b, const char* prefix, seq_list* list, int depth) {
+    name_append(b, prefix);
+    for (seq_list* l = list; l != NULL; l = l->next) {
+        child_name_into(b, l->comb, depth, "");
+        if (l->next != NULL) name_append(b, ", ");
+    }
+}
+
+// Describes a combinator from its type and children. Leaves `b` untouched
+// for combinators that have no generated name (primitives, expr, custom).
+static void name_into(name_buf* b, combinator_t* comb, int depth) {
+    void* a = comb->args;
+    if (a == NULL) return;
+    const char* u = "unnamed_parser";
+    switch (comb->type) {
+        case COMB_EXPECT:
+            name_append(b, "expect ");
+            child_name_into(b, ((expect_args*)a)->comb, depth, u);
+            break;
+        case COMB_SEQ: list_name_into(b, "sequence of ", ((seq_args*)a)->list, depth); break;
+        case COMB_MULTI: list_name_into(b, "any of ", ((seq_args*)a)->list, depth); break;
+        case COMB_GSEQ: list_name_into(b, "gseq of ", ((seq_args*)a)->list, depth); break;
+        case COMB_FLATMAP:
+            name_append(b, "flatMap over ");
+            child_name_into(b, ((flatMap_args*)a)->parser, depth, u);
+            break;
+        case COMB_LEFT:
+        case COMB_RIGHT:
+            name_append(b, comb->type == COMB_LEFT ? "left of " : "right of ");
+            child_name_into(b, ((pair_args*)a)->p1, depth, u);
+            name_append(b, " and ");
+            child_name_into(b, ((pair_args*)a)->p2, depth, u);
+            break;
+        case COMB_NOT:
+            name_append(b, "not ");
+            child_name_into(b, ((not_args*)a)->p, depth, u);
+            break;
+        case COMB_PEEK:
+            name_append(b, "peek ");
+            child_name_into(b, ((peek_args*)a)->p, depth, u);
+            break;
+        case COMB_COMMIT:
+            name_append(b, "commit ");
+            child_name_into(b, ((commit_args*)a)->p, depth, u);
+            break;
+        case COMB_SKIP:
+        case COMB_SKIP_MANY:
+            name_append(b, comb->type == COMB_SKIP ? "skip " : "skip many ");
+            child_name_into(b, ((skip_args*)a)->p, depth, u);
+            break;
+        case COMB_BETWEEN:
+            name_append(b, "between ");
+            child_name_into(b, ((between_args*)a)->open, depth, u);
+            name_append(b, " and ");
+            child_name_into(b, ((between_args*)a)->close, depth, u);
+            break;
+        case COMB_ERRMAP:
+            name_append(b, "errmap over ");
+            child_name_into(b, ((errmap_args*)a)->parser, depth, u);
+            break;
+        case COMB_MAP:
+            name_append(b, "map over ");
+            child_name_into(b, ((map_args*)a)->parser, depth, u);
+            break;
+        case COMB_SEP_BY:
+            child_name_into(b, ((sep_by_args*)a)->p, depth, u);
+            name_append(b, " separated by ");
+            child_name_into(b, ((sep_by_args*)a)->sep, depth, u);
+            break;
+        case COMB_SEP_END_BY:
+            child_name_into(b, ((sep_end_by_args*)a)->p, depth, u);
+            name_append(b, " separated and ended by ");
+            child_name_into(b, ((sep_end_by_args*)a)->sep, depth, u);
+            break;
+        case COMB_CHAINL1:
+            name_append(b, "chainl1 of ");
+            child_name_into(b, ((chainl1_args*)a)->p, depth, u);
+            name_append(b, " with ");
+            child_name_into(b, ((chainl1_args*)a)->op, depth, u);
+            break;
+        case COMB_MANY:
+            name_append(b, "many ");
+            child_name_into(b, (combinator_t*)a, depth, u);
+            break;
+        case COMB_OPTIONAL:
+            name_append(b, "optional ");
+            child_name_into(b, ((optional_args*)a)->p, depth, u);
+            break;
+        case COMB_LAZY: {
+            // Named after its target; the depth limit stops recursive grammars
+            combinator_t** target = ((lazy_args*)a)->parser_ptr;
+            if (target != NULL && *target != NULL) child_name_into(b, *target, depth, "");
+            break;
         }
+        default:
+            break;
+    }
+}
+
+const char* combinator_name(combinator_t* comb) {
+    if (comb == NULL) return NULL;
+    char* name = __atomic_load_n(&comb->name, __ATOMIC_ACQUIRE);
+    if (name != NULL) return name;
+
+    name_buf b = {0};
+    name_into(&b, comb, 0);
+    if (b.data == NULL) return NULL;
+    if (b.len == 0) {
+        free(b.data);
+        return NULL;
+    }
+    // Cache it; parses sharing the grammar may race to do the same.
+    __atomic_fetch_or(&comb->flags, COMB_FLAG_NAME_GENERATED, __ATOMIC_RELAXED);
+    char* expected = NULL;
+    if (!__atomic_compare_exchange_n(&comb->name, &expected, b.data, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(b.data);
+        return expected;
     }
+    return b.data;
+}
+
+combinator_t* set_combinator_name(combinator_t* comb, const char* name) {
+    if (comb->flags & COMB_FLAG_INTERNED) {
+        if (comb->refcount > 1) {
+            // Shared: name an alias that takes over the caller's reference
+            combinator_t* copy = new_combinator();
+            copy->type = comb->type;
+            copy->fn = comb->fn;
+            copy->args = comb->args;
+            copy->flags = COMB_FLAG_ALIAS;
+            copy->alias_of = comb;
+            adopt_child(comb);
+            comb = copy;
+        } else {
+            // Only the caller has it; later identical builds get their own
+            intern_remove(comb);
+        }
+    }
+    free_name(comb);
+    comb->flags &= ~(COMB_FLAG_STATIC_NAME | COMB_FLAG_NAME_GENERATED);
+    comb->name = name != NULL ? strdup(name) : NULL;
+    return comb;
+}
+
+static void release_combinator(combinator_t* comb) {
+    if (comb == NULL || (comb->flags & COMB_FLAG_RELEASING)) return;
+    if (--comb->refcount > comb->cycle_refs) return;
+    comb->flags |= COMB_FLAG_RELEASING;
+
+    if (comb->flags & COMB_FLAG_INTERNED) intern_remove(comb);
+    if (comb->extra_to_free) {
+        free(comb->extra_to_free);
+        comb->extra_to_free = NULL;
+    }
+    if (comb->flags & COMB_FLAG_ALIAS) {
+        combinator_t* target = comb->alias_of;
+        free_name(comb);
+        free(comb);
+        release_combinator(target);
+        return;
+    }
+
+    // Ensure type is valid to avoid uninitialised value warnings
+    if (comb->type > P_EOI) {
+        // Type is invalid/uninitialised; only the args block can be freed
+        free_args_shallow(comb);
+        free(comb);
+        return;
+    }
+
+    for_each_child(comb, release_combinator);
+    free_args_shallow(comb);
+    free_name(comb);
     free(comb);
 }
+
+void free_combinator(combinator_t* comb) {
+    if (comb == NULL) return;
+    if (comb->floating > 0) comb->floating--;
+    release_combinator(comb);
+}
@@ -8,6 +8,8 @@
 #include <ctype.h>
 #include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 //=============================================================================
 // Public-Facing Structs and Enums
@@ -25,11 +27,16 @@ typedef unsigned int tag_t;
 // --- Argument Structs ---
 typedef struct { tag_t tag; } prim_args;
 
-// Symbol
+// Symbol. The name is stored in the same allocation, NUL-terminated;
+// `length` counts its bytes, which can include NULs decoded from escapes.
 typedef struct sym_t {
    char * name;
+   size_t length;
 } sym_t;
 
+// Decoded value carried by a literal node
+typedef enum { AST_VALUE_NONE, AST_VALUE_INT, AST_VALUE_DOUBLE } ast_value_kind;
+
 // AST node
 struct ast_t {
    tag_t typ;
@@ -38,8 +45,71 @@ struct ast_t {
    sym_t * sym;
    int line;
    int col;
+   ast_value_kind value_kind;
+   bool in_arena;             // owned by an ast_arena_t, see below
+   union { int64_t i; double d; } value;
 };
 
+// Which resource limit cut a parse short
+typedef enum {
+    PARSE_LIMIT_NONE,
+    PARSE_LIMIT_STEPS,
+    PARSE_LIMIT_DEPTH,
+    PARSE_LIMIT_MEMORY,
+    PARSE_LIMIT_CANCELLED
+} parse_limit_kind;
+
+// Per-parse resource limits, attached to an input (input_t.limits). Zero
+// means unlimited. The usage fields are reset whenever a top-level parse()
+// starts on the input and can be read afterwards.
+typedef struct {
+    uint64_t max_steps;       // parse() calls
+    unsigned max_depth;       // nested parse() calls
+    size_t max_bytes;         // bytes requested from safe_malloc
+    atomic_int* cancel;       // optional; any thread may set it non-zero
+    // Usage
+    uint64_t steps;
+    unsigned depth;
+    size_t bytes;
+    parse_limit_kind stopped;
+} parse_limits_t;
+
+// Event-sink parsing (input_t.events): instead of building an AST, tagged
+// seq/multi nodes, expression operators and tagged primitives are reported
+// to a sink as enter/leave/token events. Offsets index the input buffer.
+typedef enum {
+    PARSE_EVENT_ENTER,        // start: where the node begins
+    PARSE_EVENT_LEAVE,        // start..end: the whole node
+    PARSE_EVENT_TOKEN         // start..end: the token's text
+} parse_event_kind;
+
+typedef struct {
+    parse_event_kind kind;
+    tag_t tag;
+    int start;
+    int end;
+} parse_event_t;
+
+typedef void (*parse_event_fn)(const parse_event_t* event, void* context);
+
+struct parse_event_frame;
+
+// Events wait in a journal until no backtrack point that is still live
+// could undo them, then reach the sink in order. Backtracking truncates the
+// journal, so it holds only the current backtrack window; a successful
+// commit() releases everything before it. Set sink/context and zero the
+// rest; the remaining fields are managed by parse().
+typedef struct {
+    parse_event_fn sink;
+    void* context;
+    parse_event_t* journal;
+    size_t count, cap;
+    size_t base;              // events delivered to the sink so far
+    size_t peak;              // largest journal length during the last parse
+    struct parse_event_frame* frames;
+    unsigned depth, frame_cap;
+} parse_events_t;
+
 // Input stream
 struct input_t {
    char * buffer;
@@ -48,6 +118,15 @@ struct input_t {
    int start;
    int line;
    int col;
+   parse_limits_t * limits;   // NULL for unbounded parsing
+   // Recognize-only mode: combinators check the input and report failures
+   // at the same position but build no AST and skip map callbacks; every
+   // success carries ast_nil. Failures carry no message, parser name or
+   // unexpected text, so failed alternatives allocate nothing (see
+   // make_position_failure). Custom parsers should do the same.
+   bool recognize_only;
+   // Event-sink mode; implies recognize_only for the duration of a parse
+   parse_events_t * events;
 };
 
 // --- Parse Result & Error Structs ---
@@ -59,6 +138,12 @@ typedef struct ParseError {
     char* unexpected;
     struct ParseError* cause;
     ast_t* partial_ast;
+    // Raised past a commit() point: enclosing alternatives must not
+    // backtrack over it (see commit in combinators.h; only a commit that is
+    // a direct element of a seq or gseq counts).
+    bool committed;
+    // Set when a parse_limits_t limit stopped the parse rather than the input
+    parse_limit_kind limit;
 } ParseError;
 
 struct ParseResult {
@@ -72,10 +157,11 @@ struct ParseResult {
 // Main parser struct
 typedef enum {
     P_MATCH, P_MATCH_RAW, P_INTEGER, P_CIDENT, P_STRING, P_UNTIL, P_SUCCEED, P_ANY_CHAR, P_SATISFY, P_CI_KEYWORD,
+    P_SKIP_WHILE,
     COMB_EXPECT, COMB_SEQ, COMB_MULTI, COMB_FLATMAP, COMB_MANY, COMB_EXPR,
     COMB_OPTIONAL, COMB_SEP_BY, COMB_LEFT, COMB_RIGHT, COMB_NOT, COMB_PEEK,
     COMB_GSEQ, COMB_BETWEEN, COMB_SEP_END_BY, COMB_CHAINL1, COMB_MAP, COMB_ERRMAP,
-    COMB_LAZY,
+    COMB_LAZY, COMB_COMMIT, COMB_SKIP, COMB_SKIP_MANY,
     P_EOI
 } parser_type_t;
 
@@ -86,9 +172,34 @@ struct combinator_t {
     comb_fn fn;
     void * args;
     void * extra_to_free;
+    // Optional destructor for args, used instead of free() so custom
+    // combinators can own sub-parsers built once at construction time.
+    void (*free_args)(void* args);
+    // Set explicitly, or filled in on demand by combinator_name().
     char* name;
+    // Structural sharing (see intern_combinator). refcount counts parent
+    // edges plus references still held by whoever constructed the node;
+    // floating is how many of those are the latter.
+    int refcount;
+    int floating;
+    // Edges into this node from its own subgraph, made by children that
+    // referred to it before an in-place constructor (seq, multi, gseq, expr)
+    // filled it in. Once only those are left, the cycle is freed.
+    int cycle_refs;
+    unsigned int flags;
+    unsigned int hash;
+    combinator_t* intern_next;
+    combinator_t* alias_of;
 };
 
+// combinator_t flags
+#define COMB_FLAG_INTERNED 0x1u   // registered in the intern table
+#define COMB_FLAG_ALIAS    0x2u   // borrows type/fn/args from alias_of
+#define COMB_FLAG_STATIC_NAME    0x4u   // name is a string literal, not owned
+#define COMB_FLAG_NAME_GENERATED 0x8u   // name was derived by combinator_name()
+#define COMB_FLAG_RELEASING      0x10u  // being freed; edges back to it are ignored
+#define COMB_FLAG_VISITED        0x20u  // marked by a graph walk in progress
+
 // For flatMap
 typedef combinator_t * (*flatMap_func)(ast_t *ast);
 
@@ -109,6 +220,9 @@ ParseResult wrap_failure_with_ast(input_t* in, char* message, ParseResult origin
 //=============================================================================
 
 extern ast_t * ast_nil;
+// Returns ast_nil, allocating it on the heap (never in an arena) first if
+// it is still NULL.
+ast_t* ensure_ast_nil_initialized(void);
 
 
 //=============================================================================
@@ -116,6 +230,9 @@ extern ast_t * ast_nil;
 //=============================================================================
 
 // --- Core Parser Function ---
+// With in->limits set, exceeding a limit (or the cancel flag being set) makes
+// the whole parse fail with error->limit naming the cause; partial results
+// are freed on the way out.
 ParseResult parse(input_t * in, combinator_t * comb);
 
 // --- Primitive Parser Constructors ---
@@ -128,6 +245,9 @@ combinator_t * string(tag_t tag);
 combinator_t * until(combinator_t* p, tag_t tag);
 combinator_t * any_char(tag_t tag);
 combinator_t * satisfy(char_predicate pred, tag_t tag);
+// Consumes characters while `pred` holds; always succeeds with ast_nil and
+// allocates nothing. For whitespace and other trivia.
+combinator_t * skip_while(char_predicate pred);
 combinator_t * eoi();
 
 // --- Combinator Constructors ---
@@ -157,24 +277,115 @@ ast_t* ast1(tag_t typ, ast_t* a1);
 ast_t* ast2(tag_t typ, ast_t* a1, ast_t* a2);
 ast_t* copy_ast(ast_t* orig);
 
+// --- AST Arenas ---
+// While an arena is in use on a thread, new_ast() and symbol allocation on
+// that thread bump-allocate from it and free_ast() leaves its nodes alone;
+// ast_arena_reset() releases all of them at once and keeps the memory for
+// the next parse. For parsing many small inputs in a row. Only switch
+// arenas between parses.
+typedef struct ast_arena ast_arena_t;
+ast_arena_t* new_ast_arena(void);
+void free_ast_arena(ast_arena_t* arena);
+// Makes `arena` (NULL for the heap) current on this thread. Returns the
+// arena that was current before.
+ast_arena_t* ast_arena_use(ast_arena_t* arena);
+void ast_arena_reset(ast_arena_t* arena);
+// Bytes handed out since the last reset
+size_t ast_arena_used(const ast_arena_t* arena);
+
+// --- Literal Values ---
+// integer() and numeric scanners store the value they decoded next to the
+// literal's text. The getters return false if the node has no value of
+// that kind; ast_double_value() also converts integers. Nodes without a
+// payload (built by hand, or rebuilt from a flat or binary image) have
+// their symbol text decoded instead.
+void ast_set_int(ast_t* ast, int64_t value);
+void ast_set_double(ast_t* ast, double value);
+bool ast_int_value(const ast_t* ast, int64_t* out);
+bool ast_double_value(const ast_t* ast, double* out);
+// For scanners: the double for text[0, len), a decimal literal whose
+// significant digits (at most 19) were accumulated into `mantissa` with
+// the decimal exponent `exp10`. `truncated` means non-zero digits did not
+// fit. Exact without re-reading the text whenever the mantissa and the
+// power of ten are both exactly representable; otherwise uses strtod().
+double decimal_to_double(bool negative, uint64_t mantissa, int exp10, bool truncated, const char* text, int len);
+
 // --- Combinator Helpers ---
 combinator_t* new_combinator();
 
 // --- Extensibility Helpers ---
-typedef struct { int start; int line; int col; } InputState;
+typedef struct { int start; int line; int col; size_t mark; } InputState;
 void save_input_state(input_t* in, InputState* state);
+// Also rolls back events journaled since the state was saved.
 void restore_input_state(input_t* in, InputState* state);
+// For custom parsers: reports a token to the input's event sink, if any.
+// Tag 0 is not reported.
+void parse_emit_token(input_t* in, tag_t tag, int start, int end);
+// For error reports: a copy of at most `max` bytes of input from `start`,
+// never reading past in->length (buffers need not be NUL-terminated).
+char* input_excerpt(input_t* in, int start, int max);
+// Decodes the escapes of a string() body src[0, len) (without the quotes)
+// into `out`, which needs at most len bytes; NULL only validates. Returns
+// the decoded length, or -1 with *bad set to the offset of a malformed \u
+// escape.
+long decode_string(const char* src, int len, char* out, int* bad);
 ParseResult make_success(ast_t* ast);
 ParseResult make_failure(input_t* in, char* message);
+// In recognize-only mode make_failure_v2 frees the strings it is given and
+// returns make_position_failure(in), the shared record described below;
+// callers that format a message can return that directly instead.
 ParseResult make_failure_v2(input_t* in, char* parser_name, char* message, char* unexpected);
+// make_failure_v2 with a copy of `message`, made only when it is kept
+ParseResult make_failure_literal(input_t* in, char* parser_name, const char* message);
+// A failure at the current position with nothing else in it. Within a parse
+// this is a shared per-thread record that free_error() leaves alone; the
+// outermost parse() returns an owned copy whose message is "Syntax error.".
+// Only one such failure is live at a time: the next recognize-only failure
+// overwrites it. A custom parser must return or free a sub-failure before
+// running another sub-parse, or keep just the line and col it needs.
+ParseResult make_position_failure(input_t* in);
+// In recognize-only mode both wrap functions return `cause` moved to the
+// current position instead of wrapping it.
 ParseResult wrap_failure(input_t* in, char* message, char* parser_name, ParseResult cause);
 
 // --- Helper Function Prototypes ---
 void* safe_malloc(size_t size);
 sym_t * sym_lookup(const char * name);
+sym_t * sym_lookup_n(const char * name, size_t length);
+
+// --- Combinator Sharing ---
+// Looks up a structurally identical combinator (same type, fn, scalar
+// arguments and child pointers). On a hit `comb` is discarded and the
+// existing node is returned; otherwise `comb` is registered and returned.
+// The built-in constructors already do this; custom combinators may call it
+// when their args have the layout of their declared type.
+combinator_t* intern_combinator(combinator_t* comb);
+
+// --- Combinator Names ---
+// Returns the combinator's name. Built-in combinators that wrap others get a
+// descriptive name ("many optional match") derived from the graph the first
+// time it is asked for, with children beyond a fixed depth shown as "...".
+// parse() only asks for one for the wrappers that name their own failures
+// (not, expect, chainl1); other combinators never build names. May return
+// NULL.
+const char* combinator_name(combinator_t* comb);
+// Gives `comb` its own copy of `name` and returns the node to use from then
+// on. Identical combinators are shared (see intern_combinator), so when
+// other holders have this one the caller's reference moves to a new node
+// that parses the same way, and only that node is named. Assign names this
+// way rather than through comb->name.
+combinator_t* set_combinator_name(combinator_t* comb, const char* name);
 
 // --- Memory Management ---
+// Drops one reference; the combinator and any children it alone kept alive
+// are freed when the last reference goes. A grammar that refers to itself
+// without lazy() (`seq(p, ..., optional(p), NULL)`) is freed together with
+// the in-place node it loops back to, once nothing outside the loop holds
+// that node; nodes on the loop should not be freed separately.
 void free_combinator(combinator_t* comb);
+// Number of combinators allocated so far. Grammars are built up front, so
+// this should not move while parsing.
+size_t combinator_allocation_count(void);
 void exception(const char * err);
 
 
@@ -1,6 +1,8 @@
 #include "acutest.h"
 #include "parser.h"
 #include "combinators.h"
+#include "flat_ast.h"
+#include "ast_binary.h"
 #include <stdio.h>
 
 // Declare wrap_failure_with_ast function
@@ -147,6 +149,23 @@ void test_sep_by_combinator(void) {
     free_ast(res.value.ast);
     free_combinator(p);
     free(input->buffer);
+
+    // A list leading a sequence keeps every element, not just the first
+    input->buffer = strdup("a,b:c");
+    input->length = 5;
+    input->start = 0;
+    p = seq(new_combinator(), TEST_T_NONE, sep_by(cident(TEST_T_IDENT), match(",")), match(":"), cident(TEST_T_IDENT), NULL);
+    res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    ast = res.value.ast;
+    TEST_ASSERT(strcmp(ast->sym->name, "a") == 0);
+    ast = ast->next;
+    TEST_ASSERT(ast != NULL && strcmp(ast->sym->name, "b") == 0);
+    ast = ast->next;
+    TEST_ASSERT(ast != NULL && strcmp(ast->sym->name, "c") == 0);
+    free_ast(res.value.ast);
+    free_combinator(p);
+    free(input->buffer);
     free(input);
 }
 
@@ -291,6 +310,215 @@ void test_satisfy_combinator(void) {
     free(input);
 }
 
+static bool is_space_predicate(char c) {
+    return isspace((unsigned char)c);
+}
+
+void test_skip_combinators(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = TEST_T_NONE;
+    }
+    const char* text = "  \n\t 12 34  x";
+    input_t* input = new_input();
+    input->buffer = strdup(text);
+    input->length = strlen(text);
+    parse_limits_t usage = {0};
+    input->limits = &usage;
+
+    combinator_t* ws = skip_while(is_space_predicate);
+    ParseResult res = parse(input, ws);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(input->start == 5);
+    TEST_CHECK(input->line == 2 && input->col == 3);
+    TEST_CHECK(usage.bytes == 0);
+
+    // The skipped parsers build nothing; only the error of the attempt that
+    // ends the loop is allocated, however much was skipped before it.
+    combinator_t* numbers = skip_many(seq(new_combinator(), TEST_T_ADD,
+        integer(TEST_T_INT), ws, NULL));
+    res = parse(input, numbers);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(input->buffer[input->start] == 'x');
+    TEST_CHECK(!input->recognize_only);
+    size_t few_bytes = usage.bytes;
+    const char* longer = "1 2 3 4 5 6 7 8 9 10 11 12 x";
+    input_t* other = new_input();
+    other->buffer = strdup(longer);
+    other->length = strlen(longer);
+    other->limits = &usage;
+    res = parse(other, numbers);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(usage.bytes == few_bytes);
+    TEST_MSG("2 numbers: %zu bytes, 12 numbers: %zu bytes", few_bytes, usage.bytes);
+    free(other->buffer);
+    free(other);
+
+    combinator_t* ident = skip(cident(TEST_T_IDENT));
+    res = parse(input, ident);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(input->start == input->length);
+    res = parse(input, ident);
+    TEST_CHECK(!res.is_success);
+    free_error(res.value.error);
+
+    // skip_while always succeeds; skip_many stops on a zero-width match
+    combinator_t* loop = skip_many(ws);
+    res = parse(input, loop);
+    TEST_CHECK(res.is_success);
+
+    free_combinator(loop);
+    free_combinator(ident);
+    free_combinator(numbers);
+    free(input->buffer);
+    free(input);
+}
+
+// Parses `text` with until(delimiter) and checks where it stopped.
+static void check_until(combinator_t* p, const char* text, const char* expected, int line, int col) {
+    input_t* input = new_input();
+    input->buffer = strdup(text);
+    input->length = strlen(text);
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(strcmp(res.value.ast->sym->name, expected) == 0);
+    TEST_MSG("consumed '%s', expected '%s'", res.value.ast->sym->name, expected);
+    TEST_CHECK(input->line == line && input->col == col);
+    TEST_MSG("stopped at %d:%d, expected %d:%d", input->line, input->col, line, col);
+    free_ast(res.value.ast);
+    free(input->buffer);
+    free(input);
+}
+
+void test_until_combinator(void) {
+    const char* comment = "a {b}\n  c\n *)rest";
+    // Literal delimiters take the search path; expect() forces the
+    // general one. Both must stop at the same place.
+    combinator_t* fast = until(match("*)"), TEST_T_IDENT);
+    combinator_t* slow = until(expect(match("*)"), "end of comment"), TEST_T_IDENT);
+    check_until(fast, comment, "a {b}\n  c\n ", 3, 2);
+    check_until(slow, comment, "a {b}\n  c\n ", 3, 2);
+    check_until(fast, "no end\nhere", "no end\nhere", 2, 5);
+    check_until(slow, "no end\nhere", "no end\nhere", 2, 5);
+    check_until(fast, "*)", "", 1, 1);
+
+    combinator_t* ci = until(match_ci("end"), TEST_T_IDENT);
+    check_until(ci, "mov ax, 1\nEnD;", "mov ax, 1\n", 2, 1);
+    check_until(ci, "e en eNd", "e en ", 1, 6);
+    check_until(ci, "en", "en", 1, 3);
+
+    free_combinator(fast);
+    free_combinator(slow);
+    free_combinator(ci);
+}
+
+void test_integer_payload(void) {
+    combinator_t* p = integer(TEST_T_INT);
+    const char* texts[] = { "0", "42", "9223372036854775807", "9223372036854775808" };
+    for (int i = 0; i < 4; i++) {
+        input_t* input = new_input();
+        input->buffer = strdup(texts[i]);
+        input->length = strlen(texts[i]);
+        ParseResult res = parse(input, p);
+        TEST_ASSERT(res.is_success);
+        TEST_CHECK(strcmp(res.value.ast->sym->name, texts[i]) == 0);
+        TEST_CHECK(input->col == (int)strlen(texts[i]) + 1);
+        int64_t v = -1;
+        if (i < 3) {
+            TEST_CHECK(res.value.ast->value_kind == AST_VALUE_INT);
+            TEST_CHECK(ast_int_value(res.value.ast, &v) && v == strtoll(texts[i], NULL, 10));
+            ast_t* copy = copy_ast(res.value.ast);
+            TEST_CHECK(ast_int_value(copy, &v) && v == strtoll(texts[i], NULL, 10));
+            free_ast(copy);
+        } else {
+            // Overflow: no payload, and the text does not fit either
+            TEST_CHECK(res.value.ast->value_kind == AST_VALUE_NONE);
+            TEST_CHECK(!ast_int_value(res.value.ast, &v));
+        }
+        free_ast(res.value.ast);
+        free(input->buffer);
+        free(input);
+    }
+    free_combinator(p);
+
+    // Nodes built without a payload decode their text
+    ast_t* node = new_ast();
+    node->sym = sym_lookup("-17");
+    int64_t v = 0;
+    double d = 0;
+    TEST_CHECK(ast_int_value(node, &v) && v == -17);
+    TEST_CHECK(ast_double_value(node, &d) && d == -17.0);
+    ast_set_double(node, 2.5);
+    TEST_CHECK(!ast_int_value(node, &v));
+    TEST_CHECK(ast_double_value(node, &d) && d == 2.5);
+    free_ast(node);
+}
+
+void test_ast_arena(void) {
+    if (ast_nil == NULL) {
+        ast_nil = new_ast();
+        ast_nil->typ = TEST_T_NONE;
+    }
+    combinator_t* p = many(right(skip_while(is_space_predicate), string(TEST_T_IDENT)));
+    char text[] = "\"one\" \"two\" \"th\\u0072ee\" \"four\"";
+    input_t* input = new_input();
+
+    ast_arena_t* arena = new_ast_arena();
+    TEST_CHECK(ast_arena_use(arena) == NULL);
+    size_t used[2];
+    for (int round = 0; round < 2; round++) {
+        init_input_buffer(input, text, (int)strlen(text));
+        ParseResult res = parse(input, p);
+        TEST_ASSERT(res.is_success);
+        int count = 0;
+        for (ast_t* node = res.value.ast; node != NULL && node != ast_nil; node = node->next) {
+            TEST_CHECK(node->in_arena);
+            count++;
+        }
+        TEST_CHECK(count == 4);
+        TEST_CHECK(strcmp(res.value.ast->next->next->sym->name, "three") == 0);
+        // A no-op for arena nodes
+        free_ast(res.value.ast);
+        used[round] = ast_arena_used(arena);
+        TEST_CHECK(used[round] >= 4 * sizeof(ast_t));
+        ast_arena_reset(arena);
+        TEST_CHECK(ast_arena_used(arena) == 0);
+    }
+    TEST_CHECK(used[0] == used[1]);
+    TEST_CHECK(!ast_nil->in_arena);
+
+    // Nodes allocated after switching back come from the heap again
+    TEST_CHECK(ast_arena_use(NULL) == arena);
+    ast_t* node = new_ast();
+    TEST_CHECK(!node->in_arena);
+    free_ast(node);
+
+    free_ast_arena(arena);
+    free(input);
+    free_combinator(p);
+
+    // An ast_nil first needed during an arena parse outlives the arena.
+    ast_t* saved_nil = ast_nil;
+    ast_nil = NULL;
+    combinator_t* opt = optional(match("x"));
+    input = new_input();
+    init_input_buffer(input, "y", 1);
+    arena = new_ast_arena();
+    ast_arena_use(arena);
+    ParseResult res = parse(input, opt);
+    ast_arena_use(NULL);
+    free_ast_arena(arena);
+    TEST_ASSERT(res.is_success && res.value.ast == ast_nil);
+    TEST_CHECK(!ast_nil->in_arena);
+    free(ast_nil);
+    ast_nil = saved_nil;
+    free(input);
+    free_combinator(opt);
+}
+
 void test_partial_ast_functionality(void) {
     input_t* input = new_input();
     input->buffer = strdup("invalid input");
@@ -458,6 +686,648 @@ void test_expression_parser_behavior(void) {
     free(input);
 }
 
+static int ast_equal(ast_t* a, ast_t* b) {
+    while (a != NULL && b != NULL && a != ast_nil && b != ast_nil) {
+        if (a->typ != b->typ || a->line != b->line || a->col != b->col) return 0;
+        if ((a->sym == NULL) != (b->sym == NULL)) return 0;
+        if (a->sym && strcmp(a->sym->name, b->sym->name) != 0) return 0;
+        if (!ast_equal(a->child, b->child)) return 0;
+        a = a->next;
+        b = b->next;
+    }
+    return a == b;
+}
+
+void test_flat_ast_round_trip(void) {
+    input_t* input = new_input();
+    input->buffer = strdup("1+2*x-y/3");
+    input->length = strlen(input->buffer);
+
+    combinator_t* expr_parser = new_combinator();
+    combinator_t* factor = multi(new_combinator(), TEST_T_NONE,
+        integer(TEST_T_INT),
+        cident(TEST_T_IDENT),
+        NULL
+    );
+    expr(expr_parser, factor);
+    expr_insert(expr_parser, 0, TEST_T_ADD, EXPR_INFIX, ASSOC_LEFT, match("+"));
+    expr_altern(expr_parser, 0, TEST_T_SUB, match("-"));
+    expr_insert(expr_parser, 1, TEST_T_MUL, EXPR_INFIX, ASSOC_LEFT, match("*"));
+    expr_altern(expr_parser, 1, TEST_T_DIV, match("/"));
+
+    ParseResult result = parse(input, expr_parser);
+    TEST_ASSERT(result.is_success);
+    ast_t* ast = result.value.ast;
+
+    flat_ast_t* fa = flat_ast_from_ast(ast);
+    // SUB(ADD(1, MUL(2, x)), DIV(y, 3))
+    TEST_ASSERT(fa->count == 9);
+    TEST_ASSERT(fa->tag[fa->root] == TEST_T_SUB);
+    TEST_ASSERT(fa->parent[fa->root] == FLAT_AST_NONE);
+    flat_index_t add = flat_ast_child(fa, fa->root);
+    TEST_ASSERT(fa->tag[add] == TEST_T_ADD);
+    TEST_ASSERT(fa->parent[add] == fa->root);
+    flat_index_t div = fa->next_sibling[add];
+    TEST_ASSERT(fa->tag[div] == TEST_T_DIV);
+    TEST_ASSERT(strcmp(flat_ast_name(fa, flat_ast_child(fa, div)), "y") == 0);
+
+    ast_t* rebuilt = flat_ast_to_ast(fa);
+    TEST_ASSERT(ast_equal(ast, rebuilt));
+
+    // Appending builds sibling lists in order.
+    flat_ast_t* built = new_flat_ast();
+    flat_index_t root = flat_ast_append(built, FLAT_AST_NONE, TEST_T_ADD, NULL, 1, 1);
+    flat_ast_append(built, root, TEST_T_INT, "1", 1, 1);
+    flat_ast_append(built, root, TEST_T_INT, "2", 1, 5);
+    TEST_ASSERT(built->count == 3);
+    TEST_ASSERT(strcmp(flat_ast_name(built, built->next_sibling[flat_ast_child(built, root)]), "2") == 0);
+
+    free_flat_ast(built);
+    free_flat_ast(fa);
+    free_ast(rebuilt);
+    free_ast(ast);
+    free_combinator(expr_parser);
+    free(input->buffer);
+    free(input);
+}
+
+void test_embedded_nul_round_trip(void) {
+    // A string literal that decoded a \u0000 keeps its full length.
+    ast_t* node = new_ast();
+    node->typ = TEST_T_IDENT;
+    node->sym = sym_lookup_n("a\0b", 3);
+    ast_t* other = new_ast();
+    other->typ = TEST_T_IDENT;
+    other->sym = sym_lookup_n("a", 1);
+    node->next = other;
+
+    flat_ast_t* fa = flat_ast_from_ast(node);
+    TEST_CHECK(flat_ast_name_length(fa, 0) == 3 && memcmp(flat_ast_name(fa, 0), "a\0b", 3) == 0);
+    ast_t* rebuilt = flat_ast_to_ast(fa);
+    TEST_CHECK(rebuilt->sym->length == 3 && memcmp(rebuilt->sym->name, "a\0b", 3) == 0);
+    TEST_CHECK(rebuilt->next->sym->length == 1);
+    free_ast(rebuilt);
+    free_flat_ast(fa);
+
+    FILE* out = tmpfile();
+    TEST_ASSERT(out != NULL);
+    TEST_ASSERT(ast_binary_write(out, node, NULL) == 0);
+    size_t size = (size_t)ftell(out);
+    uint64_t* image = (uint64_t*)safe_malloc(size + 8);
+    rewind(out);
+    TEST_ASSERT(fread(image, 1, size, out) == size);
+    fclose(out);
+    ast_image_t img;
+    TEST_ASSERT(ast_image_open(&img, image, size) == 0);
+    // "a" is not taken for the prefix of "a\0b".
+    TEST_CHECK(img.nodes[0].name != img.nodes[1].name);
+    TEST_CHECK(ast_image_name_length(&img, 0) == 3 && ast_image_name_length(&img, 1) == 1);
+    ast_t* loaded = ast_image_to_ast(&img);
+    TEST_CHECK(loaded->sym->length == 3 && memcmp(loaded->sym->name, "a\0b", 3) == 0);
+    TEST_CHECK(loaded->next->sym->length == 1 && strcmp(loaded->next->sym->name, "a") == 0);
+    free_ast(loaded);
+    free(image);
+    free_ast(node);
+}
+
+void test_combinator_interning(void) {
+    // Identical primitives and combinators are built once.
+    combinator_t* a1 = match("a");
+    combinator_t* a2 = match("a");
+    combinator_t* b = match("b");
+    TEST_ASSERT(a1 == a2);
+    TEST_ASSERT(a1 != b);
+    combinator_t* many1 = many(a1);
+    combinator_t* many2 = many(a2);
+    TEST_ASSERT(many1 == many2);
+
+    // Caller-supplied nodes keep their identity but share the subgraph.
+    combinator_t* s1 = seq(new_combinator(), TEST_T_NONE, match("x"), integer(TEST_T_INT), NULL);
+    combinator_t* s2 = seq(new_combinator(), TEST_T_NONE, match("x"), integer(TEST_T_INT), NULL);
+    TEST_ASSERT(s1 != s2);
+    TEST_ASSERT(s1->args == s2->args);
+    TEST_ASSERT(strcmp(combinator_name(s1), combinator_name(s2)) == 0);
+
+    // Releasing one owner leaves the shared parts usable by the other.
+    free_combinator(s1);
+    free_combinator(many1);
+    input_t* input = new_input();
+    input->buffer = strdup("x42aa");
+    input->length = strlen(input->buffer);
+    ParseResult res = parse(input, s2);
+    TEST_ASSERT(res.is_success);
+    TEST_ASSERT(res.value.ast->typ == TEST_T_INT);
+    free_ast(res.value.ast);
+    res = parse(input, many2);
+    TEST_ASSERT(res.is_success);
+    TEST_ASSERT(input->start == input->length);
+
+    free_combinator(s2);
+    free_combinator(many2);
+    free_combinator(b);
+    free(input->buffer);
+    free(input);
+}
+
+void test_self_referencing_grammar(void) {
+    // A sequence that refers to itself without lazy()
+    combinator_t* p = new_combinator();
+    seq(p, TEST_T_NONE, match("a"), optional(p), NULL);
+    input_t* input = new_input();
+    input->buffer = strdup("aab");
+    input->length = strlen(input->buffer);
+    ParseResult res = parse(input, p);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == 2);
+    free_ast(res.value.ast);
+    free_combinator(p);
+
+    // The same loop owned by a parent goes with the parent
+    p = new_combinator();
+    seq(p, TEST_T_NONE, match("a"), optional(p), NULL);
+    combinator_t* root = many(p);
+    free_combinator(root);
+
+    // Two sequences that refer to each other
+    combinator_t* x = new_combinator();
+    combinator_t* y = new_combinator();
+    seq(x, TEST_T_NONE, match("x"), optional(y), NULL);
+    seq(y, TEST_T_NONE, match("y"), optional(x), NULL);
+    input->start = 0;
+    free(input->buffer);
+    input->buffer = strdup("xyx");
+    input->length = strlen(input->buffer);
+    res = parse(input, x);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == input->length);
+    free_ast(res.value.ast);
+    free_combinator(x);
+
+    free(input->buffer);
+    free(input);
+}
+
+void test_combinator_names(void) {
+    // Names are not built with the grammar or on successful parses.
+    combinator_t* c = optional(many(seq(new_combinator(), TEST_T_NONE, match("n1"), integer(TEST_T_INT), NULL)));
+    TEST_ASSERT(c->name == NULL);
+    input_t* input = new_input();
+    input->buffer = strdup("n17n18");
+    input->length = strlen(input->buffer);
+    ParseResult res = parse(input, c);
+    TEST_ASSERT(res.is_success);
+    TEST_ASSERT(c->name == NULL);
+    free_ast(res.value.ast);
+    TEST_CHECK(strcmp(combinator_name(c), "optional many sequence of match, integer") == 0);
+    TEST_ASSERT(combinator_name(c) == c->name);
+
+    // Deep children are truncated.
+    combinator_t* deep = match("deep");
+    for (int i = 0; i < 10; i++) deep = optional(deep);
+    TEST_CHECK(strcmp(combinator_name(deep), "optional optional optional optional optional ...") == 0);
+
+    // Explicit names are kept and used by parents.
+    combinator_t* e = set_combinator_name(many(match("ex")), "ex list");
+    combinator_t* outer = optional(e);
+    TEST_CHECK(strcmp(combinator_name(e), "ex list") == 0);
+    TEST_CHECK(strcmp(combinator_name(outer), "optional ex list") == 0);
+
+    // Naming one combinator leaves identical ones alone, whether they were
+    // built before or after it.
+    combinator_t* before = many(match("ex"));
+    combinator_t* named = set_combinator_name(many(match("ex")), "other list");
+    combinator_t* after = many(match("ex"));
+    TEST_CHECK(named != before && named != after && named != e);
+    TEST_CHECK(strcmp(combinator_name(before), "many match") == 0);
+    TEST_CHECK(strcmp(combinator_name(after), "many match") == 0);
+    TEST_CHECK(strcmp(combinator_name(named), "other list") == 0);
+    TEST_CHECK(strcmp(combinator_name(e), "ex list") == 0);
+    combinator_t* primitive = set_combinator_name(match("ex"), "ex keyword");
+    TEST_CHECK(strcmp(combinator_name(primitive), "ex keyword") == 0);
+    combinator_t* keyword = match("ex");
+    TEST_CHECK(keyword != primitive && strcmp(combinator_name(keyword), "match") == 0);
+    free(input->buffer);
+    input->buffer = strdup("exex");
+    input->length = strlen(input->buffer);
+    input->start = 0;
+    res = parse(input, named);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == input->length);
+    free_ast(res.value.ast);
+    free_combinator(before);
+    free_combinator(named);
+    free_combinator(after);
+    free_combinator(primitive);
+    free_combinator(keyword);
+
+    // Wrappers that report their own failures label them with the generated
+    // name; failures passed up through other combinators are not renamed.
+    combinator_t* n = pnot(match("pn"));
+    free(input->buffer);
+    input->buffer = strdup("pn");
+    input->length = strlen(input->buffer);
+    input->start = 0;
+    res = parse(input, n);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->parser_name != NULL && strcmp(res.value.error->parser_name, "not match") == 0);
+    free_error(res.value.error);
+    combinator_t* s = seq(new_combinator(), TEST_T_NONE, match("p"), match("q"), NULL);
+    input->start = 0;
+    res = parse(input, s);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->parser_name == NULL);
+    TEST_CHECK(s->name == NULL);
+    free_error(res.value.error);
+
+    free_combinator(c);
+    free_combinator(deep);
+    free_combinator(outer);
+    free_combinator(n);
+    free_combinator(s);
+    free(input->buffer);
+    free(input);
+}
+
+void test_commit_combinator(void) {
+    input_t* input = new_input();
+    input->buffer = strdup("ac");
+    input->length = strlen(input->buffer);
+
+    // Without a cut the second alternative is tried.
+    combinator_t* plain = multi(new_combinator(), TEST_T_NONE,
+        seq(new_combinator(), TEST_T_NONE, match("a"), match("b"), NULL),
+        seq(new_combinator(), TEST_T_NONE, match("a"), match("c"), NULL),
+        NULL);
+    ParseResult res = parse(input, plain);
+    TEST_ASSERT(res.is_success);
+    free_ast(res.value.ast);
+
+    // Past the cut, multi, optional and many report the failure instead.
+    combinator_t* committed = seq(new_combinator(), TEST_T_NONE, commit(match("a")), match("b"), NULL);
+    combinator_t* cut = multi(new_combinator(), TEST_T_NONE,
+        committed,
+        seq(new_combinator(), TEST_T_NONE, match("a"), match("c"), NULL),
+        NULL);
+    input->start = 0;
+    res = parse(input, cut);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->committed);
+    free_error(res.value.error);
+
+    combinator_t* opt = optional(committed);
+    input->start = 0;
+    res = parse(input, opt);
+    TEST_CHECK(!res.is_success);
+    if (!res.is_success) free_error(res.value.error);
+
+    combinator_t* rep = many(committed);
+    free(input->buffer);
+    input->buffer = strdup("abac");
+    input->length = strlen(input->buffer);
+    input->start = 0;
+    res = parse(input, rep);
+    TEST_CHECK(!res.is_success);
+    if (!res.is_success) free_error(res.value.error);
+
+    // A failure of the committed parser itself still backtracks.
+    input->start = 2;
+    input->buffer[2] = 'x';
+    res = parse(input, opt);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == 2);
+
+    // chainl1 reports a committed failure of its operator too.
+    combinator_t* chain = chainl1(integer(TEST_T_INT),
+        seq(new_combinator(), TEST_T_ADD, commit(match("+")), match("+"), NULL));
+    free(input->buffer);
+    input->buffer = strdup("1++2+3");
+    input->length = strlen(input->buffer);
+    input->start = 0;
+    res = parse(input, chain);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->committed);
+    free_error(res.value.error);
+    input->buffer[4] = '-';
+    input->start = 0;
+    res = parse(input, chain);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == 4 && res.value.ast->typ == TEST_T_ADD);
+    free_ast(res.value.ast);
+
+    free_combinator(plain);
+    free_combinator(cut);
+    free_combinator(opt);
+    free_combinator(rep);
+    free_combinator(chain);
+    free(input->buffer);
+    free(input);
+}
+
+void test_parse_limits(void) {
+    // nest := "(" nest ")" | "x"
+    combinator_t* nest = new_combinator();
+    multi(nest, TEST_T_NONE,
+        seq(new_combinator(), TEST_T_NONE, match("("), lazy(&nest), match(")"), NULL),
+        match("x"),
+        NULL);
+
+    input_t* input = new_input();
+    size_t n = 200;
+    input->buffer = safe_malloc(2 * n + 2);
+    memset(input->buffer, '(', n);
+    input->buffer[n] = 'x';
+    memset(input->buffer + n + 1, ')', n);
+    input->buffer[2 * n + 1] = '\0';
+    input->length = 2 * n + 1;
+
+    parse_limits_t limits = {0};
+    input->limits = &limits;
+    ParseResult res = parse(input, nest);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(limits.stopped == PARSE_LIMIT_NONE);
+    TEST_CHECK(limits.steps > n && limits.depth == 0 && limits.bytes > 0);
+    free_ast(res.value.ast);
+
+    struct { parse_limits_t limits; parse_limit_kind expected; } cases[] = {
+        { { .max_depth = 50 }, PARSE_LIMIT_DEPTH },
+        { { .max_steps = 100 }, PARSE_LIMIT_STEPS },
+        { { .max_bytes = limits.bytes / 2 }, PARSE_LIMIT_MEMORY },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        input->limits = &cases[i].limits;
+        input->start = 0;
+        res = parse(input, nest);
+        TEST_ASSERT(!res.is_success);
+        TEST_CHECK(res.value.error->limit == cases[i].expected);
+        TEST_CHECK(cases[i].limits.stopped == cases[i].expected);
+        TEST_CHECK(cases[i].limits.depth == 0);
+        free_error(res.value.error);
+    }
+
+    // Cancellation, then a fresh budget on the next parse
+    atomic_int cancel = 1;
+    parse_limits_t cancellable = { .cancel = &cancel };
+    input->limits = &cancellable;
+    input->start = 0;
+    res = parse(input, nest);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->limit == PARSE_LIMIT_CANCELLED);
+    free_error(res.value.error);
+    atomic_store(&cancel, 0);
+    input->start = 0;
+    res = parse(input, nest);
+    TEST_ASSERT(res.is_success);
+    free_ast(res.value.ast);
+
+    // Ordinary syntax errors are not limit failures
+    input->buffer[n] = 'y';
+    input->start = 0;
+    res = parse(input, nest);
+    TEST_ASSERT(!res.is_success);
+    TEST_CHECK(res.value.error->limit == PARSE_LIMIT_NONE);
+    free_error(res.value.error);
+
+    free_combinator(nest);
+    free(input->buffer);
+    free(input);
+}
+
+static void count_nodes(ast_t* node, void* context) {
+    (void)node;
+    (*(size_t*)context)++;
+}
+
+void test_deep_input(void) {
+    // Far deeper than the C stack could take one frame chain per level
+    combinator_t* nest = new_combinator();
+    multi(nest, TEST_T_NONE,
+        seq(new_combinator(), TEST_T_INT, match("("), lazy(&nest), match(")"), NULL),
+        integer(TEST_T_INT),
+        NULL);
+
+    input_t* input = new_input();
+    size_t n = 50000;
+    input->buffer = safe_malloc(2 * n + 2);
+    memset(input->buffer, '(', n);
+    input->buffer[n] = '1';
+    memset(input->buffer + n + 1, ')', n);
+    input->buffer[2 * n + 1] = '\0';
+    input->length = 2 * n + 1;
+
+    ParseResult res = parse(input, nest);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(input->start == input->length);
+
+    ast_t* copy = copy_ast(res.value.ast);
+    size_t count = 0;
+    parser_walk_ast(copy, count_nodes, &count);
+    TEST_CHECK(count == n + 1);
+    TEST_MSG("counted %zu nodes", count);
+    free_ast(copy);
+    free_ast(res.value.ast);
+
+    // A long sibling chain, as statement lists build
+    ast_t* list = NULL;
+    for (size_t i = 0; i < 1000000; i++) {
+        ast_t* node = new_ast();
+        node->typ = TEST_T_INT;
+        node->next = list;
+        list = node;
+    }
+    count = 0;
+    parser_walk_ast(list, count_nodes, &count);
+    TEST_CHECK(count == 1000000);
+    copy = copy_ast(list);
+    free_ast(list);
+    free_ast(copy);
+
+    free_combinator(nest);
+    free(input->buffer);
+    free(input);
+}
+
+static int map_calls = 0;
+
+static ast_t* count_map_calls(ast_t* ast) {
+    map_calls++;
+    return ast;
+}
+
+void test_recognize_only(void) {
+    combinator_t* expr_parser = new_combinator();
+    combinator_t* factor = multi(new_combinator(), TEST_T_NONE,
+        integer(TEST_T_INT),
+        cident(TEST_T_IDENT),
+        NULL
+    );
+    expr(expr_parser, factor);
+    expr_insert(expr_parser, 0, TEST_T_ADD, EXPR_INFIX, ASSOC_LEFT, match("+"));
+    expr_altern(expr_parser, 0, TEST_T_SUB, match("-"));
+    expr_insert(expr_parser, 1, TEST_T_MUL, EXPR_INFIX, ASSOC_LEFT, match("*"));
+    combinator_t* list = seq(new_combinator(), TEST_T_NONE,
+        match("["),
+        sep_by(map(expr_parser, count_map_calls), match(",")),
+        match("]"),
+        NULL);
+
+    const char* valid = "[1+2*x,3-4,y,5*6*7]";
+    input_t* input = new_input();
+    input->buffer = strdup(valid);
+    input->length = strlen(valid);
+    parse_limits_t usage = {0};
+    input->limits = &usage;
+
+    ParseResult res = parse(input, list);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(map_calls == 4);
+    size_t full_bytes = usage.bytes;
+    free_ast(res.value.ast);
+
+    map_calls = 0;
+    input->start = 0;
+    input->recognize_only = true;
+    res = parse(input, list);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(input->start == input->length);
+    TEST_CHECK(map_calls == 0);
+    // Failed alternatives included, nothing is allocated
+    TEST_CHECK(usage.bytes == 0);
+    TEST_MSG("recognize: %zu bytes, full: %zu bytes", usage.bytes, full_bytes);
+    free(input->buffer);
+
+    // Failures are reported where a full parse reports them
+    const char* invalid = "[1+2*x,\n3-,y]";
+    input->buffer = strdup(invalid);
+    input->length = strlen(invalid);
+    int line[2], col[2];
+    for (int mode = 0; mode < 2; mode++) {
+        input->start = 0;
+        input->line = 1;
+        input->col = 1;
+        input->recognize_only = mode == 1;
+        res = parse(input, list);
+        TEST_ASSERT(!res.is_success);
+        line[mode] = res.value.error->line;
+        col[mode] = res.value.error->col;
+        free_error(res.value.error);
+    }
+    TEST_CHECK(line[0] == line[1] && col[0] == col[1]);
+    TEST_MSG("full %d:%d, recognize %d:%d", line[0], col[0], line[1], col[1]);
+
+    free_combinator(list);
+    free(input->buffer);
+    free(input);
+}
+
+typedef struct {
+    const char* buffer;
+    char out[256];
+    size_t len;
+    size_t events;
+} event_trace;
+
+static const char* test_tag_name(tag_t tag) {
+    switch (tag) {
+        case TEST_T_ADD: return "ADD";
+        case TEST_T_SUB: return "SUB";
+        case TEST_T_MUL: return "MUL";
+        default: return "?";
+    }
+}
+
+// Renders events as an s-expression: (ADD 1 (MUL 2 3))
+static void trace_event(const parse_event_t* event, void* context) {
+    event_trace* t = (event_trace*)context;
+    t->events++;
+    char piece[64];
+    switch (event->kind) {
+        case PARSE_EVENT_ENTER:
+            snprintf(piece, sizeof(piece), "%s(%s", t->len && t->out[t->len - 1] != '(' ? " " : "", test_tag_name(event->tag));
+            break;
+        case PARSE_EVENT_LEAVE:
+            snprintf(piece, sizeof(piece), ")");
+            break;
+        case PARSE_EVENT_TOKEN:
+            snprintf(piece, sizeof(piece), " %.*s", event->end - event->start, t->buffer + event->start);
+            break;
+    }
+    size_t n = strlen(piece);
+    if (t->len + n < sizeof(t->out)) {
+        memcpy(t->out + t->len, piece, n + 1);
+        t->len += n;
+    }
+}
+
+static ParseResult parse_events(input_t* input, combinator_t* p, const char* text, event_trace* trace, parse_events_t* events) {
+    memset(trace, 0, sizeof(*trace));
+    memset(events, 0, sizeof(*events));
+    events->sink = trace_event;
+    events->context = trace;
+    free(input->buffer);
+    input->buffer = strdup(text);
+    input->length = strlen(text);
+    input->start = 0;
+    input->events = events;
+    trace->buffer = input->buffer;
+    return parse(input, p);
+}
+
+void test_event_sink(void) {
+    input_t* input = new_input();
+    event_trace trace;
+    parse_events_t events;
+
+    // The ADD alternative gets as far as "1" before failing; its events
+    // must not reach the sink.
+    combinator_t* choice = multi(new_combinator(), TEST_T_NONE,
+        seq(new_combinator(), TEST_T_ADD, integer(TEST_T_INT), match("+"), integer(TEST_T_INT), NULL),
+        seq(new_combinator(), TEST_T_SUB, integer(TEST_T_INT), match("-"), integer(TEST_T_INT), NULL),
+        NULL);
+    ParseResult res = parse_events(input, choice, "1-2", &trace, &events);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(res.value.ast == ast_nil);
+    TEST_CHECK(strcmp(trace.out, "(SUB 1 2)") == 0);
+    TEST_MSG("events: %s", trace.out);
+    TEST_CHECK(!input->recognize_only);
+
+    res = parse_events(input, choice, "1*2", &trace, &events);
+    TEST_CHECK(!res.is_success);
+    TEST_CHECK(trace.events == 0);
+    free_error(res.value.error);
+    free_combinator(choice);
+
+    combinator_t* expr_parser = new_combinator();
+    expr(expr_parser, integer(TEST_T_INT));
+    expr_insert(expr_parser, 0, TEST_T_ADD, EXPR_INFIX, ASSOC_LEFT, match("+"));
+    expr_altern(expr_parser, 0, TEST_T_SUB, match("-"));
+    expr_insert(expr_parser, 1, TEST_T_MUL, EXPR_INFIX, ASSOC_LEFT, match("*"));
+    res = parse_events(input, expr_parser, "1+2*3-4", &trace, &events);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(strcmp(trace.out, "(SUB (ADD 1 (MUL 2 3)) 4)") == 0);
+    TEST_MSG("events: %s", trace.out);
+    free_combinator(expr_parser);
+
+    // Finished repetitions reach the sink while the parse is running, so
+    // the journal stays small however long the input is.
+    combinator_t* stmts = many(seq(new_combinator(), TEST_T_ADD,
+        integer(TEST_T_INT), match("+"), integer(TEST_T_INT), match(";"), NULL));
+    const int reps = 10000;
+    char* text = (char*)safe_malloc(reps * 4 + 1);
+    for (int i = 0; i < reps; i++) memcpy(text + i * 4, "1+2;", 4);
+    text[reps * 4] = '\0';
+    res = parse_events(input, stmts, text, &trace, &events);
+    TEST_ASSERT(res.is_success);
+    TEST_CHECK(trace.events == (size_t)reps * 4);
+    TEST_CHECK(events.peak < 16);
+    TEST_MSG("journal peak: %zu", events.peak);
+    free(text);
+    free_combinator(stmts);
+
+    free(input->buffer);
+    free(input);
+}
+
 TEST_LIST = {
     { "pnot_combinator", test_pnot_combinator },
     { "peek_combinator", test_peek_combinator },
@@ -470,9 +1340,23 @@ TEST_LIST = {
     { "map_combinator", test_map_combinator },
     { "errmap_combinator", test_errmap_combinator },
     { "satisfy_combinator", test_satisfy_combinator },
+    { "skip_combinators", test_skip_combinators },
+    { "until_combinator", test_until_combinator },
+    { "integer_payload", test_integer_payload },
+    { "ast_arena", test_ast_arena },
     { "partial_ast_functionality", test_partial_ast_functionality },
     { "expression_parser_partial_ast", test_expression_parser_partial_ast },
     { "expression_parser_invalid_input", test_expression_parser_invalid_input },
     { "expression_parser_behavior", test_expression_parser_behavior },
+    { "flat_ast_round_trip", test_flat_ast_round_trip },
+    { "embedded_nul_round_trip", test_embedded_nul_round_trip },
+    { "combinator_interning", test_combinator_interning },
+    { "self_referencing_grammar", test_self_referencing_grammar },
+    { "combinator_names", test_combinator_names },
+    { "commit_combinator", test_commit_combinator },
+    { "parse_limits", test_parse_limits },
+    { "deep_input", test_deep_input },
+    { "recognize_only", test_recognize_only },
+    { "event_sink", test_event_sink },
     { NULL, NULL }
 };